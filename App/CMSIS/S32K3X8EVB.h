@@ -44,62 +44,149 @@
 #endif
 
 /******************************************************************************/
-/*                          Timer Register declaration                        */
+/*                           PIT Register declaration                         */
 /******************************************************************************/
 
 typedef struct
 {
-  __IO uint32_t CTRL;             // Offset: 0x000 (R/W)  Control Register
-  __IO uint32_t VALUE;            // Offset: 0x004 (R/W)  Current Value Register
-  __IO uint32_t RELOAD;           // Offset: 0x008 (R/W)  Reload Value Register
-  __IO uint32_t INTCLR;           // Offset: 0x00C ( /W)  Interrupt Clear Register
-  __I  uint32_t RIS;              // Offset: 0x010 (R/ )  Raw Interrupt Status Register
-  __I  uint32_t MIS;              // Offset: 0x014 (R/ )  Masked Interrupt Status Register
-  __IO uint32_t BGLOAD;           // Offset: 0x018 (R/W)  Background Load Register
-} S32K3X8_TIMER_TypeDef;
+  __IO uint32_t LDVAL;            // Offset: 0x000 (R/W)  Timer Load Value Register
+  __I  uint32_t CVAL;             // Offset: 0x004 (R/ )  Current Timer Value Register
+  __IO uint32_t TCTRL;            // Offset: 0x008 (R/W)  Timer Control Register
+  __IO uint32_t TFLG;             // Offset: 0x00C (R/W)  Timer Flag Register
+} S32K3X8_PIT_CHANNEL_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t MCR;              // Offset: 0x000 (R/W)  Module Control Register
+       uint32_t RESERVED0[55];
+  __I  uint32_t LTMR64H;          // Offset: 0x0E0 (R/ )  Upper Lifetime Timer Register
+  __I  uint32_t LTMR64L;          // Offset: 0x0E4 (R/ )  Lower Lifetime Timer Register
+       uint32_t RESERVED1[6];
+  S32K3X8_PIT_CHANNEL_TypeDef CH[4]; // Offset: 0x100    Timer Channel n Registers
+} S32K3X8_PIT_TypeDef;
+
+/******************************************************************************/
+/*                          eDMA Register declaration                         */
+/******************************************************************************/
+
+typedef struct
+{
+  __IO uint32_t CH_CSR;           // Offset: 0x000 (R/W)  Channel Control and Status Register
+  __IO uint32_t CH_ES;            // Offset: 0x004 (R/W)  Channel Error Status Register
+  __IO uint32_t CH_INT;           // Offset: 0x008 (R/W)  Channel Interrupt Status Register
+  __IO uint32_t CH_SBR;           // Offset: 0x00C (R/W)  Channel System Bus Register
+  __IO uint32_t CH_PRI;           // Offset: 0x010 (R/W)  Channel Priority Register
+       uint32_t RESERVED0[3];
+  __IO uint32_t TCD_SADDR;        // Offset: 0x020 (R/W)  TCD Source Address
+  __IO uint16_t TCD_SOFF;         // Offset: 0x024 (R/W)  TCD Signed Source Address Offset
+  __IO uint16_t TCD_ATTR;         // Offset: 0x026 (R/W)  TCD Transfer Attributes
+  __IO uint32_t TCD_NBYTES;       // Offset: 0x028 (R/W)  TCD Minor Loop Byte Count
+  __IO uint32_t TCD_SLAST_SDA;    // Offset: 0x02C (R/W)  TCD Last Source Address Adjustment
+  __IO uint32_t TCD_DADDR;        // Offset: 0x030 (R/W)  TCD Destination Address
+  __IO uint16_t TCD_DOFF;         // Offset: 0x034 (R/W)  TCD Signed Destination Address Offset
+  __IO uint16_t TCD_CITER;        // Offset: 0x036 (R/W)  TCD Current Major Loop Count
+  __IO uint32_t TCD_DLAST_SGA;    // Offset: 0x038 (R/W)  TCD Last Destination Address Adjustment / Scatter Gather Address
+  __IO uint16_t TCD_CSR;          // Offset: 0x03C (R/W)  TCD Control and Status
+  __IO uint16_t TCD_BITER;        // Offset: 0x03E (R/W)  TCD Beginning Major Loop Count
+} S32K3X8_EDMA_CH_TypeDef;
+
+/******************************************************************************/
+/*                         DMAMUX Register declaration                        */
+/******************************************************************************/
+
+typedef struct
+{
+  __IO uint8_t CHCFG[16];         // Offset: 0x000 (R/W)  Channel Configuration Registers, see DMAMUX_CHCFG_IDX
+} S32K3X8_DMAMUX_TypeDef;
 
 /******************************************************************************/
 /*                           Peripheral memory map                            */
 /******************************************************************************/
-#define S32K3X8_TIMER0_BASE       (0x40037000UL)  // Timer 0 base address
-#define S32K3X8_TIMER1_BASE       (0x40038000UL)  // Timer 1 base address
-#define S32K3X8_TIMER2_BASE       (0x40039000UL)  // Timer 2 base address 
+#define S32K3X8_PIT0_BASE         (0x40037000UL)  // PIT 0 base address
+#define S32K3X8_PIT1_BASE         (0x40038000UL)  // PIT 1 base address
+#define S32K3X8_PIT2_BASE         (0x40039000UL)  // PIT 2 base address
+
+#define S32K3X8_EDMA_CH0_BASE     (0x40210000UL)  // eDMA channel 0 base address
+#define S32K3X8_DMAMUX0_BASE      (0x40280000UL)  // DMAMUX 0 base address (eDMA channels 0-15)
+
+#define S32K3X8_MSCM_BASE         (0x40260000UL)  // MSCM base address (per-core CPU configuration)
 
 /******************************************************************************/
 /*                           Peripheral declaration                           */
 /******************************************************************************/
-#define S32K3X8_TIMER0            ((S32K3X8_TIMER_TypeDef *) S32K3X8_TIMER0_BASE)
-#define S32K3X8_TIMER1            ((S32K3X8_TIMER_TypeDef *) S32K3X8_TIMER1_BASE)
-#define S32K3X8_TIMER2            ((S32K3X8_TIMER_TypeDef *) S32K3X8_TIMER2_BASE)
+#define S32K3X8_PIT0              ((S32K3X8_PIT_TypeDef *) S32K3X8_PIT0_BASE)
+#define S32K3X8_PIT1              ((S32K3X8_PIT_TypeDef *) S32K3X8_PIT1_BASE)
+#define S32K3X8_PIT2              ((S32K3X8_PIT_TypeDef *) S32K3X8_PIT2_BASE)
+
+#define S32K3X8_EDMA_CH0          ((S32K3X8_EDMA_CH_TypeDef *) S32K3X8_EDMA_CH0_BASE)
+#define S32K3X8_DMAMUX0           ((S32K3X8_DMAMUX_TypeDef *) S32K3X8_DMAMUX0_BASE)
+
+/* Logical number of the core reading the register (0 for the boot core) */
+#define S32K3X8_MSCM_CPXNUM       (*(volatile uint32_t *)(S32K3X8_MSCM_BASE + 0x004))
+
+/******************************************************************************/
+/*                     PIT Module Control Register Definitions                */
+/******************************************************************************/
+#define PIT_MCR_FRZ_Pos           0
+#define PIT_MCR_FRZ_Msk           (1UL << PIT_MCR_FRZ_Pos)
+
+#define PIT_MCR_MDIS_Pos          1
+#define PIT_MCR_MDIS_Msk          (1UL << PIT_MCR_MDIS_Pos)
 
 /******************************************************************************/
-/*                     Timer Control Register Definitions                     */
+/*                    PIT Timer Control Register Definitions                  */
 /******************************************************************************/
-#define TIMER_CTRL_ENABLE_Pos     0
-#define TIMER_CTRL_ENABLE_Msk     (1UL << TIMER_CTRL_ENABLE_Pos)
+#define PIT_TCTRL_TEN_Pos         0
+#define PIT_TCTRL_TEN_Msk         (1UL << PIT_TCTRL_TEN_Pos)
+
+#define PIT_TCTRL_TIE_Pos         1
+#define PIT_TCTRL_TIE_Msk         (1UL << PIT_TCTRL_TIE_Pos)
 
-#define TIMER_CTRL_MODE_Pos       1
-#define TIMER_CTRL_MODE_Msk       (1UL << TIMER_CTRL_MODE_Pos)
+#define PIT_TCTRL_CHN_Pos         2
+#define PIT_TCTRL_CHN_Msk         (1UL << PIT_TCTRL_CHN_Pos)
 
-#define TIMER_CTRL_INTEN_Pos      2
-#define TIMER_CTRL_INTEN_Msk      (1UL << TIMER_CTRL_INTEN_Pos)
+/******************************************************************************/
+/*                      PIT Timer Flag Register Definitions                   */
+/******************************************************************************/
+#define PIT_TFLG_TIF_Pos          0
+#define PIT_TFLG_TIF_Msk          (1UL << PIT_TFLG_TIF_Pos)
 
 /******************************************************************************/
-/*                 Timer Interrupt Clear Register Definitions                 */
+/*                  eDMA Channel Control and Status Definitions               */
 /******************************************************************************/
-#define TIMER_INTCLR_Pos          0
-#define TIMER_INTCLR_Msk          (1UL << TIMER_INTCLR_Pos)
+#define EDMA_CH_CSR_ERQ_Pos       0
+#define EDMA_CH_CSR_ERQ_Msk       (1UL << EDMA_CH_CSR_ERQ_Pos)
+
+#define EDMA_CH_CSR_DONE_Pos      30
+#define EDMA_CH_CSR_DONE_Msk      (1UL << EDMA_CH_CSR_DONE_Pos)
 
 /******************************************************************************/
-/*               Timer Raw Interrupt Status Register Definitions              */
+/*                          eDMA TCD Field Definitions                        */
 /******************************************************************************/
-#define TIMER_RIS_Pos             0
-#define TIMER_RIS_Msk             (1UL << TIMER_RIS_Pos)
+#define EDMA_TCD_ATTR_DSIZE_Pos   0
+#define EDMA_TCD_ATTR_SSIZE_Pos   8
+#define EDMA_TCD_ATTR_SIZE_8BIT   0
+
+#define EDMA_TCD_CSR_START_Pos    0
+#define EDMA_TCD_CSR_START_Msk    (1UL << EDMA_TCD_CSR_START_Pos)
+
+#define EDMA_TCD_CSR_INTMAJOR_Pos 1
+#define EDMA_TCD_CSR_INTMAJOR_Msk (1UL << EDMA_TCD_CSR_INTMAJOR_Pos)
+
+#define EDMA_TCD_CSR_DREQ_Pos     3
+#define EDMA_TCD_CSR_DREQ_Msk     (1UL << EDMA_TCD_CSR_DREQ_Pos)
 
 /******************************************************************************/
-/*             Timer Masked Interrupt Status Register Definitions             */
+/*                       DMAMUX Channel Config Definitions                    */
 /******************************************************************************/
-#define TIMER_MIS_Pos             0
-#define TIMER_MIS_Msk             (1UL << TIMER_MIS_Pos)
+#define DMAMUX_CHCFG_ENBL_Pos     7
+#define DMAMUX_CHCFG_ENBL_Msk     (1UL << DMAMUX_CHCFG_ENBL_Pos)
+
+/* CHCFG registers are byte-swapped within each word: CHCFG0 is at offset 3 */
+#define DMAMUX_CHCFG_IDX(ch)      (((ch) & ~3) | (3 - ((ch) & 3)))
+
+/* DMAMUX0 request sources */
+#define DMAMUX_SRC_LPUART0_RX     2
+#define DMAMUX_SRC_LPUART0_TX     3
 
 #endif /* __S32K3X8EVB_H */
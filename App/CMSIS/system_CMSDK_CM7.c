@@ -49,6 +49,8 @@
 
 #include <stdint.h>
 
+#include "mpu_setup.h"
+
 /*----------------------------------------------------------------------------
   Define clocks
  *----------------------------------------------------------------------------*/
@@ -102,6 +104,9 @@ void SystemInit(void)
     SCB->CCR |= SCB_CCR_UNALIGN_TRP_Msk;
 #endif
 
+    /* Set the cacheability of the memory map, then enable the L1 caches */
+    vSetupMemoryAttributes();
+
     SystemCoreClock = __SYSTEM_CLOCK;
 
 }
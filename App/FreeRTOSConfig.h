@@ -36,9 +36,16 @@
     #define __NVIC_PRIO_BITS 4  /* Cortex-M7 uses 4 priority bits */
 #endif
 
-/* Trace and runtime stats configuration */
-#define configUSE_TRACE_FACILITY                 0
-#define configGENERATE_RUN_TIME_STATS            0
+/* Trace and runtime stats configuration: the run-time counter is the PIT0 lifetime timer, see RunTimeStats.c */
+#define configUSE_TRACE_FACILITY                 1
+#define configGENERATE_RUN_TIME_STATS            1
+#define configRUN_TIME_COUNTER_TYPE              uint64_t
+#ifndef __IASMARM__
+    extern void vConfigureRunTimeCounter( void );
+    extern uint64_t ullGetRunTimeCounter( void );
+    #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    vConfigureRunTimeCounter()
+    #define portGET_RUN_TIME_COUNTER_VALUE()            ullGetRunTimeCounter()
+#endif
 
 /* Scheduler configuration */
 #define configUSE_PREEMPTION                     1
@@ -47,11 +54,19 @@
 #define configCPU_CLOCK_HZ                       ( ( unsigned long ) 240000000 )
 #define configTICK_RATE_HZ                       ( ( TickType_t ) 1000 )
 #define configMINIMAL_STACK_SIZE                 ( ( unsigned short ) 160 )
-#define configTOTAL_HEAP_SIZE                    ( ( size_t ) ( 16 * 1024 ) )
+#define configTOTAL_HEAP_SIZE                    ( ( size_t ) ( 16 * 1024 ) )   /* Unused by heap_5, see memory_map.c */
 #define configMAX_TASK_NAME_LEN                  ( 12 )
 #define configUSE_16_BIT_TICKS                   0
 #define configIDLE_SHOULD_YIELD                  0
 
+/* Tickless idle: SysTick is stopped and PIT2 wakes the core up, see TicklessIdle.c */
+#define configUSE_TICKLESS_IDLE                  2
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP    2
+#ifndef __IASMARM__
+    extern void vApplicationSleep( uint32_t xExpectedIdleTime );
+    #define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vApplicationSleep( xExpectedIdleTime )
+#endif
+
 /* Co-routine configuration */
 #define configUSE_CO_ROUTINES                    0
 #define configMAX_CO_ROUTINE_PRIORITIES          ( 2 )
@@ -103,7 +118,8 @@
 
 /* Interrupt priority configuration */
 #define configKERNEL_INTERRUPT_PRIORITY          ( 255 )  /* Lowest priority for kernel interrupt */
-#define configMAX_SYSCALL_INTERRUPT_PRIORITY     ( 5 << (8 - __NVIC_PRIO_BITS) )  /* NVIC priority level */
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY  ( 5 )  /* Same level, unshifted, for NVIC_SetPriority() */
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY     ( configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY << (8 - __NVIC_PRIO_BITS) )  /* NVIC priority level */
 
 #ifndef __IASMARM__
     #define configASSERT( x ) if( ( x ) == 0 ) while(1);
@@ -142,9 +158,9 @@
 /* Dynamic memory allocation configuration */
 #define configSUPPORT_DYNAMIC_ALLOCATION                1
 
-/* Static memory allocation configuration */
-#define configSUPPORT_STATIC_ALLOCATION                 0
-#define configUSE_STATIC_ALLOCATION                     0
+/* Static memory allocation configuration: the hot tasks live in DTCM, see memory_map.h */
+#define configSUPPORT_STATIC_ALLOCATION                 1
+#define configUSE_STATIC_ALLOCATION                     1
 // #define portHAS_STACK_OVERFLOW_CHECKING                 1
 
 /* Privilege level configuration */
@@ -0,0 +1,264 @@
+/*
+ * libFuzzer driver of the s32k3x8evb fuzzing harness
+ *
+ * Runs on the host, built with "clang -fsanitize=fuzzer" by "make qemu_fuzz".
+ * It starts one QEMU for the whole campaign (the command line comes from
+ * S32K3_FUZZ_QEMU), connected to it by the "fuzz" chardev, and with the
+ * edgecov plugin (S32K3_FUZZ_PLUGIN) counting the edges of the firmware in
+ * a map shared through /dev/shm. For every input, QEMU rewinds the
+ * firmware to the snapshot taken after boot, feeds the input to LPUART0
+ * and to the PITs, and tells whether a core faulted; the edge counters go
+ * to libFuzzer as extra counters. The format of the inputs and the
+ * protocol are described in qemu/hw/arm/s32k3x8evb_fuzz.c.
+ *
+ * A fault, or QEMU dying (e.g. on a lockup), is reported to libFuzzer as
+ * a crash with abort(), which saves the input as crash-<sha1>.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Layout of the map of contrib/plugins/edgecov.c */
+#define fuzzMAP_SIZE            ( 64 * 1024 )
+#define fuzzMAP_MAX_VCPUS       16
+#define fuzzMAP_FILE_SIZE       ( fuzzMAP_SIZE + fuzzMAP_MAX_VCPUS * sizeof( uint32_t ) )
+
+/* From qemu/include/hw/arm/s32k3x8evb_fuzz.h */
+#define fuzzREADY               0x46323353u
+#define fuzzSTATUS_FAULT        ( 1u << 0 )
+
+/* Counters libFuzzer picks up on its own, next to the ones of the driver */
+__attribute__( ( section( "__libfuzzer_extra_counters" ) ) )
+static uint8_t ucEdgeCounters[ fuzzMAP_SIZE ];
+
+static uint8_t *pucMap;
+static int xSocket = -1;
+static pid_t xQemuPid = -1;
+static char cMapPath[ 64 ];
+static char cDir[ 64 ];
+static char cSocketPath[ 128 ];
+
+/*-----------------------------------------------------------*/
+
+static int prvReadAll( int fd, void *pvBuf, size_t xSize )
+{
+    uint8_t *pucBuf = pvBuf;
+
+    while( xSize > 0 )
+    {
+        ssize_t xRet = read( fd, pucBuf, xSize );
+
+        if( xRet <= 0 )
+        {
+            return -1;
+        }
+        pucBuf += xRet;
+        xSize -= ( size_t ) xRet;
+    }
+    return 0;
+}
+
+static int prvWriteAll( int fd, const void *pvBuf, size_t xSize )
+{
+    const uint8_t *pucBuf = pvBuf;
+
+    while( xSize > 0 )
+    {
+        ssize_t xRet = write( fd, pucBuf, xSize );
+
+        if( xRet <= 0 )
+        {
+            return -1;
+        }
+        pucBuf += xRet;
+        xSize -= ( size_t ) xRet;
+    }
+    return 0;
+}
+
+static void prvPutLE32( uint8_t *pucBuf, uint32_t ulValue )
+{
+    pucBuf[ 0 ] = ( uint8_t ) ulValue;
+    pucBuf[ 1 ] = ( uint8_t ) ( ulValue >> 8 );
+    pucBuf[ 2 ] = ( uint8_t ) ( ulValue >> 16 );
+    pucBuf[ 3 ] = ( uint8_t ) ( ulValue >> 24 );
+}
+
+static uint32_t prvGetLE32( const uint8_t *pucBuf )
+{
+    return ( uint32_t ) pucBuf[ 0 ] | ( ( uint32_t ) pucBuf[ 1 ] << 8 ) |
+           ( ( uint32_t ) pucBuf[ 2 ] << 16 ) | ( ( uint32_t ) pucBuf[ 3 ] << 24 );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Tell why QEMU went away, then let libFuzzer save the input */
+static void prvQemuLost( void )
+{
+    int xStatus;
+
+    if( xQemuPid > 0 && waitpid( xQemuPid, &xStatus, 0 ) == xQemuPid )
+    {
+        if( WIFSIGNALED( xStatus ) )
+        {
+            fprintf( stderr, "fuzz: QEMU killed by signal %d\n", WTERMSIG( xStatus ) );
+        }
+        else
+        {
+            fprintf( stderr, "fuzz: QEMU exited with status %d\n", WEXITSTATUS( xStatus ) );
+        }
+        xQemuPid = -1;
+    }
+    abort();
+}
+
+static void prvCleanup( void )
+{
+    if( xQemuPid > 0 )
+    {
+        kill( xQemuPid, SIGKILL );
+        waitpid( xQemuPid, NULL, 0 );
+    }
+    unlink( cSocketPath );
+    rmdir( cDir );
+    unlink( cMapPath );
+}
+
+static void prvFatal( const char *pcMessage )
+{
+    perror( pcMessage );
+    exit( 1 );
+}
+
+/*-----------------------------------------------------------*/
+
+int LLVMFuzzerInitialize( int *argc, char ***argv )
+{
+    const char *pcQemu = getenv( "S32K3_FUZZ_QEMU" );
+    const char *pcPlugin = getenv( "S32K3_FUZZ_PLUGIN" );
+    struct sockaddr_un xAddr = { .sun_family = AF_UNIX };
+    uint8_t ucReady[ 4 ];
+    char *pcCommand;
+    int xListen, fd;
+
+    ( void ) argc;
+    ( void ) argv;
+
+    if( pcQemu == NULL || pcPlugin == NULL )
+    {
+        fprintf( stderr, "fuzz: S32K3_FUZZ_QEMU and S32K3_FUZZ_PLUGIN must be set, see \"make qemu_fuzz\"\n" );
+        exit( 1 );
+    }
+
+    /* Write errors are reported by prvWriteAll() when QEMU dies */
+    signal( SIGPIPE, SIG_IGN );
+    atexit( prvCleanup );
+
+    /* Coverage map shared with the edgecov plugin */
+    snprintf( cMapPath, sizeof( cMapPath ), "/dev/shm/s32k3-fuzz-%d", ( int ) getpid() );
+    fd = open( cMapPath, O_RDWR | O_CREAT | O_TRUNC, 0600 );
+    if( fd < 0 || ftruncate( fd, fuzzMAP_FILE_SIZE ) < 0 )
+    {
+        prvFatal( "fuzz: coverage map" );
+    }
+    pucMap = mmap( NULL, fuzzMAP_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( pucMap == MAP_FAILED )
+    {
+        prvFatal( "fuzz: coverage map" );
+    }
+
+    /* QEMU connects to the driver, so that it is listening before QEMU starts */
+    strcpy( cDir, "/tmp/s32k3-fuzz-XXXXXX" );
+    if( mkdtemp( cDir ) == NULL )
+    {
+        prvFatal( "fuzz: socket directory" );
+    }
+    snprintf( cSocketPath, sizeof( cSocketPath ), "%s/fuzz.sock", cDir );
+    strncpy( xAddr.sun_path, cSocketPath, sizeof( xAddr.sun_path ) - 1 );
+    xListen = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( xListen < 0 ||
+        bind( xListen, ( struct sockaddr * ) &xAddr, sizeof( xAddr ) ) < 0 ||
+        listen( xListen, 1 ) < 0 )
+    {
+        prvFatal( "fuzz: socket" );
+    }
+
+    if( asprintf( &pcCommand, "exec %s -chardev socket,id=fuzz,path=%s -plugin %s,map=%s",
+                  pcQemu, cSocketPath, pcPlugin, cMapPath ) < 0 )
+    {
+        prvFatal( "fuzz: command line" );
+    }
+    fprintf( stderr, "fuzz: starting %s\n", pcCommand );
+
+    xQemuPid = fork();
+    if( xQemuPid == 0 )
+    {
+        close( xListen );
+        execl( "/bin/sh", "sh", "-c", pcCommand, ( char * ) NULL );
+        _exit( 127 );
+    }
+    if( xQemuPid < 0 )
+    {
+        prvFatal( "fuzz: fork" );
+    }
+    free( pcCommand );
+
+    xSocket = accept( xListen, NULL, NULL );
+    close( xListen );
+    if( xSocket < 0 )
+    {
+        prvFatal( "fuzz: accept" );
+    }
+
+    /* QEMU boots the firmware and takes the snapshot first */
+    if( prvReadAll( xSocket, ucReady, sizeof( ucReady ) ) < 0 ||
+        prvGetLE32( ucReady ) != fuzzREADY )
+    {
+        fprintf( stderr, "fuzz: QEMU did not get ready\n" );
+        exit( 1 );
+    }
+
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput( const uint8_t *pucData, size_t xSize )
+{
+    uint8_t ucHeader[ 4 ];
+    uint8_t ucReply[ 12 ];
+    uint32_t ulStatus;
+
+    /* Also forgets the last block of the previous input */
+    memset( pucMap, 0, fuzzMAP_FILE_SIZE );
+
+    prvPutLE32( ucHeader, ( uint32_t ) xSize );
+    if( prvWriteAll( xSocket, ucHeader, sizeof( ucHeader ) ) < 0 ||
+        prvWriteAll( xSocket, pucData, xSize ) < 0 ||
+        prvReadAll( xSocket, ucReply, sizeof( ucReply ) ) < 0 )
+    {
+        prvQemuLost();
+    }
+
+    memcpy( ucEdgeCounters, pucMap, fuzzMAP_SIZE );
+
+    ulStatus = prvGetLE32( &ucReply[ 0 ] );
+    if( ulStatus & fuzzSTATUS_FAULT )
+    {
+        fprintf( stderr, "fuzz: fault, CFSR 0x%08x HFSR 0x%08x\n",
+                 prvGetLE32( &ucReply[ 4 ] ), prvGetLE32( &ucReply[ 8 ] ) );
+        abort();
+    }
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+
+/* MPU includes */
+#include "memory_map.h"
+
+/* Bounds of the SRAM left free by the linker, see s32_linker.ld */
+extern uint8_t _heap_sram0_start[], _heap_sram0_end[];
+extern uint8_t _heap_sram1_start[], _heap_sram1_end[];
+extern uint8_t _heap_sram2_start[], _heap_sram2_end[];
+
+void vSetupHeapRegions( void )
+{
+    /* heap_5 wants them in ascending address order, terminated by an empty region */
+    static HeapRegion_t xHeapRegions[ 4 ];
+
+    xHeapRegions[ 0 ].pucStartAddress = _heap_sram0_start;
+    xHeapRegions[ 0 ].xSizeInBytes = ( size_t ) ( _heap_sram0_end - _heap_sram0_start );
+    xHeapRegions[ 1 ].pucStartAddress = _heap_sram1_start;
+    xHeapRegions[ 1 ].xSizeInBytes = ( size_t ) ( _heap_sram1_end - _heap_sram1_start );
+    xHeapRegions[ 2 ].pucStartAddress = _heap_sram2_start;
+    xHeapRegions[ 2 ].xSizeInBytes = ( size_t ) ( _heap_sram2_end - _heap_sram2_start );
+    xHeapRegions[ 3 ].pucStartAddress = NULL;
+    xHeapRegions[ 3 ].xSizeInBytes = 0;
+
+    vPortDefineHeapRegions( xHeapRegions );
+}
@@ -0,0 +1,23 @@
+#ifndef MEMORY_MAP_H
+#define MEMORY_MAP_H
+
+/*
+ * Placement of the FreeRTOS objects in the memories of the S32K3 (see
+ * s32_linker.ld):
+ *
+ *  - the TCBs and stacks of the hot tasks are allocated statically in DTCM,
+ *    which the core reads without wait states and without the cache;
+ *  - everything created dynamically comes from heap_5, whose regions span
+ *    the SRAM blocks left free by the linker;
+ *  - large tables that are seldom touched go to SRAM with SRAM_NOINIT.
+ *
+ * Neither section is cleared by Reset_Handler: the objects placed there
+ * must be initialised by their owner (xTaskCreateStatic(), vPoolInit()...).
+ */
+#define DTCM_NOINIT     __attribute__( ( section( ".dtcm_noinit" ) ) )
+#define SRAM_NOINIT     __attribute__( ( section( ".sram_noinit" ) ) )
+
+/* Hand the SRAM blocks to heap_5, before the first object is created */
+void vSetupHeapRegions( void );
+
+#endif /* MEMORY_MAP_H */
@@ -1,81 +1,102 @@
 /*-----------------------------------------------------------------------------------------*/
-/* mpu_setup.c - Cortex-M7 MPU Port Layer for FreeRTOS                                     */
+/* mpu_setup.c - Cortex-M7 memory attributes and L1 cache management                       */
 /*-----------------------------------------------------------------------------------------*/
 
+#include "mpu_setup.h"
+
+/* FreeRTOS includes */
 #include "FreeRTOS.h"
-#include "task.h"
-#include <stdint.h>
 
-/* Cortex-M7 MPU Register Addresses (CMSIS standard) */
-#define MPU_TYPE         (*(volatile uint32_t*)0xE000ED90)
-#define MPU_CTRL         (*(volatile uint32_t*)0xE000ED94)
-#define MPU_RNR          (*(volatile uint32_t*)0xE000ED98)
-#define MPU_RBAR         (*(volatile uint32_t*)0xE000ED9C)
-#define MPU_RASR         (*(volatile uint32_t*)0xE000EDA0)
+/* Library includes. */
+#include "S32K3X8EVB.h"
+
+/* Size of a D-cache line, the granule of the maintenance operations */
+#define mpuCACHE_LINE_SIZE      32UL
+
+/* Attributes of the regions below */
+#define mpuNORMAL_WB            ARM_MPU_ACCESS_NORMAL( ARM_MPU_CACHEP_WB_WRA, ARM_MPU_CACHEP_WB_WRA, 0U )
+#define mpuNORMAL_NOCACHE       ARM_MPU_ACCESS_NORMAL( ARM_MPU_CACHEP_NOCACHE, ARM_MPU_CACHEP_NOCACHE, 0U )
+#define mpuDEVICE               ARM_MPU_ACCESS_DEVICE( 1U )
+
+/*
+ * Memory map of the S32K3, lowest priority first: a region overrides the ones
+ * above it where they overlap. Addresses that no region covers (holes, UTEST,
+ * the PPB) keep the default memory map, which stays enabled for privileged
+ * code; all the FreeRTOS tasks run privileged with this port.
+ *
+ * Flash and SRAM go through the L1 caches. The TCMs are never cached by the
+ * core, they are marked non-cacheable so that the MPU agrees with it, and so
+ * are their backdoor addresses, which the stack and the eDMA use.
+ */
+static const ARM_MPU_Region_t xRegions[] =
+{
+    /* PFLASH blocks 0-3, 0x00400000-0x00BFFFFF: 2 MB subregions 2-5 of a 16 MB region */
+    { ARM_MPU_RBAR( 0, 0x00000000UL ),
+      ARM_MPU_RASR_EX( 0U, ARM_MPU_AP_RO, mpuNORMAL_WB, 0xC3U, ARM_MPU_REGION_SIZE_16MB ) },
+
+    /* ITCM of the core, holding the vector table and the hot code */
+    { ARM_MPU_RBAR( 1, 0x00000000UL ),
+      ARM_MPU_RASR_EX( 0U, ARM_MPU_AP_FULL, mpuNORMAL_NOCACHE, 0x00U, ARM_MPU_REGION_SIZE_64KB ) },
+
+    /* ITCM backdoors of the three cores */
+    { ARM_MPU_RBAR( 2, 0x11000000UL ),
+      ARM_MPU_RASR_EX( 0U, ARM_MPU_AP_FULL, mpuNORMAL_NOCACHE, 0x00U, ARM_MPU_REGION_SIZE_16MB ) },
+
+    /* DFLASH */
+    { ARM_MPU_RBAR( 3, 0x10000000UL ),
+      ARM_MPU_RASR_EX( 1U, ARM_MPU_AP_RO, mpuNORMAL_WB, 0x00U, ARM_MPU_REGION_SIZE_128KB ) },
+
+    /* DTCM of the core: .data, .bss and the static tasks (memory_map.h) */
+    { ARM_MPU_RBAR( 4, 0x20000000UL ),
+      ARM_MPU_RASR_EX( 1U, ARM_MPU_AP_FULL, mpuNORMAL_NOCACHE, 0x00U, ARM_MPU_REGION_SIZE_128KB ) },
 
-/* MPU Region Numbers */
-#define MAIN_FLASH_REGION    0
-#define SRAM_REGION          1
-#define PERIPHERALS_REGION   2
+    /* DTCM backdoors of the three cores, the main stack is in the one of core 2 */
+    { ARM_MPU_RBAR( 5, 0x21000000UL ),
+      ARM_MPU_RASR_EX( 1U, ARM_MPU_AP_FULL, mpuNORMAL_NOCACHE, 0x00U, ARM_MPU_REGION_SIZE_16MB ) },
 
-/* MPU Settings */
-#define MPU_ENABLE              (1UL << 0)
-#define MPU_PRIVILEGED_DEFAULT  (1UL << 2)
+    /* SRAM, 0x20400000-0x204BFFFF, the FreeRTOS heap: 128 KB subregions 0-5 of a 1 MB region */
+    { ARM_MPU_RBAR( 6, 0x20400000UL ),
+      ARM_MPU_RASR_EX( 1U, ARM_MPU_AP_FULL, mpuNORMAL_WB, 0xC0U, ARM_MPU_REGION_SIZE_1MB ) },
+
+    /* Peripherals */
+    { ARM_MPU_RBAR( 7, 0x40000000UL ),
+      ARM_MPU_RASR_EX( 1U, ARM_MPU_AP_FULL, mpuDEVICE, 0x00U, ARM_MPU_REGION_SIZE_512MB ) },
+};
 
 /*-----------------------------------------------------------------------------------------*/
 
-void vPortSetupMPU(void) 
+void vSetupMemoryAttributes(void)
 {
-    /* Disable MPU during configuration */
-    MPU_CTRL = 0;
-
-    /*--------------------------------------------------------
-     * Region 0: Flash Memory (Execute + Read-Only)
-     * Base: 0x00400000 (PFLASH), Size: 8MB
-     *--------------------------------------------------------*/
-    MPU_RNR = MAIN_FLASH_REGION;
-    MPU_RBAR = 0x00400000 | (MAIN_FLASH_REGION << 8) | (1UL << 4);  // VALID=1
-    MPU_RASR = (0x16UL << 1)  |  // SIZE=8MB (log2(8M)-1=23 → TEX=0, S=1, C=1, B=0)
-               (0x03UL << 24) |  // XN=0, AP=011 (Privileged RW, Unprivileged RO)
-               (1UL << 0);       // ENABLE
-
-               
-
-    /*---------------------------------------------------------
-     * Region 1: DTCM/SRAM (Full Access)
-     * Base: 0x20000000 (DTCM0), Size: 128KB
-     *--------------------------------------------------------*/
-    MPU_RNR = SRAM_REGION;
-    MPU_RBAR = 0x20000000 | (SRAM_REGION << 8) | (1UL << 4);  // VALID=1
-    MPU_RASR = (0x10UL << 1)  |  // SIZE=128KB (log2(128K)-1=17)
-               (0x03UL << 24) |  // AP=011 (RW for privileged, RO for unprivileged)
-               (1UL << 0);       // ENABLE
-
-    /*---------------------------------------------------------
-     * Region 2: Peripherals (Privileged Access Only)
-     * Base: 0x40000000, Size: 512MB
-     *--------------------------------------------------------*/
-    MPU_RNR = PERIPHERALS_REGION;
-    MPU_RBAR = 0x40000000 | (PERIPHERALS_REGION << 8) | (1UL << 4);  // VALID=1
-    MPU_RASR = (0x1CUL << 1)  |  // SIZE=512MB (log2(512M)-1=28)
-               (0x01UL << 24) |  // AP=001 (Privileged RW only)
-               (1UL << 0);       // ENABLE
-
-    /* Enable MPU with default privileged access */
-    MPU_CTRL = MPU_ENABLE | MPU_PRIVILEGED_DEFAULT;
-    __asm volatile("dsb");
-    __asm volatile("isb");
-}
+    uint32_t ulNumRegions = sizeof(xRegions) / sizeof(xRegions[0]);
+    uint32_t ulMaxRegions = (MPU->TYPE & MPU_TYPE_DREGION_Msk) >> MPU_TYPE_DREGION_Pos;
 
+    /* Called once from SystemInit(), while both caches are still disabled */
+    ARM_MPU_Disable();
+    ARM_MPU_Load(xRegions, ulNumRegions);
+    for (uint32_t i = ulNumRegions; i < ulMaxRegions; i++) {
+        ARM_MPU_ClrRegion(i);
+    }
+    ARM_MPU_Enable(MPU_CTRL_PRIVDEFENA_Msk);
+
+    /* Both calls invalidate the whole cache before turning it on */
+    SCB_EnableICache();
+    SCB_EnableDCache();
+}
 
 /*-----------------------------------------------------------------------------------------*/
 
-/* Enable MPU in privileged mode before starting scheduler */
-void vPortEnterPrivileged(void) 
+void vCacheCleanForDMA(const volatile void *pvAddress, uint32_t ulSize)
 {
-    __asm volatile("mrs r0, control  \n"
-                   "bic r0, #1       \n"
-                   "msr control, r0  \n"
-                   "dsb             \n"
-                   "isb             \n");
+    /* Write back the lines the eDMA is about to read */
+    SCB_CleanDCache_by_Addr((volatile void *)pvAddress, (int32_t)ulSize);
+}
+
+void vCacheInvalidateForDMA(volatile void *pvAddress, uint32_t ulSize)
+{
+    /* Invalidating a partial line would also drop the neighbouring data */
+    configASSERT(((uint32_t)pvAddress % mpuCACHE_LINE_SIZE) == 0);
+    configASSERT((ulSize % mpuCACHE_LINE_SIZE) == 0);
+
+    /* Drop the stale lines so that the CPU reads what the eDMA wrote */
+    SCB_InvalidateDCache_by_Addr(pvAddress, (int32_t)ulSize);
 }
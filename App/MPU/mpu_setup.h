@@ -0,0 +1,23 @@
+#ifndef MPU_SETUP_H
+#define MPU_SETUP_H
+
+#include <stdint.h>
+
+/*
+ * Program the MPU with the memory map of the S32K3 and enable the L1 caches:
+ * flash and SRAM are write-back cacheable, the TCMs and the peripherals are
+ * not. Called once by SystemInit().
+ */
+void vSetupMemoryAttributes(void);
+
+/*
+ * Cache maintenance around eDMA transfers from and to cacheable SRAM (the
+ * .dma_buffer section). Clean a buffer after the CPU filled it and before the
+ * eDMA reads it; invalidate a buffer after the eDMA wrote it and before the
+ * CPU reads it. Buffers that are invalidated must start and end on a 32 byte
+ * cache line boundary.
+ */
+void vCacheCleanForDMA(const volatile void *pvAddress, uint32_t ulSize);
+void vCacheInvalidateForDMA(volatile void *pvAddress, uint32_t ulSize);
+
+#endif /* MPU_SETUP_H */
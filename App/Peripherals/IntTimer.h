@@ -1,11 +1,20 @@
 #ifndef INT_QUEUE_TIMER_H
 #define INT_QUEUE_TIMER_H
 
+#include "FreeRTOS.h"
 #include "globals.h"
 
+/* PIT module clock (AIPS_SLOW_CLK) */
+#define tmrPIT_CLOCK_HZ         ( 40000000UL )
+
 void vInitialiseTimers( my_bool verbose );
-void TIMER0_IRQHandler( void );
+
+/* Channel driving the timeout wheel, times are in PIT clock cycles */
+void vIntTimerStart( uint32_t ulCycles );
+void vIntTimerStop( void );
+uint32_t ulIntTimerElapsed( void );
+BaseType_t xIntTimerPending( void );
+
 void TIMER1_IRQHandler( void );
-void TIMER2_IRQHandler( void );
 
 #endif
@@ -0,0 +1,162 @@
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Peripheral includes */
+#include "RunTimeStats.h"
+#include "console.h"
+
+/* Library includes. */
+#include "S32K3X8EVB.h"
+
+/* Above the application tasks, so the report still comes out under load */
+#define statsTASK_PRIORITY      ( tskIDLE_PRIORITY + 6 )
+
+/* Period of the reports */
+#define statsPERIOD_MS          1000
+
+/* Most tasks reported, task numbers above are left out */
+#define statsMAX_TASKS          16
+
+/* The names are sent again every so many reports, for late decoders */
+#define statsNAME_EVERY         10
+
+/*
+ * Channels 0 and 1 of PIT0 form the lifetime timer: channel 0 counts down
+ * from 0xFFFFFFFF at the PIT clock, channel 1 is chained to it and counts
+ * its expiries. No interrupt is enabled, so the counter costs nothing
+ * while the core sleeps in tickless idle.
+ */
+#define statsLOW_CHANNEL        ( S32K3X8_PIT0->CH[0] )
+#define statsHIGH_CHANNEL       ( S32K3X8_PIT0->CH[1] )
+
+/* Payload of a consoleFRAME_TASKS frame */
+#define statsTASK_RECORD_SIZE   5
+#define statsPAYLOAD_MAX        ( 4 + statsMAX_TASKS * statsTASK_RECORD_SIZE )
+
+static TaskStatus_t xStatus[ statsMAX_TASKS ];
+
+/* Counters at the previous report, by task number */
+static configRUN_TIME_COUNTER_TYPE ullLastRunTime[ statsMAX_TASKS + 1 ];
+static uint8_t ucNameSent[ statsMAX_TASKS + 1 ];
+
+static void prvStatsTask( void *pvParameters );
+
+/*--------------------------------------------------------------------------------*/
+
+void vConfigureRunTimeCounter( void )
+{
+    S32K3X8_PIT0->MCR = 0;                                 /* Enable the PIT module */
+
+    statsHIGH_CHANNEL.TCTRL = 0;
+    statsLOW_CHANNEL.TCTRL  = 0;
+    statsHIGH_CHANNEL.LDVAL = 0xFFFFFFFFUL;
+    statsLOW_CHANNEL.LDVAL  = 0xFFFFFFFFUL;
+
+    /* Start the chained channel first so that it sees every expiry */
+    statsHIGH_CHANNEL.TCTRL = PIT_TCTRL_CHN_Msk |          /* Chain to channel 0. */
+                              PIT_TCTRL_TEN_Msk;           /* Enable Timer. */
+    statsLOW_CHANNEL.TCTRL  = PIT_TCTRL_TEN_Msk;           /* Enable Timer. */
+}
+
+uint64_t ullGetRunTimeCounter( void )
+{
+    /* Reading LTMR64H latches the low half into LTMR64L */
+    uint32_t ulHigh = S32K3X8_PIT0->LTMR64H;
+    uint32_t ulLow  = S32K3X8_PIT0->LTMR64L;
+
+    /* Both channels count down from 0xFFFFFFFF */
+    return ~( ( ( uint64_t ) ulHigh << 32 ) | ulLow );
+}
+
+void vStartStatsTask( void )
+{
+    xTaskCreate( prvStatsTask, "StatsTask", configMINIMAL_STACK_SIZE * 2, NULL, statsTASK_PRIORITY, NULL );
+}
+
+/*--------------------------------------------------------------------------------*/
+
+static uint8_t *prvPut16( uint8_t *pucOut, uint32_t ulValue )
+{
+    pucOut[ 0 ] = ( uint8_t ) ulValue;
+    pucOut[ 1 ] = ( uint8_t ) ( ulValue >> 8 );
+    return pucOut + 2;
+}
+
+static uint8_t *prvPut32( uint8_t *pucOut, uint32_t ulValue )
+{
+    pucOut = prvPut16( pucOut, ulValue );
+    return prvPut16( pucOut, ulValue >> 16 );
+}
+
+static void prvSendName( const TaskStatus_t *pxTask )
+{
+    uint8_t ucPayload[ 1 + configMAX_TASK_NAME_LEN ];
+    uint32_t ulLength = 0;
+
+    ucPayload[ 0 ] = ( uint8_t ) pxTask->xTaskNumber;
+    while( ( ulLength < configMAX_TASK_NAME_LEN ) && ( pxTask->pcTaskName[ ulLength ] != '\0' ) )
+    {
+        ucPayload[ 1 + ulLength ] = ( uint8_t ) pxTask->pcTaskName[ ulLength ];
+        ulLength++;
+    }
+
+    vConsoleWriteFrame( consoleFRAME_NAME, ucPayload, ulLength + 1 );
+}
+
+static void prvStatsTask( void *pvParameters )
+{
+    static uint8_t ucPayload[ statsPAYLOAD_MAX ];
+    configRUN_TIME_COUNTER_TYPE ullTotal;
+    configRUN_TIME_COUNTER_TYPE ullLastTotal = 0;
+    TickType_t xLastWake = xTaskGetTickCount();
+    uint32_t ulReports = 0;
+
+    (void) pvParameters;
+
+    for( ;; )
+    {
+        UBaseType_t uxCount;
+        uint64_t ullWindow;
+        uint8_t *pucOut;
+
+        vTaskDelayUntil( &xLastWake, pdMS_TO_TICKS( statsPERIOD_MS ) );
+
+        uxCount = uxTaskGetSystemState( xStatus, statsMAX_TASKS, &ullTotal );
+        ullWindow = ullTotal - ullLastTotal;
+        ullLastTotal = ullTotal;
+        if( ( uxCount == 0 ) || ( ullWindow == 0 ) )
+        {
+            continue;
+        }
+
+        pucOut = prvPut32( ucPayload, ( uint32_t ) ullWindow );
+        for( UBaseType_t i = 0; i < uxCount; i++ )
+        {
+            TaskStatus_t *pxTask = &xStatus[ i ];
+            UBaseType_t uxNumber = pxTask->xTaskNumber;
+            uint64_t ullRun;
+
+            if( uxNumber > statsMAX_TASKS )
+            {
+                continue;
+            }
+
+            if( !ucNameSent[ uxNumber ] || ( ulReports % statsNAME_EVERY ) == 0 )
+            {
+                prvSendName( pxTask );
+                ucNameSent[ uxNumber ] = 1;
+            }
+
+            ullRun = pxTask->ulRunTimeCounter - ullLastRunTime[ uxNumber ];
+            ullLastRunTime[ uxNumber ] = pxTask->ulRunTimeCounter;
+
+            *pucOut++ = ( uint8_t ) uxNumber;
+            pucOut = prvPut16( pucOut, ( uint32_t ) ( ( ullRun * 1000U ) / ullWindow ) );
+            pucOut = prvPut16( pucOut, pxTask->usStackHighWaterMark );
+        }
+
+        vConsoleWriteFrame( consoleFRAME_TASKS, ucPayload, ( uint32_t ) ( pucOut - ucPayload ) );
+        ulReports++;
+    }
+}
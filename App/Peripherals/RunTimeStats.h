@@ -0,0 +1,25 @@
+#ifndef RUN_TIME_STATS_H
+#define RUN_TIME_STATS_H
+
+#include <stdint.h>
+
+/*
+ * Run-time counter of FreeRTOS (configGENERATE_RUN_TIME_STATS): the 64-bit
+ * lifetime timer of PIT0, counting AIPS_SLOW_CLK cycles (tmrPIT_CLOCK_HZ).
+ */
+void vConfigureRunTimeCounter( void );
+uint64_t ullGetRunTimeCounter( void );
+
+/*
+ * Statistics task: every statsPERIOD_MS it sends the CPU share of each task
+ * over that period and its stack high-water mark to the console, as binary
+ * frames (see console.h) that Profile/console_decode.py decodes:
+ *
+ *  consoleFRAME_TASKS: u32 window in PIT cycles, then for each task
+ *                      u8 number, u16 CPU share in per mille, u16 stack
+ *                      words never used
+ *  consoleFRAME_NAME:  u8 task number, then the name without terminator
+ */
+void vStartStatsTask( void );
+
+#endif /* RUN_TIME_STATS_H */
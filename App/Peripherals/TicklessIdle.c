@@ -0,0 +1,126 @@
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Peripheral includes */
+#include "TicklessIdle.h"
+#include "IntTimer.h"
+
+/* Library includes. */
+#include "S32K3X8EVB.h"
+
+/* Timer IRQ numbers */
+#define TIMER2_IRQ_num 10
+
+/*
+ * Channel 0 of PIT2 wakes the core up from tickless idle. SysTick is stopped
+ * while the core sleeps and the PIT, which keeps running at AIPS_SLOW_CLK,
+ * measures how long the sleep actually lasted.
+ */
+#define tlsWAKEUP_CHANNEL       ( S32K3X8_PIT2->CH[0] )
+
+/* PIT cycles per RTOS tick, and CPU (SysTick) cycles per PIT cycle */
+#define tlsTICK_CYCLES          ( tmrPIT_CLOCK_HZ / configTICK_RATE_HZ )
+#define tlsSYSTICK_PER_PIT      ( configCPU_CLOCK_HZ / tmrPIT_CLOCK_HZ )
+
+/* Longest sleep, keeps the PIT reload value within 32 bits */
+#define tlsMAX_SLEEP_TICKS      ( 60000UL )
+
+/*
+ * Part of a tick that has elapsed while sleeping but was not accounted for,
+ * SysTick restarts with a full period after each sleep. Carrying it over to
+ * the next sleep keeps the tick count from drifting behind the PIT.
+ */
+static uint32_t ulTickCarry = 0;
+
+void vInitialiseTicklessIdle( void )
+{
+    S32K3X8_PIT2->MCR = 0;                                 /* Enable the PIT module */
+    tlsWAKEUP_CHANNEL.TCTRL = 0;                           /* Only runs while sleeping */
+    tlsWAKEUP_CHANNEL.TFLG  = PIT_TFLG_TIF_Msk;            /* Clear any pending interrupts */
+
+    NVIC_SetPriority( TIMER2_IRQ_num, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY );
+    NVIC_EnableIRQ( TIMER2_IRQ_num );
+}
+
+void vApplicationSleep( TickType_t xExpectedIdleTime )
+{
+    uint32_t ulStartOffset;
+    uint32_t ulSleepCycles;
+    uint32_t ulElapsed;
+    uint32_t ulTicks;
+
+    if( xExpectedIdleTime > tlsMAX_SLEEP_TICKS )
+    {
+        xExpectedIdleTime = tlsMAX_SLEEP_TICKS;
+    }
+
+    /* Stop the tick, remembering how far into the current period it got */
+    __disable_irq();
+    __DSB();
+    __ISB();
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+    /* A task may have been readied between the idle task's check and here */
+    if( eTaskConfirmSleepModeStatus() == eAbortSleep )
+    {
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        __enable_irq();
+        return;
+    }
+
+    ulStartOffset = ( SysTick->LOAD - SysTick->VAL ) / tlsSYSTICK_PER_PIT + ulTickCarry;
+
+    /* Wake up at the tick boundary where the next task is due */
+    ulSleepCycles = xExpectedIdleTime * tlsTICK_CYCLES - ulStartOffset;
+    tlsWAKEUP_CHANNEL.TFLG  = PIT_TFLG_TIF_Msk;
+    tlsWAKEUP_CHANNEL.LDVAL = ulSleepCycles - 1;
+    tlsWAKEUP_CHANNEL.TCTRL = PIT_TCTRL_TIE_Msk |          /* Enable Timer interrupt. */
+                              PIT_TCTRL_TEN_Msk;           /* Enable Timer. */
+
+    /* Any interrupt wakes the core up, PRIMASK keeps it pending until the tick is fixed */
+    __DSB();
+    __WFI();
+    __ISB();
+
+    if( tlsWAKEUP_CHANNEL.TFLG & PIT_TFLG_TIF_Msk )
+    {
+        ulElapsed = ulSleepCycles;
+    }
+    else
+    {
+        ulElapsed = tlsWAKEUP_CHANNEL.LDVAL - tlsWAKEUP_CHANNEL.CVAL;
+    }
+
+    /* The wakeup interrupt has done its job, its handler does not need to run */
+    tlsWAKEUP_CHANNEL.TCTRL = 0;
+    tlsWAKEUP_CHANNEL.TFLG  = PIT_TFLG_TIF_Msk;
+    NVIC_ClearPendingIRQ( TIMER2_IRQ_num );
+
+    ulTicks = ( ulStartOffset + ulElapsed ) / tlsTICK_CYCLES;
+    ulTickCarry = ( ulStartOffset + ulElapsed ) % tlsTICK_CYCLES;
+
+    /* Restart the tick with a full period */
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    if( ulTicks >= xExpectedIdleTime )
+    {
+        /* Let the tick interrupt count the last tick, it unblocks the task that is due */
+        vTaskStepTick( xExpectedIdleTime - 1 );
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    }
+    else if( ulTicks > 0 )
+    {
+        vTaskStepTick( ulTicks );
+    }
+
+    __enable_irq();
+}
+
+void TIMER2_IRQHandler( void )
+{
+    /* Only reached if the wakeup fired after the sleep had already ended */
+    tlsWAKEUP_CHANNEL.TCTRL = 0;
+    tlsWAKEUP_CHANNEL.TFLG  = PIT_TFLG_TIF_Msk;
+}
@@ -0,0 +1,10 @@
+#ifndef TICKLESS_IDLE_H
+#define TICKLESS_IDLE_H
+
+#include "FreeRTOS.h"
+
+void vInitialiseTicklessIdle( void );
+void vApplicationSleep( TickType_t xExpectedIdleTime );
+void TIMER2_IRQHandler( void );
+
+#endif /* TICKLESS_IDLE_H */
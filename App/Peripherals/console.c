@@ -0,0 +1,238 @@
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Peripheral includes */
+#include "console.h"
+#include "uart.h"
+#include "printf-stdarg.h"
+
+/* MPU includes */
+#include "memory_map.h"
+
+/* Library includes. */
+#include "S32K3X8EVB.h"
+
+/* The logging task only runs when nothing else has work to do */
+#define consoleTASK_PRIORITY    ( tskIDLE_PRIORITY + 1 )
+
+/* Number of slots in the ring, must be a power of two */
+#define consoleNUM_SLOTS        64
+
+/* Payload of a slot, longer messages take several consecutive slots */
+#define consoleSLOT_SIZE        62
+
+typedef struct
+{
+    volatile uint8_t ucReady;       /* Set by the producer once the slot is filled */
+    uint8_t ucLength;               /* Bytes used in cData */
+    char cData[ consoleSLOT_SIZE ];
+} ConsoleSlot_t;
+
+/*
+ * Producers reserve slots by advancing ulHead with an exclusive store, so a
+ * task and any number of nested interrupts can queue messages at the same
+ * time without a lock. Only the logging task advances ulTail; a slot that
+ * has been reserved but not filled yet (its producer was preempted) stops
+ * the task until the producer marks it ready and notifies it.
+ */
+static ConsoleSlot_t xSlots[ consoleNUM_SLOTS ];
+static volatile uint32_t ulHead = 0;        /* Next slot to reserve */
+static volatile uint32_t ulTail = 0;        /* Next slot to send */
+static volatile uint32_t ulDropped = 0;     /* Messages lost because the ring was full */
+
+static TaskHandle_t xConsoleTask = NULL;
+
+static void prvConsoleTask( void *pvParameters );
+
+/*--------------------------------------------------------------------------------*/
+
+static int prvConsoleReserve( uint32_t ulCount, uint32_t *pulFirst )
+{
+    uint32_t ulFirst;
+
+    do
+    {
+        ulFirst = __LDREXW( &ulHead );
+        if( ( ulFirst + ulCount - ulTail ) > consoleNUM_SLOTS )
+        {
+            __CLREX();
+            return 0;
+        }
+    } while( __STREXW( ulFirst + ulCount, &ulHead ) != 0 );
+
+    *pulFirst = ulFirst;
+    return 1;
+}
+
+static void prvConsoleCountDrop( void )
+{
+    uint32_t ulValue;
+
+    do
+    {
+        ulValue = __LDREXW( &ulDropped );
+    } while( __STREXW( ulValue + 1, &ulDropped ) != 0 );
+}
+
+static void prvConsoleNotify( void )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if( xConsoleTask == NULL )
+    {
+        return;
+    }
+
+    if( __get_IPSR() != 0 )
+    {
+        vTaskNotifyGiveFromISR( xConsoleTask, &xHigherPriorityTaskWoken );
+        portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+    }
+    else if( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED )
+    {
+        xTaskNotifyGive( xConsoleTask );
+    }
+    /* Messages queued before the scheduler starts are sent by the first run of the task */
+}
+
+/*--------------------------------------------------------------------------------*/
+
+void vConsoleInit( void )
+{
+    static DTCM_NOINIT StaticTask_t xConsoleTaskTCB;
+    static DTCM_NOINIT StackType_t uxConsoleTaskStack[ configMINIMAL_STACK_SIZE ];
+
+    xConsoleTask = xTaskCreateStatic( prvConsoleTask, "Console", configMINIMAL_STACK_SIZE, NULL, consoleTASK_PRIORITY,
+                                      uxConsoleTaskStack, &xConsoleTaskTCB );
+}
+
+void vConsoleWrite( const char *pcData, size_t xLength )
+{
+    uint32_t ulCount = ( xLength + consoleSLOT_SIZE - 1 ) / consoleSLOT_SIZE;
+    uint32_t ulFirst;
+
+    if( ulCount == 0 )
+    {
+        return;
+    }
+
+    if( !prvConsoleReserve( ulCount, &ulFirst ) )
+    {
+        prvConsoleCountDrop();
+        return;
+    }
+
+    for( uint32_t i = 0; i < ulCount; i++ )
+    {
+        ConsoleSlot_t *pxSlot = &xSlots[ ( ulFirst + i ) & ( consoleNUM_SLOTS - 1 ) ];
+        size_t xChunk = ( xLength > consoleSLOT_SIZE ) ? consoleSLOT_SIZE : xLength;
+
+        for( size_t j = 0; j < xChunk; j++ )
+        {
+            pxSlot->cData[ j ] = pcData[ j ];
+        }
+        pxSlot->ucLength = ( uint8_t ) xChunk;
+
+        /* Publish the data before the flag the logging task polls */
+        __DMB();
+        pxSlot->ucReady = 1;
+
+        pcData += xChunk;
+        xLength -= xChunk;
+    }
+
+    prvConsoleNotify();
+}
+
+void vConsoleWriteFrame( uint8_t ucType, const uint8_t *pucPayload, uint32_t ulLength )
+{
+    uint8_t ucFrame[ consoleFRAME_OVERHEAD + consoleFRAME_MAX_PAYLOAD ];
+    uint8_t ucSum = ucType + ( uint8_t ) ulLength;
+
+    configASSERT( ulLength <= consoleFRAME_MAX_PAYLOAD );
+
+    ucFrame[ 0 ] = consoleFRAME_SYNC0;
+    ucFrame[ 1 ] = consoleFRAME_SYNC1;
+    ucFrame[ 2 ] = ucType;
+    ucFrame[ 3 ] = ( uint8_t ) ulLength;
+    for( uint32_t i = 0; i < ulLength; i++ )
+    {
+        ucFrame[ 4 + i ] = pucPayload[ i ];
+        ucSum += pucPayload[ i ];
+    }
+    ucFrame[ 4 + ulLength ] = ( uint8_t ) -ucSum;
+
+    /* A single write keeps the frame in consecutive slots */
+    vConsoleWrite( ( const char * ) ucFrame, ulLength + consoleFRAME_OVERHEAD );
+}
+
+uint32_t ulConsoleDroppedCount( void )
+{
+    return ulDropped;
+}
+
+void vConsoleTxCompleteFromISR( void )
+{
+    prvConsoleNotify();
+}
+
+/*--------------------------------------------------------------------------------*/
+
+static void prvConsoleSend( void )
+{
+    /* Sleep until the eDMA is done with the other half of the UART buffer */
+    while( UART_txBusy() )
+    {
+        ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+    }
+    UART_flush();
+}
+
+static void prvConsoleTask( void *pvParameters )
+{
+    uint32_t ulReported = 0;
+
+    (void) pvParameters;
+
+    for( ;; )
+    {
+        ConsoleSlot_t *pxSlot = &xSlots[ ulTail & ( consoleNUM_SLOTS - 1 ) ];
+
+        if( ( ulTail == ulHead ) || !pxSlot->ucReady )
+        {
+            /* Tell how much was lost once the ring has been emptied */
+            if( ( ulTail == ulHead ) && ( ulDropped != ulReported ) )
+            {
+                ulReported = ulDropped;
+                printf( "[CONSOLE] %u messages dropped\n", ( unsigned int ) ulReported );
+                continue;
+            }
+
+            /* Push out what has been collected, then wait for new messages */
+            if( UART_txPending() != 0 )
+            {
+                prvConsoleSend();
+            }
+            else
+            {
+                ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+            }
+            continue;
+        }
+
+        if( UART_txFree() < pxSlot->ucLength )
+        {
+            prvConsoleSend();
+        }
+        for( uint32_t i = 0; i < pxSlot->ucLength; i++ )
+        {
+            UART_putChar( pxSlot->cData[ i ] );
+        }
+
+        /* Release the slot before producers can see it as free */
+        pxSlot->ucReady = 0;
+        __DMB();
+        ulTail++;
+    }
+}
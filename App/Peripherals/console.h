@@ -0,0 +1,39 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Non-blocking console: messages are queued in a lock-free ring of slots and
+ * sent to the UART by a low-priority logging task, so printing never waits
+ * on the serial line. vConsoleWrite() can be called from tasks and from
+ * interrupts up to configMAX_SYSCALL_INTERRUPT_PRIORITY; when the ring is
+ * full the message is dropped and counted instead of blocking the caller.
+ */
+void vConsoleInit( void );
+void vConsoleWrite( const char *pcData, size_t xLength );
+uint32_t ulConsoleDroppedCount( void );
+
+/*
+ * Binary frames share the console with the text, Profile/console_decode.py
+ * picks them out: two sync bytes, the type, the length of the payload, the
+ * payload and a checksum making the sum of type, length, payload and
+ * checksum zero modulo 256. Multi-byte fields are little-endian.
+ */
+#define consoleFRAME_SYNC0          0xA5
+#define consoleFRAME_SYNC1          0x5A
+#define consoleFRAME_OVERHEAD       5
+#define consoleFRAME_MAX_PAYLOAD    96      /* Kept small, the frame is built on the caller's stack */
+
+/* Frame types */
+#define consoleFRAME_TASKS          0x01    /* Run-time statistics, see RunTimeStats.h */
+#define consoleFRAME_NAME           0x02    /* Task name, see RunTimeStats.h */
+#define consoleFRAME_LOG            0x03    /* Deferred log message, see dlog.h */
+
+void vConsoleWriteFrame( uint8_t ucType, const uint8_t *pucPayload, uint32_t ulLength );
+
+/* Called by the UART when the eDMA has handed a buffer over to the LPUART */
+void vConsoleTxCompleteFromISR( void );
+
+#endif /* CONSOLE_H */
@@ -0,0 +1,32 @@
+/* Peripheral includes */
+#include "dlog.h"
+#include "console.h"
+
+/*
+ * .dlog_fmt starts at address 0 and is not loaded, so the address of a
+ * format is its offset in the section; the linker script checks that it
+ * fits in the 16 bits of the identifier.
+ */
+void vDlogWrite( const char *pcFormat, const uint32_t *pulArgs, uint32_t ulCount )
+{
+    uint8_t ucPayload[ 2 + dlogMAX_ARGS * 4 ];
+    uint32_t ulId = ( uint32_t ) pcFormat;
+    uint8_t *pucOut = ucPayload;
+
+    if( ulCount > dlogMAX_ARGS )
+    {
+        ulCount = dlogMAX_ARGS;
+    }
+
+    *pucOut++ = ( uint8_t ) ulId;
+    *pucOut++ = ( uint8_t ) ( ulId >> 8 );
+    for( uint32_t i = 0; i < ulCount; i++ )
+    {
+        *pucOut++ = ( uint8_t ) pulArgs[ i ];
+        *pucOut++ = ( uint8_t ) ( pulArgs[ i ] >> 8 );
+        *pucOut++ = ( uint8_t ) ( pulArgs[ i ] >> 16 );
+        *pucOut++ = ( uint8_t ) ( pulArgs[ i ] >> 24 );
+    }
+
+    vConsoleWriteFrame( consoleFRAME_LOG, ucPayload, ( uint32_t ) ( pucOut - ucPayload ) );
+}
@@ -0,0 +1,42 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+
+#include "printf-stdarg.h"
+
+/*
+ * Deferred logging: DLOG() takes a printf() format and up to dlogMAX_ARGS
+ * integer arguments, but the target does not format anything. The format
+ * string goes to the .dlog_fmt section, which the linker keeps in the ELF
+ * without loading it (see s32_linker.ld), and the console only receives a
+ * consoleFRAME_LOG frame: the offset of the format in .dlog_fmt on 16 bits,
+ * then every argument on 32 bits. Profile/console_decode.py rebuilds the
+ * text from the ELF.
+ *
+ * Arguments are converted to uint32_t: a %s argument must be cast, and can
+ * only be a string the host finds in the ELF (a literal or a const array).
+ *
+ * Building with DLOG_DEFERRED=0 turns DLOG() back into printf().
+ */
+#ifndef DLOG_DEFERRED
+    #define DLOG_DEFERRED       1
+#endif
+
+#define dlogMAX_ARGS            8
+
+void vDlogWrite( const char *pcFormat, const uint32_t *pulArgs, uint32_t ulCount );
+
+#if DLOG_DEFERRED
+    #define DLOG( fmt, ... )                                                                        \
+        do {                                                                                        \
+            static const char pcDlogFormat[] __attribute__( ( section( ".dlog_fmt" ) ) ) = fmt;     \
+            const uint32_t ulDlogArgs[] = { 0, ##__VA_ARGS__ };                                     \
+            vDlogWrite( pcDlogFormat, &ulDlogArgs[ 1 ],                                             \
+                        ( sizeof( ulDlogArgs ) / sizeof( ulDlogArgs[ 0 ] ) ) - 1 );                 \
+        } while( 0 )
+#else
+    #define DLOG( fmt, ... )    printf( fmt, ##__VA_ARGS__ )
+#endif
+
+#endif /* DLOG_H */
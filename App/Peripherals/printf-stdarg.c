@@ -27,6 +27,10 @@
 
 #include <stdarg.h>
 #include "uart.h"
+#include "console.h"
+
+/* Longest message printf() can queue, including the terminator */
+#define PRINTF_LINE_SIZE 128
 
 #define putchar(c)      UART_putChar(c)
 
@@ -207,9 +211,17 @@ static int tiny_print( char **out, const char *format, va_list args, unsigned in
 int printf(const char *format, ...)
 {
         va_list args;
+        char line[ PRINTF_LINE_SIZE ];
+        char *end = line;
+        int len;
 
+        /* Format on the stack, longer messages are truncated */
         va_start( args, format );
-        return tiny_print( 0, format, args, 0 );
+        len = tiny_print( &end, format, args, sizeof( line ) );
+
+        /* Queue it for the logging task, never waiting for the UART */
+        vConsoleWrite( line, ( size_t ) ( end - line ) );
+        return len;
 }
 
 /* To keep linker happy. */
@@ -1,39 +1,166 @@
 #include "uart.h"
+#include "console.h"
+#include "S32K3X8EVB.h"
+#include "mpu_setup.h"
+
+/* eDMA channel used by the transmitter, fed by channel 0 of DMAMUX0 */
+#define uartTX_DMA_CHANNEL      0
+
+/* Interrupt raised by the channel at the end of each transfer */
+#define uartTX_DMA_IRQ_num      ( 32 + uartTX_DMA_CHANNEL )
+
+/* Interrupt of LPUART0, raised here when a byte is received */
+#define uartRX_IRQ_num          0
+
+/* Size of each half of the transmit double buffer */
+#define uartTX_BUFFER_SIZE      128
+
+/*
+ * Transmit double buffer: the eDMA feeds one half to the LPUART while the
+ * CPU fills the other one, so printing never waits on the serial line
+ * unless a whole buffer is filled before the previous one is sent.
+ * It lives in SRAM: the eDMA cannot reach the core-local DTCM addresses.
+ * SRAM is cached, so each half is written back before the eDMA reads it.
+ */
+static char ucTxBuffer[2][uartTX_BUFFER_SIZE] __attribute__((section(".dma_buffer"), aligned(32)));
+static uint32_t ulTxFillIndex = 0;      /* Half of the buffer being filled */
+static uint32_t ulTxFillCount = 0;      /* Bytes queued in that half */
+
+static UART_RxHandler_t pxRxHandler = NULL;
+
+static void prvUART_DMAInit(void)
+{
+    S32K3X8_EDMA_CH_TypeDef *pxChannel = S32K3X8_EDMA_CH0;
+
+    /* Route the LPUART0 transmit request to the channel */
+    S32K3X8_DMAMUX0->CHCFG[DMAMUX_CHCFG_IDX(uartTX_DMA_CHANNEL)] = DMAMUX_CHCFG_ENBL_Msk | DMAMUX_SRC_LPUART0_TX;
+
+    /* One byte from the buffer into DATA for every request */
+    pxChannel->TCD_SOFF = 1;
+    pxChannel->TCD_ATTR = (EDMA_TCD_ATTR_SIZE_8BIT << EDMA_TCD_ATTR_SSIZE_Pos) |
+                          (EDMA_TCD_ATTR_SIZE_8BIT << EDMA_TCD_ATTR_DSIZE_Pos);
+    pxChannel->TCD_NBYTES = 1;
+    pxChannel->TCD_SLAST_SDA = 0;
+    pxChannel->TCD_DADDR = (uint32_t)&LPUART_DATA;
+    pxChannel->TCD_DOFF = 0;
+    pxChannel->TCD_DLAST_SGA = 0;
+
+    /* Disable the request and interrupt once the buffer has been sent */
+    pxChannel->TCD_CSR = EDMA_TCD_CSR_DREQ_Msk | EDMA_TCD_CSR_INTMAJOR_Msk;
+
+    NVIC_SetPriority( uartTX_DMA_IRQ_num, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY );
+    NVIC_EnableIRQ( uartTX_DMA_IRQ_num );
+}
+
+int UART_txBusy(void)
+{
+    /* ERQ is cleared by the hardware at the end of the major loop */
+    return (S32K3X8_EDMA_CH0->CH_CSR & EDMA_CH_CSR_ERQ_Msk) != 0;
+}
+
+uint32_t UART_txPending(void)
+{
+    return ulTxFillCount;
+}
+
+uint32_t UART_txFree(void)
+{
+    return uartTX_BUFFER_SIZE - ulTxFillCount;
+}
+
+void UART_DMA_IRQHandler(void)
+{
+    /* Clear the interrupt and wake up whoever waits for the buffer */
+    S32K3X8_EDMA_CH0->CH_INT = 1;
+    vConsoleTxCompleteFromISR();
+}
+
+void UART_setRxHandler(UART_RxHandler_t pxHandler)
+{
+    pxRxHandler = pxHandler;
+
+    /* RXWATER is 0: RDRF, and the interrupt, as soon as one byte is in the FIFO */
+    NVIC_SetPriority( uartRX_IRQ_num, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY );
+    NVIC_EnableIRQ( uartRX_IRQ_num );
+    LPUART_CTRL |= CTRL_RIE;
+}
+
+void UART_RX_IRQHandler(void)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    /* Each read of DATA pops the RX FIFO, RDRF clears once it is empty */
+    while (LPUART_STAT & RDRF_FLAG) {
+        uint8_t ucByte = (uint8_t)LPUART_DATA;
+
+        if (pxRxHandler != NULL) {
+            pxRxHandler(ucByte, &xHigherPriorityTaskWoken);
+        }
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
 
 void UART_init(void)
 {
-    /* Configure the baud rate */
-    LPUART_BRR = 16;
+    /* Configure the baud rate: 80 MHz / (16 * 43) ~= 115200 baud */
+    LPUART_BAUD = (15 << 24) | 43; // OSR = 15 (16x oversampling), SBR = 43
 
-    /* Enable the transmitter and receiver */
-    LPUART_CR1 = (1 << 3) | (1 << 2); // TE (Transmitter enable) and RE (Receiver enable)
+    /* Enable the TX and RX FIFOs */
+    LPUART_FIFO = FIFO_TXFE | FIFO_RXFE;
+
+    /* Keep TDRE set as long as there is room left in the TX FIFO */
+    LPUART_WATER = LPUART_FIFO_DEPTH - 1;
 
-    /* Enable the UART */
-    LPUART_CR1 |= (1 << 0); // UE (USART enable)
+    /* Let TDRE request the eDMA instead of the CPU polling it */
+    prvUART_DMAInit();
+    LPUART_BAUD |= BAUD_TDMAE;
+
+    /* Enable the transmitter and receiver */
+    LPUART_CTRL = CTRL_TE | CTRL_RE;
 
     // UART_printf("\nUART initialized!\n\n");
 }
 
+void UART_flush(void)
+{
+    S32K3X8_EDMA_CH_TypeDef *pxChannel = S32K3X8_EDMA_CH0;
+
+    if (ulTxFillCount == 0) {
+        return;
+    }
+
+    /* Wait for the previous buffer to be handed over to the LPUART */
+    while (UART_txBusy()) {
+        /* Wait for the eDMA to finish */
+    }
+
+    /* Send the half that has been filled, one byte per minor loop */
+    vCacheCleanForDMA(ucTxBuffer[ulTxFillIndex], ulTxFillCount);
+    pxChannel->TCD_SADDR = (uint32_t)ucTxBuffer[ulTxFillIndex];
+    pxChannel->TCD_CITER = (uint16_t)ulTxFillCount;
+    pxChannel->TCD_BITER = (uint16_t)ulTxFillCount;
+    pxChannel->CH_CSR = EDMA_CH_CSR_DONE_Msk | EDMA_CH_CSR_ERQ_Msk;
+
+    /* Keep filling the other half in the meantime */
+    ulTxFillIndex ^= 1;
+    ulTxFillCount = 0;
+}
+
 void UART_printf(const char *s) 
 {
     while (*s != '\0') {
-        /* Wait until the transmit data register is empty */
-        while (!(LPUART_ISR & TXE_FLAG)) {
-            /* Wait for the transmission register to be empty */
-        }
-        /* Write the character to the TDR */
-        LPUART_TDR = (unsigned int)(*s);
+        UART_putChar(*s);
         s++;
     }
+    UART_flush();
 }
 
 void UART_putChar(char c) 
 {
-    /* Wait until the transmit data register is empty */
-   
-    while (!(LPUART_ISR & TXE_FLAG)) {
-        /* Wait for the transmission register to be empty */
+    /* Queue the character, sending the buffer once it is full */
+    ucTxBuffer[ulTxFillIndex][ulTxFillCount++] = c;
+    if (ulTxFillCount == uartTX_BUFFER_SIZE) {
+        UART_flush();
     }
-    /* Write the character to the TDR */
-    LPUART_TDR = (unsigned int)c;
 }
@@ -5,23 +5,51 @@
 
 #define LPUART_BASE_ADDR 0x4006A000
 
-#define LPUART_CR1   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x00))
-#define LPUART_CR2   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x04))
-#define LPUART_CR3   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x08))
-#define LPUART_BRR   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x0C))
-#define LPUART_GTPR  (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x10))
-#define LPUART_RTOR  (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x14))
-#define LPUART_RQR   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x18))
-#define LPUART_ISR   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x1C))
-#define LPUART_ICR   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x20))
-#define LPUART_RDR   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x24))
-#define LPUART_TDR   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x28))
-
-/* Flag for ISR register */
-#define TXE_FLAG  (1 << 7)  // TXE (Transmit Data Register Empty)
+#define LPUART_VERID  (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x00))
+#define LPUART_PARAM  (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x04))
+#define LPUART_GLOBAL (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x08))
+#define LPUART_PINCFG (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x0C))
+#define LPUART_BAUD   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x10))
+#define LPUART_STAT   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x14))
+#define LPUART_CTRL   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x18))
+#define LPUART_DATA   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x1C))
+#define LPUART_MATCH  (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x20))
+#define LPUART_MODIR  (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x24))
+#define LPUART_FIFO   (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x28))
+#define LPUART_WATER  (*(volatile uint32_t *)(LPUART_BASE_ADDR + 0x2C))
+
+/* Depth of the TX/RX FIFOs */
+#define LPUART_FIFO_DEPTH 16
+
+/* Bits for BAUD register */
+#define BAUD_TDMAE (1 << 23) // TDMAE (Transmitter DMA Enable)
+
+/* Flags for STAT register */
+#define TDRE_FLAG (1 << 23) // TDRE (Transmit Data Register Empty)
+#define TC_FLAG   (1 << 22) // TC (Transmission Complete)
+#define RDRF_FLAG (1 << 21) // RDRF (Receive Data Register Full)
+
+/* Bits for CTRL register */
+#define CTRL_TE   (1 << 19) // TE (Transmitter Enable)
+#define CTRL_RE   (1 << 18) // RE (Receiver Enable)
+#define CTRL_RIE  (1 << 21) // RIE (Receiver Interrupt Enable)
+
+/* Bits for FIFO register */
+#define FIFO_TXFE (1 << 7)  // TXFE (Transmit FIFO Enable)
+#define FIFO_RXFE (1 << 3)  // RXFE (Receive FIFO Enable)
+
+/* Called from the receive interrupt for every byte received */
+typedef void (*UART_RxHandler_t)(uint8_t ucByte, BaseType_t *pxHigherPriorityTaskWoken);
 
 void UART_init(void);
 void UART_printf(const char *s);
 void UART_putChar(char c);
+void UART_flush(void);
+int UART_txBusy(void);
+uint32_t UART_txPending(void);
+uint32_t UART_txFree(void);
+void UART_DMA_IRQHandler(void);
+void UART_setRxHandler(UART_RxHandler_t pxHandler);
+void UART_RX_IRQHandler(void);
 
 #endif
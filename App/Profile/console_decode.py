@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+# ---------------------------------------------------------
+# Decode the console output of the firmware. Next to its text,
+# the firmware sends binary frames (see Peripherals/console.h):
+#
+#  - deferred log messages (Peripherals/dlog.h), made of the
+#    address of a format in the .dlog_fmt section of the ELF
+#    and the raw arguments, formatted here;
+#  - the run-time statistics (Peripherals/RunTimeStats.c),
+#    printed as a table of the CPU share of every task over
+#    the last period and the stack it has never used.
+#
+# The text printed by the firmware is passed through unchanged.
+#
+# Usage: make qemu_start, or pipe the serial output of the
+# board into this script (see -h)
+# ---------------------------------------------------------
+
+import argparse
+import re
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+FRAME_TASKS = 0x01
+FRAME_NAME = 0x02
+FRAME_LOG = 0x03
+
+# PIT clock the run-time counter counts (tmrPIT_CLOCK_HZ)
+PIT_CLOCK_HZ = 40000000
+
+# Conversions of tiny_print() in printf-stdarg.c
+CONVERSION = re.compile(r"%([-0]*)(\d*)[lh]*([diuxXcs%])")
+
+
+class Elf:
+    """Sections of a little-endian ELF32 file, enough to read strings"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            sys.exit("%s: not a little-endian ELF32 file" % path)
+        shoff, = struct.unpack_from("<I", self.data, 32)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data, 46)
+        headers = [struct.unpack_from("<IIIIII", self.data, shoff + i * shentsize)
+                   for i in range(shnum)]
+        strtab = headers[shstrndx][4]
+        self.sections = {}
+        for name, stype, flags, addr, offset, size in headers:
+            end = self.data.index(b"\0", strtab + name)
+            self.sections[self.data[strtab + name:end].decode()] = \
+                (stype, flags, addr, offset, size)
+
+    def section(self, name):
+        stype, flags, addr, offset, size = self.sections.get(name, (0,) * 5)
+        return self.data[offset:offset + size]
+
+    def string_at(self, addr):
+        """C string at a load address, from the sections with contents"""
+        for stype, flags, start, offset, size in self.sections.values():
+            # SHF_ALLOC and not SHT_NOBITS
+            if flags & 2 and stype != 8 and start <= addr < start + size:
+                pos = offset + addr - start
+                end = self.data.find(b"\0", pos, offset + size)
+                return self.data[pos:end if end >= 0 else offset + size].decode("latin-1")
+        return "<0x%08x>" % addr
+
+
+def frames(stream):
+    """Yield ("text", bytes) and ("frame", type, payload) from a byte stream"""
+    buf = b""
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+        if not chunk:
+            if buf:
+                yield ("text", buf)
+            return
+        buf += chunk
+        while True:
+            start = buf.find(SYNC)
+            if start < 0:
+                # Keep a trailing first sync byte, the second may follow
+                keep = 1 if buf.endswith(SYNC[:1]) else 0
+                if len(buf) > keep:
+                    yield ("text", buf[:len(buf) - keep])
+                buf = buf[len(buf) - keep:]
+                break
+            if start:
+                yield ("text", buf[:start])
+                buf = buf[start:]
+            if len(buf) < 4 or len(buf) < 5 + buf[3]:
+                break
+            length = buf[3]
+            body = buf[2:4 + length + 1]
+            if sum(body) & 0xff:
+                # Not a frame after all, pass the sync bytes through as text
+                yield ("text", buf[:1])
+                buf = buf[1:]
+                continue
+            yield ("frame", buf[2], buf[4:4 + length])
+            buf = buf[5 + length:]
+
+
+def format_log(elf, payload):
+    """Rebuild the text of a deferred log message"""
+    if elf is None:
+        return "[dlog] no ELF given (--elf) to decode message %s\n" % payload.hex()
+    formats = elf.section(".dlog_fmt")
+    fmt_id, = struct.unpack_from("<H", payload, 0)
+    end = formats.find(b"\0", fmt_id)
+    if fmt_id >= len(formats) or end < 0:
+        return "[dlog] unknown message %d, is the ELF up to date?\n" % fmt_id
+    fmt = formats[fmt_id:end].decode("latin-1")
+    args = list(struct.unpack_from("<%dI" % ((len(payload) - 2) // 4), payload, 2))
+
+    def convert(m):
+        flags, width, conv = m.groups()
+        if conv == "%":
+            return "%"
+        value = args.pop(0) if args else 0
+        if conv in "di":
+            value = value - (1 << 32) if value & 0x80000000 else value
+            conv = "d"
+        elif conv == "s":
+            value = elf.string_at(value)
+        return ("%" + flags + width + conv) % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Decode the console output of the firmware")
+    parser.add_argument("log", nargs="?", help="serial output (default: stdin)")
+    parser.add_argument("--elf", help="firmware, to decode the log messages")
+    parser.add_argument("--quiet", action="store_true",
+                        help="only print the statistics, not the console text")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf) if args.elf else None
+    stream = open(args.log, "rb") if args.log else sys.stdin.buffer
+    out = sys.stdout
+    names = {}
+
+    for item in frames(stream):
+        if item[0] == "text":
+            if not args.quiet:
+                out.write(item[1].decode("latin-1"))
+                out.flush()
+            continue
+
+        ftype, payload = item[1], item[2]
+        if ftype == FRAME_LOG and len(payload) >= 2:
+            if not args.quiet:
+                out.write(format_log(elf, payload))
+                out.flush()
+        elif ftype == FRAME_NAME and payload:
+            names[payload[0]] = payload[1:].decode("latin-1")
+        elif ftype == FRAME_TASKS and len(payload) >= 4:
+            (window,) = struct.unpack_from("<I", payload, 0)
+            out.write("\n--- run-time stats over %.1f ms ---\n"
+                      % (1000.0 * window / PIT_CLOCK_HZ))
+            out.write("%-12s %8s %14s\n" % ("task", "cpu", "stack left"))
+            idle = None
+            for off in range(4, len(payload) - 4, 5):
+                number, permille, stack = struct.unpack_from("<BHH", payload, off)
+                name = names.get(number, "#%d" % number)
+                if name == "IDLE":
+                    idle = permille
+                out.write("%-12s %7.1f%% %8d words\n"
+                          % (name, permille / 10.0, stack))
+            if idle is not None:
+                out.write("headroom     %7.1f%%\n" % (idle / 10.0))
+            out.flush()
+
+
+if __name__ == "__main__":
+    main()
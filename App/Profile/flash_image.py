@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# ---------------------------------------------------------
+# Render the program flash of the s32k3x8evb (blocks 0 to 3,
+# 8 MB from 0x00400000, see --size for the smaller parts of
+# the family) from the firmware ELF, the way QEMU
+# loads it with -kernel: the contents of every PT_LOAD
+# segment at its physical address, zeros everywhere else.
+# The segments outside the program flash (the vector table
+# in the ITCM, the initialised SRAM sections) go to a copy
+# of the ELF where the flash segments are dropped.
+#
+# QEMU maps the image copy-on-write with the machine option
+# flash-image=<file> and loads the copy with -kernel, so that
+# every instance started from the same image shares the pages
+# of the flash instead of holding its own copy.
+#
+# Usage: make flash_image, or see -h
+# ---------------------------------------------------------
+
+import argparse
+import os
+import struct
+import sys
+
+FLASH_BASE = 0x00400000
+FLASH_SIZE = 0x00800000
+
+PT_NULL = 0
+PT_LOAD = 1
+
+
+def segments(data):
+    """(program header offset, physical address, contents) of the PT_LOAD segments of an ELF32 file"""
+    phoff, = struct.unpack_from("<I", data, 28)
+    phentsize, phnum = struct.unpack_from("<HH", data, 42)
+    for i in range(phnum):
+        ph = phoff + i * phentsize
+        ptype, offset, vaddr, paddr, filesz, memsz = struct.unpack_from("<IIIIII", data, ph)
+        # The rest of memsz is .bss, which the startup code clears
+        if ptype == PT_LOAD and filesz:
+            yield ph, paddr, data[offset:offset + filesz]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Render the program flash image of the firmware")
+    parser.add_argument("--elf", required=True, help="firmware ELF file")
+    parser.add_argument("-o", "--output", required=True, help="flash image to write")
+    parser.add_argument("--rest", required=True, help="ELF to write with the segments outside the flash")
+    parser.add_argument("--size", type=lambda x: int(x, 0), default=FLASH_SIZE,
+                        help="size of the program flash (default: 0x%x, S32K358)" % FLASH_SIZE)
+    args = parser.parse_args()
+
+    with open(args.elf, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+        sys.exit("%s: not a little-endian ELF32 file" % args.elf)
+
+    image = bytearray(args.size)
+    rest = bytearray(data)
+    for ph, paddr, contents in segments(data):
+        start = paddr - FLASH_BASE
+        if start >= args.size or start + len(contents) <= 0:
+            continue
+        if start < 0 or start + len(contents) > args.size:
+            sys.exit("%s: segment at 0x%08x crosses the bounds of the program flash" % (args.elf, paddr))
+        image[start:start + len(contents)] = contents
+        struct.pack_into("<I", rest, ph, PT_NULL)
+
+    # QEMU instances may be mapping the old files: replace them, do not rewrite them
+    for path, contents in ((args.output, image), (args.rest, rest)):
+        tmp = path + ".tmp"
+        with open(tmp, "wb") as f:
+            f.write(contents)
+        os.replace(tmp, path)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+# ---------------------------------------------------------
+# Turn an execution profile of the firmware into the list of
+# functions the linker places in ITCM (see .itcm_text in
+# s32_linker.ld).
+#
+# The profile is the report of the QEMU hotblocks plugin
+# (contrib/plugins/hotblocks.c, run with limit=0), the symbols
+# come from arm-none-eabi-nm. The executed instructions of every
+# translation block are charged to the function containing it,
+# then the functions are picked by executed instructions per
+# byte of code until the ITCM budget is used up.
+#
+# Usage: make itcm_profile (or run this script by hand, see -h)
+# ---------------------------------------------------------
+
+import argparse
+import bisect
+import re
+import subprocess
+import sys
+
+# Functions that run before Reset_Handler has filled the ITCM
+NEVER_MOVE = {"Reset_Handler"}
+
+# Rough cost of the long branch veneers the linker may add for each function
+VENEER_SIZE = 8
+
+
+def read_symbols(nm, elf):
+    """Return the sorted (start, end, name) of every function of the ELF"""
+    out = subprocess.run([nm, "--defined-only", "--print-size", elf],
+                         check=True, capture_output=True, text=True).stdout
+    funcs = []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) != 4 or fields[2] not in ("t", "T", "w", "W"):
+            continue
+        start = int(fields[0], 16) & ~1     # Drop the Thumb bit
+        size = int(fields[1], 16)
+        if size:
+            funcs.append((start, start + size, fields[3]))
+    funcs.sort()
+    return funcs
+
+
+def read_profile(path):
+    """Yield (pc, executed instructions) of every block of a hotblocks report"""
+    row = re.compile(r"^\s*(0x[0-9a-fA-F]+),\s*(\d+),\s*(\d+),\s*(\d+)\s*$")
+    with open(path) as f:
+        for line in f:
+            m = row.match(line)
+            if m:
+                yield int(m.group(1), 16), int(m.group(3)) * int(m.group(4))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generate the ITCM placement from a hotblocks profile")
+    parser.add_argument("--elf", required=True, help="profiled firmware")
+    parser.add_argument("--profile", required=True, help="hotblocks report")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    parser.add_argument("--budget", type=int, default=48 * 1024,
+                        help="bytes of ITCM given to code (default 48 KB)")
+    parser.add_argument("--min-share", type=float, default=0.001,
+                        help="ignore functions below this share of the "
+                             "executed instructions (default 0.1%%)")
+    parser.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+
+    funcs = read_symbols(args.nm, args.elf)
+    starts = [f[0] for f in funcs]
+
+    heat = {}
+    total = 0
+    for pc, insns in read_profile(args.profile):
+        total += insns
+        i = bisect.bisect_right(starts, pc) - 1
+        if i >= 0 and pc < funcs[i][1]:
+            name = funcs[i][2]
+            heat[name] = heat.get(name, 0) + insns
+
+    if total == 0:
+        sys.exit("%s: no hotblocks report found" % args.profile)
+
+    sizes = {name: end - start for start, end, name in funcs}
+    candidates = [name for name in heat
+                  if name not in NEVER_MOVE
+                  and heat[name] >= args.min_share * total]
+    candidates.sort(key=lambda n: heat[n] / sizes[n], reverse=True)
+
+    chosen = []
+    used = 0
+    for name in candidates:
+        cost = (sizes[name] + VENEER_SIZE + 3) & ~3
+        if used + cost <= args.budget:
+            chosen.append(name)
+            used += cost
+
+    covered = sum(heat[n] for n in chosen)
+    with open(args.output, "w") as f:
+        f.write("/*\n"
+                " * Functions placed in ITCM, generated by itcm_profile.py\n"
+                " * from %s: %d functions, %d bytes, %.1f%% of the\n"
+                " * executed instructions. Do not edit, run make itcm_profile.\n"
+                " */\n" % (args.profile, len(chosen), used,
+                           100.0 * covered / total))
+        for name in chosen:
+            f.write("*(.text.%s)%s/* %5.2f%% */\n"
+                    % (name, " " * max(1, 40 - len(name)),
+                       100.0 * heat[name] / total))
+
+    print("%d functions (%d bytes) cover %.1f%% of the executed instructions"
+          % (len(chosen), used, 100.0 * covered / total))
+
+
+if __name__ == "__main__":
+    main()
@@ -6,10 +6,8 @@ typedef short int my_bool;
 #define true 1
 #define false 0
 
-/* Global variables */
-extern int userActivity;
-extern int userActivityDetection;
-extern int suspiciousActivity;
-extern int suspiciousActivityDetection;
+/* Global variables, written by the event simulator and sampled by the timer interrupts */
+extern volatile int userActivity;
+extern volatile int suspiciousActivity;
 
 #endif /* GLOBALS_H */
@@ -0,0 +1,64 @@
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Application includes */
+#include "object_pool.h"
+
+void vPoolInit( ObjectPool_t *pxPool, void *pvStorage, size_t xBlockSize, UBaseType_t uxCount )
+{
+    uint8_t *pucBlock = ( uint8_t * ) pvStorage;
+
+    configASSERT( ( xBlockSize >= sizeof( void * ) ) && ( ( xBlockSize % sizeof( void * ) ) == 0 ) );
+
+    /* Chain the blocks in address order, the first one is handed out first */
+    pxPool->pvFree = NULL;
+    for( UBaseType_t i = uxCount; i > 0; i-- )
+    {
+        void **ppvBlock = ( void ** ) ( pucBlock + ( i - 1 ) * xBlockSize );
+
+        *ppvBlock = pxPool->pvFree;
+        pxPool->pvFree = ppvBlock;
+    }
+    pxPool->uxFreeCount = uxCount;
+    pxPool->uxCount = uxCount;
+}
+
+void *pvPoolAlloc( ObjectPool_t *pxPool )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    void **ppvBlock;
+
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    {
+        ppvBlock = ( void ** ) pxPool->pvFree;
+        if( ppvBlock != NULL )
+        {
+            pxPool->pvFree = *ppvBlock;
+            pxPool->uxFreeCount--;
+        }
+    }
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+    return ppvBlock;
+}
+
+void vPoolFree( ObjectPool_t *pxPool, void *pvBlock )
+{
+    UBaseType_t uxSavedInterruptStatus;
+
+    configASSERT( pxPool->uxFreeCount < pxPool->uxCount );
+
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    {
+        *( void ** ) pvBlock = pxPool->pvFree;
+        pxPool->pvFree = pvBlock;
+        pxPool->uxFreeCount++;
+    }
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+}
+
+UBaseType_t uxPoolFreeCount( const ObjectPool_t *pxPool )
+{
+    return pxPool->uxFreeCount;
+}
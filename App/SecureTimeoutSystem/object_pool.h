@@ -0,0 +1,28 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+
+/*
+ * Pool of fixed-size blocks carved out of storage the caller provides.
+ * The free blocks are chained through their first word, so allocating and
+ * freeing are O(1), never fragment and can be done from an interrupt.
+ * Blocks are not cleared.
+ */
+typedef struct
+{
+    void *pvFree;               /* First free block, NULL when exhausted */
+    UBaseType_t uxFreeCount;
+    UBaseType_t uxCount;
+} ObjectPool_t;
+
+/* Round the size of an object up to a block of the pool */
+#define poolBLOCK_SIZE( xSize )     ( ( ( xSize ) + sizeof( void * ) - 1 ) & ~( sizeof( void * ) - 1 ) )
+
+void vPoolInit( ObjectPool_t *pxPool, void *pvStorage, size_t xBlockSize, UBaseType_t uxCount );
+void *pvPoolAlloc( ObjectPool_t *pxPool );
+void vPoolFree( ObjectPool_t *pxPool, void *pvBlock );
+UBaseType_t uxPoolFreeCount( const ObjectPool_t *pxPool );
+
+#endif /* OBJECT_POOL_H */
@@ -1,17 +1,23 @@
 /* FreeRTOS includes */
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
 
 /* Application includes */
 #include "secure_timeout_system.h"
+#include "timeout_wheel.h"
+#include "object_pool.h"
 #include "globals.h"
 
 /* Peripheral includes */
 #include "uart.h"
 #include "IntTimer.h"
 #include "printf-stdarg.h"
+#include "dlog.h"
 
 /* MPU includes */
+#include "memory_map.h"
+
 // #include "mpu_wrappers.h" /* Uncomment this line to include MPU wrappers */
 
 /* Task priorities */
@@ -19,21 +25,71 @@
 #define ALERT_TASK_PRIORITY   (tskIDLE_PRIORITY + 3)
 #define EVENT_TASK_PRIORITY   (tskIDLE_PRIORITY + 4)
 
+/* Period at which the activity flags are sampled */
+#define SAMPLE_PERIOD_MS      500
+
+/* User sessions, each one times out after a period without activity */
+#define NUM_SESSIONS          1024
+#define SESSION_TIMEOUT_MS    30000
+
+/* Period of the simulated events, and bytes from the console waiting to become events */
+#define EVENT_PERIOD_MS       5000
+#define EVENT_QUEUE_LENGTH    16
+
 /* Task functions */
 static void vMonitorTask(void *pvParameters);
 static void vAlertTask(void *pvParameters);
 static void vEventTask(void *pvParameters);
 
+/* The tasks are allocated statically, in DTCM */
+static DTCM_NOINIT StaticTask_t xMonitorTaskTCB;
+static DTCM_NOINIT StaticTask_t xAlertTaskTCB;
+static DTCM_NOINIT StaticTask_t xEventTaskTCB;
+static DTCM_NOINIT StackType_t uxMonitorTaskStack[ configMINIMAL_STACK_SIZE ];
+static DTCM_NOINIT StackType_t uxAlertTaskStack[ configMINIMAL_STACK_SIZE ];
+static DTCM_NOINIT StackType_t uxEventTaskStack[ configMINIMAL_STACK_SIZE ];
+
+/* Task handles, used by the samplers to notify the monitors */
+static TaskHandle_t xMonitorTaskHandle = NULL;
+static TaskHandle_t xAlertTaskHandle = NULL;
+
 /* Global variables */
-int userActivity = 0;
-int userActivityDetection = 0;
-int suspiciousActivity = 0;
-int suspiciousActivityDetection = 0;
+volatile int userActivity = 0;
+volatile int suspiciousActivity = 0;
+
+/* Last activity state signalled to each monitor */
+static int userActivityState = 0;
+static int suspiciousActivityState = 0;
 
 /* Activity Detection counters */
 static int userADCount = 0;
 static int suspiciousADCount = 0;
 
+/* Timeouts driving the samplers */
+static Timeout_t xUserSampler;
+static Timeout_t xSuspiciousSampler;
+
+/* An open session, released to the pool when it times out */
+typedef struct
+{
+    Timeout_t xTimeout;
+    int session;
+} Session_t;
+
+/* Session records come from a fixed pool in SRAM, the table of open sessions stays in DTCM */
+static SRAM_NOINIT Session_t xSessionStorage[NUM_SESSIONS];
+static ObjectPool_t xSessionPool;
+static Session_t *pxSessions[NUM_SESSIONS];
+
+/* Events received on the console, queued by the LPUART receive interrupt */
+static DTCM_NOINIT StaticQueue_t xEventQueueBuffer;
+static DTCM_NOINIT uint8_t ucEventQueueStorage[ EVENT_QUEUE_LENGTH ];
+static QueueHandle_t xEventQueue = NULL;
+
+/* Session counters, updated by the timeout wheel worker and the event simulator */
+static int activeSessions = 0;
+static int expiredSessions = 0;
+
 /* Seed used to generate pseudo random numbers */
 static uint32_t seed = 14536;
 
@@ -48,9 +104,98 @@ uint32_t simpleRandom()
 void initSecureTimeoutSystem( void ) 
 {
     userActivity = 0;
-    userActivityDetection = 0;
     suspiciousActivity = 0;
-    suspiciousActivityDetection = 0;
+    userActivityState = 0;
+    suspiciousActivityState = 0;
+}
+
+/*
+ * The samplers run from the timeout wheel worker every SAMPLE_PERIOD_MS and
+ * notify the monitor only when the state changes, carrying the new state in
+ * the notification value. The monitors block on the notification, so they
+ * run once per change instead of polling.
+ */
+static void prvUserActivitySample( void *pvContext )
+{
+    int state = (userActivity == 1) ? 1 : 0;
+
+    (void) pvContext;
+
+    if (state != userActivityState)
+    {
+        userActivityState = state;
+        xTaskNotify(xMonitorTaskHandle, state, eSetValueWithOverwrite);
+    }
+    vTimeoutArm(&xUserSampler, SAMPLE_PERIOD_MS);
+}
+
+static void prvSuspiciousActivitySample( void *pvContext )
+{
+    int state = (suspiciousActivity == 1) ? 1 : 0;
+
+    (void) pvContext;
+
+    if (state != suspiciousActivityState)
+    {
+        suspiciousActivityState = state;
+        xTaskNotify(xAlertTaskHandle, state, eSetValueWithOverwrite);
+    }
+    vTimeoutArm(&xSuspiciousSampler, SAMPLE_PERIOD_MS);
+}
+
+static void prvSessionExpired( void *pvContext )
+{
+    Session_t *pxSession = (Session_t *) pvContext;
+
+    /*
+     * A touch between the worker taking the timeout off the expired list
+     * and this callback has re-armed it: the session is live again.
+     */
+    taskENTER_CRITICAL();
+    if (!xTimeoutIsArmed(&pxSession->xTimeout))
+    {
+        activeSessions--;
+        expiredSessions++;
+        pxSessions[pxSession->session] = NULL;
+        vPoolFree(&xSessionPool, pxSession);
+    }
+    taskEXIT_CRITICAL();
+}
+
+/*
+ * Start or extend a session after some user activity. A session is active
+ * for as long as it has a record, including while its timeout waits for
+ * the worker: re-arming takes it back off the expired list.
+ */
+static void prvSessionTouch( int session )
+{
+    Session_t *pxSession;
+
+    taskENTER_CRITICAL();
+    pxSession = pxSessions[session];
+    if (pxSession == NULL)
+    {
+        pxSession = (Session_t *) pvPoolAlloc(&xSessionPool);
+        if (pxSession == NULL)
+        {
+            /* Out of records, the activity is ignored */
+            taskEXIT_CRITICAL();
+            return;
+        }
+        pxSession->session = session;
+        vTimeoutInit(&pxSession->xTimeout, prvSessionExpired, pxSession);
+        pxSessions[session] = pxSession;
+        activeSessions++;
+    }
+
+    vTimeoutArm(&pxSession->xTimeout, SESSION_TIMEOUT_MS);
+    taskEXIT_CRITICAL();
+}
+
+/* A byte is dropped when the event simulator is EVENT_QUEUE_LENGTH events behind */
+static void prvEventReceivedFromISR( uint8_t ucByte, BaseType_t *pxHigherPriorityTaskWoken )
+{
+    (void) xQueueSendFromISR(xEventQueue, &ucByte, pxHigherPriorityTaskWoken);
 }
 
 /*--------------------------------------------------------------------------------*/
@@ -62,83 +207,140 @@ void vStartSecureTimeoutSystem( my_bool verbose )
 
     /* Hardware initialisation */
     vInitialiseTimers( verbose );
+    vTimeoutWheelInit();
+
+    /* Events from the console, before the task that waits for them */
+    xEventQueue = xQueueCreateStatic(EVENT_QUEUE_LENGTH, sizeof(uint8_t), ucEventQueueStorage, &xEventQueueBuffer);
+    UART_setRxHandler(prvEventReceivedFromISR);
 
     /* Create the tasks */
-    xTaskCreate(vMonitorTask, "MonitorTask", configMINIMAL_STACK_SIZE, NULL, MONITOR_TASK_PRIORITY, NULL);
-    xTaskCreate(vAlertTask,   "AlertTask",   configMINIMAL_STACK_SIZE, NULL, ALERT_TASK_PRIORITY,   NULL);
-    xTaskCreate(vEventTask,   "EventTask",   configMINIMAL_STACK_SIZE, NULL, EVENT_TASK_PRIORITY,   NULL);  
+    xMonitorTaskHandle = xTaskCreateStatic(vMonitorTask, "MonitorTask", configMINIMAL_STACK_SIZE, NULL, MONITOR_TASK_PRIORITY, uxMonitorTaskStack, &xMonitorTaskTCB);
+    xAlertTaskHandle   = xTaskCreateStatic(vAlertTask,   "AlertTask",   configMINIMAL_STACK_SIZE, NULL, ALERT_TASK_PRIORITY,   uxAlertTaskStack,   &xAlertTaskTCB);
+    (void) xTaskCreateStatic(vEventTask, "EventTask", configMINIMAL_STACK_SIZE, NULL, EVENT_TASK_PRIORITY, uxEventTaskStack, &xEventTaskTCB);
+
+    /* Start sampling the activities */
+    vTimeoutInit(&xUserSampler, prvUserActivitySample, NULL);
+    vTimeoutInit(&xSuspiciousSampler, prvSuspiciousActivitySample, NULL);
+    vTimeoutArm(&xUserSampler, SAMPLE_PERIOD_MS);
+    vTimeoutArm(&xSuspiciousSampler, SAMPLE_PERIOD_MS);
+
+    /* Open every session, with staggered timeouts */
+    vPoolInit(&xSessionPool, xSessionStorage, sizeof(Session_t), NUM_SESSIONS);
+    for (int i = 0; i < NUM_SESSIONS; i++)
+    {
+        Session_t *pxSession = (Session_t *) pvPoolAlloc(&xSessionPool);
+
+        pxSession->session = i;
+        vTimeoutInit(&pxSession->xTimeout, prvSessionExpired, pxSession);
+        vTimeoutArm(&pxSession->xTimeout, SESSION_TIMEOUT_MS + i * 20);
+        pxSessions[i] = pxSession;
+    }
+    activeSessions = NUM_SESSIONS;
 }
 
 static void vMonitorTask(void *pvParameters) 
 {
     (void) pvParameters;
-
-    vTaskDelay(pdMS_TO_TICKS(500));
+    uint32_t ulState;
 
     for (;;) 
     {
-        if (userActivityDetection == 1) 
+        /* Sleep until the sampler reports a change of the user activity */
+        xTaskNotifyWait(0, 0, &ulState, portMAX_DELAY);
+
+        if (ulState == 1) 
         {
-            userActivityDetection = 0;
-            printf("[USER MONITOR] Activity detected              | Status: ACTIVE\n");
+            DLOG("[USER MONITOR] Activity detected              | Status: ACTIVE\n");
             /* Possible extra implementation */
         } 
         else 
         {
-            printf("[USER MONITOR] No activity                    | Status: IDLE\n");
+            DLOG("[USER MONITOR] No activity                    | Status: IDLE\n");
         }
-        vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
 
 static void vAlertTask(void *pvParameters) 
 {
     (void) pvParameters;
-
-    vTaskDelay(pdMS_TO_TICKS(500));
+    uint32_t ulState;
 
     for (;;) 
     {
-        if (suspiciousActivityDetection == 1) 
+        /* Sleep until the sampler reports a change of the suspicious activity */
+        xTaskNotifyWait(0, 0, &ulState, portMAX_DELAY);
+
+        if (ulState == 1) 
         {
-            suspiciousActivityDetection = 0;
-            printf("[SECURITY ALERT] Suspicious activity detected | Status: ALARM\n");
-            printf("[SECURITY ALERT] Initiating security protocols...\n");
+            DLOG("[SECURITY ALERT] Suspicious activity detected | Status: ALARM\n");
+            DLOG("[SECURITY ALERT] Initiating security protocols...\n");
             /* Possible extra implementation */
         } 
         else 
         {
-            printf("[SECURITY ALERT] System secure                | Status: NORMAL\n");
+            DLOG("[SECURITY ALERT] System secure                | Status: NORMAL\n");
         }
-        vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
 
+/* Raise a user activity on @session, or a security event */
+static void prvGenerateEvent( BaseType_t xSuspicious, int session )
+{
+    /* Reset Activities */
+    userActivity = 0;
+    suspiciousActivity = 0;
+
+    if (!xSuspicious) 
+    {
+        userActivity = 1;
+        userADCount++;
+        prvSessionTouch(session);
+        DLOG("[EVENT SIMULATOR] Generated: User Activity    | Count: %d\n", userADCount);
+        DLOG("[EVENT SIMULATOR] Session %d extended\n\n", session);
+    } 
+    else 
+    {
+        suspiciousActivity = 1;
+        suspiciousADCount++;
+        DLOG("[EVENT SIMULATOR] Generated: Security Event   | Count: %d\n\n", suspiciousADCount);
+    }
+
+    DLOG("[EVENT SIMULATOR] Sessions: %d active, %d timed out\n\n", activeSessions, expiredSessions);
+}
+
 static void vEventTask(void *pvParameters) 
 {
     (void) pvParameters;
+    TimeOut_t xTimeOut;
+    TickType_t xTicksToWait;
+    uint8_t ucByte;
 
     for (;;) 
     {
-        printf("\n[EVENT SIMULATOR] ------ New Cycle Started -------------------\n");
-                  
-        /* Reset Activities */
-        userActivity = 0;
-        suspiciousActivity = 0;
+        DLOG("\n[EVENT SIMULATOR] ------ New Cycle Started -------------------\n");
 
         if (simpleRandom() % 2 == 1) 
         {
-            userActivity = 1;
-            userADCount++;
-            printf("[EVENT SIMULATOR] Generated: User Activity    | Count: %d\n\n", userADCount);
+            prvGenerateEvent(pdFALSE, simpleRandom() % NUM_SESSIONS);
         } 
         else 
         {
-            suspiciousActivity = 1;
-            suspiciousADCount++;
-            printf("[EVENT SIMULATOR] Generated: Security Event   | Count: %d\n\n", suspiciousADCount);
+            prvGenerateEvent(pdTRUE, 0);
         }
 
-        vTaskDelay(pdMS_TO_TICKS(5000));
+        /*
+         * Until the next cycle, every byte received on the console is an
+         * event too: a security event when bit 7 is set, otherwise some
+         * user activity on the session numbered by the byte.
+         */
+        xTicksToWait = pdMS_TO_TICKS(EVENT_PERIOD_MS);
+        vTaskSetTimeOutState(&xTimeOut);
+        while (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE)
+        {
+            if (xQueueReceive(xEventQueue, &ucByte, xTicksToWait) == pdPASS)
+            {
+                prvGenerateEvent((ucByte & 0x80) != 0, ucByte % NUM_SESSIONS);
+            }
+        }
     }
 }
@@ -0,0 +1,383 @@
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "list.h"
+
+/* Application includes */
+#include "timeout_wheel.h"
+
+/* Peripheral includes */
+#include "IntTimer.h"
+
+/* MPU includes */
+#include "memory_map.h"
+
+/*
+ * Hierarchical timing wheel: four levels of 64 slots, each slot of level n
+ * spanning 64^n ticks. A timeout is linked into the lowest level whose
+ * current rotation contains its expiry time, and moves down one or more
+ * levels when the wheel reaches the start of its slot ("cascade"). Arming
+ * and cancelling only link or unlink a list item, whatever the number of
+ * pending timeouts.
+ *
+ * The wheel does not tick: the PIT channel is reloaded to fire at the next
+ * slot that holds work, and the interrupt handler advances the wheel time
+ * up to that point in one go, using the occupancy bitmaps to skip empty
+ * slots. Expired timeouts are moved to a list that the worker task drains,
+ * so the callbacks of everything that expired together run in one batch.
+ */
+
+#define wheelLEVELS             4
+#define wheelSLOT_BITS          6
+#define wheelSLOTS              ( 1UL << wheelSLOT_BITS )
+#define wheelSLOT_MASK          ( wheelSLOTS - 1 )
+
+/* PIT cycles per wheel tick */
+#define wheelTICK_CYCLES        ( tmrPIT_CLOCK_HZ / wheelTICK_HZ )
+
+/* Longest period the PIT is loaded with, keeps the reload value within 32 bits */
+#define wheelMAX_PERIOD_TICKS   ( 60000UL )
+
+/* Expiry callbacks have to run before the tasks they notify */
+#define wheelWORKER_PRIORITY    ( tskIDLE_PRIORITY + 5 )
+
+static List_t xWheel[ wheelLEVELS ][ wheelSLOTS ];
+static uint64_t ullOccupied[ wheelLEVELS ];     /* Non-empty slots of each level */
+static List_t xExpired;                         /* Waiting for the worker task */
+
+static uint32_t ulNow = 0;              /* Wheel time, every timeout up to it has expired */
+static uint32_t ulPeriodEnd = 0;        /* Wheel time at which the PIT fires next */
+static uint32_t ulPeriodOffset = 0;     /* PIT cycles between ulNow and the last reload */
+static BaseType_t xRunning = pdFALSE;
+
+static TaskHandle_t xWorkerTask = NULL;
+static DTCM_NOINIT StaticTask_t xWorkerTaskTCB;
+static DTCM_NOINIT StackType_t uxWorkerTaskStack[ configMINIMAL_STACK_SIZE * 2 ];
+
+static void prvWorkerTask( void *pvParameters );
+
+/*--------------------------------------------------------------------------------*/
+
+static void prvInsert( Timeout_t *pxTimeout )
+{
+    uint32_t ulExpiry = listGET_LIST_ITEM_VALUE( &pxTimeout->xItem );
+    uint32_t ulLevel;
+    uint32_t ulSlot;
+
+    /* Lowest level whose current rotation contains the expiry time */
+    for( ulLevel = 0; ulLevel < wheelLEVELS - 1; ulLevel++ )
+    {
+        uint32_t ulShift = wheelSLOT_BITS * ( ulLevel + 1 );
+
+        if( ( ulExpiry >> ulShift ) == ( ulNow >> ulShift ) )
+        {
+            break;
+        }
+    }
+
+    ulSlot = ( ulExpiry >> ( wheelSLOT_BITS * ulLevel ) ) & wheelSLOT_MASK;
+    vListInsertEnd( &xWheel[ ulLevel ][ ulSlot ], &pxTimeout->xItem );
+    ullOccupied[ ulLevel ] |= 1ULL << ulSlot;
+}
+
+static void prvRemove( Timeout_t *pxTimeout )
+{
+    List_t *pxList = listLIST_ITEM_CONTAINER( &pxTimeout->xItem );
+    uint32_t ulIndex;
+
+    if( pxList == NULL )
+    {
+        return;
+    }
+
+    if( ( uxListRemove( &pxTimeout->xItem ) == 0 ) && ( pxList != &xExpired ) )
+    {
+        ulIndex = ( uint32_t ) ( pxList - &xWheel[ 0 ][ 0 ] );
+        ullOccupied[ ulIndex / wheelSLOTS ] &= ~( 1ULL << ( ulIndex % wheelSLOTS ) );
+    }
+}
+
+/* Move every timeout of a slot either to the expired list or down the wheel */
+static void prvEmptySlot( uint32_t ulLevel, uint32_t ulSlot )
+{
+    List_t *pxList = &xWheel[ ulLevel ][ ulSlot ];
+    UBaseType_t uxCount = listCURRENT_LIST_LENGTH( pxList );
+
+    ullOccupied[ ulLevel ] &= ~( 1ULL << ulSlot );
+
+    /* Re-inserted timeouts may land in this very slot, only take the ones there now */
+    while( uxCount-- > 0 )
+    {
+        Timeout_t *pxTimeout = listGET_OWNER_OF_HEAD_ENTRY( pxList );
+
+        ( void ) uxListRemove( &pxTimeout->xItem );
+        if( listGET_LIST_ITEM_VALUE( &pxTimeout->xItem ) == ulNow )
+        {
+            vListInsertEnd( &xExpired, &pxTimeout->xItem );
+        }
+        else
+        {
+            prvInsert( pxTimeout );
+        }
+    }
+}
+
+/* Ticks from ulNow to the next slot holding work, 0 when the wheel is empty */
+static uint32_t prvNextEvent( void )
+{
+    uint32_t ulBest = 0;
+    uint32_t ulLevel;
+
+    for( ulLevel = 0; ulLevel < wheelLEVELS; ulLevel++ )
+    {
+        uint32_t ulShift = wheelSLOT_BITS * ulLevel;
+        uint32_t ulCurrent = ( ulNow >> ulShift ) & wheelSLOT_MASK;
+        uint64_t ullAhead = ullOccupied[ ulLevel ] & ~( ( 2ULL << ulCurrent ) - 1 );
+        uint32_t ulRotation = ( ulNow >> ( ulShift + wheelSLOT_BITS ) ) << ( ulShift + wheelSLOT_BITS );
+        uint32_t ulDelta;
+
+        if( ullAhead != 0 )
+        {
+            ulDelta = ulRotation + ( ( uint32_t ) __builtin_ctzll( ullAhead ) << ulShift ) - ulNow;
+        }
+        else if( ( ulLevel == wheelLEVELS - 1 ) && ( ullOccupied[ ulLevel ] != 0 ) )
+        {
+            /* The top level wraps around into its next rotation */
+            ulDelta = ulRotation + ( 1UL << ( ulShift + wheelSLOT_BITS ) ) +
+                      ( ( uint32_t ) __builtin_ctzll( ullOccupied[ ulLevel ] ) << ulShift ) - ulNow;
+        }
+        else
+        {
+            continue;
+        }
+
+        if( ( ulBest == 0 ) || ( ulDelta < ulBest ) )
+        {
+            ulBest = ulDelta;
+        }
+    }
+
+    return ulBest;
+}
+
+static void prvAdvance( uint32_t ulTarget )
+{
+    while( ( int32_t ) ( ulTarget - ulNow ) > 0 )
+    {
+        /* Skip the empty slots in one go */
+        uint32_t ulStep = prvNextEvent();
+        uint32_t ulLevel;
+
+        if( ( ulStep == 0 ) || ( ulStep > ulTarget - ulNow ) )
+        {
+            ulNow = ulTarget;
+            break;
+        }
+        ulNow += ulStep;
+
+        /* Cascade from the highest level that starts a new slot, so lower levels see the arrivals */
+        for( ulLevel = 1; ulLevel < wheelLEVELS; ulLevel++ )
+        {
+            if( ( ulNow & ( ( 1UL << ( wheelSLOT_BITS * ulLevel ) ) - 1 ) ) != 0 )
+            {
+                break;
+            }
+        }
+        while( --ulLevel > 0 )
+        {
+            uint32_t ulSlot = ( ulNow >> ( wheelSLOT_BITS * ulLevel ) ) & wheelSLOT_MASK;
+
+            if( ullOccupied[ ulLevel ] & ( 1ULL << ulSlot ) )
+            {
+                prvEmptySlot( ulLevel, ulSlot );
+            }
+        }
+
+        if( ullOccupied[ 0 ] & ( 1ULL << ( ulNow & wheelSLOT_MASK ) ) )
+        {
+            prvEmptySlot( 0, ulNow & wheelSLOT_MASK );
+        }
+    }
+}
+
+/* Wheel time as seen by the PIT, which runs ahead of ulNow between interrupts */
+static uint32_t prvCurrentTime( void )
+{
+    if( !xRunning )
+    {
+        return ulNow;
+    }
+    if( xIntTimerPending() )
+    {
+        return ulPeriodEnd;
+    }
+    return ulNow + ( ulIntTimerElapsed() + ulPeriodOffset ) / wheelTICK_CYCLES;
+}
+
+/* Reload the PIT to fire at ulDeadline, keeping the cycles already elapsed since ulNow */
+static void prvReload( uint32_t ulDeadline )
+{
+    uint32_t ulElapsed = 0;
+    uint32_t ulBase = ulNow;
+
+    if( xRunning )
+    {
+        if( xIntTimerPending() )
+        {
+            /* The interrupt handler runs next and picks the deadline from the wheel */
+            return;
+        }
+        ulElapsed = ulIntTimerElapsed() + ulPeriodOffset;
+        ulBase = ulNow + ulElapsed / wheelTICK_CYCLES;
+    }
+
+    if( ( int32_t ) ( ulDeadline - ulBase ) < 1 )
+    {
+        ulDeadline = ulBase + 1;
+    }
+    if( ulDeadline - ulNow > wheelMAX_PERIOD_TICKS )
+    {
+        ulDeadline = ulNow + wheelMAX_PERIOD_TICKS;
+    }
+
+    vIntTimerStart( ( ulDeadline - ulNow ) * wheelTICK_CYCLES - ulElapsed );
+    ulPeriodOffset = ulElapsed;
+    ulPeriodEnd = ulDeadline;
+    xRunning = pdTRUE;
+}
+
+/*--------------------------------------------------------------------------------*/
+
+void vTimeoutWheelInit( void )
+{
+    for( uint32_t ulLevel = 0; ulLevel < wheelLEVELS; ulLevel++ )
+    {
+        for( uint32_t ulSlot = 0; ulSlot < wheelSLOTS; ulSlot++ )
+        {
+            vListInitialise( &xWheel[ ulLevel ][ ulSlot ] );
+        }
+        ullOccupied[ ulLevel ] = 0;
+    }
+    vListInitialise( &xExpired );
+
+    xWorkerTask = xTaskCreateStatic( prvWorkerTask, "TimeoutWheel", configMINIMAL_STACK_SIZE * 2, NULL, wheelWORKER_PRIORITY,
+                                     uxWorkerTaskStack, &xWorkerTaskTCB );
+}
+
+void vTimeoutInit( Timeout_t *pxTimeout, TimeoutCallback_t pxCallback, void *pvContext )
+{
+    vListInitialiseItem( &pxTimeout->xItem );
+    listSET_LIST_ITEM_OWNER( &pxTimeout->xItem, pxTimeout );
+    pxTimeout->pxCallback = pxCallback;
+    pxTimeout->pvContext = pvContext;
+}
+
+void vTimeoutArm( Timeout_t *pxTimeout, uint32_t ulDelayMs )
+{
+    uint32_t ulDelay = ulDelayMs / ( 1000UL / wheelTICK_HZ );
+    uint32_t ulExpiry;
+
+    if( ulDelay == 0 )
+    {
+        ulDelay = 1;
+    }
+    else if( ulDelay > wheelMAX_DELAY_TICKS )
+    {
+        ulDelay = wheelMAX_DELAY_TICKS;
+    }
+
+    taskENTER_CRITICAL();
+    {
+        prvRemove( pxTimeout );
+
+        ulExpiry = prvCurrentTime() + ulDelay;
+        listSET_LIST_ITEM_VALUE( &pxTimeout->xItem, ulExpiry );
+        prvInsert( pxTimeout );
+
+        /* Only an earlier deadline needs the PIT to be reloaded */
+        if( !xRunning || ( ( int32_t ) ( ulExpiry - ulPeriodEnd ) < 0 ) )
+        {
+            prvReload( ulExpiry );
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+void vTimeoutCancel( Timeout_t *pxTimeout )
+{
+    /* The PIT is left alone, an interrupt with nothing to expire is harmless */
+    taskENTER_CRITICAL();
+    {
+        prvRemove( pxTimeout );
+    }
+    taskEXIT_CRITICAL();
+}
+
+BaseType_t xTimeoutIsArmed( const Timeout_t *pxTimeout )
+{
+    List_t *pxList = listLIST_ITEM_CONTAINER( &pxTimeout->xItem );
+
+    return ( pxList != NULL ) && ( pxList != &xExpired );
+}
+
+void vTimeoutWheelTickFromISR( BaseType_t *pxHigherPriorityTaskWoken )
+{
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    uint32_t ulDelta;
+
+    /* The PIT has reloaded itself at ulPeriodEnd, count from there */
+    prvAdvance( ulPeriodEnd );
+    ulPeriodOffset = 0;
+
+    ulDelta = prvNextEvent();
+    if( ulDelta == 0 )
+    {
+        vIntTimerStop();
+        xRunning = pdFALSE;
+    }
+    else
+    {
+        prvReload( ulNow + ulDelta );
+    }
+
+    if( !listLIST_IS_EMPTY( &xExpired ) )
+    {
+        vTaskNotifyGiveFromISR( xWorkerTask, pxHigherPriorityTaskWoken );
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+}
+
+/*--------------------------------------------------------------------------------*/
+
+static void prvWorkerTask( void *pvParameters )
+{
+    (void) pvParameters;
+
+    for( ;; )
+    {
+        ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+        /* Run the callbacks of everything that expired since the last wakeup */
+        for( ;; )
+        {
+            Timeout_t *pxTimeout = NULL;
+
+            taskENTER_CRITICAL();
+            {
+                if( !listLIST_IS_EMPTY( &xExpired ) )
+                {
+                    pxTimeout = listGET_OWNER_OF_HEAD_ENTRY( &xExpired );
+                    ( void ) uxListRemove( &pxTimeout->xItem );
+                }
+            }
+            taskEXIT_CRITICAL();
+
+            if( pxTimeout == NULL )
+            {
+                break;
+            }
+            pxTimeout->pxCallback( pxTimeout->pvContext );
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef TIMEOUT_WHEEL_H
+#define TIMEOUT_WHEEL_H
+
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "list.h"
+
+/* Resolution of the wheel: one tick per millisecond */
+#define wheelTICK_HZ            ( 1000UL )
+
+/* Longest delay that can be armed, in ticks (about 4.6 hours) */
+#define wheelMAX_DELAY_TICKS    ( ( 1UL << 24 ) - 65536UL )
+
+typedef void ( *TimeoutCallback_t )( void *pvContext );
+
+/*
+ * A software timeout. The caller owns the storage; the wheel only links it
+ * into its lists, so arming, re-arming and cancelling are O(1) and never
+ * allocate.
+ */
+typedef struct
+{
+    ListItem_t xItem;               /* Wheel slot link, the item value is the expiry time */
+    TimeoutCallback_t pxCallback;   /* Called from the wheel worker task */
+    void *pvContext;
+} Timeout_t;
+
+void vTimeoutWheelInit( void );
+void vTimeoutInit( Timeout_t *pxTimeout, TimeoutCallback_t pxCallback, void *pvContext );
+void vTimeoutArm( Timeout_t *pxTimeout, uint32_t ulDelayMs );
+void vTimeoutCancel( Timeout_t *pxTimeout );
+BaseType_t xTimeoutIsArmed( const Timeout_t *pxTimeout );
+
+/* Called by the interrupt handler of the PIT channel driving the wheel */
+void vTimeoutWheelTickFromISR( BaseType_t *pxHigherPriorityTaskWoken );
+
+#endif /* TIMEOUT_WHEEL_H */
@@ -8,9 +8,15 @@
 
 /* Peripheral includes */
 #include "uart.h"
+#include "console.h"
 #include "IntTimer.h"
+#include "TicklessIdle.h"
+#include "RunTimeStats.h"
 #include "printf-stdarg.h"
 
+/* MPU includes */
+#include "memory_map.h"
+
 /* Task priorities */
 #define mainTASK_PRIORITY (tskIDLE_PRIORITY + 2)
 
@@ -24,15 +30,27 @@ int main(int argc, char **argv)
     (void) argc;
     (void) argv;
 
+    /* Give the free SRAM to the heap before anything is allocated */
+    vSetupHeapRegions();
+
     /* Hardware initialisation. */
     UART_init();
 
+    /* Start the logging task that sends printf() output to the UART */
+    vConsoleInit();
+
+    /* Let the idle task stop the tick and sleep until the next task is due */
+    vInitialiseTicklessIdle();
+
     printf("\n=========================== Starting the Main ============================\n\n");
 
     /* Start the secure timeout system */
     my_bool verbose = true;
     vStartSecureTimeoutSystem(verbose);
 
+    /* Report the CPU share and the stack usage of every task once a second */
+    vStartStatsTask();
+
     printf("Ready to run the scheduler...\n");
     vTaskStartScheduler();
 
@@ -41,6 +59,19 @@ int main(int argc, char **argv)
 
 /*--------------------------------------------------------------------------------*/
 
+/* With static allocation enabled, the kernel asks the application for the idle task memory */
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize)
+{
+    static DTCM_NOINIT StaticTask_t xIdleTaskTCB;
+    static DTCM_NOINIT StackType_t uxIdleTaskStack[configMINIMAL_STACK_SIZE];
+
+    *ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = uxIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
 void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName) 
 {
     /* This function will get called if a task overflows its stack. */
@@ -48,10 +79,11 @@ void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName)
     (void)xTask;
     (void)pcTaskName;
 
-    printf("Stack overflow in task: ");
-    printf(pcTaskName);
-    printf("\n");
+    /* The logging task may never run again, write to the UART directly */
     taskDISABLE_INTERRUPTS();
+    UART_printf("Stack overflow in task: ");
+    UART_printf(pcTaskName);
+    UART_printf("\n");
 
     for (;;);
 }
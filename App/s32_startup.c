@@ -3,6 +3,7 @@
 /* Peripheral includes */
 #include "uart.h"
 #include "IntTimer.h"
+#include "TicklessIdle.h"
 #include <stdio.h>
 
 /* FreeRTOS interrupt handlers */
@@ -17,6 +18,9 @@ extern uint32_t _sdata;      /* .data VMA (RAM)    */
 extern uint32_t _edata;      /* End of .data       */
 extern uint32_t _sbss;       /* Start of .bss      */
 extern uint32_t _ebss;       /* End of .bss        */
+extern uint32_t _siitcm_text; /* .itcm_text LMA (Flash) */
+extern uint32_t _sitcm_text;  /* .itcm_text VMA (ITCM)  */
+extern uint32_t _eitcm_text;  /* End of .itcm_text      */
 
 /* Exception handlers */
 void Reset_Handler(void) __attribute__((naked));
@@ -24,9 +28,6 @@ static void HardFault_Handler(void) __attribute__((naked));
 static void MemManage_Handler(void) __attribute__((naked));
 static void Default_Handler(void);
 
-/* MPU initialization */
-// extern void vPortSetupMPU(void);
-
 /* Main application entry */
 extern int main(void);
 
@@ -40,33 +41,50 @@ void print_fault_info(uint32_t cfsr, uint32_t mmfar, uint32_t bfar);
 
 void Reset_Handler(void) 
 {
+    /* 0. Park the secondary cores: the application only runs on core 0.
+     *    This must not touch the stack, which is owned by core 0. */
+    __asm volatile (
+        "ldr r0, =0x40260004\n\t"   /* MSCM CPXNUM */
+        "ldr r0, [r0]\n\t"
+        "cbz r0, 1f\n"
+        "0:  wfi\n\t"
+        "b 0b\n"
+        "1:"
+    );
+
     /* 1. Initialize main stack pointer */
     __asm volatile (
         "ldr r0, =_estack\n\t"
         "msr msp, r0"
     );
 
-    /* 2. MPU Setup - Must happen before any memory access */
-    // vPortSetupMPU();
+    /* 2. The MPU and the caches are set up later, by SystemInit() */
 
     /* 3. Copy data segment from flash to RAM */
     uint32_t *data_load = &_sidata;
     uint32_t *data_vma = &_sdata;
     while(data_vma < &_edata) *data_vma++ = *data_load++;
 
-    /* 4. Zero-initialize BSS segment */
+    /* 4. Copy the hot code from flash to ITCM, and make sure the copy is
+     *    complete before any of it is fetched */
+    uint32_t *itcm_load = &_siitcm_text;
+    uint32_t *itcm_vma = &_sitcm_text;
+    while(itcm_vma < &_eitcm_text) *itcm_vma++ = *itcm_load++;
+    __asm volatile ("dsb\n\tisb");
+
+    /* 5. Zero-initialize BSS segment */
     uint32_t *bss_start = &_sbss;
     uint32_t *bss_end = &_ebss;
     while(bss_start < bss_end) *bss_start++ = 0;
 
-    /* 5. Call platform initialization */
+    /* 6. Call platform initialization */
     extern void SystemInit(void);
     SystemInit();
 
-    /* 6. Jump to main application */
+    /* 7. Jump to main application */
     main();
 
-    /* 7. Fallback if main returns */
+    /* 8. Fallback if main returns */
     while(1);
 }
 
@@ -204,17 +222,20 @@ const uint32_t* isr_vector[] __attribute__((section(".isr_vector"))) = {
     0,                                         /* Reserved */
     (uint32_t*)xPortPendSVHandler,             /* FreeRTOS PendSV */
     (uint32_t*)xPortSysTickHandler,            /* FreeRTOS SysTick */
-    0,0,0,0,
-    0,0,0,0,
     /* Peripheral Interrupts */
-    (uint32_t*)TIMER0_IRQHandler,              /* Timer 0 */
+    (uint32_t*)UART_RX_IRQHandler,             /* LPUART0 (UART receive) */
+    0,0,0,
+    0,0,0,0,
+    0,                                         /* Timer 0 */
     (uint32_t*)TIMER1_IRQHandler,              /* Timer 1 */
     (uint32_t*)TIMER2_IRQHandler,              /* Timer 2 */
-    
-    /* Other interrupts not initialized in the Board */
-    0,0,0,0,0,0,0,0,
+    0,0,0,0,0,
     0,0,0,0,0,0,0,0,
     0,0,0,0,0,0,0,0,
+    (uint32_t*)UART_DMA_IRQHandler,            /* eDMA channel 0 (UART transmit) */
+    
+    /* Other interrupts not initialized in the Board */
+    0,0,
     0,0,0,0,0,0,0,0,
     0,0,0,0,0,0,0,0,
     0,0,0,0,0,0,0,0,
@@ -0,0 +1,137 @@
+/*
+ * Edge coverage for the s32k3x8evb fuzzing harness
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+/*
+ * Counts the transitions between translation blocks in a map shared with
+ * a fuzzer, in the way AFL does: each block is given a random looking
+ * 16 bit id from its address, and the edge from the previous block to the
+ * current one hits the counter at (previous >> 1) ^ current. The shift
+ * keeps A->B and B->A apart, and the loops A->A away from counter 0.
+ *
+ * The map is a file, typically in /dev/shm, that the driver of the fuzzer
+ * maps too (see App/Fuzz/fuzz_driver.c): EDGECOV_MAP_SIZE counters
+ * followed by the id of the previous block of each vCPU. The driver
+ * clears the whole file before each input, which also forgets the block
+ * the previous input ended on.
+ */
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+/* Must match the driver of the fuzzer */
+#define EDGECOV_MAP_SIZE    (64 * 1024)
+#define EDGECOV_MAX_VCPUS   16
+
+typedef struct {
+    uint8_t counters[EDGECOV_MAP_SIZE];
+    uint32_t prev[EDGECOV_MAX_VCPUS];
+} EdgeMap;
+
+static EdgeMap *map;
+
+static void vcpu_tb_exec(unsigned int cpu_index, void *udata)
+{
+    uint32_t cur = GPOINTER_TO_UINT(udata);
+    uint32_t *prev = &map->prev[cpu_index % EDGECOV_MAX_VCPUS];
+    uint8_t *counter = &map->counters[(cur ^ *prev) % EDGECOV_MAP_SIZE];
+
+    /* Saturate rather than wrap, so that a hot edge never reads as unseen */
+    if (*counter != UINT8_MAX) {
+        (*counter)++;
+    }
+    *prev = cur >> 1;
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    uint64_t pc = qemu_plugin_tb_vaddr(tb);
+    uint32_t cur;
+
+    /* Thumb code is 2 byte aligned: drop bit 0 before mixing */
+    cur = (uint32_t)(pc >> 1) * 0x9e3779b1u;
+    cur = (cur >> 16) % EDGECOV_MAP_SIZE;
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, vcpu_tb_exec,
+                                         QEMU_PLUGIN_CB_NO_REGS,
+                                         GUINT_TO_POINTER(cur));
+}
+
+static bool map_open(const char *path)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+
+    if (fd < 0) {
+        fprintf(stderr, "edgecov: cannot open %s\n", path);
+        return false;
+    }
+    if (ftruncate(fd, sizeof(EdgeMap)) < 0) {
+        fprintf(stderr, "edgecov: cannot resize %s\n", path);
+        close(fd);
+        return false;
+    }
+    map = mmap(NULL, sizeof(EdgeMap), PROT_READ | PROT_WRITE, MAP_SHARED,
+               fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "edgecov: cannot map %s\n", path);
+        map = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    munmap(map, sizeof(EdgeMap));
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    const char *map_path = NULL;
+
+    for (int i = 0; i < argc; i++) {
+        char *opt = argv[i];
+        g_auto(GStrv) tokens = g_strsplit(opt, "=", 2);
+
+        if (g_strcmp0(tokens[0], "map") == 0) {
+            map_path = argv[i] + strlen("map=");
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+
+    if (!map_path) {
+        fprintf(stderr, "edgecov: the coverage map must be given with map=\n");
+        return -1;
+    }
+    if (info->system_emulation &&
+        info->system.max_vcpus > EDGECOV_MAX_VCPUS) {
+        fprintf(stderr, "edgecov: at most %d vCPUs are supported\n",
+                EDGECOV_MAX_VCPUS);
+        return -1;
+    }
+    if (!map_open(map_path)) {
+        return -1;
+    }
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
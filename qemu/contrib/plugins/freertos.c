@@ -0,0 +1,623 @@
+/*
+ * FreeRTOS task profiling for Cortex-M firmware
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+/*
+ * This plugin tells which FreeRTOS task or interrupt handler the CPU time
+ * goes to. It reads the symbols of the firmware ELF file (elf=<path>):
+ *
+ *  - pxCurrentTCB, read whenever the scheduler may have switched tasks,
+ *    and the name of the task from its TCB,
+ *  - the vector table (.isr_vector section), whose handlers are the
+ *    interrupt contexts,
+ *  - xPortPendSVHandler and vPortSVCHandler, whose exit is where the
+ *    next task starts running.
+ *
+ * Instructions and memory accesses are counted with inline operations;
+ * callbacks only run on exception entry, exception return and at the end
+ * of a context switch, so the overhead stays low. The return address of
+ * an exception is read from its stack frame on entry, and the return is
+ * seen by a conditional callback on the translation block starting there.
+ *
+ * Time is measured in instructions, converted to microseconds with the
+ * mips option in the timeline: TCG has no notion of cycles.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+#define STRTOLL(x) g_ascii_strtoll(x, NULL, 0)
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+/* Deepest nesting of exceptions tracked */
+#define MAX_NESTING         16
+
+/* No exception return expected */
+#define NO_RETURN           UINT64_MAX
+
+/* Counters updated inline, one set per vCPU */
+typedef struct {
+    uint64_t insns;
+    uint64_t mem;
+    uint64_t ret_pc;        /* Return address of the innermost exception */
+} Counters;
+
+typedef struct {
+    char name[48];
+    const char *kind;       /* "task" or "isr" */
+    uint64_t activations;
+    uint64_t insns;
+    uint64_t mem;
+} Context;
+
+typedef struct {
+    uint64_t addr;
+    Context *ctx;
+} Handler;
+
+typedef struct {
+    Context *ctx;
+    uint64_t ret_pc;
+} Frame;
+
+typedef struct {
+    Context *task;
+    Frame stack[MAX_NESTING];
+    int depth;
+    uint64_t last_insns;    /* Counters at the last accounting */
+    uint64_t last_mem;
+    uint64_t next_report;
+    struct qemu_plugin_register *reg_sp;
+    struct qemu_plugin_register *reg_lr;
+    struct qemu_plugin_register *reg_psp;
+} VCPUState;
+
+static GMutex lock;
+static struct qemu_plugin_scoreboard *counters;
+static qemu_plugin_u64 insns_entry;
+static qemu_plugin_u64 mem_entry;
+static qemu_plugin_u64 ret_entry;
+
+static VCPUState *cpus;
+static int max_cpus;
+
+static GHashTable *handlers;        /* Handler by address */
+static GHashTable *tasks;           /* Context by TCB address */
+static GHashTable *isr_contexts;    /* Context by name */
+static GPtrArray *contexts;         /* Every context, in creation order */
+static Context *main_context;
+
+/* Range of the handlers ending a context switch */
+static uint64_t switch_start[2], switch_end[2];
+
+/* Options */
+static char *elf_path;
+static uint64_t tcb_addr;
+static int tcb_name_offset = 52;
+static int tcb_name_len = 12;
+static uint64_t period = 100000000;
+static int mips = 240;
+static FILE *trace;
+static bool trace_first = true;
+
+/*------------------------------------------------------------------------------*/
+/* ELF symbols                                                                  */
+/*------------------------------------------------------------------------------*/
+
+static uint32_t le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static Context *context_new(const char *name, const char *kind)
+{
+    Context *ctx = g_new0(Context, 1);
+
+    g_strlcpy(ctx->name, name, sizeof(ctx->name));
+    ctx->kind = kind;
+    g_ptr_array_add(contexts, ctx);
+    return ctx;
+}
+
+static void add_handler(uint64_t addr, const char *name)
+{
+    Handler *h;
+    Context *ctx;
+
+    if (g_hash_table_contains(handlers, &addr)) {
+        return;
+    }
+
+    /* Vectors sharing a handler share its context */
+    ctx = g_hash_table_lookup(isr_contexts, name);
+    if (!ctx) {
+        ctx = context_new(name, "isr");
+        g_hash_table_insert(isr_contexts, ctx->name, ctx);
+    }
+
+    h = g_new0(Handler, 1);
+    h->addr = addr;
+    h->ctx = ctx;
+    g_hash_table_insert(handlers, &h->addr, h);
+}
+
+/* Find the symbols used by the plugin in a little-endian ELF32 file */
+static bool read_elf(const char *path)
+{
+    g_autofree gchar *buf = NULL;
+    g_autoptr(GHashTable) func_names = NULL;
+    const uint8_t *elf, *sections, *shstr;
+    const uint8_t *vectors = NULL;
+    uint32_t vectors_size = 0;
+    gsize len;
+    uint32_t shoff, shnum, shentsize;
+    GError *err = NULL;
+
+    if (!g_file_get_contents(path, &buf, &len, &err)) {
+        fprintf(stderr, "freertos: %s\n", err->message);
+        g_error_free(err);
+        return false;
+    }
+    elf = (const uint8_t *) buf;
+    if (len < 52 || memcmp(elf, "\x7f" "ELF", 4) != 0 ||
+        elf[4] != 1 || elf[5] != 1) {
+        fprintf(stderr, "freertos: %s is not a little-endian ELF32 file\n",
+                path);
+        return false;
+    }
+
+    shoff = le32(elf + 32);
+    shentsize = le16(elf + 46);
+    shnum = le16(elf + 48);
+    if (shoff + (uint64_t) shnum * shentsize > len) {
+        fprintf(stderr, "freertos: %s: truncated section table\n", path);
+        return false;
+    }
+    sections = elf + shoff;
+    shstr = elf + le32(sections + le16(elf + 50) * shentsize + 16);
+
+    func_names = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                       g_free, NULL);
+
+    for (uint32_t i = 0; i < shnum; i++) {
+        const uint8_t *sh = sections + i * shentsize;
+        const uint8_t *strtab;
+        uint32_t type = le32(sh + 4);
+
+        if (strcmp((const char *) shstr + le32(sh), ".isr_vector") == 0) {
+            vectors = elf + le32(sh + 16);
+            vectors_size = le32(sh + 20);
+        }
+        if (type != 2 /* SHT_SYMTAB */) {
+            continue;
+        }
+
+        strtab = elf + le32(sections + le32(sh + 24) * shentsize + 16);
+        for (uint32_t off = 0; off + 16 <= le32(sh + 20); off += 16) {
+            const uint8_t *sym = elf + le32(sh + 16) + off;
+            const char *name = (const char *) strtab + le32(sym);
+            uint64_t value = le32(sym + 4);
+            uint32_t size = le32(sym + 8);
+
+            if ((sym[12] & 0xf) == 2 /* STT_FUNC */) {
+                uint64_t *key = g_new(uint64_t, 1);
+
+                *key = value & ~1ULL;
+                g_hash_table_replace(func_names, key, (gpointer) name);
+
+                if (strcmp(name, "xPortPendSVHandler") == 0) {
+                    switch_start[0] = *key;
+                    switch_end[0] = *key + size;
+                } else if (strcmp(name, "vPortSVCHandler") == 0) {
+                    switch_start[1] = *key;
+                    switch_end[1] = *key + size;
+                }
+            } else if (strcmp(name, "pxCurrentTCB") == 0) {
+                tcb_addr = value;
+            }
+        }
+    }
+
+    if (!tcb_addr || !vectors) {
+        fprintf(stderr, "freertos: %s has no pxCurrentTCB or no .isr_vector "
+                "section\n", path);
+        return false;
+    }
+
+    /* Entry 0 is the initial stack pointer and entry 1 the reset handler */
+    for (uint32_t i = 2; i < vectors_size / 4; i++) {
+        uint64_t addr = le32(vectors + i * 4) & ~1ULL;
+        const char *name;
+        char fallback[32];
+
+        if (addr == 0) {
+            continue;
+        }
+        name = g_hash_table_lookup(func_names, &addr);
+        if (!name) {
+            snprintf(fallback, sizeof(fallback), "exception %u", i);
+            name = fallback;
+        }
+        add_handler(addr, name);
+    }
+    return true;
+}
+
+/*------------------------------------------------------------------------------*/
+/* Accounting                                                                   */
+/*------------------------------------------------------------------------------*/
+
+static uint32_t read_reg(struct qemu_plugin_register *reg)
+{
+    g_autoptr(GByteArray) buf = g_byte_array_new();
+
+    if (!reg || qemu_plugin_read_register(reg, buf) < 4) {
+        return 0;
+    }
+    return le32(buf->data);
+}
+
+static bool read_mem32(uint64_t addr, uint32_t *value)
+{
+    g_autoptr(GByteArray) buf = g_byte_array_new();
+
+    if (!qemu_plugin_read_memory_vaddr(addr, buf, 4)) {
+        return false;
+    }
+    *value = le32(buf->data);
+    return true;
+}
+
+static Context *current_context(VCPUState *cpu)
+{
+    return cpu->depth ? cpu->stack[cpu->depth - 1].ctx : cpu->task;
+}
+
+static void report(void)
+{
+    g_autoptr(GString) rep = g_string_new("");
+    uint64_t total = 0;
+
+    for (guint i = 0; i < contexts->len; i++) {
+        total += ((Context *) g_ptr_array_index(contexts, i))->insns;
+    }
+
+    g_string_append(rep, "context, kind, activations, instructions, share, "
+                    "memory accesses\n");
+    for (guint i = 0; i < contexts->len; i++) {
+        Context *ctx = g_ptr_array_index(contexts, i);
+
+        if (!ctx->insns) {
+            continue;
+        }
+        g_string_append_printf(rep, "%s, %s, %" PRIu64 ", %" PRIu64
+                               ", %.2f%%, %" PRIu64 "\n",
+                               ctx->name, ctx->kind, ctx->activations,
+                               ctx->insns, total ? 100.0 * ctx->insns / total
+                                                 : 0.0,
+                               ctx->mem);
+    }
+    g_string_append(rep, "\n");
+    qemu_plugin_outs(rep->str);
+}
+
+/* Charge what ran since the last event to the context that was running */
+static void account(unsigned int vcpu_index)
+{
+    VCPUState *cpu = &cpus[vcpu_index];
+    Context *ctx = current_context(cpu);
+    uint64_t insns = qemu_plugin_u64_get(insns_entry, vcpu_index);
+    uint64_t mem = qemu_plugin_u64_get(mem_entry, vcpu_index);
+    uint64_t delta = insns - cpu->last_insns;
+
+    __atomic_fetch_add(&ctx->insns, delta, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ctx->mem, mem - cpu->last_mem, __ATOMIC_RELAXED);
+
+    if (trace && delta) {
+        g_mutex_lock(&lock);
+        fprintf(trace, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                "\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                trace_first ? "" : ",\n", ctx->name, ctx->kind, vcpu_index,
+                (double) cpu->last_insns / mips, (double) delta / mips);
+        trace_first = false;
+        g_mutex_unlock(&lock);
+    }
+
+    cpu->last_insns = insns;
+    cpu->last_mem = mem;
+
+    if (period && insns >= cpu->next_report) {
+        cpu->next_report = insns + period;
+        g_mutex_lock(&lock);
+        report();
+        g_mutex_unlock(&lock);
+    }
+}
+
+static void update_return(unsigned int vcpu_index)
+{
+    VCPUState *cpu = &cpus[vcpu_index];
+
+    qemu_plugin_u64_set(ret_entry, vcpu_index,
+                        cpu->depth ? cpu->stack[cpu->depth - 1].ret_pc
+                                   : NO_RETURN);
+}
+
+static void read_current_task(VCPUState *cpu)
+{
+    g_autoptr(GByteArray) buf = g_byte_array_new();
+    uint32_t tcb;
+    Context *task;
+
+    if (!read_mem32(tcb_addr, &tcb)) {
+        return;
+    }
+
+    g_mutex_lock(&lock);
+    task = g_hash_table_lookup(tasks, GUINT_TO_POINTER(tcb));
+    if (!task) {
+        char name[48] = "[unnamed]";
+
+        if (qemu_plugin_read_memory_vaddr(tcb + tcb_name_offset, buf,
+                                          tcb_name_len) && buf->data[0]) {
+            int len = MIN(tcb_name_len, (int) sizeof(name) - 1);
+
+            memcpy(name, buf->data, len);
+            name[len] = '\0';
+        }
+        task = context_new(name, "task");
+        g_hash_table_insert(tasks, GUINT_TO_POINTER(tcb), task);
+    }
+    g_mutex_unlock(&lock);
+
+    if (task != cpu->task) {
+        cpu->task = task;
+        __atomic_fetch_add(&task->activations, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void vcpu_exception_entry(unsigned int vcpu_index, void *userdata)
+{
+    VCPUState *cpu = &cpus[vcpu_index];
+    Handler *h = userdata;
+    uint32_t lr = read_reg(cpu->reg_lr);
+    uint32_t frame, ret_pc;
+
+    /* Only an exception entry leaves EXC_RETURN in LR */
+    if (lr < 0xffffffe0) {
+        return;
+    }
+
+    account(vcpu_index);
+
+    /* The stacked PC is 24 bytes into the frame, on PSP if from a task */
+    frame = (lr & 4) ? read_reg(cpu->reg_psp) : read_reg(cpu->reg_sp);
+    if (!read_mem32(frame + 24, &ret_pc)) {
+        return;
+    }
+    ret_pc &= ~1U;
+
+    if (cpu->depth && cpu->stack[cpu->depth - 1].ret_pc == ret_pc) {
+        /* Tail-chained after the previous handler, which has finished */
+        cpu->stack[cpu->depth - 1].ctx = h->ctx;
+    } else if (cpu->depth < MAX_NESTING) {
+        cpu->stack[cpu->depth].ctx = h->ctx;
+        cpu->stack[cpu->depth].ret_pc = ret_pc;
+        cpu->depth++;
+    }
+    __atomic_fetch_add(&h->ctx->activations, 1, __ATOMIC_RELAXED);
+    update_return(vcpu_index);
+}
+
+static void vcpu_exception_return(unsigned int vcpu_index, void *userdata)
+{
+    VCPUState *cpu = &cpus[vcpu_index];
+
+    account(vcpu_index);
+    if (cpu->depth) {
+        cpu->depth--;
+    }
+    update_return(vcpu_index);
+}
+
+static void vcpu_switch_exit(unsigned int vcpu_index, void *userdata)
+{
+    VCPUState *cpu = &cpus[vcpu_index];
+
+    account(vcpu_index);
+    if (cpu->depth) {
+        cpu->depth--;
+    }
+    read_current_task(cpu);
+    update_return(vcpu_index);
+}
+
+static bool in_switch_handler(uint64_t addr)
+{
+    for (int i = 0; i < 2; i++) {
+        if (addr >= switch_start[i] && addr < switch_end[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    uint64_t pc = qemu_plugin_tb_vaddr(tb);
+    size_t n_insns = qemu_plugin_tb_n_insns(tb);
+    Handler *h = g_hash_table_lookup(handlers, &pc);
+
+    qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+        tb, QEMU_PLUGIN_INLINE_ADD_U64, insns_entry, n_insns);
+
+    /* Runs only when this block is where the innermost exception returns */
+    qemu_plugin_register_vcpu_tb_exec_cond_cb(
+        tb, vcpu_exception_return, QEMU_PLUGIN_CB_NO_REGS,
+        QEMU_PLUGIN_COND_EQ, ret_entry, pc, NULL);
+
+    if (h) {
+        qemu_plugin_register_vcpu_tb_exec_cb(tb, vcpu_exception_entry,
+                                             QEMU_PLUGIN_CB_R_REGS, h);
+    }
+
+    for (size_t i = 0; i < n_insns; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        uint8_t code[2];
+
+        qemu_plugin_register_vcpu_mem_inline_per_vcpu(
+            insn, QEMU_PLUGIN_MEM_RW, QEMU_PLUGIN_INLINE_ADD_U64,
+            mem_entry, 1);
+
+        /* BX LR leaving PendSV or SVC, the next task is in pxCurrentTCB */
+        if (in_switch_handler(qemu_plugin_insn_vaddr(insn)) &&
+            qemu_plugin_insn_data(insn, code, 2) == 2 &&
+            le16(code) == 0x4770) {
+            qemu_plugin_register_vcpu_insn_exec_cb(insn, vcpu_switch_exit,
+                                                   QEMU_PLUGIN_CB_NO_REGS,
+                                                   NULL);
+        }
+    }
+}
+
+static void vcpu_init(qemu_plugin_id_t id, unsigned int vcpu_index)
+{
+    g_autoptr(GArray) regs = qemu_plugin_get_registers();
+    VCPUState *cpu;
+
+    g_assert(vcpu_index < max_cpus);
+    cpu = &cpus[vcpu_index];
+    cpu->task = main_context;
+    cpu->next_report = period;
+
+    for (guint i = 0; i < regs->len; i++) {
+        qemu_plugin_reg_descriptor *reg =
+            &g_array_index(regs, qemu_plugin_reg_descriptor, i);
+
+        if (g_strcmp0(reg->name, "sp") == 0) {
+            cpu->reg_sp = reg->handle;
+        } else if (g_strcmp0(reg->name, "lr") == 0) {
+            cpu->reg_lr = reg->handle;
+        } else if (g_strcmp0(reg->name, "psp") == 0) {
+            cpu->reg_psp = reg->handle;
+        }
+    }
+
+    qemu_plugin_u64_set(ret_entry, vcpu_index, NO_RETURN);
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    for (int i = 0; i < max_cpus; i++) {
+        if (cpus[i].task) {
+            account(i);
+        }
+    }
+
+    qemu_plugin_outs("final task profile\n");
+    report();
+
+    if (trace) {
+        fprintf(trace, "\n]\n");
+        fclose(trace);
+    }
+
+    qemu_plugin_scoreboard_free(counters);
+    g_hash_table_destroy(handlers);
+    g_hash_table_destroy(tasks);
+    g_hash_table_destroy(isr_contexts);
+    g_ptr_array_free(contexts, true);
+    g_free(cpus);
+    g_free(elf_path);
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    const char *trace_path = NULL;
+
+    for (int i = 0; i < argc; i++) {
+        char *opt = argv[i];
+        g_auto(GStrv) tokens = g_strsplit(opt, "=", 2);
+
+        if (g_strcmp0(tokens[0], "elf") == 0) {
+            elf_path = g_strdup(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "trace") == 0) {
+            trace_path = argv[i] + strlen("trace=");
+        } else if (g_strcmp0(tokens[0], "period") == 0) {
+            period = g_ascii_strtoull(tokens[1], NULL, 0);
+        } else if (g_strcmp0(tokens[0], "mips") == 0) {
+            mips = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "tcb_name_offset") == 0) {
+            tcb_name_offset = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "tcb_name_len") == 0) {
+            tcb_name_len = STRTOLL(tokens[1]);
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+
+    if (!info->system_emulation) {
+        fprintf(stderr, "freertos: only works in system emulation\n");
+        return -1;
+    }
+    if (!elf_path) {
+        fprintf(stderr, "freertos: the firmware must be given with elf=\n");
+        return -1;
+    }
+    if (mips <= 0) {
+        fprintf(stderr, "freertos: mips must be positive\n");
+        return -1;
+    }
+
+    handlers = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                     NULL, g_free);
+    tasks = g_hash_table_new(NULL, NULL);
+    isr_contexts = g_hash_table_new(g_str_hash, g_str_equal);
+    contexts = g_ptr_array_new_with_free_func(g_free);
+    main_context = context_new("[no task]", "task");
+
+    if (!read_elf(elf_path)) {
+        return -1;
+    }
+
+    if (trace_path) {
+        trace = fopen(trace_path, "w");
+        if (!trace) {
+            fprintf(stderr, "freertos: cannot open %s\n", trace_path);
+            return -1;
+        }
+        fprintf(trace, "[\n");
+    }
+
+    max_cpus = info->system.max_vcpus;
+    cpus = g_new0(VCPUState, max_cpus);
+
+    counters = qemu_plugin_scoreboard_new(sizeof(Counters));
+    insns_entry = qemu_plugin_scoreboard_u64_in_struct(counters, Counters,
+                                                       insns);
+    mem_entry = qemu_plugin_scoreboard_u64_in_struct(counters, Counters, mem);
+    ret_entry = qemu_plugin_scoreboard_u64_in_struct(counters, Counters,
+                                                     ret_pc);
+
+    qemu_plugin_register_vcpu_init_cb(id, vcpu_init);
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
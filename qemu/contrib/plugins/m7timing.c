@@ -0,0 +1,754 @@
+/*
+ * Cycle-approximate timing of the Cortex-M7 of the NXP S32K3
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+/*
+ * TCG only tells how many instructions ran, not how long they would take
+ * on the chip. This plugin estimates the cycles of a firmware running on
+ * the s32k3x8evb board. It is not a pipeline model: every instruction is
+ * charged the cost of its class, then
+ *
+ *  - two simple instructions in a row issue together (dual issue),
+ *  - a mispredicted branch or an exception entry refills the pipeline,
+ *  - fetches from flash and SRAM go through the L1 I-cache and pay the
+ *    wait states of the memory on a miss; fetches from ITCM are free,
+ *  - loads and stores to flash and SRAM go through the L1 D-cache, DTCM
+ *    accesses are free, TCM backdoors and peripherals pay a bus access.
+ *
+ * The estimate is reported per core, per function (from the symbols of
+ * the ELF file) and, when the address of pxCurrentTCB is given with
+ * tcb=<addr>, per FreeRTOS task. Interrupt handlers are charged to the
+ * task they interrupted, as the FreeRTOS run time statistics do.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+#define STRTOLL(x) g_ascii_strtoll(x, NULL, 0)
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+/* The Cortex-M7 caches have 32 byte lines, filled with 64 bit AXI beats */
+#define LINE_SIZE_SHIFT     5
+#define LINE_BEATS          4
+
+/* Entries of the branch target buffer */
+#define BTB_ENTRIES         64
+
+/* Areas of the s32k3x8evb address map with a different access cost */
+typedef enum {
+    REGION_TCM,         /* ITCM and DTCM at their core-local addresses */
+    REGION_FLASH,       /* PFLASH and DFLASH, cacheable */
+    REGION_SRAM,        /* System SRAM, cacheable */
+    REGION_BACKDOOR,    /* TCM backdoors, reached through the AHBS port */
+    REGION_DEVICE,      /* Peripherals and everything else */
+} Region;
+
+typedef enum {
+    INSN_ALU,
+    INSN_MUL,
+    INSN_DIV,
+    INSN_LOAD_STORE,
+    INSN_LOAD_STORE_MULTI,
+    INSN_BRANCH,
+    INSN_FP,
+    INSN_SYSTEM,
+} InsnClass;
+
+typedef struct {
+    const char *name;
+    uint64_t cycles;
+    uint64_t insns;
+} Function;
+
+typedef struct {
+    uint64_t tcb;
+    char name[32];
+    uint64_t cycles;
+    uint64_t insns;
+} Task;
+
+typedef struct {
+    uint64_t addr;
+    unsigned int size;
+    InsnClass class;
+    unsigned int cost;
+    Function *func;
+} InsnData;
+
+typedef struct {
+    uint64_t *tags;         /* sets * assoc entries, 0 is invalid */
+    uint64_t *lru;          /* Generation of the last access of each entry */
+    uint64_t generation;
+    int sets;
+    int assoc;
+    uint64_t accesses;
+    uint64_t misses;
+} Cache;
+
+typedef struct {
+    InsnData *prev;         /* Last instruction issued */
+    bool prev_paired;       /* It issued together with the one before */
+    uint64_t fetch_block;   /* Last 64 bit block fetched with the I-cache off */
+    uint8_t btb_counter[BTB_ENTRIES];
+    uint64_t btb_target[BTB_ENTRIES];
+    Cache *icache;
+    Cache *dcache;
+    Task *task;
+    bool tcb_written;
+    uint64_t cycles;
+    uint64_t insns;
+    uint64_t branches;
+    uint64_t mispredicts;
+    uint64_t exceptions;
+} VCPUState;
+
+static GMutex lock;
+static GHashTable *insns;
+static GHashTable *functions;
+static GHashTable *tasks;
+static VCPUState *cpus;
+static int cores;
+
+/* Options */
+static int limit = 20;
+static int freq_mhz = 240;
+static int flash_ws = 5;
+static int sram_ws = 1;
+static int device_ws = 4;
+static int branch_penalty = 8;
+static int exception_entry = 12;
+static bool use_icache = true;
+static bool use_dcache = true;
+static int icache_size = 8 * 1024;
+static int icache_assoc = 2;
+static int dcache_size = 8 * 1024;
+static int dcache_assoc = 4;
+static uint64_t tcb_addr;
+static int tcb_name_offset = 52;
+static int tcb_name_len = 12;
+
+static Function unknown_function = { .name = "[unknown]" };
+
+/*------------------------------------------------------------------------------*/
+
+static Region region_of(uint64_t addr)
+{
+    if (addr < 0x00010000 || (addr >= 0x20000000 && addr < 0x20020000)) {
+        return REGION_TCM;
+    }
+    if ((addr >= 0x00400000 && addr < 0x00c00000) ||
+        (addr >= 0x10000000 && addr < 0x10020000)) {
+        return REGION_FLASH;
+    }
+    if (addr >= 0x20400000 && addr < 0x204c0000) {
+        return REGION_SRAM;
+    }
+    if ((addr >= 0x11000000 && addr < 0x12000000) ||
+        (addr >= 0x21000000 && addr < 0x22000000)) {
+        return REGION_BACKDOOR;
+    }
+    return REGION_DEVICE;
+}
+
+/* Cycles of one access to the memory behind the caches */
+static int wait_states(Region region)
+{
+    switch (region) {
+    case REGION_FLASH:
+        return flash_ws;
+    case REGION_SRAM:
+        return sram_ws;
+    case REGION_BACKDOOR:
+        return sram_ws + 1;
+    case REGION_DEVICE:
+        return device_ws;
+    default:
+        return 0;
+    }
+}
+
+/*------------------------------------------------------------------------------*/
+
+static Cache *cache_new(int size, int assoc)
+{
+    Cache *cache = g_new0(Cache, 1);
+
+    cache->assoc = assoc;
+    cache->sets = size / (assoc << LINE_SIZE_SHIFT);
+    cache->tags = g_new0(uint64_t, cache->sets * assoc);
+    cache->lru = g_new0(uint64_t, cache->sets * assoc);
+    return cache;
+}
+
+static void cache_free(Cache *cache)
+{
+    g_free(cache->tags);
+    g_free(cache->lru);
+    g_free(cache);
+}
+
+/* Look the line of addr up, filling it on a miss. Returns true on a hit */
+static bool cache_access(Cache *cache, uint64_t addr)
+{
+    uint64_t line = addr >> LINE_SIZE_SHIFT;
+    uint64_t tag = line + 1;
+    int first = (line % cache->sets) * cache->assoc;
+    int victim = first;
+
+    cache->accesses++;
+    cache->generation++;
+    for (int i = first; i < first + cache->assoc; i++) {
+        if (cache->tags[i] == tag) {
+            cache->lru[i] = cache->generation;
+            return true;
+        }
+        if (cache->lru[i] < cache->lru[victim]) {
+            victim = i;
+        }
+    }
+
+    cache->misses++;
+    cache->tags[victim] = tag;
+    cache->lru[victim] = cache->generation;
+    return false;
+}
+
+/*------------------------------------------------------------------------------*/
+
+/*
+ * Sort a Thumb instruction into the classes above and give its cost in
+ * cycles when it does not wait for memory.
+ */
+static InsnClass classify(const uint8_t *code, size_t size, unsigned int *cost)
+{
+    uint16_t hw1 = code[0] | (code[1] << 8);
+    uint16_t hw2;
+    int regs;
+
+    *cost = 1;
+
+    if (size == 2) {
+        if ((hw1 & 0xf000) == 0xd000) {
+            /* B<c>, except for UDF and SVC */
+            return (hw1 & 0x0e00) == 0x0e00 ? INSN_SYSTEM : INSN_BRANCH;
+        }
+        if ((hw1 & 0xf800) == 0xe000 ||     /* B */
+            (hw1 & 0xff00) == 0x4700 ||     /* BX, BLX */
+            (hw1 & 0xf500) == 0xb100) {     /* CBZ, CBNZ */
+            return INSN_BRANCH;
+        }
+        if (((hw1 & 0xff00) == 0x4400 || (hw1 & 0xff00) == 0x4600) &&
+            (((hw1 >> 4) & 8) | (hw1 & 7)) == 15) {
+            /* ADD or MOV to the PC */
+            return INSN_BRANCH;
+        }
+        if ((hw1 & 0xf600) == 0xb400) {
+            /* PUSH, POP */
+            regs = __builtin_popcount(hw1 & 0x1ff);
+            *cost = 1 + (regs + 1) / 2;
+            return (hw1 & 0x0900) == 0x0900 ? INSN_BRANCH
+                                            : INSN_LOAD_STORE_MULTI;
+        }
+        if ((hw1 & 0xf000) == 0xc000) {
+            /* LDM, STM */
+            regs = __builtin_popcount(hw1 & 0xff);
+            *cost = 1 + (regs + 1) / 2;
+            return INSN_LOAD_STORE_MULTI;
+        }
+        if ((hw1 & 0xf800) == 0x4800 || (hw1 & 0xf000) == 0x5000 ||
+            (hw1 & 0xe000) == 0x6000 || (hw1 & 0xe000) == 0x8000) {
+            return INSN_LOAD_STORE;
+        }
+        if ((hw1 & 0xffc0) == 0x4340) {
+            return INSN_MUL;
+        }
+        if ((hw1 & 0xff00) == 0xbf00) {
+            /* IT is folded into the next instruction, hints (WFI...) are not */
+            if (hw1 & 0x000f) {
+                *cost = 0;
+                return INSN_ALU;
+            }
+            return (hw1 & 0x00f0) ? INSN_SYSTEM : INSN_ALU;
+        }
+        if ((hw1 & 0xffe8) == 0xb660) {
+            /* CPS */
+            return INSN_SYSTEM;
+        }
+        return INSN_ALU;
+    }
+
+    hw2 = code[2] | (code[3] << 8);
+
+    if ((hw1 & 0xf800) == 0xf000 && (hw2 & 0x8000)) {
+        if ((hw2 & 0x5000) == 0 && (hw1 & 0x0380) == 0x0380) {
+            /* MSR, MRS, barriers and hints */
+            *cost = 2;
+            return INSN_SYSTEM;
+        }
+        /* B<c>.W, B.W, BL */
+        return INSN_BRANCH;
+    }
+    if ((hw1 & 0xfe00) == 0xe800) {
+        if ((hw1 & 0xfff0) == 0xe8d0 && (hw2 & 0xffe0) == 0xf000) {
+            /* TBB, TBH */
+            *cost = 2;
+            return INSN_BRANCH;
+        }
+        if ((hw1 & 0x0040) == 0) {
+            /* LDM.W, STM.W, with a return when the PC is loaded */
+            regs = __builtin_popcount(hw2);
+            *cost = 1 + (regs + 1) / 2;
+            return ((hw1 & 0x0010) && (hw2 & 0x8000)) ? INSN_BRANCH
+                                                      : INSN_LOAD_STORE_MULTI;
+        }
+        /* LDRD, STRD, exclusives */
+        return INSN_LOAD_STORE;
+    }
+    if ((hw1 & 0xfe00) == 0xf800) {
+        /* Single loads and stores, LDR.W PC is a return */
+        if ((hw1 & 0x0070) == 0x0050 && (hw2 >> 12) == 15) {
+            *cost = 2;
+            return INSN_BRANCH;
+        }
+        return INSN_LOAD_STORE;
+    }
+    if ((hw1 & 0xffd0) == 0xfb90) {
+        /* SDIV, UDIV: 2 to 12 cycles depending on the operands */
+        *cost = 7;
+        return INSN_DIV;
+    }
+    if ((hw1 & 0xff00) == 0xfb00) {
+        return INSN_MUL;
+    }
+    if ((hw1 & 0xee00) == 0xec00) {
+        /* VLDR, VSTR, then VLDM, VSTM, VPUSH, VPOP */
+        if ((hw1 & 0xff20) == 0xed00) {
+            return INSN_LOAD_STORE;
+        }
+        regs = hw2 & 0xff;
+        *cost = 1 + (regs + 1) / 2;
+        return INSN_LOAD_STORE_MULTI;
+    }
+    if ((hw1 & 0xef00) == 0xee00) {
+        /* VDIV and VSQRT are iterative, the other FPU operations pipelined */
+        if (((hw1 & 0xffb0) == 0xee80 && (hw2 & 0x0e50) == 0x0a00) ||
+            ((hw1 & 0xffbf) == 0xeeb1 && (hw2 & 0x0ed0) == 0x0ac0)) {
+            *cost = (hw2 & 0x0100) ? 30 : 14;
+        }
+        return INSN_FP;
+    }
+    return INSN_ALU;
+}
+
+static bool can_issue_first(InsnClass class)
+{
+    return class == INSN_ALU || class == INSN_MUL ||
+           class == INSN_LOAD_STORE || class == INSN_FP;
+}
+
+static bool can_issue_second(InsnClass class)
+{
+    return can_issue_first(class) || class == INSN_BRANCH;
+}
+
+/* Update the branch target buffer. Returns true if the branch was predicted */
+static bool predict(VCPUState *cpu, uint64_t pc, bool taken, uint64_t target)
+{
+    int i = (pc >> 1) % BTB_ENTRIES;
+    bool predicted_taken = cpu->btb_counter[i] >= 2;
+    bool hit = predicted_taken == taken &&
+               (!taken || cpu->btb_target[i] == target);
+
+    if (taken) {
+        cpu->btb_target[i] = target;
+        if (cpu->btb_counter[i] < 3) {
+            cpu->btb_counter[i]++;
+        }
+    } else if (cpu->btb_counter[i] > 0) {
+        cpu->btb_counter[i]--;
+    }
+    return hit;
+}
+
+/*------------------------------------------------------------------------------*/
+
+static void read_current_task(VCPUState *cpu)
+{
+    g_autoptr(GByteArray) data = g_byte_array_new();
+    uint64_t tcb = 0;
+    Task *task;
+
+    if (!qemu_plugin_read_memory_vaddr(tcb_addr, data, 4)) {
+        return;
+    }
+    for (int i = 3; i >= 0; i--) {
+        tcb = (tcb << 8) | data->data[i];
+    }
+
+    g_mutex_lock(&lock);
+    task = g_hash_table_lookup(tasks, &tcb);
+    if (!task) {
+        task = g_new0(Task, 1);
+        task->tcb = tcb;
+        g_byte_array_set_size(data, 0);
+        if (tcb && qemu_plugin_read_memory_vaddr(tcb + tcb_name_offset,
+                                                 data, tcb_name_len)) {
+            int len = MIN(tcb_name_len, (int) sizeof(task->name) - 1);
+            memcpy(task->name, data->data, len);
+        }
+        if (!task->name[0]) {
+            g_strlcpy(task->name, tcb ? "[unnamed]" : "[no task]",
+                      sizeof(task->name));
+        }
+        g_hash_table_insert(tasks, &task->tcb, task);
+    }
+    g_mutex_unlock(&lock);
+
+    cpu->task = task;
+}
+
+static void charge(VCPUState *cpu, InsnData *insn, uint64_t cycles,
+                   uint64_t count)
+{
+    cpu->cycles += cycles;
+    cpu->insns += count;
+    __atomic_fetch_add(&insn->func->cycles, cycles, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&insn->func->insns, count, __ATOMIC_RELAXED);
+    if (cpu->task) {
+        __atomic_fetch_add(&cpu->task->cycles, cycles, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&cpu->task->insns, count, __ATOMIC_RELAXED);
+    }
+}
+
+static void vcpu_insn_exec(unsigned int vcpu_index, void *userdata)
+{
+    VCPUState *cpu = &cpus[vcpu_index % cores];
+    InsnData *insn = userdata;
+    InsnData *prev = cpu->prev;
+    bool sequential = prev && insn->addr == prev->addr + prev->size;
+    uint64_t cycles = insn->cost;
+    Region region = region_of(insn->addr);
+
+    if (cpu->tcb_written) {
+        cpu->tcb_written = false;
+        read_current_task(cpu);
+    }
+
+    /* Pipeline refills */
+    if (prev && prev->class == INSN_BRANCH) {
+        cpu->branches++;
+        if (!predict(cpu, prev->addr, !sequential, insn->addr)) {
+            cpu->mispredicts++;
+            cycles += branch_penalty;
+        }
+    } else if (prev && !sequential) {
+        /* Only an exception moves the PC after any other instruction */
+        cpu->exceptions++;
+        cycles += exception_entry;
+    }
+
+    /* Dual issue with the previous instruction */
+    if (sequential && !cpu->prev_paired && cycles > 0 &&
+        can_issue_first(prev->class) && can_issue_second(insn->class) &&
+        !(prev->class == INSN_LOAD_STORE && insn->class == INSN_LOAD_STORE)) {
+        cycles--;
+        cpu->prev_paired = true;
+    } else {
+        cpu->prev_paired = false;
+    }
+
+    /* Instruction fetch */
+    if (region == REGION_FLASH || region == REGION_SRAM) {
+        if (use_icache) {
+            if (!cache_access(cpu->icache, insn->addr)) {
+                cycles += wait_states(region) + LINE_BEATS;
+            }
+        } else if ((insn->addr >> 3) != cpu->fetch_block) {
+            cpu->fetch_block = insn->addr >> 3;
+            cycles += wait_states(region) + 1;
+        }
+    } else if (region != REGION_TCM) {
+        cycles += wait_states(region);
+    }
+
+    cpu->prev = insn;
+    charge(cpu, insn, cycles, 1);
+}
+
+static void vcpu_mem_access(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
+                            uint64_t vaddr, void *userdata)
+{
+    VCPUState *cpu = &cpus[vcpu_index % cores];
+    bool store = qemu_plugin_mem_is_store(info);
+    Region region = region_of(vaddr);
+    uint64_t cycles = 0;
+
+    if (store && tcb_addr && vaddr == tcb_addr) {
+        /* The scheduler switched tasks, find out which one runs next */
+        cpu->tcb_written = true;
+    }
+
+    switch (region) {
+    case REGION_TCM:
+        break;
+    case REGION_FLASH:
+    case REGION_SRAM:
+        if (use_dcache) {
+            /* Write-back, write-allocate: only line fills cost */
+            if (!cache_access(cpu->dcache, vaddr)) {
+                cycles = wait_states(region) + LINE_BEATS;
+            }
+        } else if (!store) {
+            cycles = wait_states(region) + 1;
+        }
+        break;
+    default:
+        /* Stores are posted to the write buffer */
+        cycles = store ? 1 : wait_states(region) + 1;
+        break;
+    }
+
+    if (cycles) {
+        charge(cpu, userdata, cycles, 0);
+    }
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n_insns = qemu_plugin_tb_n_insns(tb);
+
+    for (size_t i = 0; i < n_insns; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        uint64_t addr = qemu_plugin_insn_vaddr(insn);
+        const char *symbol = qemu_plugin_insn_symbol(insn);
+        uint8_t code[4] = { 0 };
+        size_t size = qemu_plugin_insn_data(insn, code, sizeof(code));
+        InsnData *data;
+        Function *func = &unknown_function;
+
+        g_mutex_lock(&lock);
+        if (symbol) {
+            func = g_hash_table_lookup(functions, symbol);
+            if (!func) {
+                func = g_new0(Function, 1);
+                func->name = symbol;
+                g_hash_table_insert(functions, (gpointer) symbol, func);
+            }
+        }
+
+        /*
+         * Keep one entry per address across retranslations, but classify
+         * the instruction again: the code at an address may have changed,
+         * as when the startup code copies functions into ITCM.
+         */
+        data = g_hash_table_lookup(insns, &addr);
+        if (!data) {
+            data = g_new0(InsnData, 1);
+            data->addr = addr;
+            g_hash_table_insert(insns, &data->addr, data);
+        }
+        data->size = qemu_plugin_insn_size(insn);
+        data->class = classify(code, size, &data->cost);
+        data->func = func;
+        g_mutex_unlock(&lock);
+
+        qemu_plugin_register_vcpu_insn_exec_cb(insn, vcpu_insn_exec,
+                                               QEMU_PLUGIN_CB_NO_REGS, data);
+        qemu_plugin_register_vcpu_mem_cb(insn, vcpu_mem_access,
+                                         QEMU_PLUGIN_CB_NO_REGS,
+                                         QEMU_PLUGIN_MEM_RW, data);
+    }
+}
+
+/*------------------------------------------------------------------------------*/
+
+static gint cmp_function(gconstpointer a, gconstpointer b)
+{
+    const Function *fa = a, *fb = b;
+
+    return fa->cycles > fb->cycles ? -1 : fa->cycles < fb->cycles;
+}
+
+static gint cmp_task(gconstpointer a, gconstpointer b)
+{
+    const Task *ta = a, *tb = b;
+
+    return ta->cycles > tb->cycles ? -1 : ta->cycles < tb->cycles;
+}
+
+static double ratio(uint64_t a, uint64_t b)
+{
+    return b ? (double) a / b : 0.0;
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autoptr(GString) rep = g_string_new("");
+    uint64_t total = 0;
+    GList *list, *it;
+    int i;
+
+    g_string_append_printf(rep, "Cortex-M7 timing estimate at %d MHz: "
+                           "flash %d ws, SRAM %d ws, I-cache %s, D-cache %s\n",
+                           freq_mhz, flash_ws, sram_ws,
+                           use_icache ? "on" : "off",
+                           use_dcache ? "on" : "off");
+
+    g_string_append(rep, "core, instructions, cycles, CPI, time (ms), "
+                    "imiss rate, dmiss rate, branches, mispredicts, "
+                    "exceptions\n");
+    for (i = 0; i < cores; i++) {
+        VCPUState *cpu = &cpus[i];
+
+        total += cpu->cycles;
+        g_string_append_printf(rep, "%d, %" PRIu64 ", %" PRIu64 ", %.2f, "
+                               "%.3f, %.2f%%, %.2f%%, %" PRIu64 ", %" PRIu64
+                               ", %" PRIu64 "\n",
+                               i, cpu->insns, cpu->cycles,
+                               ratio(cpu->cycles, cpu->insns),
+                               cpu->cycles / (freq_mhz * 1000.0),
+                               100.0 * ratio(cpu->icache->misses,
+                                             cpu->icache->accesses),
+                               100.0 * ratio(cpu->dcache->misses,
+                                             cpu->dcache->accesses),
+                               cpu->branches, cpu->mispredicts,
+                               cpu->exceptions);
+    }
+
+    g_string_append(rep, "\nfunction, cycles, share, instructions, CPI\n");
+    list = g_list_sort(g_hash_table_get_values(functions), cmp_function);
+    if (unknown_function.insns) {
+        list = g_list_insert_sorted(list, &unknown_function, cmp_function);
+    }
+    for (it = list, i = 0; it && (limit == 0 || i < limit);
+         it = it->next, i++) {
+        Function *func = it->data;
+
+        g_string_append_printf(rep, "%s, %" PRIu64 ", %.2f%%, %" PRIu64
+                               ", %.2f\n", func->name, func->cycles,
+                               100.0 * ratio(func->cycles, total),
+                               func->insns, ratio(func->cycles, func->insns));
+    }
+    g_list_free(list);
+
+    if (tcb_addr) {
+        g_string_append(rep, "\ntask, tcb, cycles, share, instructions, CPI\n");
+        list = g_list_sort(g_hash_table_get_values(tasks), cmp_task);
+        for (it = list; it; it = it->next) {
+            Task *task = it->data;
+
+            g_string_append_printf(rep, "%s, 0x%08" PRIx64 ", %" PRIu64
+                                   ", %.2f%%, %" PRIu64 ", %.2f\n",
+                                   task->name, task->tcb, task->cycles,
+                                   100.0 * ratio(task->cycles, total),
+                                   task->insns,
+                                   ratio(task->cycles, task->insns));
+        }
+        g_list_free(list);
+    }
+
+    qemu_plugin_outs(rep->str);
+
+    for (i = 0; i < cores; i++) {
+        cache_free(cpus[i].icache);
+        cache_free(cpus[i].dcache);
+    }
+    g_free(cpus);
+    g_hash_table_destroy(insns);
+    g_hash_table_destroy(functions);
+    g_hash_table_destroy(tasks);
+}
+
+static bool cache_geometry_ok(int size, int assoc)
+{
+    int sets = assoc > 0 ? size / (assoc << LINE_SIZE_SHIFT) : 0;
+
+    return sets > 0 && sets * (assoc << LINE_SIZE_SHIFT) == size;
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    cores = info->system_emulation ? info->system.smp_vcpus : 1;
+
+    for (int i = 0; i < argc; i++) {
+        char *opt = argv[i];
+        g_auto(GStrv) tokens = g_strsplit(opt, "=", 2);
+
+        if (g_strcmp0(tokens[0], "icache") == 0) {
+            if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &use_icache)) {
+                fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "dcache") == 0) {
+            if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &use_dcache)) {
+                fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "icachesize") == 0) {
+            icache_size = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "iassoc") == 0) {
+            icache_assoc = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "dcachesize") == 0) {
+            dcache_size = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "dassoc") == 0) {
+            dcache_assoc = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "freq") == 0) {
+            freq_mhz = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "flash_ws") == 0) {
+            flash_ws = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "sram_ws") == 0) {
+            sram_ws = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "device_ws") == 0) {
+            device_ws = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "branch_penalty") == 0) {
+            branch_penalty = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "tcb") == 0) {
+            tcb_addr = g_ascii_strtoull(tokens[1], NULL, 0);
+        } else if (g_strcmp0(tokens[0], "tcb_name_offset") == 0) {
+            tcb_name_offset = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "tcb_name_len") == 0) {
+            tcb_name_len = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "limit") == 0) {
+            limit = STRTOLL(tokens[1]);
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+
+    if (!cache_geometry_ok(icache_size, icache_assoc) ||
+        !cache_geometry_ok(dcache_size, dcache_assoc)) {
+        fprintf(stderr, "cache size must be a multiple of 32 * associativity\n");
+        return -1;
+    }
+    if (freq_mhz <= 0) {
+        fprintf(stderr, "freq must be positive\n");
+        return -1;
+    }
+
+    cpus = g_new0(VCPUState, cores);
+    for (int i = 0; i < cores; i++) {
+        cpus[i].icache = cache_new(icache_size, icache_assoc);
+        cpus[i].dcache = cache_new(dcache_size, dcache_assoc);
+        cpus[i].fetch_block = UINT64_MAX;
+    }
+
+    insns = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+    functions = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    tasks = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
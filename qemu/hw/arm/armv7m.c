@@ -262,6 +262,8 @@ static void armv7m_instance_init(Object *obj)
                               OBJECT(&s->nvic), "num-irq");
     object_property_add_alias(obj, "num-prio-bits",
                               OBJECT(&s->nvic), "num-prio-bits");
+    object_property_add_alias(obj, "latency-stats",
+                              OBJECT(&s->nvic), "latency-stats");
 
     object_initialize_child(obj, "systick-reg-ns", &s->systick[M_REG_NS],
                             TYPE_SYSTICK);
@@ -275,6 +277,11 @@ static void armv7m_instance_init(Object *obj)
                                 TYPE_BITBAND);
     }
 
+    object_initialize_child(obj, "dwt", &s->dwt, TYPE_ARMV7M_DWT);
+    object_initialize_child(obj, "itm", &s->itm, TYPE_ARMV7M_ITM);
+    object_property_add_alias(obj, "itm-chardev",
+                              OBJECT(&s->itm), "chardev");
+
     s->refclk = qdev_init_clock_in(DEVICE(obj), "refclk", NULL, NULL, 0);
     s->cpuclk = qdev_init_clock_in(DEVICE(obj), "cpuclk", NULL, NULL, 0);
 }
@@ -396,9 +403,9 @@ static void armv7m_realize(DeviceState *dev, Error **errp)
      * banked version of all of these.
      *
      * The default behaviour for unimplemented registers/ranges
-     * (for instance the Data Watchpoint and Trace unit at 0xe0001000)
-     * is to RAZ/WI for privileged access and BusFault for non-privileged
-     * access.
+     * (for instance the Data Watchpoint and Trace unit at 0xe0001000,
+     * unless enable-trace is set) is to RAZ/WI for privileged access
+     * and BusFault for non-privileged access.
      *
      * The NVIC and System Control Space (SCS) starts at 0xe000e000
      * and looks like this:
@@ -524,6 +531,27 @@ static void armv7m_realize(DeviceState *dev, Error **errp)
                                             sysbus_mmio_get_region(sbd, 0), 1);
     }
 
+    /* The DWT profiling counters at 0xe0001000 and the ITM at 0xe0000000 */
+    if (s->enable_trace) {
+        qdev_connect_clock_in(DEVICE(&s->dwt), "cpuclk", s->cpuclk);
+        sbd = SYS_BUS_DEVICE(&s->dwt);
+        if (!sysbus_realize(sbd, errp)) {
+            return;
+        }
+        memory_region_add_subregion_overlap(&s->container, 0xe0001000,
+                                            sysbus_mmio_get_region(sbd, 0), 1);
+
+        sbd = SYS_BUS_DEVICE(&s->itm);
+        if (!sysbus_realize(sbd, errp)) {
+            return;
+        }
+        memory_region_add_subregion_overlap(&s->container, 0xe0000000,
+                                            sysbus_mmio_get_region(sbd, 0), 1);
+    } else {
+        object_unparent(OBJECT(&s->dwt));
+        object_unparent(OBJECT(&s->itm));
+    }
+
     for (i = 0; i < ARRAY_SIZE(s->bitband); i++) {
         if (s->enable_bitband) {
             Object *obj = OBJECT(&s->bitband[i]);
@@ -555,6 +583,7 @@ static Property armv7m_properties[] = {
     DEFINE_PROP_UINT32("init-svtor", ARMv7MState, init_svtor, 0),
     DEFINE_PROP_UINT32("init-nsvtor", ARMv7MState, init_nsvtor, 0),
     DEFINE_PROP_BOOL("enable-bitband", ARMv7MState, enable_bitband, false),
+    DEFINE_PROP_BOOL("enable-trace", ARMv7MState, enable_trace, false),
     DEFINE_PROP_BOOL("start-powered-off", ARMv7MState, start_powered_off,
                      false),
     DEFINE_PROP_BOOL("vfp", ARMv7MState, vfp, true),
@@ -33,7 +33,9 @@
 #include "qemu/osdep.h"
 #include "qemu/timer.h"
 #include "qemu/log.h"
+#include "qemu/error-report.h"
 #include "qemu/typedefs.h"
+#include "qemu/units.h"
 
 /* Execution and Memory Management */
 #include "exec/memory.h"
@@ -44,32 +46,49 @@
 #include "hw/sysbus.h"
 #include "hw/boards.h"
 #include "hw/irq.h"
+#include "hw/loader.h"
 #include "hw/qdev-clock.h"
+#include "hw/qdev-properties-system.h"
 
 /* Specific Hardware Components */
 #include "hw/sd/sd.h"
 #include "hw/ssi/ssi.h"
 #include "hw/arm/boot.h"
 #include "hw/i2c/i2c.h"
-#include "hw/timer/cmsdk-apb-timer.h"
+#include "hw/timer/s32k3_pit.h"
 #include "hw/arm/armv7m.h"
+#include "hw/arm/s32k3x8evb_fuzz.h"
+#include "hw/arm/s32k3x8evb_snapshot.h"
 #include "hw/misc/unimp.h"
 
+/* Character Devices */
+#include "chardev/char.h"
+
 /* System Emulation */
 #include "sysemu/sysemu.h"
+#include "sysemu/reset.h"
+#include "sysemu/runstate.h"
+#include "sysemu/cpu-timers.h"
 #include "migration/vmstate.h"
+#include "trace.h"
 
 /* QEMU Object Model */
 #include "qom/object.h"
 
 /* QEMU API */
+#include "qapi/error.h"
 #include "qapi/qmp/qlist.h"
+#include "qapi/visitor.h"
 
 /* User Interface */
 #include "ui/input.h"
 
 /* LPUART Includes */
-#include "hw/char/stm32l4x5_usart.h"
+#include "hw/char/s32k3_lpuart.h"
+
+/* eDMA Includes */
+#include "hw/dma/s32k3_edma.h"
+#include "hw/dma/s32k3_dmamux.h"
 
 /*------------------------------------------------------------------------------*/
 
@@ -97,28 +116,25 @@ int load_image_targphys(const char *filename, hwaddr addr, hwaddr size);
 /* Function to load the firmware */
 void s32k3x8_load_firmware(ARMCPU *cpu, MachineState *ms, MemoryRegion *flash, const char *firmware_filename);
 
+typedef struct S32K3X8Variant S32K3X8Variant;
+
 /* Function to initialize the memory regions */
-void s32k3x8_initialize_memory_regions(MemoryRegion *system_memory);
+void s32k3x8_initialize_memory_regions(MemoryRegion *system_memory, const S32K3X8Variant *variant,
+                                       const char *flash_image);
+
+/* Function to initialize the tightly coupled memories of every core */
+void s32k3x8_initialize_tcm_regions(MemoryRegion **itcm, MemoryRegion **dtcm, MemoryRegion *system_memory,
+                                    const S32K3X8Variant *variant);
 
 /*------------------------------------------------------------------------------*/
 
 /* Define constants for memory regions */
 
-/* Flash memory blocks */
-#define FLASH_BLOCK0_BASE_ADDR  0x00400000    // Block0 base address
-#define FLASH_BLOCK0_SIZE       0x00200000    // 2 MB (Block0 size)
-
-#define FLASH_BLOCK1_BASE_ADDR  0x00600000    // Block1 base address
-#define FLASH_BLOCK1_SIZE       0x00200000    // 2 MB (Block1 size)
+/* Flash memory blocks (their sizes depend on the variant, see s32k3x8_variants) */
+#define FLASH_BLOCK0_BASE_ADDR  0x00400000    // Program flash, block n at BASE + n * STRIDE
+#define FLASH_BLOCK_STRIDE      0x00200000
 
-#define FLASH_BLOCK2_BASE_ADDR  0x00800000    // Block2 base address
-#define FLASH_BLOCK2_SIZE       0x00200000    // 2 MB (Block2 size)
-
-#define FLASH_BLOCK3_BASE_ADDR  0x00A00000    // Block3 base address
-#define FLASH_BLOCK3_SIZE       0x00200000    // 2 MB (Block3 size)
-
-#define FLASH_BLOCK4_BASE_ADDR  0x10000000    // Block4 base address
-#define FLASH_BLOCK4_SIZE       0x00020000    // 128 KB (Block4 size)
+#define FLASH_BLOCK4_BASE_ADDR  0x10000000    // Block4 (data flash) base address
 
 #define FLASH_UTEST_BASE_ADDR   0x1B000000    // Utest base address
 #define FLASH_UTEST_SIZE        0x00002000    // 8 KB (Utest size)
@@ -126,39 +142,216 @@ void s32k3x8_initialize_memory_regions(MemoryRegion *system_memory);
 /* SRAM memory blocks */
 
 #define SRAM_STDBY_BASE_ADDR    0x20400000    // SRAM standby base address
-#define SRAM_STDBY_SIZE         0x00010000    // 64 KB
-
-#define SRAM0_BASE_ADDR         0x20410000    // Block0  base address
-#define SRAM0_SIZE              0x00030000    // 192 KB (Block0 size) Total = 256 KB (standby + Sram0)
-
+#define SRAM0_BASE_ADDR         0x20410000    // SRAM0 base address
 #define SRAM1_BASE_ADDR         0x20440000    // SRAM1 base address
-#define SRAM1_SIZE              0x00040000    // 256 KB (Block1 size)
-
 #define SRAM2_BASE_ADDR         0x20480000    // SRAM2 base address
-#define SRAM2_SIZE              0x00040000    // 256 KB (Block2 size)
+#define SRAM3_BASE_ADDR         0x204C0000    // SRAM3 base address (S32K388)
 
-/* DTCM memory block*/
-#define DTCM0_BASE_ADDR         0x20000000    // DTCM0 base address
-#define DTCM0_SIZE              0x00020000    // 128 KB 
+/* Cores and tightly coupled memories (S32K358: up to three Cortex-M7 cores) */
+#define S32K3X8_MAX_CORES       3
 
-#define DTCM2_BASE_ADDR         0x21800000    // DTCM2 base address
-#define DTCM2_SIZE              0x00020000    // 128 KB
+#define ITCM_BASE_ADDR          0x00000000    // Core-local ITCM base address
+#define DTCM_BASE_ADDR          0x20000000    // Core-local DTCM base address
 
-/* ITCM memory block*/
-#define ITCM0_BASE_ADDR         0x00000000    // ITCM0 base address
-#define ITCM0_SIZE              0x00010000    // 64KB
+/* Backdoor (system bus) addresses of the TCMs: core n at BASE + n * STRIDE */
+#define ITCM_BACKDOOR_BASE_ADDR 0x11000000    // Core 0 ITCM backdoor
+#define DTCM_BACKDOOR_BASE_ADDR 0x21000000    // Core 0 DTCM backdoor
+#define TCM_BACKDOOR_STRIDE     0x00400000
 
-#define ITCM2_BASE_ADDR         0x00010000    // ITCM2 base address
-#define ITCM2_SIZE              0x00010000    // 64KB
+/* MSCM processor configuration registers, private to each core */
+#define MSCM_CPX_BASE_ADDR      0x40260000    // CPXTYPE, CPXNUM, CPXREV, CPXCFG0-3
+#define MSCM_CPX_SIZE           0x00000020
+#define MSCM_CPXNUM             0x4           // Logical number of the accessing core
 
 /*LPUART memory address*/
 #define UART_BASE_ADDR          0x4006A000    // UART base address
+#define S32K3X8_MAX_LPUARTS     16            // LPUART n at UART_BASE_ADDR + n * 0x1000
+#define LPUART0_IRQ             0             // LPUART n is on LPUART0_IRQ + n
 
 /* PIT Timer base addresses */
 #define PIT_TIMER1_BASE_ADDR    0x40037000    // PIT base address
 #define PIT_TIMER2_BASE_ADDR    0x40038000    // PIT base address
 #define PIT_TIMER3_BASE_ADDR    0x40039000    // PIT base address
 
+/* PIT modules interrupt lines (one line per module, shared by its 4 channels) */
+#define PIT_TIMER1_IRQ          8
+#define PIT_TIMER2_IRQ          9
+#define PIT_TIMER3_IRQ          10
+#define S32K3X8_MAX_PITS        3
+
+/* eDMA base addresses */
+#define EDMA_BASE_ADDR          0x4020C000    // eDMA management page
+#define EDMA_TCD0_BASE_ADDR     0x40210000    // Channels 0-11 pages
+#define EDMA_TCD12_BASE_ADDR    0x40410000    // Channels 12-31 pages
+#define EDMA_TCD12_FIRST        12            // First channel mapped at EDMA_TCD12_BASE_ADDR
+
+/* DMAMUX base addresses (DMAMUX0 feeds channels 0-15, DMAMUX1 channels 16-31) */
+#define DMAMUX0_BASE_ADDR       0x40280000    // DMAMUX0 base address
+#define DMAMUX1_BASE_ADDR       0x40284000    // DMAMUX1 base address
+#define NUM_DMAMUX              2
+
+/* eDMA interrupt lines (one line per channel, plus the error line) */
+#define EDMA_CH0_IRQ            32            // Channel n is on EDMA_CH0_IRQ + n
+#define EDMA_ERR_IRQ            64
+
+/* DMAMUX request sources of the LPUARTs: LPUART 0-7 on DMAMUX0, LPUART 8-15 on DMAMUX1 */
+#define LPUARTS_PER_DMAMUX      8
+#define DMAMUX_SRC_LPUART_RX(n) (2 + 2 * ((n) % LPUARTS_PER_DMAMUX))
+#define DMAMUX_SRC_LPUART_TX(n) (3 + 2 * ((n) % LPUARTS_PER_DMAMUX))
+
+/*------------------------------------------------------------------------------*/
+
+/*
+ * Descriptors of the parts of the S32K3 family: one machine per entry of
+ * s32k3x8_variants, which only creates the memories and the peripherals
+ * its part has. The address map and the interrupt lines of what exists
+ * are the same on all of them.
+ */
+
+#define S32K3X8_MAX_SRAM_BLOCKS 5
+
+typedef struct S32K3X8MemBlock {
+    const char *name;
+    hwaddr base;
+    uint64_t size;
+} S32K3X8MemBlock;
+
+struct S32K3X8Variant {
+    const char *name;                           // Machine name
+    const char *alias;                          // Other name of the machine, or NULL
+    const char *desc;
+    int num_cores;                              // Cores the software sees (a lockstep pair is one)
+    uint32_t core_clk_hz;                       // CORE_CLK, which the cores and their SysTick run at
+    uint32_t aips_plat_clk_hz;                  // AIPS_PLAT_CLK, of LPUART 0, 1 and 8
+    uint32_t aips_slow_clk_hz;                  // AIPS_SLOW_CLK, of the other LPUARTs and of the PITs
+    int num_flash_blocks;                       // Program flash blocks, at FLASH_BLOCK0_BASE_ADDR upwards
+    uint64_t flash_block_size;
+    uint64_t data_flash_size;                   // Block4
+    S32K3X8MemBlock sram[S32K3X8_MAX_SRAM_BLOCKS]; // Up to the first one of size 0
+    uint64_t itcm_size;                         // Per core
+    uint64_t dtcm_size;                         // Per core
+    int num_irq;                                // External interrupts of each NVIC
+    int num_lpuarts;
+    int lpuart_irq;                             // LPUART n is on IRQ lpuart_irq + n
+    int num_pits;
+    int pit_irq[S32K3X8_MAX_PITS];
+    int edma_ch0_irq;                           // eDMA channel n is on IRQ edma_ch0_irq + n
+    int edma_err_irq;
+};
+
+static const S32K3X8Variant s32k3x8_variants[] = {
+    {
+        .name = "s32k311evb",
+        .desc = "NXP S32K311 EVB (Cortex-M7, 1 core)",
+        .num_cores = 1,
+        .core_clk_hz = 120000000,
+        .aips_plat_clk_hz = 60000000,
+        .aips_slow_clk_hz = 30000000,
+        .num_flash_blocks = 1,
+        .flash_block_size = 1 * MiB,
+        .data_flash_size = 64 * KiB,
+        .sram = {
+            { "s32k3x8.sram_standby", SRAM_STDBY_BASE_ADDR, 64 * KiB },
+            { "s32k3x8.sram0", SRAM0_BASE_ADDR, 64 * KiB },
+        },
+        .itcm_size = 64 * KiB,
+        .dtcm_size = 128 * KiB,
+        .num_irq = 256,
+        .num_lpuarts = 4,
+        .lpuart_irq = LPUART0_IRQ,
+        .num_pits = 2,
+        .pit_irq = { PIT_TIMER1_IRQ, PIT_TIMER2_IRQ },
+        .edma_ch0_irq = EDMA_CH0_IRQ,
+        .edma_err_irq = EDMA_ERR_IRQ,
+    },
+    {
+        .name = "s32k344evb",
+        .desc = "NXP S32K344 EVB (Cortex-M7 lockstep pair)",
+        .num_cores = 1,
+        .core_clk_hz = 160000000,
+        .aips_plat_clk_hz = 80000000,
+        .aips_slow_clk_hz = 40000000,
+        .num_flash_blocks = 2,
+        .flash_block_size = 2 * MiB,
+        .data_flash_size = 128 * KiB,
+        .sram = {
+            { "s32k3x8.sram_standby", SRAM_STDBY_BASE_ADDR, 64 * KiB },
+            { "s32k3x8.sram0", SRAM0_BASE_ADDR, 192 * KiB },
+            { "s32k3x8.sram1", SRAM1_BASE_ADDR, 256 * KiB },
+        },
+        .itcm_size = 64 * KiB,
+        .dtcm_size = 128 * KiB,
+        .num_irq = 256,
+        .num_lpuarts = 16,
+        .lpuart_irq = LPUART0_IRQ,
+        .num_pits = 3,
+        .pit_irq = { PIT_TIMER1_IRQ, PIT_TIMER2_IRQ, PIT_TIMER3_IRQ },
+        .edma_ch0_irq = EDMA_CH0_IRQ,
+        .edma_err_irq = EDMA_ERR_IRQ,
+    },
+    {
+        /* The board the App is written for */
+        .name = "s32k3x8evb",
+        .alias = "s32k358evb",
+        .desc = "NXP S32K3X8 EVB (S32K358, Cortex-M7, up to 3 cores)",
+        .num_cores = 3,
+        .core_clk_hz = 240000000,
+        .aips_plat_clk_hz = 80000000,
+        .aips_slow_clk_hz = 40000000,
+        .num_flash_blocks = 4,
+        .flash_block_size = 2 * MiB,
+        .data_flash_size = 128 * KiB,
+        .sram = {
+            { "s32k3x8.sram_standby", SRAM_STDBY_BASE_ADDR, 64 * KiB },
+            { "s32k3x8.sram0", SRAM0_BASE_ADDR, 192 * KiB },
+            { "s32k3x8.sram1", SRAM1_BASE_ADDR, 256 * KiB },
+            { "s32k3x8.sram2", SRAM2_BASE_ADDR, 256 * KiB },
+        },
+        .itcm_size = 64 * KiB,
+        .dtcm_size = 128 * KiB,
+        .num_irq = 256,
+        .num_lpuarts = 16,
+        .lpuart_irq = LPUART0_IRQ,
+        .num_pits = 3,
+        .pit_irq = { PIT_TIMER1_IRQ, PIT_TIMER2_IRQ, PIT_TIMER3_IRQ },
+        .edma_ch0_irq = EDMA_CH0_IRQ,
+        .edma_err_irq = EDMA_ERR_IRQ,
+    },
+    {
+        .name = "s32k388evb",
+        .desc = "NXP S32K388 EVB (Cortex-M7, up to 3 cores)",
+        .num_cores = 3,
+        .core_clk_hz = 320000000,
+        .aips_plat_clk_hz = 160000000,
+        .aips_slow_clk_hz = 80000000,
+        .num_flash_blocks = 4,
+        .flash_block_size = 2 * MiB,
+        .data_flash_size = 128 * KiB,
+        .sram = {
+            { "s32k3x8.sram_standby", SRAM_STDBY_BASE_ADDR, 64 * KiB },
+            { "s32k3x8.sram0", SRAM0_BASE_ADDR, 192 * KiB },
+            { "s32k3x8.sram1", SRAM1_BASE_ADDR, 256 * KiB },
+            { "s32k3x8.sram2", SRAM2_BASE_ADDR, 256 * KiB },
+            { "s32k3x8.sram3", SRAM3_BASE_ADDR, 1280 * KiB },
+        },
+        .itcm_size = 64 * KiB,
+        .dtcm_size = 128 * KiB,
+        .num_irq = 256,
+        .num_lpuarts = 16,
+        .lpuart_irq = LPUART0_IRQ,
+        .num_pits = 3,
+        .pit_irq = { PIT_TIMER1_IRQ, PIT_TIMER2_IRQ, PIT_TIMER3_IRQ },
+        .edma_ch0_irq = EDMA_CH0_IRQ,
+        .edma_err_irq = EDMA_ERR_IRQ,
+    },
+};
+
+/* Span of the program flash of a variant, from FLASH_BLOCK0_BASE_ADDR */
+
+static uint64_t s32k3x8_program_flash_size(const S32K3X8Variant *variant) {
+    return (variant->num_flash_blocks - 1) * FLASH_BLOCK_STRIDE + variant->flash_block_size;
+}
+
 /*------------------------------------------------------------------------------*/
 
 /* Define the machine state */
@@ -189,8 +382,15 @@ struct ssys_state {
 
 struct S32K3X8MachineState {
     MachineState *parent_obj;
+    const S32K3X8Variant *variant;              // Part of the family emulated
     ssys_state sys;
     ARMv7MState nvic;
+    DeviceState *dmamux[NUM_DMAMUX];
+    DeviceState *cores[S32K3X8_MAX_CORES];       // ARMv7M container (CPU + NVIC) of each core
+    MemoryRegion *itcm[S32K3X8_MAX_CORES];
+    MemoryRegion *dtcm[S32K3X8_MAX_CORES];
+    DeviceState *lpuart0;                       // Console, and the input of the fuzzing harness
+    S32K3PITState *pits[S32K3X8_MAX_PITS];
 };
 typedef struct S32K3X8MachineState S32K3X8MachineState;
 
@@ -203,51 +403,94 @@ typedef struct S32K3X8MachineState S32K3X8MachineState;
 
 DECLARE_INSTANCE_CHECKER(S32K3X8MachineState, S32K3X8_MACHINE, TYPE_S32K3X8_MACHINE)
 
+/* QOM instance of the board, it only carries the user-settable machine options */
+
+struct S32K3X8EVBMachine {
+    MachineState parent_obj;
+    bool skip_idle;                             // Jump the virtual clock over idle periods
+    bool irq_latency;                           // Print the interrupt latencies of each core at exit
+    bool rewind_on_reset;                       // System resets rewind to the snapshot, once there is one
+    uint64_t snapshot_at;                       // Virtual time (ns) of the automatic snapshot, 0 for none
+    uint64_t fuzz_budget;                       // Virtual time (ns) each input of the fuzzing harness runs for
+    char *flash_image;                          // Program flash contents, mapped instead of loaded by -kernel
+};
+typedef struct S32K3X8EVBMachine S32K3X8EVBMachine;
+
+/* Class of the machine of each variant, TYPE_S32K3X8_MACHINE being their abstract parent */
+
+struct S32K3X8MachineClass {
+    MachineClass parent_class;
+    const S32K3X8Variant *variant;
+};
+
+DECLARE_OBJ_CHECKERS(S32K3X8EVBMachine, S32K3X8MachineClass, S32K3X8EVB_MACHINE, TYPE_S32K3X8_MACHINE)
+
 /*------------------------------------------------------------------------------*/
 
+/*
+ * Program flash block, either a private ROM the firmware is loaded into, or
+ * a private copy-on-write mapping of its part of the image given with
+ * "flash-image", opened read-only. The guest sees it as ROM, so the pages
+ * stay shared with every other QEMU mapping the same image through the host
+ * page cache; only a page written by the loader (an ELF segment in the
+ * program flash) gets a private copy.
+ */
+
+static void s32k3x8_initialize_flash_block(MemoryRegion *mr, const char *name, uint64_t size,
+                                           const char *flash_image, uint64_t offset) {
+
+    if (!flash_image) {
+        memory_region_init_rom(mr, NULL, name, size, &error_fatal);
+        return;
+    }
+
+#ifdef CONFIG_POSIX
+    memory_region_init_ram_from_file(mr, NULL, name, size, 0, RAM_READONLY_FD,
+                                     flash_image, offset, &error_fatal);
+    memory_region_set_readonly(mr, true);
+#else
+    error_report("flash-image is not supported on this host");
+    exit(1);
+#endif
+}
+
 /* Implementation of the function to initialize the memory regions */
 
-void s32k3x8_initialize_memory_regions(MemoryRegion *system_memory) {
+void s32k3x8_initialize_memory_regions(MemoryRegion *system_memory, const S32K3X8Variant *variant,
+                                       const char *flash_image) {
+
+    uint64_t program_flash_size = s32k3x8_program_flash_size(variant);
 
     fprintf_v(stdout, "\n------------------ Initialization of the memory regions ------------------\n");
 
     /* Initialize the memory regions for the flash, SRAM, and DRAM */
 
-    MemoryRegion *flash0 = g_new(MemoryRegion, 1);
-    MemoryRegion *flash1 = g_new(MemoryRegion, 1);
-    MemoryRegion *flash2 = g_new(MemoryRegion, 1);
-    MemoryRegion *flash3 = g_new(MemoryRegion, 1);
     MemoryRegion *flash4 = g_new(MemoryRegion, 1);
 
     MemoryRegion *utest = g_new(MemoryRegion, 1);
 
-    MemoryRegion *sram_standby = g_new(MemoryRegion, 1);
-    MemoryRegion *sram0 = g_new(MemoryRegion, 1);
-    MemoryRegion *sram1 = g_new(MemoryRegion, 1);
-    MemoryRegion *sram2 = g_new(MemoryRegion, 1);
-		
-    MemoryRegion *itcm0 = g_new(MemoryRegion, 1);
-    MemoryRegion *itcm2 = g_new(MemoryRegion, 1);
-    MemoryRegion *dtcm0 = g_new(MemoryRegion, 1);
-    MemoryRegion *dtcm2 = g_new(MemoryRegion, 1);
-
     /* Flash memory initialization (Read-Only) */
 
     fprintf_v(stdout, "\nInitializing flash memory...\n\n");
 
-    memory_region_init_rom(flash0, NULL, "s32k3x8.flash0", FLASH_BLOCK0_SIZE, &error_fatal);
-    memory_region_add_subregion(system_memory, FLASH_BLOCK0_BASE_ADDR, flash0);
-
-    memory_region_init_rom(flash1, NULL, "s32k3x8.flash1", FLASH_BLOCK1_SIZE, &error_fatal);
-    memory_region_add_subregion(system_memory, FLASH_BLOCK1_BASE_ADDR, flash1);
+    /* The image covers the program flash, from block 0 to the end of the last one */
+    if (flash_image && get_image_size(flash_image) != program_flash_size) {
+        error_report("flash-image '%s' must be %" PRIu64 " bytes, the size of the program flash",
+                     flash_image, program_flash_size);
+        exit(1);
+    }
 
-    memory_region_init_rom(flash2, NULL, "s32k3x8.flash2", FLASH_BLOCK2_SIZE, &error_fatal);
-    memory_region_add_subregion(system_memory, FLASH_BLOCK2_BASE_ADDR, flash2);
+    for (int i = 0; i < variant->num_flash_blocks; i++) {
+        MemoryRegion *flash = g_new(MemoryRegion, 1);
+        char name[32];
 
-    memory_region_init_rom(flash3, NULL, "s32k3x8.flash3", FLASH_BLOCK3_SIZE, &error_fatal);
-    memory_region_add_subregion(system_memory, FLASH_BLOCK3_BASE_ADDR, flash3);
+        snprintf(name, sizeof(name), "s32k3x8.flash%d", i);
+        s32k3x8_initialize_flash_block(flash, name, variant->flash_block_size, flash_image,
+                                       i * FLASH_BLOCK_STRIDE);
+        memory_region_add_subregion(system_memory, FLASH_BLOCK0_BASE_ADDR + i * FLASH_BLOCK_STRIDE, flash);
+    }
 
-    memory_region_init_rom(flash4, NULL, "s32k3x8.flash4", FLASH_BLOCK4_SIZE, &error_fatal);
+    memory_region_init_rom(flash4, NULL, "s32k3x8.flash4", variant->data_flash_size, &error_fatal);
     memory_region_add_subregion(system_memory, FLASH_BLOCK4_BASE_ADDR, flash4);
 
     memory_region_init_rom(utest, NULL, "s32k3x8.utest", FLASH_UTEST_SIZE, &error_fatal);
@@ -257,73 +500,309 @@ void s32k3x8_initialize_memory_regions(MemoryRegion *system_memory) {
 
     fprintf_v(stdout, "Initializing SRAM memory...\n\n");
 
-    /* SRAM Standby */
-    memory_region_init_ram(sram_standby, NULL, "s32k3x8.sram_standby", SRAM_STDBY_SIZE, &error_fatal);
-    memory_region_add_subregion_overlap(system_memory, SRAM_STDBY_BASE_ADDR, sram_standby, 0);
+    for (int i = 0; i < S32K3X8_MAX_SRAM_BLOCKS && variant->sram[i].size; i++) {
+        const S32K3X8MemBlock *block = &variant->sram[i];
+        MemoryRegion *sram = g_new(MemoryRegion, 1);
+
+        memory_region_init_ram(sram, NULL, block->name, block->size, &error_fatal);
+        memory_region_add_subregion_overlap(system_memory, block->base, sram, 0);
+        s32k3x8_snapshot_add_ram(sram, block->base);
+    }
+    
+    fprintf_v(stdout, "Memory regions initialized successfully.\n");
+}
+
+/*------------------------------------------------------------------------------*/
 
-	memory_region_init_ram(sram0, NULL, "s32k3x8.sram0", SRAM0_SIZE, &error_fatal);
-    memory_region_add_subregion_overlap(system_memory, SRAM0_BASE_ADDR, sram0, 0);
+/* Implementation of the function to initialize the TCMs */
+
+void s32k3x8_initialize_tcm_regions(MemoryRegion **itcm, MemoryRegion **dtcm, MemoryRegion *system_memory,
+                                    const S32K3X8Variant *variant) {
+
+    fprintf_v(stdout, "\nInitializing ITCM and DTCM memory...\n\n");
+
+    /*
+     * Every core has its own ITCM and DTCM. The system bus only reaches them
+     * through their backdoor addresses; each core also sees its own pair at
+     * ITCM_BASE_ADDR and DTCM_BASE_ADDR (see s32k3x8_core_memory()). The TCMs
+     * of all the cores of the part exist even when fewer cores are emulated,
+     * as on the chip.
+     */
+    for (int i = 0; i < variant->num_cores; i++) {
+        char name[32];
+        hwaddr itcm_addr = ITCM_BACKDOOR_BASE_ADDR + i * TCM_BACKDOOR_STRIDE;
+        hwaddr dtcm_addr = DTCM_BACKDOOR_BASE_ADDR + i * TCM_BACKDOOR_STRIDE;
+
+        itcm[i] = g_new(MemoryRegion, 1);
+        snprintf(name, sizeof(name), "s32k3x8.itcm%d", i);
+        memory_region_init_ram(itcm[i], NULL, name, variant->itcm_size, &error_fatal);
+        memory_region_add_subregion(system_memory, itcm_addr, itcm[i]);
+        s32k3x8_snapshot_add_ram(itcm[i], itcm_addr);
+
+        dtcm[i] = g_new(MemoryRegion, 1);
+        snprintf(name, sizeof(name), "s32k3x8.dtcm%d", i);
+        memory_region_init_ram(dtcm[i], NULL, name, variant->dtcm_size, &error_fatal);
+        memory_region_add_subregion(system_memory, dtcm_addr, dtcm[i]);
+        s32k3x8_snapshot_add_ram(dtcm[i], dtcm_addr);
+
+        fprintf_v(stdout, "Core %d: ITCM backdoor at 0x%08lx, DTCM backdoor at 0x%08lx\n", i, itcm_addr, dtcm_addr);
+    }
+}
 
-    memory_region_init_ram(sram1, NULL, "s32k3x8.sram1", SRAM1_SIZE, &error_fatal);
-    memory_region_add_subregion_overlap(system_memory, SRAM1_BASE_ADDR, sram1, 0);
+/*------------------------------------------------------------------------------*/
 
-    memory_region_init_ram(sram2, NULL, "s32k3x8.sram2", SRAM2_SIZE, &error_fatal);
-    memory_region_add_subregion_overlap(system_memory, SRAM2_BASE_ADDR, sram2, 0);
-    
-    /* ITCM memory inizialization */
+/* MSCM processor configuration registers: CPXNUM tells a core which one it is */
 
-    fprintf_v(stdout, "Initializing ITCM memory...\n\n");
+static uint64_t s32k3x8_mscm_cpx_read(void *opaque, hwaddr addr, unsigned size) {
 
-    memory_region_init_ram(itcm0, NULL, "s32k3x8.itcm0", ITCM0_SIZE, &error_fatal);
-    memory_region_add_subregion(system_memory, ITCM0_BASE_ADDR, itcm0);
+    if (addr == MSCM_CPXNUM) {
+        return GPOINTER_TO_UINT(opaque);
+    }
+
+    qemu_log_mask(LOG_UNIMP, "%s: unimplemented register at offset 0x%" HWADDR_PRIx "\n", __func__, addr);
+    return 0;
+}
+
+static void s32k3x8_mscm_cpx_write(void *opaque, hwaddr addr, uint64_t value, unsigned size) {
 
-    memory_region_init_ram(itcm2, NULL, "s32k3x8.itcm2", ITCM2_SIZE, &error_fatal);
-    memory_region_add_subregion(system_memory, ITCM2_BASE_ADDR, itcm2);
- 
-    /* DTCM memory inizialization */
+    qemu_log_mask(LOG_GUEST_ERROR, "%s: write to read-only register at offset 0x%" HWADDR_PRIx "\n", __func__, addr);
+}
 
-    fprintf_v(stdout, "Initializing DTCM memory...\n\n");
+static const MemoryRegionOps s32k3x8_mscm_cpx_ops = {
+    .read = s32k3x8_mscm_cpx_read,
+    .write = s32k3x8_mscm_cpx_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
 
-    memory_region_init_ram(dtcm0, NULL, "s32k3x8.dtcm0", DTCM0_SIZE, &error_fatal);
-    memory_region_add_subregion(system_memory, DTCM0_BASE_ADDR, dtcm0);
+/*------------------------------------------------------------------------------*/
 
-    memory_region_init_ram(dtcm2, NULL, "s32k3x8.dtcm2", DTCM2_SIZE, &error_fatal);
-    memory_region_add_subregion(system_memory, DTCM2_BASE_ADDR, dtcm2);
+/* Function to build the address space seen by one core */
 
-    fprintf_v(stdout, "Memory regions initialized successfully.\n");
+static MemoryRegion *s32k3x8_core_memory(S32K3X8MachineState *m_state, int core) {
+
+    MemoryRegion *container = g_new(MemoryRegion, 1);
+    MemoryRegion *system_alias = g_new(MemoryRegion, 1);
+    MemoryRegion *itcm_alias = g_new(MemoryRegion, 1);
+    MemoryRegion *dtcm_alias = g_new(MemoryRegion, 1);
+    MemoryRegion *mscm_cpx = g_new(MemoryRegion, 1);
+    char name[32];
+
+    snprintf(name, sizeof(name), "s32k3x8.core%d", core);
+    memory_region_init(container, NULL, name, UINT64_MAX);
+
+    /* Flash, SRAM, peripherals and the TCM backdoors are shared by all the cores */
+    snprintf(name, sizeof(name), "s32k3x8.core%d.system", core);
+    memory_region_init_alias(system_alias, NULL, name, get_system_memory(), 0, UINT64_MAX);
+    memory_region_add_subregion_overlap(container, 0, system_alias, 0);
+
+    /* The core-local TCM windows and MSCM page hide the shared map */
+    snprintf(name, sizeof(name), "s32k3x8.core%d.itcm", core);
+    memory_region_init_alias(itcm_alias, NULL, name, m_state->itcm[core], 0, m_state->variant->itcm_size);
+    memory_region_add_subregion_overlap(container, ITCM_BASE_ADDR, itcm_alias, 1);
+
+    snprintf(name, sizeof(name), "s32k3x8.core%d.dtcm", core);
+    memory_region_init_alias(dtcm_alias, NULL, name, m_state->dtcm[core], 0, m_state->variant->dtcm_size);
+    memory_region_add_subregion_overlap(container, DTCM_BASE_ADDR, dtcm_alias, 1);
+
+    snprintf(name, sizeof(name), "s32k3x8.core%d.mscm", core);
+    memory_region_init_io(mscm_cpx, NULL, &s32k3x8_mscm_cpx_ops, GUINT_TO_POINTER(core), name, MSCM_CPX_SIZE);
+    memory_region_add_subregion_overlap(container, MSCM_CPX_BASE_ADDR, mscm_cpx, 1);
+
+    return container;
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Reset handler of the secondary cores (armv7m_load_kernel() only handles core 0) */
+
+static void s32k3x8_core_reset(void *opaque) {
+    cpu_reset(CPU(opaque));
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Function to initialize one core: its ARMv7M container holds the CPU and its NVIC */
+
+static DeviceState *initialize_core(S32K3X8MachineState *m_state, Object *soc_container, int core) {
+
+    char name[16];
+    Chardev *itm_chr;
+
+    DeviceState *nvic = qdev_new(TYPE_ARMV7M); // Create a new NVIC device model
+
+    /* Add the NVIC to the SoC container */
+    snprintf(name, sizeof(name), "v7m%d", core);
+    object_property_add_child(soc_container, name, OBJECT(nvic));
+
+    /* Configure the NVIC with the number of IRQs of the part (256 for S32K358) */
+    qdev_prop_set_uint32(nvic, "num-irq", m_state->variant->num_irq);
+
+    /* Configure the number of priority bits for the NVIC */
+    qdev_prop_set_uint8(nvic, "num-prio-bits", 4);
+
+    /* Connect the NVIC to the system clock */
+    qdev_connect_clock_in(nvic, "cpuclk", m_state->sys.sysclk);
+    qdev_connect_clock_in(nvic, "refclk", m_state->sys.refclk);
+
+    /* Set the CPU type for the NVIC (retrieved from the machine state) */
+    /* In particular we are setting the cortex-m7 cpu type */
+    qdev_prop_set_string(nvic, "cpu-type", m_state->parent_obj->cpu_type);
+
+    /* Enable bit-band support for the NVIC */
+    qdev_prop_set_bit(nvic, "enable-bitband", true);
+
+    /* Interrupt latency histograms, printed when QEMU exits */
+    qdev_prop_set_bit(nvic, "latency-stats", S32K3X8EVB_MACHINE(m_state->parent_obj)->irq_latency);
+
+    /* DWT cycle counter and ITM; the trace of core n goes to "-chardev ...,id=itm<n>" */
+    qdev_prop_set_bit(nvic, "enable-trace", true);
+    snprintf(name, sizeof(name), "itm%d", core);
+    itm_chr = qemu_chr_find(name);
+    if (itm_chr) {
+        qdev_prop_set_chr(nvic, "itm-chardev", itm_chr);
+    }
+
+    /*
+     * The secondary cores boot from the vector table of the image, which is
+     * linked at the start of core 0's ITCM: reach it through its backdoor
+     */
+    if (core != 0) {
+        qdev_prop_set_uint32(nvic, "init-svtor", ITCM_BACKDOOR_BASE_ADDR);
+    }
+
+    /* Link the NVIC's memory access to the address space of this core */
+    object_property_set_link(OBJECT(nvic), "memory", OBJECT(s32k3x8_core_memory(m_state, core)), &error_abort);
+
+    /* Realize and activate the NVIC model */
+    sysbus_realize_and_unref(SYS_BUS_DEVICE(nvic), &error_fatal);
+
+    if (core != 0) {
+        qemu_register_reset(s32k3x8_core_reset, ARMV7M(nvic)->cpu);
+    }
+
+    fprintf_v(stdout, "Initialized core %d\n", core);
+
+    return nvic;
 }
 
 /*------------------------------------------------------------------------------*/
 
+/* Function to realize one LPUART device and connect it */
+
+static DeviceState *realize_lpuart(S32K3X8MachineState *m_state, DeviceState *nvic, int i) {
+
+    DeviceState *lpuart = qdev_new(TYPE_S32K3_LPUART);
+    qdev_prop_set_chr(lpuart, "chardev", serial_hd(i));
+
+    if(i==0 || i==1 || i==8) {
+        qdev_connect_clock_in(lpuart, "clk", m_state->sys.aips_plat_clk);
+    } else {
+        qdev_connect_clock_in(lpuart, "clk", m_state->sys.aips_slow_clk);
+    }
+
+    sysbus_realize_and_unref(SYS_BUS_DEVICE(lpuart), &error_fatal);
+
+    /* Calculate base address for each LPUART */
+    hwaddr base_addr = UART_BASE_ADDR + (i * 0x1000); // Assuming 0x1000 offset between LPUARTs
+    sysbus_mmio_map(SYS_BUS_DEVICE(lpuart), 0, base_addr);
+
+    /* Connect LPUART interrupt to NVIC */
+    sysbus_connect_irq(SYS_BUS_DEVICE(lpuart), 0, qdev_get_gpio_in(nvic, m_state->variant->lpuart_irq + i));
+
+    /* Connect LPUART DMA requests to its DMAMUX */
+    DeviceState *dmamux = m_state->dmamux[i / LPUARTS_PER_DMAMUX];
+    qdev_connect_gpio_out_named(lpuart, "dma-rx", 0,
+                                qdev_get_gpio_in_named(dmamux, "request", DMAMUX_SRC_LPUART_RX(i)));
+    qdev_connect_gpio_out_named(lpuart, "dma-tx", 0,
+                                qdev_get_gpio_in_named(dmamux, "request", DMAMUX_SRC_LPUART_TX(i)));
+
+    return lpuart;
+}
+
+/*
+ * An LPUART without a serial backend is only realized the first time the
+ * guest accesses its registers. Until then its window is a placeholder
+ * region, so that the unused LPUARTs cost no device, vmstate section or
+ * reset handler (the App only uses LPUART0). The access that realizes the
+ * device is forwarded to it, and the placeholder is disabled under it.
+ */
+
+typedef struct S32K3X8LazyLPUART {
+    S32K3X8MachineState *m_state;
+    DeviceState *nvic;
+    int index;
+    MemoryRegion window;                        // Placeholder, until the device is realized
+    DeviceState *dev;
+} S32K3X8LazyLPUART;
+
+static MemoryRegion *s32k3x8_lazy_lpuart_realize(S32K3X8LazyLPUART *lazy) {
+
+    if (!lazy->dev) {
+        trace_s32k3x8_lpuart_realize(lazy->index);
+        lazy->dev = realize_lpuart(lazy->m_state, lazy->nvic, lazy->index);
+        memory_region_set_enabled(&lazy->window, false);
+        s32k3x8_snapshot_add_device(lazy->dev);
+    }
+
+    return sysbus_mmio_get_region(SYS_BUS_DEVICE(lazy->dev), 0);
+}
+
+static MemTxResult s32k3x8_lazy_lpuart_read(void *opaque, hwaddr addr, uint64_t *data,
+                                            unsigned size, MemTxAttrs attrs) {
+
+    return memory_region_dispatch_read(s32k3x8_lazy_lpuart_realize(opaque), addr, data,
+                                       size_memop(size) | MO_LE, attrs);
+}
+
+static MemTxResult s32k3x8_lazy_lpuart_write(void *opaque, hwaddr addr, uint64_t data,
+                                             unsigned size, MemTxAttrs attrs) {
+
+    return memory_region_dispatch_write(s32k3x8_lazy_lpuart_realize(opaque), addr, data,
+                                        size_memop(size) | MO_LE, attrs);
+}
+
+static const MemoryRegionOps s32k3x8_lazy_lpuart_ops = {
+    .read_with_attrs = s32k3x8_lazy_lpuart_read,
+    .write_with_attrs = s32k3x8_lazy_lpuart_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+};
+
 /* Function to initialize LPUART devices */
 
 static void initialize_lpuarts(S32K3X8MachineState *m_state, DeviceState *nvic, int num_lpuarts) {
 
+    /* Their DMA requests only have sources on DMAMUX0 and DMAMUX1 */
+    assert(num_lpuarts <= S32K3X8_MAX_LPUARTS);
+
     fprintf_v(stdout, "\n---------------------- Initializing LPUART Devices -----------------------\n\n");
 
     for (int i = 0; i < num_lpuarts; i++) {
-        char device_name[32];
-        snprintf(device_name, sizeof(device_name), "s32k3x8.lpuart%d", i);
+        hwaddr base_addr = UART_BASE_ADDR + (i * 0x1000);
 
-        DeviceState *lpuart = qdev_new(TYPE_STM32L4X5_LPUART);
-        qdev_prop_set_chr(lpuart, "chardev", serial_hd(i));
+        /* LPUART0 is the console, and the input of the fuzzing harness */
+        if (i == 0 || serial_hd(i)) {
+            DeviceState *lpuart = realize_lpuart(m_state, nvic, i);
 
-	    if(i==0 || i==1 || i==8) {
-            qdev_connect_clock_in(lpuart, "clk", m_state->sys.aips_plat_clk);
-        } else {
-            qdev_connect_clock_in(lpuart, "clk", m_state->sys.aips_slow_clk);
+            if (i == 0) {
+                m_state->lpuart0 = lpuart;
+            }
+            fprintf_v(stdout, "Initialized LPUART %2d at base address 0x%08lx\n", i, base_addr);
+            continue;
         }
 
-        sysbus_realize_and_unref(SYS_BUS_DEVICE(lpuart), &error_fatal);
-
-        /* Calculate base address for each LPUART */
-        hwaddr base_addr = UART_BASE_ADDR + (i * 0x1000); // Assuming 0x1000 offset between LPUARTs
-        sysbus_mmio_map(SYS_BUS_DEVICE(lpuart), 0, base_addr);
+        S32K3X8LazyLPUART *lazy = g_new0(S32K3X8LazyLPUART, 1);
+        char name[32];
 
-        /* Connect LPUART interrupt to NVIC */
-        sysbus_connect_irq(SYS_BUS_DEVICE(lpuart), 0, qdev_get_gpio_in(nvic, i));
+        lazy->m_state = m_state;
+        lazy->nvic = nvic;
+        lazy->index = i;
+        snprintf(name, sizeof(name), "s32k3x8.lpuart%d-lazy", i);
+        memory_region_init_io(&lazy->window, NULL, &s32k3x8_lazy_lpuart_ops, lazy, name, 0x1000);
+        memory_region_add_subregion(get_system_memory(), base_addr, &lazy->window);
 
-        fprintf_v(stdout, "Initialized LPUART %2d at base address 0x%08lx\n", i, base_addr);
+        fprintf_v(stdout, "LPUART %2d at base address 0x%08lx realized on first access\n", i, base_addr);
     }
 
     fprintf_v(stdout, "\nAll LPUART devices initialized and connected to NVIC.\n");
@@ -331,6 +810,93 @@ static void initialize_lpuarts(S32K3X8MachineState *m_state, DeviceState *nvic,
 
 /*------------------------------------------------------------------------------*/
 
+/* Function to initialize the eDMA controller and its DMAMUXes */
+
+static void initialize_edma(S32K3X8MachineState *m_state, DeviceState *nvic) {
+
+    const S32K3X8Variant *variant = m_state->variant;
+    static const hwaddr dmamux_base_addr[NUM_DMAMUX] = {
+        DMAMUX0_BASE_ADDR, DMAMUX1_BASE_ADDR,
+    };
+
+    fprintf_v(stdout, "\n----------------------- Initialization of the eDMA -----------------------\n\n");
+
+    DeviceState *edma = qdev_new(TYPE_S32K3_EDMA);
+
+    /* The eDMA is a bus master on the system memory */
+    object_property_set_link(OBJECT(edma), "memory", OBJECT(get_system_memory()), &error_fatal);
+
+    sysbus_realize_and_unref(SYS_BUS_DEVICE(edma), &error_fatal);
+    sysbus_mmio_map(SYS_BUS_DEVICE(edma), 0, EDMA_BASE_ADDR);
+
+    for (int i = 0; i < S32K3_EDMA_NUM_CHANNELS; i++) {
+        /* Channel pages are split in two blocks of the peripheral space */
+        hwaddr ch_addr = i < EDMA_TCD12_FIRST
+            ? EDMA_TCD0_BASE_ADDR + i * S32K3_EDMA_CH_PAGE_SIZE
+            : EDMA_TCD12_BASE_ADDR + (i - EDMA_TCD12_FIRST) * S32K3_EDMA_CH_PAGE_SIZE;
+        sysbus_mmio_map(SYS_BUS_DEVICE(edma), 1 + i, ch_addr);
+
+        sysbus_connect_irq(SYS_BUS_DEVICE(edma), i, qdev_get_gpio_in(nvic, variant->edma_ch0_irq + i));
+    }
+    sysbus_connect_irq(SYS_BUS_DEVICE(edma), S32K3_EDMA_NUM_CHANNELS, qdev_get_gpio_in(nvic, variant->edma_err_irq));
+
+    fprintf_v(stdout, "Initialized eDMA at base address 0x%08x (IRQs %d-%d, error IRQ %d)\n",
+              EDMA_BASE_ADDR, variant->edma_ch0_irq, variant->edma_ch0_irq + S32K3_EDMA_NUM_CHANNELS - 1,
+              variant->edma_err_irq);
+
+    for (int i = 0; i < NUM_DMAMUX; i++) {
+        DeviceState *dmamux = qdev_new(TYPE_S32K3_DMAMUX);
+
+        sysbus_realize_and_unref(SYS_BUS_DEVICE(dmamux), &error_fatal);
+        sysbus_mmio_map(SYS_BUS_DEVICE(dmamux), 0, dmamux_base_addr[i]);
+
+        /* Each DMAMUX feeds 16 consecutive eDMA channels */
+        for (int ch = 0; ch < S32K3_DMAMUX_NUM_CHANNELS; ch++) {
+            qdev_connect_gpio_out(dmamux, ch, qdev_get_gpio_in(edma, i * S32K3_DMAMUX_NUM_CHANNELS + ch));
+        }
+
+        m_state->dmamux[i] = dmamux;
+
+        fprintf_v(stdout, "Initialized DMAMUX %d at base address 0x%08lx\n", i, dmamux_base_addr[i]);
+    }
+
+    fprintf_v(stdout, "\neDMA initialized and connected to NVIC.\n");
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Function to initialize PIT devices */
+
+static void initialize_pits(S32K3X8MachineState *m_state, DeviceState *nvic) {
+
+    static const hwaddr pit_base_addr[S32K3X8_MAX_PITS] = {
+        PIT_TIMER1_BASE_ADDR, PIT_TIMER2_BASE_ADDR, PIT_TIMER3_BASE_ADDR,
+    };
+    const int *pit_irq = m_state->variant->pit_irq;
+
+    fprintf_v(stdout, "\n---------------------- Initialization of the Timers ----------------------\n\n");
+
+    for (int i = 0; i < m_state->variant->num_pits; i++) {
+        DeviceState *pit = qdev_new(TYPE_S32K3_PIT);
+
+        /* The PIT modules are clocked by AIPS_SLOW_CLK */
+        qdev_connect_clock_in(pit, "clk", m_state->sys.aips_slow_clk);
+
+        sysbus_realize_and_unref(SYS_BUS_DEVICE(pit), &error_fatal);
+        sysbus_mmio_map(SYS_BUS_DEVICE(pit), 0, pit_base_addr[i]);
+        m_state->pits[i] = S32K3_PIT(pit);
+
+        /* All 4 channels of a module share the same interrupt line */
+        sysbus_connect_irq(SYS_BUS_DEVICE(pit), 0, qdev_get_gpio_in(nvic, pit_irq[i]));
+
+        fprintf_v(stdout, "Initialized PIT %d at base address 0x%08lx (IRQ %d)\n", i, pit_base_addr[i], pit_irq[i]);
+    }
+
+    fprintf_v(stdout, "\nAll PIT devices initialized and connected to NVIC.\n");
+}
+
+/*------------------------------------------------------------------------------*/
+
 /* Function to initialize the S32K3X8 board for QEMU */
 
 static void s32k3x8_init(MachineState *ms) {
@@ -344,7 +910,6 @@ static void s32k3x8_init(MachineState *ms) {
     DeviceState *nvic;                                  // Device models for NVIC and PIT timer
     Object *soc_container;                              // Container object for the System-on-Chip (SoC)
     DeviceState *syss_dev;                              // Device state for the system controller
-    DeviceState *pit_timer1,*pit_timer2,*pit_timer3;    // DeviceState for the PIT timers
     MemoryRegion *system_memory;                        // Initialize the pointer to the system memory
 
     /*--------------------------------------------------------------------------------------*/
@@ -356,14 +921,31 @@ static void s32k3x8_init(MachineState *ms) {
     /* The machine state in qemu represents the state of the machine at runtime */
     m_state->parent_obj = ms;  // Link the machine state to the parent machine state object
 
+    /* The part of the family this machine emulates */
+    m_state->variant = S32K3X8EVB_MACHINE_GET_CLASS(ms)->variant;
+
     /*--------------------------------------------------------------------------------------*/
     /*---------------Obtain a reference to the global system memory region------------------*/
     /*--------------------------------------------------------------------------------------*/
 
     system_memory = get_system_memory();
 
+    /*--------------------------------------------------------------------------------------*/
+    /*----------------------------Configure the virtual clock-------------------------------*/
+    /*--------------------------------------------------------------------------------------*/
+
+    if (S32K3X8EVB_MACHINE(ms)->skip_idle) {
+        if (icount_enabled()) {
+            error_report("skip-idle cannot be combined with -icount, "
+                         "use -icount sleep=off instead");
+            exit(1);
+        }
+        cpu_timers_set_skip_idle(true);
+    }
+
     /* Initialize memory regions for flash, SRAM, etc. */
-    s32k3x8_initialize_memory_regions(system_memory);
+    s32k3x8_initialize_memory_regions(system_memory, m_state->variant, S32K3X8EVB_MACHINE(ms)->flash_image);
+    s32k3x8_initialize_tcm_regions(m_state->itcm, m_state->dtcm, system_memory, m_state->variant);
 
     /*--------------------------------------------------------------------------------------*/
     /*------------------------Create a container object for the SoC-------------------------*/
@@ -394,17 +976,17 @@ static void s32k3x8_init(MachineState *ms) {
 
     m_state->sys.sysclk = clock_new(OBJECT(DEVICE(&m_state->sys)), "sysclk"); // Create clock object
     
-    /* Set the clock period to 4.16ns (equivalent to 240MHz frequency) */
-    clock_set_ns(m_state->sys.sysclk, 4.16);
+    /* CORE_CLK of the part (240MHz on S32K358) */
+    clock_set_hz(m_state->sys.sysclk, m_state->variant->core_clk_hz);
 
     m_state->sys.refclk = clock_new(OBJECT(DEVICE(&m_state->sys)), "refclk");
     clock_set_hz(m_state->sys.refclk, 1000000);
 
     m_state->sys.aips_plat_clk = clock_new(OBJECT(DEVICE(&m_state->sys)), "aips_plat_clk");
-    clock_set_hz(m_state->sys.aips_plat_clk, 80000000);
+    clock_set_hz(m_state->sys.aips_plat_clk, m_state->variant->aips_plat_clk_hz);
 
     m_state->sys.aips_slow_clk = clock_new(OBJECT(DEVICE(&m_state->sys)), "aips_slow_clk");
-    clock_set_hz(m_state->sys.aips_slow_clk, 40000000);
+    clock_set_hz(m_state->sys.aips_slow_clk, m_state->variant->aips_slow_clk_hz);
 
     /* Log the successful clock initialization */
     fprintf_v(stdout, "\nClock initialized.\n");
@@ -413,83 +995,39 @@ static void s32k3x8_init(MachineState *ms) {
     /*-------------Initialize the Nested Vectored Interrupt Controller (NVIC)---------------*/
     /*--------------------------------------------------------------------------------------*/
 
-    fprintf_v(stdout, "\n------------------- Initialization of the system NVIC --------------------\n");
-
-    nvic = qdev_new(TYPE_ARMV7M); // Create a new NVIC device model
-
-    /* Add the NVIC to the SoC container */
-    object_property_add_child(soc_container, "v7m", OBJECT(nvic));
-
-    /* Configure the NVIC with the number of IRQs (256 for S32K3X8) */
-    qdev_prop_set_uint32(nvic, "num-irq", 256);
+    fprintf_v(stdout, "\n------------------- Initialization of the cores and NVICs ----------------\n\n");
 
-    /* Configure the number of priority bits for the NVIC */
-    qdev_prop_set_uint8(nvic, "num-prio-bits", 4);
-
-    /* Connect the NVIC to the system clock */
-    qdev_connect_clock_in(nvic, "cpuclk", m_state->sys.sysclk);
-    qdev_connect_clock_in(nvic, "refclk", m_state->sys.refclk);
-
-    /* Set the CPU type for the NVIC (retrieved from the machine state) */
-    /* In particular we are setting the cortex-m7 cpu type */
-    qdev_prop_set_string(nvic, "cpu-type", m_state->parent_obj->cpu_type);
-
-    /* Enable bit-band support for the NVIC */
-    qdev_prop_set_bit(nvic, "enable-bitband", true);
+    /*
+     * One ARMv7M container (CPU + NVIC) per core. With more than one core
+     * TCG runs each of them in its own host thread (MTTCG is the default for
+     * Arm guests); peripheral interrupts are all routed to core 0's NVIC.
+     */
+    for (int i = 0; i < ms->smp.cpus; i++) {
+        m_state->cores[i] = initialize_core(m_state, soc_container, i);
+    }
+    nvic = m_state->cores[0];
 
-    /* Link the NVIC's memory access to the system memory */
-    object_property_set_link(OBJECT(nvic), "memory", OBJECT(get_system_memory()), &error_abort);
+    /* Log the successful realization of the NVICs */
+    fprintf_v(stdout, "\n%u core(s) and NVIC(s) realized.\n", ms->smp.cpus);
 
-    /* Realize and activate the NVIC model */
-    sysbus_realize_and_unref(SYS_BUS_DEVICE(nvic), &error_fatal);
+    /*--------------------------------------------------------------------------------------*/
+    /*-------------------------- Initialize the eDMA controller-----------------------------*/
+    /*--------------------------------------------------------------------------------------*/
 
-    /* Log the successful realization of the NVIC */
-    fprintf_v(stdout, "\nNVIC realized.\n");
+    /* Must come before the LPUARTs, which route their DMA requests to the DMAMUXes */
+    initialize_edma(m_state, nvic);
 
     /*--------------------------------------------------------------------------------------*/
     /*--------------------------Initialize the LPUART device--------------------------------*/
     /*--------------------------------------------------------------------------------------*/
 
-    initialize_lpuarts(m_state, nvic, 16);
+    initialize_lpuarts(m_state, nvic, m_state->variant->num_lpuarts);
 
     /*--------------------------------------------------------------------------------------*/
     /*-------------------------- Initialize the PIT timer-----------------------------------*/
     /*--------------------------------------------------------------------------------------*/
 
-    fprintf_v(stdout, "\n---------------------- Initialization of the Timers ----------------------\n");
-
-    /* First Timer */
-    pit_timer1 = qdev_new(TYPE_CMSDK_APB_TIMER);
-    SysBusDevice *sbd1;
-    sbd1 = SYS_BUS_DEVICE(pit_timer1);
-    qdev_connect_clock_in(DEVICE(pit_timer1), "pclk", m_state->sys.sysclk);
-    sysbus_realize_and_unref(sbd1, &error_fatal);
-    sysbus_mmio_map(sbd1, 0, PIT_TIMER1_BASE_ADDR);
-    sysbus_connect_irq(sbd1, 0, qdev_get_gpio_in(nvic, 8));
-
-    fprintf_v(stdout,"\nFirst Timer Initialized Correctly\n");
-
-    /* Second Timer */
-    pit_timer2 = qdev_new(TYPE_CMSDK_APB_TIMER);
-    SysBusDevice *sbd2;
-    sbd2 = SYS_BUS_DEVICE(pit_timer2);
-    qdev_connect_clock_in(DEVICE(pit_timer2), "pclk", m_state->sys.sysclk);
-    sysbus_realize_and_unref(sbd2, &error_fatal);
-    sysbus_mmio_map(sbd2, 0, PIT_TIMER2_BASE_ADDR);
-    sysbus_connect_irq(sbd2, 0, qdev_get_gpio_in(nvic, 9));
-
-    fprintf_v(stdout,"\nSecond Timer Initialized Correctly\n");
-
-    /* Third Timer */
-    pit_timer3 = qdev_new(TYPE_CMSDK_APB_TIMER);
-    SysBusDevice *sbd3;
-    sbd3 = SYS_BUS_DEVICE(pit_timer3);
-    qdev_connect_clock_in(DEVICE(pit_timer3), "pclk", m_state->sys.sysclk);
-    sysbus_realize_and_unref(sbd3, &error_fatal);
-    sysbus_mmio_map(sbd3, 0, PIT_TIMER3_BASE_ADDR);
-    sysbus_connect_irq(sbd3, 0, qdev_get_gpio_in(nvic, 10));
-
-    fprintf_v(stdout,"\nThird Timer Initialized Correctly\n");
+    initialize_pits(m_state, nvic);
 
     /*--------------------------------------------------------------------------------------*/
     /*--------------------Load firmware into the emulated flash memory----------------------*/
@@ -497,12 +1035,34 @@ static void s32k3x8_init(MachineState *ms) {
 
     fprintf_v(stdout, "\n---------------- Loading the Kernel into the flash memory ----------------\n");
 
-    /* The firmware file is specified in the machine state (ms->kernel_filename) */
-    armv7m_load_kernel(ARM_CPU(first_cpu), ms->kernel_filename, FLASH_BLOCK0_BASE_ADDR, FLASH_BLOCK0_SIZE + FLASH_BLOCK1_SIZE  + FLASH_BLOCK2_SIZE  + FLASH_BLOCK3_SIZE );
+    /*
+     * The firmware file is specified in the machine state (ms->kernel_filename).
+     * With "flash-image" it only holds what the image cannot: the segments
+     * outside the program flash, such as the vector table in the ITCM
+     */
+    armv7m_load_kernel(ARM_CPU(first_cpu), ms->kernel_filename, FLASH_BLOCK0_BASE_ADDR,
+                       s32k3x8_program_flash_size(m_state->variant));
 
     /* Log the successful loading of the firmware */
     fprintf_v(stdout, "\nKernel loaded into flash memory.\n\n");
 
+    /*
+     * Snapshot for the test loops to rewind to (see s32k3x8evb_snapshot.c),
+     * or for the fuzzer, when there is a "-chardev ...,id=fuzz" to its driver
+     * (see s32k3x8evb_fuzz.c)
+     */
+    Chardev *fuzz_chr = qemu_chr_find("fuzz");
+    if (fuzz_chr) {
+        if (!S32K3X8EVB_MACHINE(ms)->snapshot_at) {
+            error_report("the fuzzing harness needs the snapshot-at machine option");
+            exit(1);
+        }
+        s32k3x8_fuzz_init(fuzz_chr, S32K3_LPUART(m_state->lpuart0), m_state->pits, m_state->variant->num_pits,
+                          S32K3X8EVB_MACHINE(ms)->snapshot_at, S32K3X8EVB_MACHINE(ms)->fuzz_budget);
+    } else if (S32K3X8EVB_MACHINE(ms)->snapshot_at) {
+        s32k3x8_snapshot_save_at(S32K3X8EVB_MACHINE(ms)->snapshot_at);
+    }
+
     /* Log the completion of the board initialization */
     fprintf_v(stdout, "System initialized.\n\n");
 
@@ -513,20 +1073,175 @@ static void s32k3x8_init(MachineState *ms) {
 
 /*------------------------------------------------------------------------------*/
 
-/* Implementation of the class init function */
+/* Reset of the machine: a rewind to the snapshot with "rewind-on-reset" */
+
+static void s32k3x8_reset(MachineState *ms, ResetType type) {
+
+    if (S32K3X8EVB_MACHINE(ms)->rewind_on_reset && type == RESET_TYPE_COLD && s32k3x8_snapshot_valid()) {
+        Error *err = NULL;
+        bool running = runstate_is_running();
+        bool rewound;
+
+        /*
+         * The vCPUs are paused, but the virtual clock has to stop too while
+         * it is reloaded. A reset from the monitor of a stopped VM finds it
+         * stopped already, and leaves it so.
+         */
+        if (running) {
+            cpu_disable_ticks();
+        }
+        rewound = s32k3x8_snapshot_restore(NULL, &err);
+        if (running) {
+            cpu_enable_ticks();
+        }
+
+        if (rewound) {
+            return;
+        }
+        error_report_err(err);
+    }
+
+    qemu_devices_reset(type);
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Accessors of the "skip-idle" machine property */
+
+static bool s32k3x8_get_skip_idle(Object *obj, Error **errp) {
+    return S32K3X8EVB_MACHINE(obj)->skip_idle;
+}
+
+static void s32k3x8_set_skip_idle(Object *obj, bool value, Error **errp) {
+    S32K3X8EVB_MACHINE(obj)->skip_idle = value;
+}
+
+/* Accessors of the "irq-latency" machine property */
+
+static bool s32k3x8_get_irq_latency(Object *obj, Error **errp) {
+    return S32K3X8EVB_MACHINE(obj)->irq_latency;
+}
+
+static void s32k3x8_set_irq_latency(Object *obj, bool value, Error **errp) {
+    S32K3X8EVB_MACHINE(obj)->irq_latency = value;
+}
+
+/* Accessors of the "rewind-on-reset" machine property */
+
+static bool s32k3x8_get_rewind_on_reset(Object *obj, Error **errp) {
+    return S32K3X8EVB_MACHINE(obj)->rewind_on_reset;
+}
+
+static void s32k3x8_set_rewind_on_reset(Object *obj, bool value, Error **errp) {
+    S32K3X8EVB_MACHINE(obj)->rewind_on_reset = value;
+}
+
+/* Accessors of the "snapshot-at" machine property */
+
+static void s32k3x8_get_snapshot_at(Object *obj, Visitor *v, const char *name, void *opaque, Error **errp) {
+    visit_type_uint64(v, name, &S32K3X8EVB_MACHINE(obj)->snapshot_at, errp);
+}
+
+static void s32k3x8_set_snapshot_at(Object *obj, Visitor *v, const char *name, void *opaque, Error **errp) {
+    visit_type_uint64(v, name, &S32K3X8EVB_MACHINE(obj)->snapshot_at, errp);
+}
+
+/* Accessors of the "flash-image" machine property */
+
+static char *s32k3x8_get_flash_image(Object *obj, Error **errp) {
+    return g_strdup(S32K3X8EVB_MACHINE(obj)->flash_image);
+}
+
+static void s32k3x8_set_flash_image(Object *obj, const char *value, Error **errp) {
+    g_free(S32K3X8EVB_MACHINE(obj)->flash_image);
+    S32K3X8EVB_MACHINE(obj)->flash_image = g_strdup(value);
+}
+
+/* Accessors of the "fuzz-budget" machine property */
+
+static void s32k3x8_get_fuzz_budget(Object *obj, Visitor *v, const char *name, void *opaque, Error **errp) {
+    visit_type_uint64(v, name, &S32K3X8EVB_MACHINE(obj)->fuzz_budget, errp);
+}
+
+static void s32k3x8_set_fuzz_budget(Object *obj, Visitor *v, const char *name, void *opaque, Error **errp) {
+    uint64_t value;
+
+    if (!visit_type_uint64(v, name, &value, errp)) {
+        return;
+    }
+    if (value == 0 || value > INT64_MAX) {
+        error_setg(errp, "fuzz-budget must be between 1 and %" PRId64 " ns", INT64_MAX);
+        return;
+    }
+    S32K3X8EVB_MACHINE(obj)->fuzz_budget = value;
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Implementation of the class init function, common to all the variants */
 
 static void s32k3x8_class_init(ObjectClass *oc, void *data) {
     MachineClass *mc = MACHINE_CLASS(oc);
-    mc->name = g_strdup("s32k3x8evb");
-    mc->desc = "NXP S32K3X8 EVB (Cortex-M7)";
     mc->init = s32k3x8_init;
+    mc->reset = s32k3x8_reset;
     mc->default_cpu_type = ARM_CPU_TYPE_NAME("cortex-m7");
     mc->default_cpus = 1;
     mc->min_cpus = mc->default_cpus;
-    mc->max_cpus = mc->default_cpus;
     mc->no_floppy = 1;
     mc->no_cdrom = 1;
     mc->no_parallel = 1;
+
+    object_class_property_add_bool(oc, "skip-idle", s32k3x8_get_skip_idle, s32k3x8_set_skip_idle);
+    object_class_property_set_description(oc, "skip-idle",
+        "Move the virtual clock straight to the next timer deadline "
+        "whenever every core is sleeping in WFI/WFE");
+
+    object_class_property_add_bool(oc, "irq-latency", s32k3x8_get_irq_latency, s32k3x8_set_irq_latency);
+    object_class_property_set_description(oc, "irq-latency",
+        "Measure the latency and the duration of every interrupt and "
+        "print their histograms when QEMU exits");
+
+    object_class_property_add(oc, "snapshot-at", "uint64",
+                              s32k3x8_get_snapshot_at, s32k3x8_set_snapshot_at, NULL, NULL);
+    object_class_property_set_description(oc, "snapshot-at",
+        "Take an in-memory snapshot of the machine when the virtual clock "
+        "reaches this time in ns (see x-s32k3x8-snapshot-save)");
+
+    object_class_property_add_bool(oc, "rewind-on-reset", s32k3x8_get_rewind_on_reset,
+                                   s32k3x8_set_rewind_on_reset);
+    object_class_property_set_description(oc, "rewind-on-reset",
+        "Once a snapshot has been taken, turn every system reset into a "
+        "rewind to it, which only copies back the dirty RAM pages");
+
+    object_class_property_add(oc, "fuzz-budget", "uint64",
+                              s32k3x8_get_fuzz_budget, s32k3x8_set_fuzz_budget, NULL, NULL);
+    object_class_property_set_description(oc, "fuzz-budget",
+        "Virtual time in ns each input of the fuzzing harness runs for "
+        "(default: 100 ms)");
+
+    object_class_property_add_str(oc, "flash-image", s32k3x8_get_flash_image, s32k3x8_set_flash_image);
+    object_class_property_set_description(oc, "flash-image",
+        "Map the program flash copy-on-write from this image of it, "
+        "rendered from the firmware once and shared by every QEMU that "
+        "maps it; -kernel then only loads the rest of the firmware");
+}
+
+/* Class init function of the machine of one variant (data) */
+
+static void s32k3x8_variant_class_init(ObjectClass *oc, void *data) {
+    MachineClass *mc = MACHINE_CLASS(oc);
+    const S32K3X8Variant *variant = data;
+
+    S32K3X8EVB_MACHINE_CLASS(oc)->variant = variant;
+    mc->desc = variant->desc;
+    mc->alias = variant->alias;
+    mc->max_cpus = variant->num_cores;
+}
+
+/* Default values of the machine options */
+
+static void s32k3x8_instance_init(Object *obj) {
+    S32K3X8EVB_MACHINE(obj)->fuzz_budget = 100 * SCALE_MS;
 }
 
 /*------------------------------------------------------------------------------*/
@@ -536,6 +1251,10 @@ static void s32k3x8_class_init(ObjectClass *oc, void *data) {
 static const TypeInfo s32k3x8_machine_types = {
     .name           = TYPE_S32K3X8_MACHINE,
     .parent         = TYPE_MACHINE,
+    .abstract       = true,
+    .instance_size  = sizeof(S32K3X8EVBMachine),
+    .instance_init  = s32k3x8_instance_init,
+    .class_size     = sizeof(S32K3X8MachineClass),
     .class_init     = s32k3x8_class_init,
 };
 
@@ -548,6 +1267,19 @@ static const TypeInfo s32k3x8evb_sys_info = {
 static void s32k3x8evb_machine_init(void) {
     type_register_static(&s32k3x8_machine_types);
     type_register_static(&s32k3x8evb_sys_info);
+
+    /* One machine per part of the family */
+    for (int i = 0; i < ARRAY_SIZE(s32k3x8_variants); i++) {
+        g_autofree char *name = g_strdup_printf("%s" TYPE_MACHINE_SUFFIX, s32k3x8_variants[i].name);
+        TypeInfo variant_info = {
+            .name       = name,
+            .parent     = TYPE_S32K3X8_MACHINE,
+            .class_init = s32k3x8_variant_class_init,
+            .class_data = (void *)&s32k3x8_variants[i],
+        };
+
+        type_register(&variant_info);
+    }
 }
 
 type_init(s32k3x8evb_machine_init);
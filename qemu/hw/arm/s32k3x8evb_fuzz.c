@@ -0,0 +1,306 @@
+/*
+ * NXP S32K3X8EVB snapshot fuzzing harness
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+/*
+ * Runs the inputs of a coverage-guided fuzzer against the firmware, in a
+ * single QEMU: the machine boots once, is snapshotted at "snapshot-at",
+ * and is rewound to the snapshot (see s32k3x8evb_snapshot.c) before each
+ * input, which costs the few dirty pages of the previous run instead of
+ * a boot. The fuzzer, e.g. the libFuzzer driver in App/Fuzz, talks to the
+ * board over the chardev with id "fuzz":
+ *
+ *   QEMU -> driver   u32 S32K3X8_FUZZ_READY, once the snapshot is taken
+ *   driver -> QEMU   u32 length, then the input
+ *   QEMU -> driver   u32 status, u32 CFSR, u32 HFSR, once the input ran
+ *
+ * all little-endian. An input is a sequence of 4 byte records
+ *
+ *   u8 kind, u8 arg, u16 delay
+ *
+ * applied "delay" us of virtual time after the previous one:
+ *
+ *   kind % 3 == 0    arg is received by LPUART0
+ *   kind % 3 == 1    PIT module (arg & 3) % npits stalls for
+ *                    ((arg >> 2) + 1) * 16 us, see s32k3_pit_stall()
+ *   kind % 3 == 2    nothing, the time just passes
+ *
+ * The input ends "fuzz-budget" ns after the rewind; records past the end
+ * are dropped. A fault is reported when a core has a sticky bit set in
+ * its CFSR or HFSR: the firmware does not recover from them. A lockup
+ * aborts QEMU, which the driver reports as a crash too. The edge coverage
+ * is collected separately, by the edgecov TCG plugin.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "qemu/error-report.h"
+#include "qemu/main-loop.h"
+#include "qemu/timer.h"
+#include "qemu/units.h"
+#include "qapi/error.h"
+#include "chardev/char-fe.h"
+#include "hw/core/cpu.h"
+#include "hw/arm/s32k3x8evb_fuzz.h"
+#include "hw/arm/s32k3x8evb_snapshot.h"
+#include "sysemu/runstate.h"
+#include "target/arm/cpu.h"
+#include "trace.h"
+
+/* Largest input accepted from the driver */
+#define S32K3X8_FUZZ_MAX_INPUT      (1 * MiB)
+
+#define S32K3X8_FUZZ_RECORD_SIZE    4
+#define S32K3X8_FUZZ_MAX_PITS       4
+
+enum {
+    S32K3X8_FUZZ_OP_RX,
+    S32K3X8_FUZZ_OP_STALL,
+    S32K3X8_FUZZ_OP_IDLE,
+    S32K3X8_FUZZ_OP_KINDS,
+};
+
+typedef struct S32K3X8FuzzOp {
+    int64_t when;                   // Virtual time at which the op applies
+    uint8_t kind;
+    uint8_t arg;
+} S32K3X8FuzzOp;
+
+typedef struct S32K3X8Fuzz {
+    CharBackend chr;
+    S32K3LPUARTState *uart;
+    S32K3PITState *pits[S32K3X8_FUZZ_MAX_PITS];
+    int npits;
+    int64_t budget_ns;
+    QEMUTimer *ready_timer;         // Time of the snapshot
+    QEMUTimer *timer;               // Next op or end of the input
+    GByteArray *rx;                 // Bytes received from the driver and not consumed yet
+    GArray *ops;                    // S32K3X8FuzzOp of the running input
+    guint next_op;
+    int64_t end;
+    bool ready;                     // The snapshot has been taken
+    bool running;                   // An input is running
+} S32K3X8Fuzz;
+
+static S32K3X8Fuzz fuzz;
+
+static void s32k3x8_fuzz_process(void);
+
+/*------------------------------------------------------------------------------*/
+
+/* Apply the ops that are due, then wait for the next one or for the end of the input */
+
+static void s32k3x8_fuzz_op(S32K3X8FuzzOp *op) {
+
+    int pit;
+
+    switch (op->kind) {
+    case S32K3X8_FUZZ_OP_RX:
+        /* A byte that finds the FIFO full is lost, as on the wire */
+        s32k3_lpuart_inject_rx(fuzz.uart, &op->arg, 1);
+        break;
+    case S32K3X8_FUZZ_OP_STALL:
+        pit = (op->arg & 3) % fuzz.npits;
+        s32k3_pit_stall(fuzz.pits[pit], ((op->arg >> 2) + 1) * 16 * SCALE_US);
+        break;
+    default:
+        break;
+    }
+}
+
+static void s32k3x8_fuzz_end_bh(void *opaque);
+
+static void s32k3x8_fuzz_timer(void *opaque) {
+
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    while (fuzz.next_op < fuzz.ops->len) {
+        S32K3X8FuzzOp *op = &g_array_index(fuzz.ops, S32K3X8FuzzOp, fuzz.next_op);
+
+        if (op->when > now) {
+            timer_mod(fuzz.timer, op->when);
+            return;
+        }
+        s32k3x8_fuzz_op(op);
+        fuzz.next_op++;
+    }
+
+    if (now < fuzz.end) {
+        timer_mod(fuzz.timer, fuzz.end);
+        return;
+    }
+
+    /* With icount the timer runs in the vCPU thread, which cannot stop the VM itself */
+    aio_bh_schedule_oneshot(qemu_get_aio_context(), s32k3x8_fuzz_end_bh, NULL);
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Rewind the machine and run an input */
+
+static void s32k3x8_fuzz_start(const uint8_t *input, uint32_t size) {
+
+    int64_t when;
+    Error *err = NULL;
+
+    if (!s32k3x8_snapshot_restore(NULL, &err)) {
+        error_report_err(err);
+        exit(1);
+    }
+
+    /* The virtual clock is back at the time of the snapshot */
+    when = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    fuzz.end = when + fuzz.budget_ns;
+
+    g_array_set_size(fuzz.ops, 0);
+    for (uint32_t i = 0; i + S32K3X8_FUZZ_RECORD_SIZE <= size; i += S32K3X8_FUZZ_RECORD_SIZE) {
+        S32K3X8FuzzOp op = {
+            .kind = input[i] % S32K3X8_FUZZ_OP_KINDS,
+            .arg = input[i + 1],
+        };
+
+        when += lduw_le_p(&input[i + 2]) * SCALE_US;
+        if (when > fuzz.end) {
+            break;
+        }
+        op.when = when;
+        g_array_append_val(fuzz.ops, op);
+    }
+    fuzz.next_op = 0;
+
+    trace_s32k3x8_fuzz_start(size, fuzz.ops->len);
+    fuzz.running = true;
+    timer_mod(fuzz.timer, fuzz.ops->len ? g_array_index(fuzz.ops, S32K3X8FuzzOp, 0).when : fuzz.end);
+    vm_start();
+}
+
+/* Report how the input ended and move to the next one */
+
+static void s32k3x8_fuzz_end_bh(void *opaque) {
+
+    uint32_t cfsr = 0, hfsr = 0, status = 0;
+    uint8_t reply[12];
+    CPUState *cpu;
+
+    vm_stop(RUN_STATE_PAUSED);
+    timer_del(fuzz.timer);
+
+    CPU_FOREACH(cpu) {
+        CPUARMState *env = &ARM_CPU(cpu)->env;
+
+        cfsr |= env->v7m.cfsr[M_REG_NS] | env->v7m.cfsr[M_REG_S];
+        hfsr |= env->v7m.hfsr;
+    }
+    if (cfsr || hfsr) {
+        status |= S32K3X8_FUZZ_STATUS_FAULT;
+    }
+
+    trace_s32k3x8_fuzz_end(status, cfsr, hfsr);
+    stl_le_p(&reply[0], status);
+    stl_le_p(&reply[4], cfsr);
+    stl_le_p(&reply[8], hfsr);
+    qemu_chr_fe_write_all(&fuzz.chr, reply, sizeof(reply));
+
+    fuzz.running = false;
+    s32k3x8_fuzz_process();
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Chardev to the driver */
+
+static void s32k3x8_fuzz_process(void) {
+
+    uint32_t size;
+
+    if (!fuzz.ready || fuzz.running || fuzz.rx->len < 4) {
+        qemu_chr_fe_accept_input(&fuzz.chr);
+        return;
+    }
+
+    size = ldl_le_p(fuzz.rx->data);
+    if (size > S32K3X8_FUZZ_MAX_INPUT) {
+        error_report("fuzz: input of %u bytes, the limit is %u", size, (uint32_t)S32K3X8_FUZZ_MAX_INPUT);
+        exit(1);
+    }
+    if (fuzz.rx->len < 4 + size) {
+        qemu_chr_fe_accept_input(&fuzz.chr);
+        return;
+    }
+
+    s32k3x8_fuzz_start(fuzz.rx->data + 4, size);
+    g_byte_array_remove_range(fuzz.rx, 0, 4 + size);
+}
+
+static int s32k3x8_fuzz_can_receive(void *opaque) {
+
+    /* The driver waits for the status of an input before it sends the next one */
+    return fuzz.running ? 0 : 4 * KiB;
+}
+
+static void s32k3x8_fuzz_receive(void *opaque, const uint8_t *buf, int size) {
+
+    g_byte_array_append(fuzz.rx, buf, size);
+    s32k3x8_fuzz_process();
+}
+
+static void s32k3x8_fuzz_event(void *opaque, QEMUChrEvent event) {
+
+    /* Without its driver the harness has nothing left to do */
+    if (event == CHR_EVENT_CLOSED) {
+        qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_ERROR);
+    }
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Snapshot the booted firmware, and tell the driver it can send inputs */
+
+static void s32k3x8_fuzz_ready_bh(void *opaque) {
+
+    uint8_t magic[4];
+    Error *err = NULL;
+
+    vm_stop(RUN_STATE_PAUSED);
+    if (!s32k3x8_snapshot_save(&err)) {
+        error_report_err(err);
+        exit(1);
+    }
+
+    stl_le_p(magic, S32K3X8_FUZZ_READY);
+    qemu_chr_fe_write_all(&fuzz.chr, magic, sizeof(magic));
+
+    fuzz.ready = true;
+    s32k3x8_fuzz_process();
+}
+
+static void s32k3x8_fuzz_ready_timer(void *opaque) {
+
+    /* Same as s32k3x8_fuzz_timer(): the VM is stopped from the main loop */
+    aio_bh_schedule_oneshot(qemu_get_aio_context(), s32k3x8_fuzz_ready_bh, NULL);
+}
+
+void s32k3x8_fuzz_init(Chardev *chr, S32K3LPUARTState *uart, S32K3PITState **pits, int npits,
+                       int64_t snapshot_ns, int64_t budget_ns) {
+
+    assert(npits > 0 && npits <= S32K3X8_FUZZ_MAX_PITS);
+
+    fuzz.uart = uart;
+    memcpy(fuzz.pits, pits, npits * sizeof(*pits));
+    fuzz.npits = npits;
+    fuzz.budget_ns = budget_ns;
+    fuzz.rx = g_byte_array_new();
+    fuzz.ops = g_array_new(false, false, sizeof(S32K3X8FuzzOp));
+
+    qemu_chr_fe_init(&fuzz.chr, chr, &error_fatal);
+    qemu_chr_fe_set_handlers(&fuzz.chr, s32k3x8_fuzz_can_receive, s32k3x8_fuzz_receive,
+                             s32k3x8_fuzz_event, NULL, NULL, NULL, true);
+
+    fuzz.timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, s32k3x8_fuzz_timer, NULL);
+    fuzz.ready_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, s32k3x8_fuzz_ready_timer, NULL);
+    timer_mod(fuzz.ready_timer, snapshot_ns);
+}
@@ -0,0 +1,336 @@
+/*
+ * NXP S32K3X8EVB in-memory snapshot and fast rewind
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+/*
+ * A test loop boots the firmware once, takes a snapshot, then rewinds the
+ * machine to it before every scenario instead of starting a new QEMU. The
+ * firmware only writes to a few KB of the SRAM and TCMs between two
+ * rewinds, so the RAM blocks of the board are dirty-logged (with the same
+ * DIRTY_MEMORY_VGA client display devices use to find which lines of
+ * their framebuffer changed) and only the dirty pages are copied back.
+ * Everything else (CPUs, NVICs, PITs, LPUARTs, eDMA and the virtual
+ * clock) is small, and is reloaded from the device state saved through
+ * the migration code, as COLO does for its checkpoints.
+ *
+ * The snapshot is driven from QMP (x-s32k3x8-snapshot-save and
+ * x-s32k3x8-snapshot-restore), or from the command line with the
+ * "snapshot-at" and "rewind-on-reset" machine options, where each system
+ * reset requested by the guest or the monitor becomes a rewind.
+ *
+ * Flash is not part of the snapshot: the guest cannot write to it. Nor
+ * are the devices the board only realizes once the guest uses them (see
+ * s32k3x8_snapshot_add_device()), until the next snapshot.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/error-report.h"
+#include "qemu/main-loop.h"
+#include "qemu/timer.h"
+#include "qemu/units.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-misc-target.h"
+#include "exec/address-spaces.h"
+#include "exec/exec-all.h"
+#include "exec/memory.h"
+#include "exec/target_page.h"
+#include "hw/core/cpu.h"
+#include "hw/qdev-core.h"
+#include "hw/arm/s32k3x8evb_snapshot.h"
+#include "io/channel-buffer.h"
+#include "migration/qemu-file.h"
+#include "migration/savevm.h"
+#include "sysemu/runstate.h"
+#include "sysemu/tcg.h"
+#include "trace.h"
+
+/* Initial size of the buffer the device state is saved to */
+#define S32K3X8_SNAPSHOT_DEVICE_BUFFER  (64 * KiB)
+
+typedef struct S32K3X8SnapshotRAM {
+    MemoryRegion *mr;
+    hwaddr addr;                    // Where mr is mapped in address_space_memory
+    uint64_t size;
+    uint8_t *copy;                  // Contents at the time of the snapshot
+} S32K3X8SnapshotRAM;
+
+typedef struct S32K3X8Snapshot {
+    GArray *ram;                    // S32K3X8SnapshotRAM, one per RAM block of the board
+    uint8_t *devices;               // Device state, as written by qemu_save_device_state()
+    size_t devices_size;
+    GPtrArray *new_devices;         // DeviceState realized since the snapshot
+    bool valid;
+    QEMUTimer *save_timer;
+} S32K3X8Snapshot;
+
+static S32K3X8Snapshot snapshot;
+
+/*------------------------------------------------------------------------------*/
+
+void s32k3x8_snapshot_add_ram(MemoryRegion *mr, hwaddr addr) {
+
+    S32K3X8SnapshotRAM ram = {
+        .mr = mr,
+        .addr = addr,
+        .size = memory_region_size(mr),
+    };
+
+    if (!snapshot.ram) {
+        snapshot.ram = g_array_new(false, true, sizeof(S32K3X8SnapshotRAM));
+    }
+    g_array_append_val(snapshot.ram, ram);
+}
+
+void s32k3x8_snapshot_add_device(DeviceState *dev) {
+
+    /* A device realized before the first snapshot is saved with the others */
+    if (!snapshot.valid) {
+        return;
+    }
+    if (!snapshot.new_devices) {
+        snapshot.new_devices = g_ptr_array_new();
+    }
+    g_ptr_array_add(snapshot.new_devices, dev);
+}
+
+bool s32k3x8_snapshot_valid(void) {
+    return snapshot.valid;
+}
+
+/*------------------------------------------------------------------------------*/
+
+bool s32k3x8_snapshot_save(Error **errp) {
+
+    QIOChannelBuffer *bioc;
+    QEMUFile *f;
+    uint64_t ram_bytes = 0;
+    int ret;
+
+    /* The device state first: unlike the copy of the RAM, it can fail */
+    bioc = qio_channel_buffer_new(S32K3X8_SNAPSHOT_DEVICE_BUFFER);
+    qio_channel_set_name(QIO_CHANNEL(bioc), "s32k3x8-snapshot-save");
+    f = qemu_file_new_output(QIO_CHANNEL(bioc));
+
+    ret = qemu_save_device_state(f);
+    if (ret == 0) {
+        ret = qemu_fflush(f);
+    }
+    if (ret == 0) {
+        g_free(snapshot.devices);
+        snapshot.devices = g_memdup2(bioc->data, bioc->usage);
+        snapshot.devices_size = bioc->usage;
+    }
+    qemu_fclose(f);
+    object_unref(OBJECT(bioc));
+
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "failed to save the device state");
+        return false;
+    }
+
+    for (guint i = 0; i < snapshot.ram->len; i++) {
+        S32K3X8SnapshotRAM *ram = &g_array_index(snapshot.ram, S32K3X8SnapshotRAM, i);
+
+        if (!ram->copy) {
+            ram->copy = g_malloc(ram->size);
+            memory_region_set_log(ram->mr, true, DIRTY_MEMORY_VGA);
+        }
+        memcpy(ram->copy, memory_region_get_ram_ptr(ram->mr), ram->size);
+        memory_region_reset_dirty(ram->mr, 0, ram->size, DIRTY_MEMORY_VGA);
+        ram_bytes += ram->size;
+    }
+
+    /* The device state saved above includes them now */
+    if (snapshot.new_devices) {
+        g_ptr_array_set_size(snapshot.new_devices, 0);
+    }
+
+    snapshot.valid = true;
+    trace_s32k3x8_snapshot_save(ram_bytes, snapshot.devices_size);
+    return true;
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Write back the pages of a RAM block dirtied since the last save or restore */
+
+static uint64_t s32k3x8_snapshot_restore_ram(S32K3X8SnapshotRAM *ram) {
+
+    hwaddr page = qemu_target_page_size();
+    DirtyBitmapSnapshot *dirty;
+    uint64_t pages = 0;
+
+    dirty = memory_region_snapshot_and_clear_dirty(ram->mr, 0, ram->size, DIRTY_MEMORY_VGA);
+
+    for (hwaddr offset = 0; offset < ram->size; offset += page) {
+        hwaddr start = offset;
+
+        if (!memory_region_snapshot_get_dirty(ram->mr, dirty, offset, page)) {
+            continue;
+        }
+
+        /* One write per run of dirty pages */
+        while (offset + page < ram->size &&
+               memory_region_snapshot_get_dirty(ram->mr, dirty, offset + page, page)) {
+            offset += page;
+        }
+
+        /* Through the address space, which throws away the TBs translated from these pages */
+        address_space_write(&address_space_memory, ram->addr + start, MEMTXATTRS_UNSPECIFIED,
+                            ram->copy + start, offset + page - start);
+        pages += (offset + page - start) / page;
+    }
+    g_free(dirty);
+
+    /* The writes above marked the pages dirty again */
+    if (pages) {
+        memory_region_reset_dirty(ram->mr, 0, ram->size, DIRTY_MEMORY_VGA);
+    }
+
+    return pages;
+}
+
+/* Reload the device state saved by s32k3x8_snapshot_save() */
+
+static bool s32k3x8_snapshot_restore_devices(Error **errp) {
+
+    QIOChannelBuffer *bioc;
+    QEMUFile *f;
+    int ret = -EINVAL;
+
+    /* Closing the file frees the buffer of the channel, so work on a copy */
+    bioc = qio_channel_buffer_new(snapshot.devices_size);
+    qio_channel_set_name(QIO_CHANNEL(bioc), "s32k3x8-snapshot-restore");
+    memcpy(bioc->data, snapshot.devices, snapshot.devices_size);
+    bioc->usage = snapshot.devices_size;
+    f = qemu_file_new_input(QIO_CHANNEL(bioc));
+
+    /* qemu_save_device_state() writes the file header, qemu_load_device_state() does not read it */
+    if (qemu_get_be32(f) == QEMU_VM_FILE_MAGIC && qemu_get_be32(f) == QEMU_VM_FILE_VERSION) {
+        ret = qemu_load_device_state(f);
+    }
+    qemu_fclose(f);
+    object_unref(OBJECT(bioc));
+
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "failed to load the device state");
+        return false;
+    }
+    return true;
+}
+
+bool s32k3x8_snapshot_restore(uint64_t *dirty_pages, Error **errp) {
+
+    uint64_t pages = 0;
+    CPUState *cpu;
+
+    if (!snapshot.valid) {
+        error_setg(errp, "no snapshot has been taken");
+        return false;
+    }
+
+    for (guint i = 0; i < snapshot.ram->len; i++) {
+        pages += s32k3x8_snapshot_restore_ram(&g_array_index(snapshot.ram, S32K3X8SnapshotRAM, i));
+    }
+
+    if (!s32k3x8_snapshot_restore_devices(errp)) {
+        return false;
+    }
+
+    /* The devices the snapshot has no state for did not exist yet: they go back to their reset state */
+    for (guint i = 0; snapshot.new_devices && i < snapshot.new_devices->len; i++) {
+        device_cold_reset(g_ptr_array_index(snapshot.new_devices, i));
+    }
+
+    /* Loading the CPU state does not flush the TLBs, which cache the MPU permissions */
+    if (tcg_enabled()) {
+        CPU_FOREACH(cpu) {
+            tlb_flush(cpu);
+        }
+    }
+
+    trace_s32k3x8_snapshot_restore(pages, snapshot.devices_size);
+    if (dirty_pages) {
+        *dirty_pages = pages;
+    }
+    return true;
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* Snapshot taken at a given virtual time ("snapshot-at" machine option) */
+
+static void s32k3x8_snapshot_save_bh(void *opaque) {
+
+    bool running = runstate_is_running();
+    Error *err = NULL;
+
+    vm_stop(RUN_STATE_SAVE_VM);
+    if (!s32k3x8_snapshot_save(&err)) {
+        error_report_err(err);
+    }
+    if (running) {
+        vm_start();
+    }
+}
+
+static void s32k3x8_snapshot_save_timer(void *opaque) {
+
+    /* With icount the timer runs in the vCPU thread, which cannot stop the VM itself */
+    aio_bh_schedule_oneshot(qemu_get_aio_context(), s32k3x8_snapshot_save_bh, NULL);
+}
+
+void s32k3x8_snapshot_save_at(int64_t ns) {
+
+    snapshot.save_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, s32k3x8_snapshot_save_timer, NULL);
+    timer_mod(snapshot.save_timer, ns);
+}
+
+/*------------------------------------------------------------------------------*/
+
+/* QMP commands */
+
+void qmp_x_s32k3x8_snapshot_save(Error **errp) {
+
+    bool running = runstate_is_running();
+
+    if (!snapshot.ram) {
+        error_setg(errp, "snapshots are only supported by the s32k3x8evb machine");
+        return;
+    }
+
+    vm_stop(RUN_STATE_SAVE_VM);
+    s32k3x8_snapshot_save(errp);
+    if (running) {
+        vm_start();
+    }
+}
+
+S32K3X8SnapshotRestoreInfo *qmp_x_s32k3x8_snapshot_restore(Error **errp) {
+
+    bool running = runstate_is_running();
+    S32K3X8SnapshotRestoreInfo *info = NULL;
+    uint64_t pages;
+
+    if (!snapshot.ram) {
+        error_setg(errp, "snapshots are only supported by the s32k3x8evb machine");
+        return NULL;
+    }
+
+    vm_stop(RUN_STATE_RESTORE_VM);
+    if (s32k3x8_snapshot_restore(&pages, errp)) {
+        info = g_new0(S32K3X8SnapshotRestoreInfo, 1);
+        info->dirty_pages = pages;
+        info->dirty_bytes = pages * qemu_target_page_size();
+        info->device_bytes = snapshot.devices_size;
+    }
+    if (running) {
+        vm_start();
+    }
+
+    return info;
+}
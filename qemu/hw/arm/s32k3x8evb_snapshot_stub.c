@@ -0,0 +1,22 @@
+/*
+ * NXP S32K3X8EVB in-memory snapshot, for builds without the board
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-misc-target.h"
+
+void qmp_x_s32k3x8_snapshot_save(Error **errp)
+{
+    error_setg(errp, "snapshots are only supported by the s32k3x8evb machine");
+}
+
+S32K3X8SnapshotRestoreInfo *qmp_x_s32k3x8_snapshot_restore(Error **errp)
+{
+    error_setg(errp, "snapshots are only supported by the s32k3x8evb machine");
+    return NULL;
+}
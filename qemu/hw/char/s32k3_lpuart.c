@@ -0,0 +1,662 @@
+/*
+ * NXP S32K3 LPUART (Low Power Universal Asynchronous Receiver/Transmitter)
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ * The reference used is chapter "Low Power Universal Asynchronous
+ * Receiver/Transmitter (LPUART)" of the S32K3xx Reference Manual.
+ *
+ * Transmitted data is collected in a 16-entry TX FIFO which is drained to
+ * the character backend from a bottom half, so that a burst of DATA
+ * writes from the guest reaches the backend as a single multi-byte write.
+ * Received data is accepted from the backend as many bytes at a time as
+ * the RX FIFO has room for. Both FIFOs fall back to a depth of one data
+ * word when disabled in the FIFO register, as on the real hardware.
+ *
+ * The transmitter and receiver DMA requests (BAUD.TDMAE/RDMAE) are
+ * level outputs that follow TDRE and RDRF respectively.
+ *
+ * Not modelled: 9/10-bit data words, match/address modes, LIN break,
+ * loopback, IrDA, modem control and the baud rate timing itself
+ * (characters are sent as soon as the bottom half runs).
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "qemu/main-loop.h"
+#include "qemu/host-utils.h"
+#include "qapi/error.h"
+#include "chardev/char-fe.h"
+#include "chardev/char-serial.h"
+#include "migration/vmstate.h"
+#include "hw/char/s32k3_lpuart.h"
+#include "hw/clock.h"
+#include "hw/irq.h"
+#include "hw/qdev-clock.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-properties-system.h"
+#include "hw/registerfields.h"
+#include "trace.h"
+
+REG32(VERID, 0x00)
+REG32(PARAM, 0x04)
+    FIELD(PARAM, TXFIFO, 0, 8)
+    FIELD(PARAM, RXFIFO, 8, 8)
+REG32(GLOBAL, 0x08)
+    FIELD(GLOBAL, RST, 1, 1)     /* Software reset */
+REG32(PINCFG, 0x0C)
+    FIELD(PINCFG, TRGSEL, 0, 2)
+REG32(BAUD, 0x10)
+    FIELD(BAUD, MAEN1, 31, 1)    /* Match address mode enable 1 */
+    FIELD(BAUD, MAEN2, 30, 1)    /* Match address mode enable 2 */
+    FIELD(BAUD, M10, 29, 1)      /* 10-bit mode select */
+    FIELD(BAUD, OSR, 24, 5)      /* Oversampling ratio */
+    FIELD(BAUD, TDMAE, 23, 1)    /* Transmitter DMA enable */
+    FIELD(BAUD, RDMAE, 21, 1)    /* Receiver full DMA enable */
+    FIELD(BAUD, RIDMAE, 20, 1)   /* Receiver idle DMA enable */
+    FIELD(BAUD, MATCFG, 18, 2)   /* Match configuration */
+    FIELD(BAUD, BOTHEDGE, 17, 1) /* Both edge sampling */
+    FIELD(BAUD, RESYNCDIS, 16, 1) /* Resynchronization disable */
+    FIELD(BAUD, LBKDIE, 15, 1)   /* LIN break detect interrupt enable */
+    FIELD(BAUD, RXEDGIE, 14, 1)  /* RX input active edge interrupt enable */
+    FIELD(BAUD, SBNS, 13, 1)     /* Stop bit number select */
+    FIELD(BAUD, SBR, 0, 13)      /* Baud rate modulo divisor */
+REG32(STAT, 0x14)
+    FIELD(STAT, LBKDIF, 31, 1)   /* LIN break detect interrupt flag */
+    FIELD(STAT, RXEDGIF, 30, 1)  /* RX pin active edge interrupt flag */
+    FIELD(STAT, MSBF, 29, 1)     /* MSB first */
+    FIELD(STAT, RXINV, 28, 1)    /* Receive data inversion */
+    FIELD(STAT, RWUID, 27, 1)    /* Receive wake up idle detect */
+    FIELD(STAT, BRK13, 26, 1)    /* Break character generation length */
+    FIELD(STAT, LBKDE, 25, 1)    /* LIN break detection enable */
+    FIELD(STAT, RAF, 24, 1)      /* Receiver active flag */
+    FIELD(STAT, TDRE, 23, 1)     /* Transmit data register empty flag */
+    FIELD(STAT, TC, 22, 1)       /* Transmission complete flag */
+    FIELD(STAT, RDRF, 21, 1)     /* Receive data register full flag */
+    FIELD(STAT, IDLE, 20, 1)     /* Idle line flag */
+    FIELD(STAT, OR, 19, 1)       /* Receiver overrun flag */
+    FIELD(STAT, NF, 18, 1)       /* Noise flag */
+    FIELD(STAT, FE, 17, 1)       /* Framing error flag */
+    FIELD(STAT, PF, 16, 1)       /* Parity error flag */
+    FIELD(STAT, MA1F, 15, 1)     /* Match 1 flag */
+    FIELD(STAT, MA2F, 14, 1)     /* Match 2 flag */
+REG32(CTRL, 0x18)
+    FIELD(CTRL, ORIE, 27, 1)     /* Overrun interrupt enable */
+    FIELD(CTRL, NEIE, 26, 1)     /* Noise error interrupt enable */
+    FIELD(CTRL, FEIE, 25, 1)     /* Framing error interrupt enable */
+    FIELD(CTRL, PEIE, 24, 1)     /* Parity error interrupt enable */
+    FIELD(CTRL, TIE, 23, 1)      /* Transmit interrupt enable */
+    FIELD(CTRL, TCIE, 22, 1)     /* Transmission complete interrupt enable */
+    FIELD(CTRL, RIE, 21, 1)      /* Receiver interrupt enable */
+    FIELD(CTRL, ILIE, 20, 1)     /* Idle line interrupt enable */
+    FIELD(CTRL, TE, 19, 1)       /* Transmitter enable */
+    FIELD(CTRL, RE, 18, 1)       /* Receiver enable */
+    FIELD(CTRL, M7, 11, 1)       /* 7-bit mode select */
+    FIELD(CTRL, LOOPS, 7, 1)     /* Loop mode select */
+    FIELD(CTRL, M, 4, 1)         /* 9-bit or 8-bit mode select */
+    FIELD(CTRL, PE, 1, 1)        /* Parity enable */
+    FIELD(CTRL, PT, 0, 1)        /* Parity type */
+REG32(DATA, 0x1C)
+    FIELD(DATA, DATA, 0, 10)
+    FIELD(DATA, IDLINE, 11, 1)   /* Idle line */
+    FIELD(DATA, RXEMPT, 12, 1)   /* Receive buffer empty */
+REG32(MATCH, 0x20)
+REG32(MODIR, 0x24)
+REG32(FIFO, 0x28)
+    FIELD(FIFO, RXFIFOSIZE, 0, 3)
+    FIELD(FIFO, RXFE, 3, 1)      /* Receive FIFO enable */
+    FIELD(FIFO, TXFIFOSIZE, 4, 3)
+    FIELD(FIFO, TXFE, 7, 1)      /* Transmit FIFO enable */
+    FIELD(FIFO, RXUFE, 8, 1)     /* Receive FIFO underflow interrupt enable */
+    FIELD(FIFO, TXOFE, 9, 1)     /* Transmit FIFO overflow interrupt enable */
+    FIELD(FIFO, RXIDEN, 10, 3)   /* Receiver idle empty enable */
+    FIELD(FIFO, RXFLUSH, 14, 1)  /* Receive FIFO flush */
+    FIELD(FIFO, TXFLUSH, 15, 1)  /* Transmit FIFO flush */
+    FIELD(FIFO, RXUF, 16, 1)     /* Receiver FIFO underflow flag */
+    FIELD(FIFO, TXOF, 17, 1)     /* Transmitter FIFO overflow flag */
+    FIELD(FIFO, RXEMPT, 22, 1)   /* Receive FIFO/buffer empty */
+    FIELD(FIFO, TXEMPT, 23, 1)   /* Transmit FIFO/buffer empty */
+REG32(WATER, 0x2C)
+    FIELD(WATER, TXWATER, 0, 4)
+    FIELD(WATER, TXCOUNT, 8, 5)
+    FIELD(WATER, RXWATER, 16, 4)
+    FIELD(WATER, RXCOUNT, 24, 5)
+
+#define LPUART_VERID 0x04040007
+
+/* FIFO size encoding 0b011: 16 datawords */
+#define LPUART_FIFO_SIZE_16 3
+
+#define STAT_W1C_MASK (R_STAT_LBKDIF_MASK | R_STAT_RXEDGIF_MASK | \
+                       R_STAT_IDLE_MASK | R_STAT_OR_MASK | R_STAT_NF_MASK | \
+                       R_STAT_FE_MASK | R_STAT_PF_MASK | R_STAT_MA1F_MASK | \
+                       R_STAT_MA2F_MASK)
+#define STAT_RW_MASK (R_STAT_MSBF_MASK | R_STAT_RXINV_MASK | \
+                      R_STAT_RWUID_MASK | R_STAT_BRK13_MASK | \
+                      R_STAT_LBKDE_MASK)
+#define FIFO_RW_MASK (R_FIFO_RXFE_MASK | R_FIFO_TXFE_MASK | \
+                      R_FIFO_RXUFE_MASK | R_FIFO_TXOFE_MASK | \
+                      R_FIFO_RXIDEN_MASK)
+#define FIFO_W1C_MASK (R_FIFO_RXUF_MASK | R_FIFO_TXOF_MASK)
+#define WATER_RW_MASK (R_WATER_TXWATER_MASK | R_WATER_RXWATER_MASK)
+
+static uint32_t s32k3_lpuart_tx_depth(S32K3LPUARTState *s)
+{
+    return (s->fifo & R_FIFO_TXFE_MASK) ? S32K3_LPUART_FIFO_SIZE : 1;
+}
+
+static uint32_t s32k3_lpuart_rx_depth(S32K3LPUARTState *s)
+{
+    return (s->fifo & R_FIFO_RXFE_MASK) ? S32K3_LPUART_FIFO_SIZE : 1;
+}
+
+/* Recompute the FIFO-derived status bits and the interrupt line */
+static void s32k3_lpuart_update(S32K3LPUARTState *s)
+{
+    uint32_t txcount = fifo8_num_used(&s->tx_fifo);
+    uint32_t rxcount = fifo8_num_used(&s->rx_fifo);
+    bool tdre, rdrf, level;
+
+    if (s->fifo & R_FIFO_TXFE_MASK) {
+        tdre = txcount <= FIELD_EX32(s->water, WATER, TXWATER);
+    } else {
+        tdre = txcount == 0;
+    }
+    if (s->fifo & R_FIFO_RXFE_MASK) {
+        rdrf = rxcount > FIELD_EX32(s->water, WATER, RXWATER);
+    } else {
+        rdrf = rxcount != 0;
+    }
+
+    s->stat = FIELD_DP32(s->stat, STAT, TDRE, tdre);
+    s->stat = FIELD_DP32(s->stat, STAT, TC, txcount == 0);
+    s->stat = FIELD_DP32(s->stat, STAT, RDRF, rdrf);
+    s->water = FIELD_DP32(s->water, WATER, TXCOUNT, txcount);
+    s->water = FIELD_DP32(s->water, WATER, RXCOUNT, rxcount);
+    s->fifo = FIELD_DP32(s->fifo, FIFO, TXEMPT, txcount == 0);
+    s->fifo = FIELD_DP32(s->fifo, FIFO, RXEMPT, rxcount == 0);
+
+    level = ((s->stat & R_STAT_TDRE_MASK) && (s->ctrl & R_CTRL_TIE_MASK))   ||
+            ((s->stat & R_STAT_TC_MASK) && (s->ctrl & R_CTRL_TCIE_MASK))    ||
+            ((s->stat & R_STAT_RDRF_MASK) && (s->ctrl & R_CTRL_RIE_MASK))   ||
+            ((s->stat & R_STAT_IDLE_MASK) && (s->ctrl & R_CTRL_ILIE_MASK))  ||
+            ((s->stat & R_STAT_OR_MASK) && (s->ctrl & R_CTRL_ORIE_MASK))    ||
+            ((s->fifo & R_FIFO_TXOF_MASK) && (s->fifo & R_FIFO_TXOFE_MASK)) ||
+            ((s->fifo & R_FIFO_RXUF_MASK) && (s->fifo & R_FIFO_RXUFE_MASK));
+
+    trace_s32k3_lpuart_irq(level, s->stat);
+    qemu_set_irq(s->irq, level);
+
+    /* DMA requests follow the same flags as the interrupts they replace */
+    qemu_set_irq(s->dma_tx, tdre && (s->baud & R_BAUD_TDMAE_MASK) &&
+                            (s->ctrl & R_CTRL_TE_MASK));
+    qemu_set_irq(s->dma_rx, rdrf && (s->baud & R_BAUD_RDMAE_MASK));
+}
+
+static int s32k3_lpuart_can_receive(void *opaque)
+{
+    S32K3LPUARTState *s = opaque;
+    uint32_t depth = s32k3_lpuart_rx_depth(s);
+    uint32_t used = fifo8_num_used(&s->rx_fifo);
+
+    if (!(s->ctrl & R_CTRL_RE_MASK) || used >= depth) {
+        return 0;
+    }
+    return depth - used;
+}
+
+static void s32k3_lpuart_receive(void *opaque, const uint8_t *buf, int size)
+{
+    S32K3LPUARTState *s = opaque;
+    int space = s32k3_lpuart_can_receive(s);
+
+    if (size > space) {
+        /* The backend should have honoured can_receive; treat as overrun */
+        s->stat |= R_STAT_OR_MASK;
+        size = space;
+    }
+    fifo8_push_all(&s->rx_fifo, buf, size);
+    trace_s32k3_lpuart_rx(size);
+
+    /* The line goes idle at the end of each burst from the backend */
+    s->stat |= R_STAT_IDLE_MASK;
+    s32k3_lpuart_update(s);
+}
+
+int s32k3_lpuart_inject_rx(S32K3LPUARTState *s, const uint8_t *buf, int size)
+{
+    size = MIN(size, s32k3_lpuart_can_receive(s));
+    if (size > 0) {
+        s32k3_lpuart_receive(s, buf, size);
+    }
+    return size;
+}
+
+/*
+ * Send as much of the TX FIFO as the backend accepts, and arrange to be
+ * called back later for the rest if it is busy.
+ */
+static gboolean s32k3_lpuart_xmit(void *do_not_use, GIOCondition cond,
+                                  void *opaque)
+{
+    S32K3LPUARTState *s = opaque;
+    const uint8_t *buf;
+    uint32_t len;
+    int ret;
+
+    s->watch_tag = 0;
+
+    while ((s->ctrl & R_CTRL_TE_MASK) && !fifo8_is_empty(&s->tx_fifo)) {
+        buf = fifo8_peek_bufptr(&s->tx_fifo, fifo8_num_used(&s->tx_fifo),
+                                &len);
+        ret = qemu_chr_fe_write(&s->chr, buf, len);
+        if (ret <= 0) {
+            s->watch_tag = qemu_chr_fe_add_watch(&s->chr, G_IO_OUT | G_IO_HUP,
+                                                 s32k3_lpuart_xmit, s);
+            if (!s->watch_tag) {
+                /*
+                 * Most common reason to be here is "no chardev backend":
+                 * just insta-drain the FIFO, so the serial output goes
+                 * into a void, rather than blocking the guest.
+                 */
+                fifo8_reset(&s->tx_fifo);
+                break;
+            }
+            trace_s32k3_lpuart_tx_pending(fifo8_num_used(&s->tx_fifo));
+            break;
+        }
+        trace_s32k3_lpuart_tx(ret);
+        fifo8_drop(&s->tx_fifo, ret);
+    }
+
+    s32k3_lpuart_update(s);
+    return G_SOURCE_REMOVE;
+}
+
+static void s32k3_lpuart_tx_bh(void *opaque)
+{
+    S32K3LPUARTState *s = opaque;
+
+    /* A pending watch will resume transmission by itself */
+    if (!s->watch_tag) {
+        s32k3_lpuart_xmit(NULL, G_IO_OUT, s);
+    }
+}
+
+static void s32k3_lpuart_cancel_transmit(S32K3LPUARTState *s)
+{
+    if (s->watch_tag) {
+        g_source_remove(s->watch_tag);
+        s->watch_tag = 0;
+    }
+    qemu_bh_cancel(s->tx_bh);
+}
+
+static void s32k3_lpuart_update_params(S32K3LPUARTState *s)
+{
+    QEMUSerialSetParams ssp;
+    uint32_t osr, sbr;
+
+    sbr = FIELD_EX32(s->baud, BAUD, SBR);
+    if (sbr == 0) {
+        /* Baud rate generator disabled */
+        return;
+    }
+
+    osr = FIELD_EX32(s->baud, BAUD, OSR);
+    if (osr == 1 || osr == 2) {
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: reserved oversampling ratio %u\n", __func__, osr);
+        return;
+    }
+    /* OSR == 0 selects the reset default of 16x oversampling */
+    osr = osr ? osr + 1 : 16;
+
+    if ((s->baud & R_BAUD_M10_MASK) || (s->ctrl & R_CTRL_M_MASK)) {
+        qemu_log_mask(LOG_UNIMP, "%s: 9/10-bit data words\n", __func__);
+        ssp.data_bits = 8;
+    } else if (s->ctrl & R_CTRL_M7_MASK) {
+        ssp.data_bits = 7;
+    } else {
+        ssp.data_bits = 8;
+    }
+
+    if (s->ctrl & R_CTRL_PE_MASK) {
+        ssp.parity = (s->ctrl & R_CTRL_PT_MASK) ? 'O' : 'E';
+    } else {
+        ssp.parity = 'N';
+    }
+    ssp.stop_bits = (s->baud & R_BAUD_SBNS_MASK) ? 2 : 1;
+    ssp.speed = clock_get_hz(s->clk) / (osr * sbr);
+
+    qemu_chr_fe_ioctl(&s->chr, CHR_IOCTL_SERIAL_SET_PARAMS, &ssp);
+
+    trace_s32k3_lpuart_update_params(ssp.speed, ssp.parity, ssp.data_bits,
+                                     ssp.stop_bits);
+}
+
+/* Reset everything but GLOBAL, which is how the software reset behaves */
+static void s32k3_lpuart_reset_regs(S32K3LPUARTState *s)
+{
+    s->pincfg = 0x00000000;
+    s->baud = 0x0F000004;
+    s->stat = 0x00C00000;
+    s->ctrl = 0x00000000;
+    s->match = 0x00000000;
+    s->modir = 0x00000000;
+    s->fifo = FIELD_DP32(0, FIFO, RXFIFOSIZE, LPUART_FIFO_SIZE_16) |
+              FIELD_DP32(0, FIFO, TXFIFOSIZE, LPUART_FIFO_SIZE_16);
+    s->water = 0x00000000;
+
+    fifo8_reset(&s->tx_fifo);
+    fifo8_reset(&s->rx_fifo);
+    s32k3_lpuart_cancel_transmit(s);
+    s32k3_lpuart_update(s);
+}
+
+static void s32k3_lpuart_reset_hold(Object *obj, ResetType type)
+{
+    S32K3LPUARTState *s = S32K3_LPUART(obj);
+
+    s->global = 0x00000000;
+    s32k3_lpuart_reset_regs(s);
+}
+
+static uint64_t s32k3_lpuart_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    S32K3LPUARTState *s = opaque;
+    uint64_t retvalue = 0;
+
+    if (size != 4 && addr != A_DATA) {
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: %u-byte read of offset 0x%"HWADDR_PRIx"\n",
+                      __func__, size, addr);
+        return 0;
+    }
+
+    switch (addr) {
+    case A_VERID:
+        retvalue = LPUART_VERID;
+        break;
+    case A_PARAM:
+        /* log2 of the FIFO sizes */
+        retvalue = FIELD_DP32(0, PARAM, TXFIFO, ctz32(S32K3_LPUART_FIFO_SIZE));
+        retvalue = FIELD_DP32(retvalue, PARAM, RXFIFO,
+                              ctz32(S32K3_LPUART_FIFO_SIZE));
+        break;
+    case A_GLOBAL:
+        retvalue = s->global;
+        break;
+    case A_PINCFG:
+        retvalue = s->pincfg;
+        break;
+    case A_BAUD:
+        retvalue = s->baud;
+        break;
+    case A_STAT:
+        retvalue = s->stat;
+        break;
+    case A_CTRL:
+        retvalue = s->ctrl;
+        break;
+    case A_DATA:
+        if (fifo8_is_empty(&s->rx_fifo)) {
+            retvalue = R_DATA_RXEMPT_MASK;
+            if (s->fifo & R_FIFO_RXFE_MASK) {
+                s->fifo |= R_FIFO_RXUF_MASK;
+            }
+        } else {
+            retvalue = fifo8_pop(&s->rx_fifo);
+            qemu_chr_fe_accept_input(&s->chr);
+        }
+        s32k3_lpuart_update(s);
+        break;
+    case A_MATCH:
+        retvalue = s->match;
+        break;
+    case A_MODIR:
+        retvalue = s->modir;
+        break;
+    case A_FIFO:
+        retvalue = s->fifo;
+        break;
+    case A_WATER:
+        retvalue = s->water;
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: Bad offset 0x%"HWADDR_PRIx"\n", __func__, addr);
+        break;
+    }
+
+    trace_s32k3_lpuart_read(addr, retvalue);
+
+    return retvalue;
+}
+
+static void s32k3_lpuart_write(void *opaque, hwaddr addr,
+                               uint64_t val64, unsigned int size)
+{
+    S32K3LPUARTState *s = opaque;
+    const uint32_t value = val64;
+    uint32_t old;
+
+    trace_s32k3_lpuart_write(addr, value);
+
+    if (size != 4 && addr != A_DATA) {
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: %u-byte write of offset 0x%"HWADDR_PRIx"\n",
+                      __func__, size, addr);
+        return;
+    }
+
+    if ((s->global & R_GLOBAL_RST_MASK) && addr != A_GLOBAL) {
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: write while in software reset\n", __func__);
+        return;
+    }
+
+    switch (addr) {
+    case A_VERID:
+    case A_PARAM:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: write to read-only offset 0x%"HWADDR_PRIx"\n",
+                      __func__, addr);
+        return;
+    case A_GLOBAL:
+        s->global = value & R_GLOBAL_RST_MASK;
+        if (s->global & R_GLOBAL_RST_MASK) {
+            s32k3_lpuart_reset_regs(s);
+        }
+        return;
+    case A_PINCFG:
+        s->pincfg = value & R_PINCFG_TRGSEL_MASK;
+        return;
+    case A_BAUD:
+        s->baud = value;
+        s32k3_lpuart_update_params(s);
+        s32k3_lpuart_update(s);
+        return;
+    case A_STAT:
+        s->stat = (s->stat & ~STAT_RW_MASK) | (value & STAT_RW_MASK);
+        s->stat &= ~(value & STAT_W1C_MASK);
+        s32k3_lpuart_update(s);
+        return;
+    case A_CTRL:
+        old = s->ctrl;
+        s->ctrl = value;
+        if (value & R_CTRL_LOOPS_MASK) {
+            qemu_log_mask(LOG_UNIMP, "%s: loop mode\n", __func__);
+        }
+        s32k3_lpuart_update_params(s);
+        if (!(old & R_CTRL_TE_MASK) && (value & R_CTRL_TE_MASK)) {
+            qemu_bh_schedule(s->tx_bh);
+        }
+        if (!(old & R_CTRL_RE_MASK) && (value & R_CTRL_RE_MASK)) {
+            qemu_chr_fe_accept_input(&s->chr);
+        }
+        s32k3_lpuart_update(s);
+        return;
+    case A_DATA:
+        if (!(s->ctrl & R_CTRL_TE_MASK)) {
+            qemu_log_mask(LOG_GUEST_ERROR,
+                          "%s: write to DATA with transmitter disabled\n",
+                          __func__);
+            return;
+        }
+        if (fifo8_num_used(&s->tx_fifo) >= s32k3_lpuart_tx_depth(s)) {
+            /* Overflow: the data word is lost */
+            s->fifo |= R_FIFO_TXOF_MASK;
+        } else {
+            fifo8_push(&s->tx_fifo, value & 0xff);
+            qemu_bh_schedule(s->tx_bh);
+        }
+        s32k3_lpuart_update(s);
+        return;
+    case A_MATCH:
+        s->match = value;
+        return;
+    case A_MODIR:
+        s->modir = value;
+        return;
+    case A_FIFO:
+        if (value & R_FIFO_TXFLUSH_MASK) {
+            fifo8_reset(&s->tx_fifo);
+        }
+        if (value & R_FIFO_RXFLUSH_MASK) {
+            fifo8_reset(&s->rx_fifo);
+            qemu_chr_fe_accept_input(&s->chr);
+        }
+        s->fifo = (s->fifo & ~FIFO_RW_MASK) | (value & FIFO_RW_MASK);
+        s->fifo &= ~(value & FIFO_W1C_MASK);
+        s32k3_lpuart_update(s);
+        return;
+    case A_WATER:
+        if (FIELD_EX32(value, WATER, TXWATER) >= S32K3_LPUART_FIFO_SIZE ||
+            FIELD_EX32(value, WATER, RXWATER) >= S32K3_LPUART_FIFO_SIZE) {
+            qemu_log_mask(LOG_GUEST_ERROR,
+                          "%s: watermark larger than the FIFO\n", __func__);
+        }
+        s->water = (s->water & ~WATER_RW_MASK) | (value & WATER_RW_MASK);
+        s32k3_lpuart_update(s);
+        return;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: Bad offset 0x%"HWADDR_PRIx"\n", __func__, addr);
+    }
+}
+
+/*
+ * Registers are 32-bit only, except DATA which also takes the 8 and 16-bit
+ * accesses that DMA transfers with SSIZE/DSIZE of one byte make.
+ */
+static const MemoryRegionOps s32k3_lpuart_ops = {
+    .read = s32k3_lpuart_read,
+    .write = s32k3_lpuart_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .valid = {
+        .max_access_size = 4,
+        .min_access_size = 1,
+        .unaligned = false
+    },
+};
+
+static Property s32k3_lpuart_properties[] = {
+    DEFINE_PROP_CHR("chardev", S32K3LPUARTState, chr),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void s32k3_lpuart_init(Object *obj)
+{
+    S32K3LPUARTState *s = S32K3_LPUART(obj);
+
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    qdev_init_gpio_out_named(DEVICE(obj), &s->dma_tx, "dma-tx", 1);
+    qdev_init_gpio_out_named(DEVICE(obj), &s->dma_rx, "dma-rx", 1);
+
+    memory_region_init_io(&s->mmio, obj, &s32k3_lpuart_ops, s,
+                          TYPE_S32K3_LPUART, 0x1000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "clk", NULL, s, 0);
+}
+
+static int s32k3_lpuart_post_load(void *opaque, int version_id)
+{
+    S32K3LPUARTState *s = opaque;
+
+    s32k3_lpuart_update_params(s);
+    if (!fifo8_is_empty(&s->tx_fifo)) {
+        qemu_bh_schedule(s->tx_bh);
+    }
+    return 0;
+}
+
+static const VMStateDescription vmstate_s32k3_lpuart = {
+    .name = TYPE_S32K3_LPUART,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = s32k3_lpuart_post_load,
+    .fields = (const VMStateField[]) {
+        VMSTATE_UINT32(global, S32K3LPUARTState),
+        VMSTATE_UINT32(pincfg, S32K3LPUARTState),
+        VMSTATE_UINT32(baud, S32K3LPUARTState),
+        VMSTATE_UINT32(stat, S32K3LPUARTState),
+        VMSTATE_UINT32(ctrl, S32K3LPUARTState),
+        VMSTATE_UINT32(match, S32K3LPUARTState),
+        VMSTATE_UINT32(modir, S32K3LPUARTState),
+        VMSTATE_UINT32(fifo, S32K3LPUARTState),
+        VMSTATE_UINT32(water, S32K3LPUARTState),
+        VMSTATE_FIFO8(tx_fifo, S32K3LPUARTState),
+        VMSTATE_FIFO8(rx_fifo, S32K3LPUARTState),
+        VMSTATE_CLOCK(clk, S32K3LPUARTState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void s32k3_lpuart_realize(DeviceState *dev, Error **errp)
+{
+    S32K3LPUARTState *s = S32K3_LPUART(dev);
+
+    if (!clock_has_source(s->clk)) {
+        error_setg(errp, "LPUART clock must be wired up by SoC code");
+        return;
+    }
+
+    fifo8_create(&s->tx_fifo, S32K3_LPUART_FIFO_SIZE);
+    fifo8_create(&s->rx_fifo, S32K3_LPUART_FIFO_SIZE);
+    s->tx_bh = qemu_bh_new_guarded(s32k3_lpuart_tx_bh, s,
+                                   &dev->mem_reentrancy_guard);
+
+    qemu_chr_fe_set_handlers(&s->chr, s32k3_lpuart_can_receive,
+                             s32k3_lpuart_receive, NULL, NULL,
+                             s, NULL, true);
+}
+
+static void s32k3_lpuart_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+    ResettableClass *rc = RESETTABLE_CLASS(klass);
+
+    rc->phases.hold = s32k3_lpuart_reset_hold;
+    device_class_set_props(dc, s32k3_lpuart_properties);
+    dc->realize = s32k3_lpuart_realize;
+    dc->vmsd = &vmstate_s32k3_lpuart;
+}
+
+static const TypeInfo s32k3_lpuart_info = {
+    .name          = TYPE_S32K3_LPUART,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(S32K3LPUARTState),
+    .instance_init = s32k3_lpuart_init,
+    .class_init    = s32k3_lpuart_class_init,
+};
+
+static void s32k3_lpuart_register_types(void)
+{
+    type_register_static(&s32k3_lpuart_info);
+}
+
+type_init(s32k3_lpuart_register_types);
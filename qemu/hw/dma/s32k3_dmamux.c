@@ -0,0 +1,185 @@
+/*
+ * NXP S32K3 DMA channel multiplexer (DMAMUX)
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ * The reference used is chapter "Direct Memory Access Multiplexer
+ * (DMAMUX)" of the S32K3xx Reference Manual.
+ *
+ * Each multiplexer routes one of 64 request sources to each of the 16 eDMA
+ * channels it serves. The periodic trigger mode (CHCFG.TRIG), which gates
+ * requests with the PIT, is not modelled.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "migration/vmstate.h"
+#include "hw/dma/s32k3_dmamux.h"
+#include "hw/irq.h"
+#include "trace.h"
+
+/* CHCFG register bits (8-bit registers) */
+#define CHCFG_SOURCE_MASK 0x3f  /* DMA channel source (slot) */
+#define CHCFG_TRIG        0x40  /* DMA channel trigger enable */
+#define CHCFG_ENBL        0x80  /* DMA channel enable */
+
+/*
+ * The CHCFG registers are laid out in big-endian order within each 32-bit
+ * word: CHCFG3 is at offset 0, CHCFG2 at 1, CHCFG1 at 2 and CHCFG0 at 3.
+ */
+static unsigned int s32k3_dmamux_channel(hwaddr addr)
+{
+    return (addr & ~3) | (3 - (addr & 3));
+}
+
+static bool s32k3_dmamux_level(S32K3DMAMUXState *s, unsigned int ch)
+{
+    uint8_t source = s->chcfg[ch] & CHCFG_SOURCE_MASK;
+
+    if (!(s->chcfg[ch] & CHCFG_ENBL) || source == 0) {
+        return false;
+    }
+    if (source == S32K3_DMAMUX_SRC_ALWAYS_ON0 ||
+        source == S32K3_DMAMUX_SRC_ALWAYS_ON1) {
+        return true;
+    }
+    return s->sources & (1ULL << source);
+}
+
+static void s32k3_dmamux_update(S32K3DMAMUXState *s, unsigned int ch)
+{
+    qemu_set_irq(s->out[ch], s32k3_dmamux_level(s, ch));
+}
+
+static void s32k3_dmamux_set_request(void *opaque, int n, int level)
+{
+    S32K3DMAMUXState *s = opaque;
+    uint64_t mask = 1ULL << n;
+
+    if (!!(s->sources & mask) == !!level) {
+        return;
+    }
+
+    trace_s32k3_dmamux_request(n, level);
+
+    if (level) {
+        s->sources |= mask;
+    } else {
+        s->sources &= ~mask;
+    }
+
+    for (unsigned int ch = 0; ch < S32K3_DMAMUX_NUM_CHANNELS; ch++) {
+        if ((s->chcfg[ch] & CHCFG_SOURCE_MASK) == n) {
+            s32k3_dmamux_update(s, ch);
+        }
+    }
+}
+
+static uint64_t s32k3_dmamux_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    S32K3DMAMUXState *s = opaque;
+    uint64_t retvalue = s->chcfg[s32k3_dmamux_channel(addr)];
+
+    trace_s32k3_dmamux_read(addr, retvalue);
+
+    return retvalue;
+}
+
+static void s32k3_dmamux_write(void *opaque, hwaddr addr,
+                               uint64_t val64, unsigned int size)
+{
+    S32K3DMAMUXState *s = opaque;
+    unsigned int ch = s32k3_dmamux_channel(addr);
+
+    trace_s32k3_dmamux_write(addr, val64);
+
+    /* The source can only be changed while the channel is disabled */
+    if ((s->chcfg[ch] & CHCFG_ENBL) && (val64 & CHCFG_ENBL) &&
+        (val64 & CHCFG_SOURCE_MASK) != (s->chcfg[ch] & CHCFG_SOURCE_MASK)) {
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: channel %u source changed while enabled\n",
+                      __func__, ch);
+    }
+    if (val64 & CHCFG_TRIG) {
+        qemu_log_mask(LOG_UNIMP, "%s: periodic trigger mode\n", __func__);
+    }
+
+    s->chcfg[ch] = val64;
+    s32k3_dmamux_update(s, ch);
+}
+
+static const MemoryRegionOps s32k3_dmamux_ops = {
+    .read = s32k3_dmamux_read,
+    .write = s32k3_dmamux_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .valid = {
+        .min_access_size = 1,
+        .max_access_size = 4,
+    },
+    .impl = {
+        .min_access_size = 1,
+        .max_access_size = 1,
+    },
+};
+
+static void s32k3_dmamux_reset_hold(Object *obj, ResetType type)
+{
+    S32K3DMAMUXState *s = S32K3_DMAMUX(obj);
+
+    memset(s->chcfg, 0, sizeof(s->chcfg));
+    for (unsigned int ch = 0; ch < S32K3_DMAMUX_NUM_CHANNELS; ch++) {
+        s32k3_dmamux_update(s, ch);
+    }
+}
+
+static void s32k3_dmamux_init(Object *obj)
+{
+    S32K3DMAMUXState *s = S32K3_DMAMUX(obj);
+    DeviceState *dev = DEVICE(obj);
+
+    memory_region_init_io(&s->mmio, obj, &s32k3_dmamux_ops, s,
+                          TYPE_S32K3_DMAMUX, S32K3_DMAMUX_NUM_CHANNELS);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+
+    qdev_init_gpio_in_named(dev, s32k3_dmamux_set_request, "request",
+                            S32K3_DMAMUX_NUM_SOURCES);
+    qdev_init_gpio_out(dev, s->out, S32K3_DMAMUX_NUM_CHANNELS);
+}
+
+static const VMStateDescription vmstate_s32k3_dmamux = {
+    .name = TYPE_S32K3_DMAMUX,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (const VMStateField[]) {
+        VMSTATE_UINT8_ARRAY(chcfg, S32K3DMAMUXState,
+                            S32K3_DMAMUX_NUM_CHANNELS),
+        VMSTATE_UINT64(sources, S32K3DMAMUXState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void s32k3_dmamux_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+    ResettableClass *rc = RESETTABLE_CLASS(klass);
+
+    rc->phases.hold = s32k3_dmamux_reset_hold;
+    dc->vmsd = &vmstate_s32k3_dmamux;
+}
+
+static const TypeInfo s32k3_dmamux_info = {
+    .name          = TYPE_S32K3_DMAMUX,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(S32K3DMAMUXState),
+    .instance_init = s32k3_dmamux_init,
+    .class_init    = s32k3_dmamux_class_init,
+};
+
+static void s32k3_dmamux_register_types(void)
+{
+    type_register_static(&s32k3_dmamux_info);
+}
+
+type_init(s32k3_dmamux_register_types);
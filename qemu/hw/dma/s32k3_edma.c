@@ -0,0 +1,874 @@
+/*
+ * NXP S32K3 enhanced Direct Memory Access controller (eDMA)
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ * The reference used is chapter "Enhanced Direct Memory Access (eDMA)" of
+ * the S32K3xx Reference Manual.
+ *
+ * Channels are serviced from a bottom half, one minor loop per service
+ * request, in fixed priority order. A channel is requested either by
+ * software (TCD_CSR.START) or by its hardware request input while
+ * CH_CSR.ERQ is set; hardware requests are level sensitive, so a channel
+ * keeps executing minor loops for as long as its peripheral asserts the
+ * request.
+ *
+ * Minor loops that walk both source and destination contiguously through
+ * RAM are done as a single host memmove(); everything else (peripheral
+ * registers, modulo addressing, non-unit offsets) is done beat by beat
+ * through the address space.
+ *
+ * Not modelled: round-robin arbitration, channel preemption, bandwidth
+ * control and the transfer timing itself.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "qemu/main-loop.h"
+#include "qemu/rcu.h"
+#include "qapi/error.h"
+#include "migration/vmstate.h"
+#include "hw/dma/s32k3_edma.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "hw/registerfields.h"
+#include "trace.h"
+
+/* Management page */
+REG32(CSR, 0x000)
+    FIELD(CSR, EDBG, 1, 1)       /* Enable debug */
+    FIELD(CSR, ERCA, 2, 1)       /* Enable round robin channel arbitration */
+    FIELD(CSR, HAE, 4, 1)        /* Halt after error */
+    FIELD(CSR, HALT, 5, 1)       /* Halt DMA operations */
+    FIELD(CSR, GCLC, 6, 1)       /* Global channel linking control */
+    FIELD(CSR, GMRC, 7, 1)       /* Global master ID replication control */
+    FIELD(CSR, ECX, 8, 1)        /* Cancel transfer with error */
+    FIELD(CSR, CX, 9, 1)         /* Cancel transfer */
+    FIELD(CSR, ACTIVE_ID, 24, 5)
+    FIELD(CSR, ACTIVE, 31, 1)
+REG32(ES, 0x004)
+    FIELD(ES, ERRCHN, 24, 5)     /* Channel of the last recorded error */
+    FIELD(ES, VLD, 31, 1)        /* Logical OR of all CH_ES[ERR] */
+REG32(INT, 0x008)
+REG32(HRS, 0x00C)
+REG32(CH_GRPRI, 0x100)
+
+/* Channel page */
+REG32(CH_CSR, 0x00)
+    FIELD(CH_CSR, ERQ, 0, 1)     /* Enable DMA request */
+    FIELD(CH_CSR, EARQ, 1, 1)    /* Enable asynchronous DMA request */
+    FIELD(CH_CSR, EEI, 2, 1)     /* Enable error interrupt */
+    FIELD(CH_CSR, EBW, 3, 1)     /* Enable buffered writes */
+    FIELD(CH_CSR, DONE, 30, 1)   /* Channel done */
+    FIELD(CH_CSR, ACTIVE, 31, 1) /* Channel active */
+REG32(CH_ES, 0x04)
+    FIELD(CH_ES, DBE, 0, 1)      /* Destination bus error */
+    FIELD(CH_ES, SBE, 1, 1)      /* Source bus error */
+    FIELD(CH_ES, SGE, 2, 1)      /* Scatter/gather configuration error */
+    FIELD(CH_ES, NCE, 3, 1)      /* NBYTES/CITER configuration error */
+    FIELD(CH_ES, DOE, 4, 1)      /* Destination offset error */
+    FIELD(CH_ES, DAE, 5, 1)      /* Destination address error */
+    FIELD(CH_ES, SOE, 6, 1)      /* Source offset error */
+    FIELD(CH_ES, SAE, 7, 1)      /* Source address error */
+    FIELD(CH_ES, ERR, 31, 1)     /* Error in channel */
+REG32(CH_INT, 0x08)
+    FIELD(CH_INT, INT, 0, 1)
+REG32(CH_SBR, 0x0C)
+REG32(CH_PRI, 0x10)
+    FIELD(CH_PRI, APL, 0, 3)     /* Arbitration priority level */
+    FIELD(CH_PRI, DPA, 30, 1)    /* Disable preempt ability */
+    FIELD(CH_PRI, ECP, 31, 1)    /* Enable channel preemption */
+
+/* Transfer control descriptor, as 32-bit words of the channel page */
+REG32(TCD_SADDR, 0x20)
+REG32(TCD_SOFF_ATTR, 0x24)
+    FIELD(TCD_SOFF_ATTR, SOFF, 0, 16)
+    FIELD(TCD_SOFF_ATTR, DSIZE, 16, 3)
+    FIELD(TCD_SOFF_ATTR, DMOD, 19, 5)
+    FIELD(TCD_SOFF_ATTR, SSIZE, 24, 3)
+    FIELD(TCD_SOFF_ATTR, SMOD, 27, 5)
+REG32(TCD_NBYTES, 0x28)
+    FIELD(TCD_NBYTES, NBYTES, 0, 30)
+    FIELD(TCD_NBYTES, NBYTES_MLOFF, 0, 10)
+    FIELD(TCD_NBYTES, MLOFF, 10, 20)
+    FIELD(TCD_NBYTES, DMLOE, 30, 1)
+    FIELD(TCD_NBYTES, SMLOE, 31, 1)
+REG32(TCD_SLAST_SDA, 0x2C)
+REG32(TCD_DADDR, 0x30)
+REG32(TCD_DOFF_CITER, 0x34)
+    FIELD(TCD_DOFF_CITER, DOFF, 0, 16)
+    FIELD(TCD_DOFF_CITER, CITER, 16, 15)
+    FIELD(TCD_DOFF_CITER, CITER_LINKED, 16, 9)
+    FIELD(TCD_DOFF_CITER, LINKCH, 25, 5)
+    FIELD(TCD_DOFF_CITER, ELINK, 31, 1)
+REG32(TCD_DLAST_SGA, 0x38)
+REG32(TCD_CSR_BITER, 0x3C)
+    FIELD(TCD_CSR_BITER, START, 0, 1)
+    FIELD(TCD_CSR_BITER, INTMAJOR, 1, 1)
+    FIELD(TCD_CSR_BITER, INTHALF, 2, 1)
+    FIELD(TCD_CSR_BITER, DREQ, 3, 1)
+    FIELD(TCD_CSR_BITER, ESG, 4, 1)
+    FIELD(TCD_CSR_BITER, MAJORELINK, 5, 1)
+    FIELD(TCD_CSR_BITER, EEOP, 6, 1)
+    FIELD(TCD_CSR_BITER, ESDA, 7, 1)
+    FIELD(TCD_CSR_BITER, MAJORLINKCH, 8, 5)
+    FIELD(TCD_CSR_BITER, BWC, 14, 2)
+    FIELD(TCD_CSR_BITER, BITER, 16, 15)
+    FIELD(TCD_CSR_BITER, BITER_LINKED, 16, 9)
+    FIELD(TCD_CSR_BITER, LINKCH, 25, 5)
+    FIELD(TCD_CSR_BITER, ELINK, 31, 1)
+
+/* Index of each TCD word in S32K3EDMAChannel::tcd */
+#define TCD_IDX(reg) ((A_ ## reg - A_TCD_SADDR) >> 2)
+
+#define CSR_RW_MASK (R_CSR_EDBG_MASK | R_CSR_ERCA_MASK | R_CSR_HAE_MASK | \
+                     R_CSR_HALT_MASK | R_CSR_GCLC_MASK | R_CSR_GMRC_MASK)
+#define CH_CSR_RW_MASK (R_CH_CSR_ERQ_MASK | R_CH_CSR_EARQ_MASK | \
+                        R_CH_CSR_EEI_MASK | R_CH_CSR_EBW_MASK)
+#define CH_PRI_RW_MASK (R_CH_PRI_APL_MASK | R_CH_PRI_DPA_MASK | \
+                        R_CH_PRI_ECP_MASK)
+
+/* Largest transfer size (SSIZE/DSIZE == 5: 32-byte burst) */
+#define EDMA_MAX_XFER_SIZE 32
+
+/* Minor loops serviced per bottom half run before yielding the main loop */
+#define EDMA_BH_BUDGET 64
+
+static unsigned int s32k3_edma_xfer_size(uint32_t size_field)
+{
+    return size_field <= 5 ? 1 << size_field : 0;
+}
+
+static void s32k3_edma_update_irq(S32K3EDMAState *s, unsigned int n)
+{
+    S32K3EDMAChannel *ch = &s->ch[n];
+    bool err = false;
+
+    qemu_set_irq(s->irq[n], ch->intr & R_CH_INT_INT_MASK);
+
+    for (unsigned int i = 0; i < S32K3_EDMA_NUM_CHANNELS; i++) {
+        if ((s->ch[i].es & R_CH_ES_ERR_MASK) &&
+            (s->ch[i].csr & R_CH_CSR_EEI_MASK)) {
+            err = true;
+            break;
+        }
+    }
+    qemu_set_irq(s->err_irq, err);
+}
+
+static void s32k3_edma_error(S32K3EDMAState *s, S32K3EDMAChannel *ch,
+                             uint32_t errors)
+{
+    trace_s32k3_edma_error(ch->id, errors);
+
+    ch->es |= errors | R_CH_ES_ERR_MASK;
+    s->es = FIELD_DP32(errors, ES, ERRCHN, ch->id);
+    /* The faulting service request is dropped */
+    ch->tcd[TCD_IDX(TCD_CSR_BITER)] &= ~R_TCD_CSR_BITER_START_MASK;
+    if (s->csr & R_CSR_HAE_MASK) {
+        s->csr |= R_CSR_HALT_MASK;
+    }
+    s32k3_edma_update_irq(s, ch->id);
+}
+
+static bool s32k3_edma_pending(S32K3EDMAState *s, S32K3EDMAChannel *ch)
+{
+    if (ch->tcd[TCD_IDX(TCD_CSR_BITER)] & R_TCD_CSR_BITER_START_MASK) {
+        return true;
+    }
+    return (ch->csr & R_CH_CSR_ERQ_MASK) && (s->hrs & (1U << ch->id)) &&
+           !(ch->es & R_CH_ES_ERR_MASK);
+}
+
+/*
+ * Select the next channel to service: the highest arbitration priority
+ * level wins, ties go to the highest channel number.
+ */
+static S32K3EDMAChannel *s32k3_edma_next_channel(S32K3EDMAState *s)
+{
+    S32K3EDMAChannel *best = NULL;
+    uint32_t best_apl = 0;
+
+    if (s->csr & R_CSR_HALT_MASK) {
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < S32K3_EDMA_NUM_CHANNELS; i++) {
+        S32K3EDMAChannel *ch = &s->ch[i];
+        uint32_t apl = FIELD_EX32(ch->pri, CH_PRI, APL);
+
+        if (s32k3_edma_pending(s, ch) && (!best || apl >= best_apl)) {
+            best = ch;
+            best_apl = apl;
+        }
+    }
+    return best;
+}
+
+static uint32_t s32k3_edma_next_addr(uint32_t addr, int32_t off, uint32_t mod)
+{
+    uint32_t mask;
+
+    if (mod == 0) {
+        return addr + off;
+    }
+    /* Modulo addressing: only the low mod bits of the address move */
+    mask = MAKE_64BIT_MASK(0, mod);
+    return (addr & ~mask) | ((addr + off) & mask);
+}
+
+/*
+ * Copy @len bytes between two RAM ranges with a single host memmove().
+ * Returns false without copying anything when either range is not plain
+ * RAM (MMIO, ROM as a destination, or crossing a region boundary), in
+ * which case the caller falls back to beat by beat accesses.
+ */
+static bool s32k3_edma_copy_direct(S32K3EDMAState *s, hwaddr src, hwaddr dst,
+                                   hwaddr len)
+{
+    MemTxAttrs attrs = MEMTXATTRS_UNSPECIFIED;
+    MemoryRegion *mr;
+    hwaddr xlat, l, slen, dlen;
+    void *sptr, *dptr;
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        l = len;
+        mr = address_space_translate(&s->dma_as, src, &xlat, &l, false, attrs);
+        if (l < len || !memory_access_is_direct(mr, false)) {
+            return false;
+        }
+        l = len;
+        mr = address_space_translate(&s->dma_as, dst, &xlat, &l, true, attrs);
+        if (l < len || !memory_access_is_direct(mr, true)) {
+            return false;
+        }
+    }
+
+    slen = len;
+    sptr = address_space_map(&s->dma_as, src, &slen, false, attrs);
+    if (!sptr) {
+        return false;
+    }
+    dlen = len;
+    dptr = address_space_map(&s->dma_as, dst, &dlen, true, attrs);
+    if (!dptr) {
+        address_space_unmap(&s->dma_as, sptr, slen, false, 0);
+        return false;
+    }
+    if (slen < len || dlen < len) {
+        address_space_unmap(&s->dma_as, dptr, dlen, true, 0);
+        address_space_unmap(&s->dma_as, sptr, slen, false, 0);
+        return false;
+    }
+
+    memmove(dptr, sptr, len);
+
+    /* Unmapping the destination marks it dirty and invalidates any TBs */
+    address_space_unmap(&s->dma_as, dptr, dlen, true, len);
+    address_space_unmap(&s->dma_as, sptr, slen, false, len);
+    return true;
+}
+
+/*
+ * Move one minor loop worth of data beat by beat. Source beats are gathered
+ * until a whole destination beat is available, so SSIZE and DSIZE may
+ * differ. Returns the CH_ES error bits, if any.
+ */
+static uint32_t s32k3_edma_copy_beats(S32K3EDMAState *s, uint32_t *saddr,
+                                      uint32_t *daddr, uint32_t nbytes,
+                                      uint32_t attr_word, int32_t doff)
+{
+    MemTxAttrs attrs = MEMTXATTRS_UNSPECIFIED;
+    unsigned int ssize = s32k3_edma_xfer_size(
+        FIELD_EX32(attr_word, TCD_SOFF_ATTR, SSIZE));
+    unsigned int dsize = s32k3_edma_xfer_size(
+        FIELD_EX32(attr_word, TCD_SOFF_ATTR, DSIZE));
+    int32_t soff = (int16_t)FIELD_EX32(attr_word, TCD_SOFF_ATTR, SOFF);
+    uint32_t smod = FIELD_EX32(attr_word, TCD_SOFF_ATTR, SMOD);
+    uint32_t dmod = FIELD_EX32(attr_word, TCD_SOFF_ATTR, DMOD);
+    uint8_t buf[2 * EDMA_MAX_XFER_SIZE];
+    unsigned int fill = 0;
+
+    for (uint32_t done = 0; done < nbytes; done += ssize) {
+        if (address_space_read(&s->dma_as, *saddr, attrs, buf + fill,
+                               ssize) != MEMTX_OK) {
+            return R_CH_ES_SBE_MASK;
+        }
+        fill += ssize;
+        *saddr = s32k3_edma_next_addr(*saddr, soff, smod);
+
+        while (fill >= dsize) {
+            if (address_space_write(&s->dma_as, *daddr, attrs, buf,
+                                    dsize) != MEMTX_OK) {
+                return R_CH_ES_DBE_MASK;
+            }
+            fill -= dsize;
+            memmove(buf, buf + dsize, fill);
+            *daddr = s32k3_edma_next_addr(*daddr, doff, dmod);
+        }
+    }
+    return 0;
+}
+
+/* Check the TCD for the configuration errors the engine reports */
+static uint32_t s32k3_edma_check_tcd(S32K3EDMAChannel *ch, uint32_t nbytes)
+{
+    uint32_t *tcd = ch->tcd;
+    uint32_t attr_word = tcd[TCD_IDX(TCD_SOFF_ATTR)];
+    uint32_t citer_word = tcd[TCD_IDX(TCD_DOFF_CITER)];
+    uint32_t biter_word = tcd[TCD_IDX(TCD_CSR_BITER)];
+    unsigned int ssize = s32k3_edma_xfer_size(
+        FIELD_EX32(attr_word, TCD_SOFF_ATTR, SSIZE));
+    unsigned int dsize = s32k3_edma_xfer_size(
+        FIELD_EX32(attr_word, TCD_SOFF_ATTR, DSIZE));
+    uint32_t citer;
+    uint32_t errors = 0;
+
+    if (ssize == 0 || dsize == 0) {
+        return R_CH_ES_NCE_MASK;
+    }
+
+    if (tcd[TCD_IDX(TCD_SADDR)] & (ssize - 1)) {
+        errors |= R_CH_ES_SAE_MASK;
+    }
+    if (tcd[TCD_IDX(TCD_DADDR)] & (dsize - 1)) {
+        errors |= R_CH_ES_DAE_MASK;
+    }
+    if (FIELD_EX32(attr_word, TCD_SOFF_ATTR, SOFF) & (ssize - 1)) {
+        errors |= R_CH_ES_SOE_MASK;
+    }
+    if (FIELD_EX32(citer_word, TCD_DOFF_CITER, DOFF) & (dsize - 1)) {
+        errors |= R_CH_ES_DOE_MASK;
+    }
+
+    if (citer_word & R_TCD_DOFF_CITER_ELINK_MASK) {
+        citer = FIELD_EX32(citer_word, TCD_DOFF_CITER, CITER_LINKED);
+    } else {
+        citer = FIELD_EX32(citer_word, TCD_DOFF_CITER, CITER);
+    }
+    if (nbytes == 0 || nbytes % MAX(ssize, dsize) || citer == 0 ||
+        !(citer_word & R_TCD_DOFF_CITER_ELINK_MASK) !=
+        !(biter_word & R_TCD_CSR_BITER_ELINK_MASK)) {
+        errors |= R_CH_ES_NCE_MASK;
+    }
+
+    if ((biter_word & R_TCD_CSR_BITER_ESG_MASK) &&
+        (tcd[TCD_IDX(TCD_DLAST_SGA)] & 0x1f)) {
+        errors |= R_CH_ES_SGE_MASK;
+    }
+
+    return errors;
+}
+
+/* Load the next TCD of a scatter/gather chain from memory */
+static uint32_t s32k3_edma_load_tcd(S32K3EDMAState *s, S32K3EDMAChannel *ch)
+{
+    uint32_t sga = ch->tcd[TCD_IDX(TCD_DLAST_SGA)];
+    uint32_t tcd[S32K3_EDMA_TCD_WORDS];
+
+    if (address_space_read(&s->dma_as, sga, MEMTXATTRS_UNSPECIFIED, tcd,
+                           sizeof(tcd)) != MEMTX_OK) {
+        return R_CH_ES_SGE_MASK;
+    }
+    for (unsigned int i = 0; i < S32K3_EDMA_TCD_WORDS; i++) {
+        ch->tcd[i] = le32_to_cpu(tcd[i]);
+    }
+    trace_s32k3_edma_load_tcd(ch->id, sga);
+    return 0;
+}
+
+static void s32k3_edma_link(S32K3EDMAState *s, unsigned int n)
+{
+    s->ch[n].tcd[TCD_IDX(TCD_CSR_BITER)] |= R_TCD_CSR_BITER_START_MASK;
+}
+
+/* Execute one minor loop of @ch and do the major loop bookkeeping */
+static void s32k3_edma_service(S32K3EDMAState *s, S32K3EDMAChannel *ch)
+{
+    uint32_t *tcd = ch->tcd;
+    uint32_t nbytes_word = tcd[TCD_IDX(TCD_NBYTES)];
+    uint32_t attr_word = tcd[TCD_IDX(TCD_SOFF_ATTR)];
+    uint32_t citer_word = tcd[TCD_IDX(TCD_DOFF_CITER)];
+    uint32_t csr_word = tcd[TCD_IDX(TCD_CSR_BITER)];
+    uint32_t saddr = tcd[TCD_IDX(TCD_SADDR)];
+    uint32_t daddr = tcd[TCD_IDX(TCD_DADDR)];
+    unsigned int ssize = s32k3_edma_xfer_size(
+        FIELD_EX32(attr_word, TCD_SOFF_ATTR, SSIZE));
+    unsigned int dsize = s32k3_edma_xfer_size(
+        FIELD_EX32(attr_word, TCD_SOFF_ATTR, DSIZE));
+    int32_t soff = (int16_t)FIELD_EX32(attr_word, TCD_SOFF_ATTR, SOFF);
+    int32_t doff = (int16_t)FIELD_EX32(citer_word, TCD_DOFF_CITER, DOFF);
+    bool elink = citer_word & R_TCD_DOFF_CITER_ELINK_MASK;
+    uint32_t nbytes, citer, biter, errors;
+    int32_t mloff = 0;
+
+    if (nbytes_word & (R_TCD_NBYTES_SMLOE_MASK | R_TCD_NBYTES_DMLOE_MASK)) {
+        nbytes = FIELD_EX32(nbytes_word, TCD_NBYTES, NBYTES_MLOFF);
+        mloff = sextract32(nbytes_word, R_TCD_NBYTES_MLOFF_SHIFT,
+                           R_TCD_NBYTES_MLOFF_LENGTH);
+    } else {
+        nbytes = FIELD_EX32(nbytes_word, TCD_NBYTES, NBYTES);
+    }
+
+    errors = s32k3_edma_check_tcd(ch, nbytes);
+    if (errors) {
+        s32k3_edma_error(s, ch, errors);
+        return;
+    }
+
+    /* Channel activation: START self-clears and DONE is cleared */
+    csr_word &= ~R_TCD_CSR_BITER_START_MASK;
+    tcd[TCD_IDX(TCD_CSR_BITER)] = csr_word;
+    ch->csr &= ~R_CH_CSR_DONE_MASK;
+    if (elink) {
+        citer = FIELD_EX32(citer_word, TCD_DOFF_CITER, CITER_LINKED);
+    } else {
+        citer = FIELD_EX32(citer_word, TCD_DOFF_CITER, CITER);
+    }
+
+    trace_s32k3_edma_minor_loop(ch->id, saddr, daddr, nbytes, citer);
+
+    if (soff == ssize && doff == dsize &&
+        !FIELD_EX32(attr_word, TCD_SOFF_ATTR, SMOD) &&
+        !FIELD_EX32(attr_word, TCD_SOFF_ATTR, DMOD) &&
+        s32k3_edma_copy_direct(s, saddr, daddr, nbytes)) {
+        saddr += nbytes;
+        daddr += nbytes;
+    } else {
+        errors = s32k3_edma_copy_beats(s, &saddr, &daddr, nbytes, attr_word,
+                                       doff);
+        if (errors) {
+            s32k3_edma_error(s, ch, errors);
+            return;
+        }
+    }
+
+    if (nbytes_word & R_TCD_NBYTES_SMLOE_MASK) {
+        saddr += mloff;
+    }
+    if (nbytes_word & R_TCD_NBYTES_DMLOE_MASK) {
+        daddr += mloff;
+    }
+
+    citer--;
+    if (citer) {
+        if (elink) {
+            citer_word = FIELD_DP32(citer_word, TCD_DOFF_CITER, CITER_LINKED,
+                                    citer);
+        } else {
+            citer_word = FIELD_DP32(citer_word, TCD_DOFF_CITER, CITER, citer);
+        }
+        tcd[TCD_IDX(TCD_SADDR)] = saddr;
+        tcd[TCD_IDX(TCD_DADDR)] = daddr;
+        tcd[TCD_IDX(TCD_DOFF_CITER)] = citer_word;
+
+        if (csr_word & R_TCD_CSR_BITER_INTHALF_MASK) {
+            biter = elink ? FIELD_EX32(csr_word, TCD_CSR_BITER, BITER_LINKED)
+                          : FIELD_EX32(csr_word, TCD_CSR_BITER, BITER);
+            if (citer == biter / 2) {
+                ch->intr |= R_CH_INT_INT_MASK;
+                s32k3_edma_update_irq(s, ch->id);
+            }
+        }
+        /* Minor loop channel link, on every minor loop but the last */
+        if (elink) {
+            s32k3_edma_link(s, FIELD_EX32(citer_word, TCD_DOFF_CITER, LINKCH));
+        }
+        return;
+    }
+
+    /* Major loop complete */
+    trace_s32k3_edma_major_done(ch->id);
+
+    if (!(csr_word & R_TCD_CSR_BITER_ESDA_MASK)) {
+        saddr += tcd[TCD_IDX(TCD_SLAST_SDA)];
+    }
+    if (!(csr_word & R_TCD_CSR_BITER_ESG_MASK)) {
+        daddr += tcd[TCD_IDX(TCD_DLAST_SGA)];
+    }
+    tcd[TCD_IDX(TCD_SADDR)] = saddr;
+    tcd[TCD_IDX(TCD_DADDR)] = daddr;
+    /* CITER reloads from BITER, including the ELINK/LINKCH bits */
+    tcd[TCD_IDX(TCD_DOFF_CITER)] =
+        (citer_word & R_TCD_DOFF_CITER_DOFF_MASK) |
+        (csr_word & ~MAKE_64BIT_MASK(0, 16));
+
+    ch->csr |= R_CH_CSR_DONE_MASK;
+    if (csr_word & R_TCD_CSR_BITER_DREQ_MASK) {
+        ch->csr &= ~R_CH_CSR_ERQ_MASK;
+    }
+    if (csr_word & R_TCD_CSR_BITER_INTMAJOR_MASK) {
+        ch->intr |= R_CH_INT_INT_MASK;
+        s32k3_edma_update_irq(s, ch->id);
+    }
+    if (csr_word & R_TCD_CSR_BITER_MAJORELINK_MASK) {
+        s32k3_edma_link(s, FIELD_EX32(csr_word, TCD_CSR_BITER, MAJORLINKCH));
+    }
+
+    if (csr_word & R_TCD_CSR_BITER_ESG_MASK) {
+        errors = s32k3_edma_load_tcd(s, ch);
+        if (errors) {
+            s32k3_edma_error(s, ch, errors);
+        }
+    }
+}
+
+static void s32k3_edma_run(void *opaque)
+{
+    S32K3EDMAState *s = opaque;
+    S32K3EDMAChannel *ch;
+
+    for (unsigned int budget = EDMA_BH_BUDGET; budget; budget--) {
+        ch = s32k3_edma_next_channel(s);
+        if (!ch) {
+            return;
+        }
+        s32k3_edma_service(s, ch);
+    }
+
+    /* Still busy: let the rest of the machine run before going on */
+    qemu_bh_schedule(s->bh);
+}
+
+static void s32k3_edma_kick(S32K3EDMAState *s)
+{
+    if (s32k3_edma_next_channel(s)) {
+        qemu_bh_schedule(s->bh);
+    }
+}
+
+static void s32k3_edma_set_request(void *opaque, int n, int level)
+{
+    S32K3EDMAState *s = opaque;
+
+    trace_s32k3_edma_request(n, level);
+
+    if (level) {
+        s->hrs |= 1U << n;
+        s32k3_edma_kick(s);
+    } else {
+        s->hrs &= ~(1U << n);
+    }
+}
+
+static uint64_t s32k3_edma_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    S32K3EDMAState *s = opaque;
+    uint64_t retvalue = 0;
+
+    switch (addr) {
+    case A_CSR:
+        retvalue = s->csr;
+        break;
+    case A_ES:
+        retvalue = s->es;
+        for (unsigned int i = 0; i < S32K3_EDMA_NUM_CHANNELS; i++) {
+            if (s->ch[i].es & R_CH_ES_ERR_MASK) {
+                retvalue |= R_ES_VLD_MASK;
+                break;
+            }
+        }
+        break;
+    case A_INT:
+        for (unsigned int i = 0; i < S32K3_EDMA_NUM_CHANNELS; i++) {
+            retvalue |= (uint64_t)(s->ch[i].intr & R_CH_INT_INT_MASK) << i;
+        }
+        break;
+    case A_HRS:
+        retvalue = s->hrs;
+        break;
+    case A_CH_GRPRI ... A_CH_GRPRI + 4 * (S32K3_EDMA_NUM_CHANNELS - 1):
+        retvalue = s->grpri[(addr - A_CH_GRPRI) >> 2];
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: Bad offset 0x%"HWADDR_PRIx"\n", __func__, addr);
+        break;
+    }
+
+    trace_s32k3_edma_read(addr, retvalue);
+
+    return retvalue;
+}
+
+static void s32k3_edma_write(void *opaque, hwaddr addr,
+                             uint64_t val64, unsigned int size)
+{
+    S32K3EDMAState *s = opaque;
+    const uint32_t value = val64;
+
+    trace_s32k3_edma_write(addr, value);
+
+    switch (addr) {
+    case A_CSR:
+        if (value & (R_CSR_ECX_MASK | R_CSR_CX_MASK)) {
+            /* Minor loops complete atomically: nothing is ever in flight */
+            qemu_log_mask(LOG_UNIMP, "%s: transfer cancel\n", __func__);
+        }
+        s->csr = (s->csr & ~CSR_RW_MASK) | (value & CSR_RW_MASK);
+        s32k3_edma_kick(s);
+        return;
+    case A_ES:
+    case A_INT:
+    case A_HRS:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: write to read-only offset 0x%"HWADDR_PRIx"\n",
+                      __func__, addr);
+        return;
+    case A_CH_GRPRI ... A_CH_GRPRI + 4 * (S32K3_EDMA_NUM_CHANNELS - 1):
+        s->grpri[(addr - A_CH_GRPRI) >> 2] = value & 0x1f;
+        return;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: Bad offset 0x%"HWADDR_PRIx"\n", __func__, addr);
+    }
+}
+
+static const MemoryRegionOps s32k3_edma_ops = {
+    .read = s32k3_edma_read,
+    .write = s32k3_edma_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .valid = {
+        .min_access_size = 4,
+        .max_access_size = 4,
+        .unaligned = false
+    },
+};
+
+/*
+ * The channel page is accessed in 8, 16 or 32-bit units: the TCD is made of
+ * 16-bit fields that drivers commonly write one at a time. Accesses are
+ * resolved against the containing 32-bit register.
+ */
+static uint64_t s32k3_edma_ch_read(void *opaque, hwaddr addr,
+                                   unsigned int size)
+{
+    S32K3EDMAChannel *ch = opaque;
+    hwaddr reg = addr & ~3;
+    uint32_t word;
+
+    switch (reg) {
+    case A_CH_CSR:
+        word = ch->csr;
+        break;
+    case A_CH_ES:
+        word = ch->es;
+        break;
+    case A_CH_INT:
+        word = ch->intr;
+        break;
+    case A_CH_SBR:
+        word = ch->sbr;
+        break;
+    case A_CH_PRI:
+        word = ch->pri;
+        break;
+    case A_TCD_SADDR ... A_TCD_CSR_BITER:
+        word = ch->tcd[(reg - A_TCD_SADDR) >> 2];
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: Bad offset 0x%"HWADDR_PRIx"\n", __func__, addr);
+        return 0;
+    }
+
+    word = extract32(word, (addr & 3) * 8, size * 8);
+    trace_s32k3_edma_ch_read(ch->id, addr, word);
+
+    return word;
+}
+
+static void s32k3_edma_ch_write(void *opaque, hwaddr addr,
+                                uint64_t val64, unsigned int size)
+{
+    S32K3EDMAChannel *ch = opaque;
+    S32K3EDMAState *s = ch->edma;
+    hwaddr reg = addr & ~3;
+    unsigned int shift = (addr & 3) * 8;
+    uint32_t mask = MAKE_64BIT_MASK(shift, size * 8);
+    uint32_t value = val64 << shift;
+
+    trace_s32k3_edma_ch_write(ch->id, addr, val64);
+
+    switch (reg) {
+    case A_CH_CSR:
+        ch->csr = (ch->csr & ~(CH_CSR_RW_MASK & mask)) |
+                  (value & CH_CSR_RW_MASK & mask);
+        ch->csr &= ~(value & mask & R_CH_CSR_DONE_MASK);
+        s32k3_edma_update_irq(s, ch->id);
+        break;
+    case A_CH_ES:
+        /* Clearing ERR clears every error bit and re-enables requests */
+        if (value & mask & R_CH_ES_ERR_MASK) {
+            ch->es = 0;
+        }
+        s32k3_edma_update_irq(s, ch->id);
+        break;
+    case A_CH_INT:
+        ch->intr &= ~(value & mask & R_CH_INT_INT_MASK);
+        s32k3_edma_update_irq(s, ch->id);
+        return;
+    case A_CH_SBR:
+        ch->sbr = (ch->sbr & ~mask) | (value & mask);
+        return;
+    case A_CH_PRI:
+        ch->pri = (ch->pri & ~(CH_PRI_RW_MASK & mask)) |
+                  (value & CH_PRI_RW_MASK & mask);
+        return;
+    case A_TCD_SADDR ... A_TCD_CSR_BITER:
+        ch->tcd[(reg - A_TCD_SADDR) >> 2] =
+            (ch->tcd[(reg - A_TCD_SADDR) >> 2] & ~mask) | (value & mask);
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "%s: Bad offset 0x%"HWADDR_PRIx"\n", __func__, addr);
+        return;
+    }
+
+    /* Enabling a request or setting TCD_CSR.START may start the channel */
+    s32k3_edma_kick(s);
+}
+
+static const MemoryRegionOps s32k3_edma_ch_ops = {
+    .read = s32k3_edma_ch_read,
+    .write = s32k3_edma_ch_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .valid = {
+        .min_access_size = 1,
+        .max_access_size = 4,
+        .unaligned = false
+    },
+};
+
+static void s32k3_edma_reset_hold(Object *obj, ResetType type)
+{
+    S32K3EDMAState *s = S32K3_EDMA(obj);
+
+    s->csr = 0;
+    s->es = 0;
+    memset(s->grpri, 0, sizeof(s->grpri));
+
+    for (unsigned int i = 0; i < S32K3_EDMA_NUM_CHANNELS; i++) {
+        S32K3EDMAChannel *ch = &s->ch[i];
+
+        ch->csr = 0;
+        ch->es = 0;
+        ch->intr = 0;
+        ch->sbr = 0;
+        ch->pri = 0;
+        memset(ch->tcd, 0, sizeof(ch->tcd));
+        qemu_irq_lower(s->irq[i]);
+    }
+    qemu_irq_lower(s->err_irq);
+    qemu_bh_cancel(s->bh);
+}
+
+static void s32k3_edma_init(Object *obj)
+{
+    S32K3EDMAState *s = S32K3_EDMA(obj);
+    SysBusDevice *sbd = SYS_BUS_DEVICE(obj);
+
+    memory_region_init_io(&s->mmio, obj, &s32k3_edma_ops, s,
+                          TYPE_S32K3_EDMA, S32K3_EDMA_CH_PAGE_SIZE);
+    sysbus_init_mmio(sbd, &s->mmio);
+
+    for (unsigned int i = 0; i < S32K3_EDMA_NUM_CHANNELS; i++) {
+        g_autofree char *name = g_strdup_printf(TYPE_S32K3_EDMA ".ch%u", i);
+
+        s->ch[i].edma = s;
+        s->ch[i].id = i;
+        memory_region_init_io(&s->ch_mmio[i], obj, &s32k3_edma_ch_ops,
+                              &s->ch[i], name, S32K3_EDMA_CH_PAGE_SIZE);
+        sysbus_init_mmio(sbd, &s->ch_mmio[i]);
+        sysbus_init_irq(sbd, &s->irq[i]);
+    }
+    sysbus_init_irq(sbd, &s->err_irq);
+
+    qdev_init_gpio_in(DEVICE(obj), s32k3_edma_set_request,
+                      S32K3_EDMA_NUM_CHANNELS);
+}
+
+static void s32k3_edma_realize(DeviceState *dev, Error **errp)
+{
+    S32K3EDMAState *s = S32K3_EDMA(dev);
+
+    if (!s->downstream) {
+        error_setg(errp, "eDMA 'memory' link not set");
+        return;
+    }
+
+    address_space_init(&s->dma_as, s->downstream, "s32k3-edma-downstream");
+    s->bh = qemu_bh_new_guarded(s32k3_edma_run, s,
+                                &dev->mem_reentrancy_guard);
+}
+
+static int s32k3_edma_post_load(void *opaque, int version_id)
+{
+    s32k3_edma_kick(opaque);
+    return 0;
+}
+
+static const VMStateDescription vmstate_s32k3_edma_channel = {
+    .name = TYPE_S32K3_EDMA "/channel",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (const VMStateField[]) {
+        VMSTATE_UINT32(csr, S32K3EDMAChannel),
+        VMSTATE_UINT32(es, S32K3EDMAChannel),
+        VMSTATE_UINT32(intr, S32K3EDMAChannel),
+        VMSTATE_UINT32(sbr, S32K3EDMAChannel),
+        VMSTATE_UINT32(pri, S32K3EDMAChannel),
+        VMSTATE_UINT32_ARRAY(tcd, S32K3EDMAChannel, S32K3_EDMA_TCD_WORDS),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription vmstate_s32k3_edma = {
+    .name = TYPE_S32K3_EDMA,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = s32k3_edma_post_load,
+    .fields = (const VMStateField[]) {
+        VMSTATE_UINT32(csr, S32K3EDMAState),
+        VMSTATE_UINT32(es, S32K3EDMAState),
+        VMSTATE_UINT32(hrs, S32K3EDMAState),
+        VMSTATE_UINT32_ARRAY(grpri, S32K3EDMAState, S32K3_EDMA_NUM_CHANNELS),
+        VMSTATE_STRUCT_ARRAY(ch, S32K3EDMAState, S32K3_EDMA_NUM_CHANNELS, 1,
+                             vmstate_s32k3_edma_channel, S32K3EDMAChannel),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static Property s32k3_edma_properties[] = {
+    DEFINE_PROP_LINK("memory", S32K3EDMAState, downstream,
+                     TYPE_MEMORY_REGION, MemoryRegion *),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void s32k3_edma_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+    ResettableClass *rc = RESETTABLE_CLASS(klass);
+
+    rc->phases.hold = s32k3_edma_reset_hold;
+    device_class_set_props(dc, s32k3_edma_properties);
+    dc->realize = s32k3_edma_realize;
+    dc->vmsd = &vmstate_s32k3_edma;
+}
+
+static const TypeInfo s32k3_edma_info = {
+    .name          = TYPE_S32K3_EDMA,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(S32K3EDMAState),
+    .instance_init = s32k3_edma_init,
+    .class_init    = s32k3_edma_class_init,
+};
+
+static void s32k3_edma_register_types(void)
+{
+    type_register_static(&s32k3_edma_info);
+}
+
+type_init(s32k3_edma_register_types);
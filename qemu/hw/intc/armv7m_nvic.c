@@ -15,11 +15,15 @@
 #include "hw/sysbus.h"
 #include "migration/vmstate.h"
 #include "qemu/timer.h"
+#include "qemu/host-utils.h"
+#include "qemu/qemu-print.h"
 #include "hw/intc/armv7m_nvic.h"
 #include "hw/irq.h"
 #include "hw/qdev-properties.h"
+#include "sysemu/cpu-timers.h"
 #include "sysemu/tcg.h"
 #include "sysemu/runstate.h"
+#include "sysemu/sysemu.h"
 #include "target/arm/cpu.h"
 #include "target/arm/cpu-features.h"
 #include "exec/exec-all.h"
@@ -88,6 +92,240 @@ static int nvic_pending_prio(NVICState *s)
     return s->vectpending_prio;
 }
 
+/* Note that exception @irq has become pending or active */
+static void nvic_mark_busy(NVICState *s, int irq)
+{
+    set_bit(irq, s->busy_vectors);
+}
+
+/*
+ * Interrupt latency statistics (the "latency-stats" property).
+ *
+ * Every exception is timestamped when it becomes pending, when the NVIC
+ * makes it active (the CPU executes the first instruction of the handler
+ * right after) and when the handler returns. The latency is the time from
+ * pending to active, the handler time the one from active to the return,
+ * including the handlers preempting it. Times are in QEMU_CLOCK_VIRTUAL
+ * nanoseconds, and in instructions when icount is enabled.
+ *
+ * The histograms have 8 buckets per power of two, so the percentiles are
+ * accurate to 12.5%.
+ */
+#define NVIC_HIST_BUCKETS (16 + 60 * 8)
+
+typedef struct NVICHistogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[NVIC_HIST_BUCKETS];
+} NVICHistogram;
+
+struct NVICLatency {
+    int64_t pend_ns;
+    int64_t pend_insns;
+    int64_t entry_ns;
+    int64_t entry_insns;
+    NVICHistogram latency_ns;
+    NVICHistogram latency_insns;
+    NVICHistogram handler_ns;
+    NVICHistogram handler_insns;
+};
+
+static unsigned nvic_hist_bucket(uint64_t v)
+{
+    int e;
+
+    if (v < 16) {
+        return v;
+    }
+    e = 63 - clz64(v);
+    return 16 + (e - 4) * 8 + ((v >> (e - 3)) & 7);
+}
+
+static uint64_t nvic_hist_bucket_max(unsigned b)
+{
+    int e;
+
+    if (b < 16) {
+        return b;
+    }
+    e = (b - 16) / 8 + 4;
+    return ((uint64_t)(8 + (b - 16) % 8) << (e - 3)) + (1ULL << (e - 3)) - 1;
+}
+
+static void nvic_hist_add(NVICHistogram *h, uint64_t v)
+{
+    h->min = h->count ? MIN(h->min, v) : v;
+    h->max = MAX(h->max, v);
+    h->count++;
+    h->sum += v;
+    h->buckets[nvic_hist_bucket(v)]++;
+}
+
+static uint64_t nvic_hist_percentile(NVICHistogram *h, unsigned percent)
+{
+    uint64_t target = (h->count * percent + 99) / 100;
+    uint64_t seen = 0;
+
+    for (unsigned b = 0; b < NVIC_HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= target) {
+            return MIN(nvic_hist_bucket_max(b), h->max);
+        }
+    }
+    return h->max;
+}
+
+static int64_t nvic_latency_insns(void)
+{
+    return icount_enabled() ? icount_get_raw() : 0;
+}
+
+static NVICLatency *nvic_latency(NVICState *s, int irq)
+{
+    if (!s->latency_stats) {
+        return NULL;
+    }
+    if (!s->latency[irq]) {
+        s->latency[irq] = g_new0(NVICLatency, 1);
+        s->latency[irq]->pend_ns = -1;
+        s->latency[irq]->entry_ns = -1;
+    }
+    return s->latency[irq];
+}
+
+static void nvic_latency_pend(NVICState *s, int irq)
+{
+    NVICLatency *lat = nvic_latency(s, irq);
+
+    if (lat && lat->pend_ns < 0) {
+        lat->pend_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+        lat->pend_insns = nvic_latency_insns();
+    }
+}
+
+/* The exception was cleared before it was taken: the next pend starts over */
+static void nvic_latency_cancel(NVICState *s, int irq)
+{
+    if (s->latency[irq]) {
+        s->latency[irq]->pend_ns = -1;
+    }
+}
+
+static void nvic_latency_acknowledge(NVICState *s, int irq)
+{
+    NVICLatency *lat = nvic_latency(s, irq);
+
+    if (!lat) {
+        return;
+    }
+    lat->entry_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    lat->entry_insns = nvic_latency_insns();
+    if (lat->pend_ns >= 0) {
+        nvic_hist_add(&lat->latency_ns, lat->entry_ns - lat->pend_ns);
+        nvic_hist_add(&lat->latency_insns,
+                      lat->entry_insns - lat->pend_insns);
+        lat->pend_ns = -1;
+    }
+}
+
+static void nvic_latency_complete(NVICState *s, int irq)
+{
+    NVICLatency *lat = nvic_latency(s, irq);
+
+    if (lat && lat->entry_ns >= 0) {
+        nvic_hist_add(&lat->handler_ns,
+                      qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - lat->entry_ns);
+        nvic_hist_add(&lat->handler_insns,
+                      nvic_latency_insns() - lat->entry_insns);
+        lat->entry_ns = -1;
+    }
+}
+
+static void nvic_latency_print(int irq, const char *what, NVICHistogram *h)
+{
+    static const char *const names[NVIC_FIRST_IRQ] = {
+        [ARMV7M_EXCP_NMI] = "NMI",
+        [ARMV7M_EXCP_HARD] = "HardFault",
+        [ARMV7M_EXCP_MEM] = "MemManage",
+        [ARMV7M_EXCP_BUS] = "BusFault",
+        [ARMV7M_EXCP_USAGE] = "UsageFault",
+        [ARMV7M_EXCP_SECURE] = "SecureFault",
+        [ARMV7M_EXCP_SVC] = "SVCall",
+        [ARMV7M_EXCP_DEBUG] = "DebugMonitor",
+        [ARMV7M_EXCP_PENDSV] = "PendSV",
+        [ARMV7M_EXCP_SYSTICK] = "SysTick",
+    };
+    g_autofree char *name = NULL;
+
+    if (!h->count) {
+        return;
+    }
+    if (irq >= NVIC_FIRST_IRQ) {
+        name = g_strdup_printf("IRQ %d", irq - NVIC_FIRST_IRQ);
+    } else {
+        name = g_strdup(names[irq] ? names[irq] : "reserved");
+    }
+    qemu_printf("%s, %s, %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64
+                ", %" PRIu64 ", %" PRIu64 "\n", name, what, h->count, h->min,
+                h->sum / h->count, nvic_hist_percentile(h, 99), h->max,
+                h->max - h->min);
+}
+
+static void nvic_latency_report(Notifier *n, void *data)
+{
+    NVICState *s = container_of(n, NVICState, latency_report);
+    bool insns = icount_enabled();
+
+    qemu_printf("Interrupt latency of CPU %d, from pending to the first "
+                "instruction of the handler, and handler time%s\n",
+                CPU(s->cpu)->cpu_index,
+                insns ? "" : " (instructions need -icount)");
+    qemu_printf("exception, measure, count, min, avg, p99, max, jitter\n");
+    for (int irq = 0; irq < s->num_irq; irq++) {
+        NVICLatency *lat = s->latency[irq];
+
+        if (!lat) {
+            continue;
+        }
+        nvic_latency_print(irq, "latency ns", &lat->latency_ns);
+        if (insns) {
+            nvic_latency_print(irq, "latency insns", &lat->latency_insns);
+        }
+        nvic_latency_print(irq, "handler ns", &lat->handler_ns);
+        if (insns) {
+            nvic_latency_print(irq, "handler insns", &lat->handler_insns);
+        }
+    }
+}
+
+/*
+ * Return the next exception after @irq which may be pending or active,
+ * or s->num_irq if there is none. All the internal exceptions are
+ * returned; external interrupts are looked up in busy_vectors, dropping
+ * the stale bits of the ones found to be neither pending nor active.
+ * Exceptions are returned in increasing order, so callers see the same
+ * sequence as a plain loop over every exception number.
+ */
+static int nvic_next_busy(NVICState *s, int irq)
+{
+    irq++;
+    if (irq < NVIC_FIRST_IRQ) {
+        return irq;
+    }
+
+    for (;;) {
+        irq = find_next_bit(s->busy_vectors, s->num_irq, irq);
+        if (irq >= s->num_irq ||
+            s->vectors[irq].pending || s->vectors[irq].active) {
+            return irq;
+        }
+        clear_bit(irq, s->busy_vectors);
+        irq++;
+    }
+}
+
 /* Return the value of the ISCR RETTOBASE bit:
  * 1 if there is exactly one active exception
  * 0 if there is more than one active exception
@@ -107,7 +345,8 @@ static bool nvic_rettobase(NVICState *s)
     int irq, nhand = 0;
     bool check_sec = arm_feature(&s->cpu->env, ARM_FEATURE_M_SECURITY);
 
-    for (irq = ARMV7M_EXCP_RESET; irq < s->num_irq; irq++) {
+    for (irq = ARMV7M_EXCP_RESET; irq < s->num_irq;
+         irq = nvic_next_busy(s, irq)) {
         if (s->vectors[irq].active ||
             (check_sec && irq < NVIC_INTERNAL_VECTORS &&
              s->sec_vectors[irq].active)) {
@@ -138,7 +377,8 @@ static bool nvic_isrpending(NVICState *s)
         return true;
     }
 
-    for (irq = NVIC_FIRST_IRQ; irq < s->num_irq; irq++) {
+    for (irq = nvic_next_busy(s, NVIC_FIRST_IRQ - 1); irq < s->num_irq;
+         irq = nvic_next_busy(s, irq)) {
         if (s->vectors[irq].pending) {
             return true;
         }
@@ -242,7 +482,7 @@ static void nvic_recompute_state_secure(NVICState *s)
      * Annoyingly, now we have two prigroup values (for S and NS)
      * we can't do the loop comparison on raw priority values.
      */
-    for (i = 1; i < s->num_irq; i++) {
+    for (i = 1; i < s->num_irq; i = nvic_next_busy(s, i)) {
         for (bank = M_REG_S; bank >= M_REG_NS; bank--) {
             VecInfo *vec;
             int prio, subprio;
@@ -306,7 +546,7 @@ static void nvic_recompute_state(NVICState *s)
         return;
     }
 
-    for (i = 1; i < s->num_irq; i++) {
+    for (i = 1; i < s->num_irq; i = nvic_next_busy(s, i)) {
         VecInfo *vec = &s->vectors[i];
 
         if (vec->enabled && vec->pending && vec->prio < pend_prio) {
@@ -517,6 +757,7 @@ static void armv7m_nvic_clear_pending(NVICState *s, int irq, bool secure)
     trace_nvic_clear_pending(irq, secure, vec->enabled, vec->prio);
     if (vec->pending) {
         vec->pending = 0;
+        nvic_latency_cancel(s, irq);
         nvic_irq_update(s);
     }
 }
@@ -657,6 +898,8 @@ static void do_armv7m_nvic_set_pending(void *opaque, int irq, bool secure,
 
     if (!vec->pending) {
         vec->pending = 1;
+        nvic_mark_busy(s, irq);
+        nvic_latency_pend(s, irq);
         nvic_irq_update(s);
     }
 }
@@ -754,6 +997,7 @@ void armv7m_nvic_set_pending_lazyfp(NVICState *s, int irq, bool secure)
     }
     if (!vec->pending) {
         vec->pending = 1;
+        nvic_mark_busy(s, irq);
         /*
          * We do not call nvic_irq_update(), because we know our caller
          * is going to handle causing us to take the exception by
@@ -791,6 +1035,8 @@ void armv7m_nvic_acknowledge_irq(NVICState *s)
 
     vec->active = 1;
     vec->pending = 0;
+    nvic_mark_busy(s, pending);
+    nvic_latency_acknowledge(s, pending);
 
     write_v7m_exception(env, s->vectpending);
 
@@ -893,12 +1139,15 @@ int armv7m_nvic_complete_irq(NVICState *s, int irq, bool secure)
     }
 
     vec->active = 0;
+    nvic_latency_complete(s, irq);
     if (vec->level) {
         /* Re-pend the exception if it's still held high; only
          * happens for external IRQs
          */
         assert(irq >= NVIC_FIRST_IRQ);
         vec->pending = 1;
+        nvic_mark_busy(s, irq);
+        nvic_latency_pend(s, irq);
     }
 
     nvic_irq_update(s);
@@ -1839,6 +2088,7 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
                        R_V7M_MPU_CTRL_HFNMIENA_MASK |
                        R_V7M_MPU_CTRL_PRIVDEFENA_MASK);
         tlb_flush(CPU(cpu));
+        arm_mpu_cache_invalidate(cpu);
         break;
     case 0xd98: /* MPU_RNR */
         if (value >= cpu->pmsav7_dregion) {
@@ -1873,6 +2123,7 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
             }
             cpu->env.pmsav8.rbar[attrs.secure][region] = value;
             tlb_flush(CPU(cpu));
+            arm_mpu_cache_invalidate(cpu);
             return;
         }
 
@@ -1898,6 +2149,7 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
 
         cpu->env.pmsav7.drbar[region] = value & ~0x1f;
         tlb_flush(CPU(cpu));
+        arm_mpu_cache_invalidate(cpu);
         break;
     }
     case 0xda0: /* MPU_RASR (v7M), MPU_RLAR (v8M) */
@@ -1923,6 +2175,7 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
             }
             cpu->env.pmsav8.rlar[attrs.secure][region] = value;
             tlb_flush(CPU(cpu));
+            arm_mpu_cache_invalidate(cpu);
             return;
         }
 
@@ -1933,6 +2186,7 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
         cpu->env.pmsav7.drsr[region] = value & 0xff3f;
         cpu->env.pmsav7.dracr[region] = (value >> 16) & 0x173f;
         tlb_flush(CPU(cpu));
+        arm_mpu_cache_invalidate(cpu);
         break;
     }
     case 0xdc0: /* MPU_MAIR0 */
@@ -2388,6 +2642,12 @@ static MemTxResult nvic_sysreg_write(void *opaque, hwaddr addr,
                 (attrs.secure || s->itns[startvec + i]) &&
                 !(setval == 0 && s->vectors[startvec + i].level &&
                   !s->vectors[startvec + i].active)) {
+                if (setval) {
+                    nvic_mark_busy(s, startvec + i);
+                    nvic_latency_pend(s, startvec + i);
+                } else if (s->vectors[startvec + i].pending) {
+                    nvic_latency_cancel(s, startvec + i);
+                }
                 s->vectors[startvec + i].pending = setval;
             }
         }
@@ -2489,6 +2749,8 @@ static int nvic_post_load(void *opaque, int version_id)
         }
     }
 
+    /* busy_vectors is not migrated: rebuild it on the next scan */
+    bitmap_fill(s->busy_vectors, NVIC_MAX_VECTORS);
     nvic_recompute_state(s);
 
     return 0;
@@ -2577,6 +2839,8 @@ static Property props_nvic[] = {
      * to use a reasonable default.
      */
     DEFINE_PROP_UINT8("num-prio-bits", NVICState, num_prio_bits, 0),
+    /* Measure the interrupt latencies and print them when QEMU exits */
+    DEFINE_PROP_BOOL("latency-stats", NVICState, latency_stats, false),
     DEFINE_PROP_END_OF_LIST()
 };
 
@@ -2587,6 +2851,14 @@ static void armv7m_nvic_reset(DeviceState *dev)
 
     memset(s->vectors, 0, sizeof(s->vectors));
     memset(s->sec_vectors, 0, sizeof(s->sec_vectors));
+    bitmap_zero(s->busy_vectors, NVIC_MAX_VECTORS);
+    for (int i = 0; i < NVIC_MAX_VECTORS; i++) {
+        /* Forget what was pending or active before the reset */
+        if (s->latency[i]) {
+            s->latency[i]->pend_ns = -1;
+            s->latency[i]->entry_ns = -1;
+        }
+    }
     s->prigroup[M_REG_NS] = 0;
     s->prigroup[M_REG_S] = 0;
 
@@ -2744,6 +3016,11 @@ static void armv7m_nvic_realize(DeviceState *dev, Error **errp)
     memory_region_init_io(&s->sysregmem, OBJECT(s), &nvic_sysreg_ops, s,
                           "nvic_sysregs", 0x1000);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->sysregmem);
+
+    if (s->latency_stats) {
+        s->latency_report.notify = nvic_latency_report;
+        qemu_add_exit_notifier(&s->latency_report);
+    }
 }
 
 static void armv7m_nvic_instance_init(Object *obj)
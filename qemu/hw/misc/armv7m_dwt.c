@@ -0,0 +1,262 @@
+/*
+ * Arm M-profile DWT (Data Watchpoint and Trace) unit
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "hw/misc/armv7m_dwt.h"
+#include "hw/qdev-clock.h"
+#include "hw/registerfields.h"
+#include "migration/vmstate.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "qemu/timer.h"
+#include "trace.h"
+
+REG32(DWT_CTRL, 0x0)
+    FIELD(DWT_CTRL, CYCCNTENA, 0, 1)
+    FIELD(DWT_CTRL, POSTPRESET, 1, 4)
+    FIELD(DWT_CTRL, POSTINIT, 5, 4)
+    FIELD(DWT_CTRL, CYCTAP, 9, 1)
+    FIELD(DWT_CTRL, SYNCTAP, 10, 2)
+    FIELD(DWT_CTRL, PCSAMPLENA, 12, 1)
+    FIELD(DWT_CTRL, EXCTRCENA, 16, 1)
+    FIELD(DWT_CTRL, CPIEVTENA, 17, 1)
+    FIELD(DWT_CTRL, EXCEVTENA, 18, 1)
+    FIELD(DWT_CTRL, SLEEPEVTENA, 19, 1)
+    FIELD(DWT_CTRL, LSUEVTENA, 20, 1)
+    FIELD(DWT_CTRL, FOLDEVTENA, 21, 1)
+    FIELD(DWT_CTRL, CYCEVTENA, 22, 1)
+    FIELD(DWT_CTRL, NUMCOMP, 28, 4)
+REG32(DWT_CYCCNT, 0x4)
+REG32(DWT_CPICNT, 0x8)
+REG32(DWT_EXCCNT, 0xc)
+REG32(DWT_SLEEPCNT, 0x10)
+REG32(DWT_LSUCNT, 0x14)
+REG32(DWT_FOLDCNT, 0x18)
+REG32(DWT_PCSR, 0x1c)
+REG32(DWT_LAR, 0xfb0)
+REG32(DWT_LSR, 0xfb4)
+
+/* The DWT_CTRL bits software can change; the rest are RAZ/WI here */
+#define DWT_CTRL_WRITABLE (R_DWT_CTRL_CYCCNTENA_MASK | \
+                           R_DWT_CTRL_POSTPRESET_MASK | \
+                           R_DWT_CTRL_POSTINIT_MASK | \
+                           R_DWT_CTRL_CYCTAP_MASK | \
+                           R_DWT_CTRL_SYNCTAP_MASK | \
+                           R_DWT_CTRL_PCSAMPLENA_MASK | \
+                           R_DWT_CTRL_EXCTRCENA_MASK | \
+                           R_DWT_CTRL_CPIEVTENA_MASK | \
+                           R_DWT_CTRL_EXCEVTENA_MASK | \
+                           R_DWT_CTRL_SLEEPEVTENA_MASK | \
+                           R_DWT_CTRL_LSUEVTENA_MASK | \
+                           R_DWT_CTRL_FOLDEVTENA_MASK | \
+                           R_DWT_CTRL_CYCEVTENA_MASK)
+
+static bool dwt_cyccnt_enabled(ARMv7MDWT *s)
+{
+    return s->ctrl & R_DWT_CTRL_CYCCNTENA_MASK;
+}
+
+/* Current CYCCNT value */
+static uint32_t dwt_cyccnt(ARMv7MDWT *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    if (!dwt_cyccnt_enabled(s)) {
+        return s->cyccnt;
+    }
+    return s->cyccnt + clock_ns_to_ticks(s->cpuclk, now - s->cyccnt_ns);
+}
+
+/* Fold the cycles elapsed since cyccnt_ns into cyccnt */
+static void dwt_cyccnt_sync(ARMv7MDWT *s)
+{
+    s->cyccnt = dwt_cyccnt(s);
+    s->cyccnt_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+}
+
+static void dwt_clk_update(void *opaque, ClockEvent event)
+{
+    ARMv7MDWT *s = ARMV7M_DWT(opaque);
+
+    /* Count the cycles run at the old frequency before it changes */
+    dwt_cyccnt_sync(s);
+}
+
+static MemTxResult dwt_read(void *opaque, hwaddr addr,
+                            uint64_t *data, unsigned size,
+                            MemTxAttrs attrs)
+{
+    ARMv7MDWT *s = ARMV7M_DWT(opaque);
+
+    if (attrs.user) {
+        return MEMTX_ERROR;
+    }
+
+    switch (addr) {
+    case A_DWT_CTRL:
+        *data = s->ctrl;
+        break;
+    case A_DWT_CYCCNT:
+        *data = dwt_cyccnt(s);
+        break;
+    case A_DWT_CPICNT:
+        *data = s->cpicnt;
+        break;
+    case A_DWT_EXCCNT:
+        *data = s->exccnt;
+        break;
+    case A_DWT_SLEEPCNT:
+        *data = s->sleepcnt;
+        break;
+    case A_DWT_LSUCNT:
+        *data = s->lsucnt;
+        break;
+    case A_DWT_FOLDCNT:
+        *data = s->foldcnt;
+        break;
+    case A_DWT_PCSR:
+        /* PC sampling is not supported */
+        *data = 0xffffffff;
+        break;
+    case A_DWT_LSR:
+        /* No software lock is implemented */
+        *data = 0;
+        break;
+    default:
+        qemu_log_mask(LOG_UNIMP, "Read DWT register offset 0x%x\n",
+                      (uint32_t)addr);
+        *data = 0;
+        break;
+    }
+
+    trace_armv7m_dwt_read(addr, *data);
+    return MEMTX_OK;
+}
+
+static MemTxResult dwt_write(void *opaque, hwaddr addr,
+                             uint64_t value, unsigned size,
+                             MemTxAttrs attrs)
+{
+    ARMv7MDWT *s = ARMV7M_DWT(opaque);
+
+    if (attrs.user) {
+        return MEMTX_ERROR;
+    }
+
+    trace_armv7m_dwt_write(addr, value);
+
+    switch (addr) {
+    case A_DWT_CTRL:
+        dwt_cyccnt_sync(s);
+        s->ctrl = (s->ctrl & ~DWT_CTRL_WRITABLE) | (value & DWT_CTRL_WRITABLE);
+        break;
+    case A_DWT_CYCCNT:
+        dwt_cyccnt_sync(s);
+        s->cyccnt = value;
+        break;
+    case A_DWT_CPICNT:
+        s->cpicnt = value;
+        break;
+    case A_DWT_EXCCNT:
+        s->exccnt = value;
+        break;
+    case A_DWT_SLEEPCNT:
+        s->sleepcnt = value;
+        break;
+    case A_DWT_LSUCNT:
+        s->lsucnt = value;
+        break;
+    case A_DWT_FOLDCNT:
+        s->foldcnt = value;
+        break;
+    case A_DWT_LAR:
+        /* No software lock is implemented: writes are ignored */
+        break;
+    default:
+        qemu_log_mask(LOG_UNIMP, "Write to DWT register offset 0x%x\n",
+                      (uint32_t)addr);
+        break;
+    }
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps dwt_ops = {
+    .read_with_attrs = dwt_read,
+    .write_with_attrs = dwt_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+static void armv7m_dwt_reset_hold(Object *obj, ResetType type)
+{
+    ARMv7MDWT *s = ARMV7M_DWT(obj);
+
+    s->ctrl = 0;
+    s->cyccnt = 0;
+    s->cyccnt_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    s->cpicnt = 0;
+    s->exccnt = 0;
+    s->sleepcnt = 0;
+    s->lsucnt = 0;
+    s->foldcnt = 0;
+}
+
+static void armv7m_dwt_init(Object *obj)
+{
+    SysBusDevice *sbd = SYS_BUS_DEVICE(obj);
+    ARMv7MDWT *s = ARMV7M_DWT(obj);
+
+    memory_region_init_io(&s->iomem, obj, &dwt_ops,
+                          s, "armv7m-dwt", 0x1000);
+    sysbus_init_mmio(sbd, &s->iomem);
+
+    s->cpuclk = qdev_init_clock_in(DEVICE(obj), "cpuclk", dwt_clk_update, s,
+                                   ClockPreUpdate);
+}
+
+static const VMStateDescription vmstate_armv7m_dwt = {
+    .name = "armv7m-dwt",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (const VMStateField[]) {
+        VMSTATE_CLOCK(cpuclk, ARMv7MDWT),
+        VMSTATE_UINT32(ctrl, ARMv7MDWT),
+        VMSTATE_UINT32(cyccnt, ARMv7MDWT),
+        VMSTATE_INT64(cyccnt_ns, ARMv7MDWT),
+        VMSTATE_UINT8(cpicnt, ARMv7MDWT),
+        VMSTATE_UINT8(exccnt, ARMv7MDWT),
+        VMSTATE_UINT8(sleepcnt, ARMv7MDWT),
+        VMSTATE_UINT8(lsucnt, ARMv7MDWT),
+        VMSTATE_UINT8(foldcnt, ARMv7MDWT),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void armv7m_dwt_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+    ResettableClass *rc = RESETTABLE_CLASS(klass);
+
+    rc->phases.hold = armv7m_dwt_reset_hold;
+    dc->vmsd = &vmstate_armv7m_dwt;
+}
+
+static const TypeInfo armv7m_dwt_info = {
+    .name = TYPE_ARMV7M_DWT,
+    .parent = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(ARMv7MDWT),
+    .instance_init = armv7m_dwt_init,
+    .class_init = armv7m_dwt_class_init,
+};
+
+static void armv7m_dwt_register_types(void)
+{
+    type_register_static(&armv7m_dwt_info);
+}
+
+type_init(armv7m_dwt_register_types);
@@ -0,0 +1,278 @@
+/*
+ * Arm M-profile ITM (Instrumentation Trace Macrocell)
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "hw/misc/armv7m_itm.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-properties-system.h"
+#include "hw/registerfields.h"
+#include "migration/vmstate.h"
+#include "qemu/log.h"
+#include "qemu/main-loop.h"
+#include "qemu/module.h"
+#include "trace.h"
+
+REG32(ITM_STIM0, 0x0)
+REG32(ITM_STIM31, 0x7c)
+REG32(ITM_TER, 0xe00)
+REG32(ITM_TPR, 0xe40)
+REG32(ITM_TCR, 0xe80)
+    FIELD(ITM_TCR, ITMENA, 0, 1)
+    FIELD(ITM_TCR, TSENA, 1, 1)
+    FIELD(ITM_TCR, SYNCENA, 2, 1)
+    FIELD(ITM_TCR, TXENA, 3, 1)
+    FIELD(ITM_TCR, SWOENA, 4, 1)
+    FIELD(ITM_TCR, TSPRESCALE, 8, 2)
+    FIELD(ITM_TCR, GTSFREQ, 10, 2)
+    FIELD(ITM_TCR, TRACEBUSID, 16, 7)
+    FIELD(ITM_TCR, BUSY, 23, 1)
+REG32(ITM_LAR, 0xfb0)
+REG32(ITM_LSR, 0xfb4)
+
+#define ITM_TCR_WRITABLE (R_ITM_TCR_ITMENA_MASK | \
+                          R_ITM_TCR_TSENA_MASK | \
+                          R_ITM_TCR_SYNCENA_MASK | \
+                          R_ITM_TCR_TXENA_MASK | \
+                          R_ITM_TCR_SWOENA_MASK | \
+                          R_ITM_TCR_TSPRESCALE_MASK | \
+                          R_ITM_TCR_GTSFREQ_MASK | \
+                          R_ITM_TCR_TRACEBUSID_MASK)
+
+/* TPR has one bit per group of 8 stimulus ports */
+#define ITM_TPR_MASK 0xf
+
+/* Largest packet: header byte and a 32-bit payload */
+#define ITM_MAX_PACKET 5
+
+static void itm_flush(ARMv7MITM *s)
+{
+    if (s->buf_len == 0) {
+        return;
+    }
+
+    trace_armv7m_itm_flush(s->buf_len);
+
+    /* A trace sink that cannot keep up stalls the guest, as a full SWO would */
+    qemu_chr_fe_write_all(&s->chr, s->buf, s->buf_len);
+    s->buf_len = 0;
+}
+
+static void itm_bh(void *opaque)
+{
+    itm_flush(ARMV7M_ITM(opaque));
+}
+
+static void itm_stimulus_write(ARMv7MITM *s, unsigned int port,
+                               uint64_t value, unsigned size,
+                               MemTxAttrs attrs)
+{
+    if (!(s->tcr & R_ITM_TCR_ITMENA_MASK) || !(s->ter & (1u << port))) {
+        return;
+    }
+    if (attrs.user && !(s->tpr & (1u << (port / 8)))) {
+        /* Unprivileged writes to a privileged port are ignored */
+        return;
+    }
+    if (!qemu_chr_fe_backend_connected(&s->chr)) {
+        return;
+    }
+
+    trace_armv7m_itm_stimulus(port, value, size);
+
+    if (s->buf_len + ITM_MAX_PACKET > sizeof(s->buf)) {
+        itm_flush(s);
+    }
+
+    /* Instrumentation packet header: A[7:3], 0, SS[1:0] = 1, 2 or 3 */
+    s->buf[s->buf_len++] = (port << 3) | (size == 4 ? 3 : size);
+    for (unsigned int i = 0; i < size; i++) {
+        s->buf[s->buf_len++] = value >> (8 * i);
+    }
+
+    qemu_bh_schedule(s->bh);
+}
+
+static MemTxResult itm_read(void *opaque, hwaddr addr,
+                            uint64_t *data, unsigned size,
+                            MemTxAttrs attrs)
+{
+    ARMv7MITM *s = ARMV7M_ITM(opaque);
+
+    if (addr <= A_ITM_STIM31 + 3) {
+        /* FIFOREADY: we can always accept a write while the ITM is enabled */
+        *data = !!(s->tcr & R_ITM_TCR_ITMENA_MASK);
+        return MEMTX_OK;
+    }
+
+    if (attrs.user) {
+        return MEMTX_ERROR;
+    }
+
+    switch (addr) {
+    case A_ITM_TER:
+        *data = s->ter;
+        break;
+    case A_ITM_TPR:
+        *data = s->tpr;
+        break;
+    case A_ITM_TCR:
+        *data = s->tcr;
+        break;
+    case A_ITM_LSR:
+        /* No software lock is implemented */
+        *data = 0;
+        break;
+    default:
+        qemu_log_mask(LOG_UNIMP, "Read ITM register offset 0x%x\n",
+                      (uint32_t)addr);
+        *data = 0;
+        break;
+    }
+    return MEMTX_OK;
+}
+
+static MemTxResult itm_write(void *opaque, hwaddr addr,
+                             uint64_t value, unsigned size,
+                             MemTxAttrs attrs)
+{
+    ARMv7MITM *s = ARMV7M_ITM(opaque);
+
+    if (addr <= A_ITM_STIM31 + 3) {
+        if (addr & (size - 1)) {
+            qemu_log_mask(LOG_GUEST_ERROR,
+                          "ITM: unaligned stimulus port write at 0x%x\n",
+                          (uint32_t)addr);
+            return MEMTX_OK;
+        }
+        itm_stimulus_write(s, addr / 4, value, size, attrs);
+        return MEMTX_OK;
+    }
+
+    if (attrs.user) {
+        return MEMTX_ERROR;
+    }
+
+    switch (addr) {
+    case A_ITM_TER:
+        s->ter = value;
+        break;
+    case A_ITM_TPR:
+        s->tpr = value & ITM_TPR_MASK;
+        break;
+    case A_ITM_TCR:
+        s->tcr = value & ITM_TCR_WRITABLE;
+        if (!(s->tcr & R_ITM_TCR_ITMENA_MASK)) {
+            /* Disabling the ITM drains the packets already accepted */
+            itm_flush(s);
+        }
+        break;
+    case A_ITM_LAR:
+        /* No software lock is implemented: writes are ignored */
+        break;
+    default:
+        qemu_log_mask(LOG_UNIMP, "Write to ITM register offset 0x%x\n",
+                      (uint32_t)addr);
+        break;
+    }
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps itm_ops = {
+    .read_with_attrs = itm_read,
+    .write_with_attrs = itm_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    /* Stimulus ports take byte, halfword and word writes */
+    .valid.min_access_size = 1,
+    .valid.max_access_size = 4,
+};
+
+static void armv7m_itm_reset_hold(Object *obj, ResetType type)
+{
+    ARMv7MITM *s = ARMV7M_ITM(obj);
+
+    itm_flush(s);
+    s->ter = 0;
+    s->tpr = 0;
+    s->tcr = 0;
+}
+
+static void armv7m_itm_init(Object *obj)
+{
+    SysBusDevice *sbd = SYS_BUS_DEVICE(obj);
+    ARMv7MITM *s = ARMV7M_ITM(obj);
+
+    memory_region_init_io(&s->iomem, obj, &itm_ops,
+                          s, "armv7m-itm", 0x1000);
+    sysbus_init_mmio(sbd, &s->iomem);
+}
+
+static void armv7m_itm_realize(DeviceState *dev, Error **errp)
+{
+    ARMv7MITM *s = ARMV7M_ITM(dev);
+
+    s->bh = qemu_bh_new_guarded(itm_bh, s, &dev->mem_reentrancy_guard);
+}
+
+static void armv7m_itm_unrealize(DeviceState *dev)
+{
+    ARMv7MITM *s = ARMV7M_ITM(dev);
+
+    itm_flush(s);
+    qemu_bh_delete(s->bh);
+}
+
+static int armv7m_itm_pre_save(void *opaque)
+{
+    /* Pending packets are not migrated: send them now */
+    itm_flush(ARMV7M_ITM(opaque));
+    return 0;
+}
+
+static const VMStateDescription vmstate_armv7m_itm = {
+    .name = "armv7m-itm",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .pre_save = armv7m_itm_pre_save,
+    .fields = (const VMStateField[]) {
+        VMSTATE_UINT32(ter, ARMv7MITM),
+        VMSTATE_UINT32(tpr, ARMv7MITM),
+        VMSTATE_UINT32(tcr, ARMv7MITM),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static Property armv7m_itm_properties[] = {
+    DEFINE_PROP_CHR("chardev", ARMv7MITM, chr),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void armv7m_itm_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+    ResettableClass *rc = RESETTABLE_CLASS(klass);
+
+    dc->realize = armv7m_itm_realize;
+    dc->unrealize = armv7m_itm_unrealize;
+    rc->phases.hold = armv7m_itm_reset_hold;
+    dc->vmsd = &vmstate_armv7m_itm;
+    device_class_set_props(dc, armv7m_itm_properties);
+}
+
+static const TypeInfo armv7m_itm_info = {
+    .name = TYPE_ARMV7M_ITM,
+    .parent = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(ARMv7MITM),
+    .instance_init = armv7m_itm_init,
+    .class_init = armv7m_itm_class_init,
+};
+
+static void armv7m_itm_register_types(void)
+{
+    type_register_static(&armv7m_itm_info);
+}
+
+type_init(armv7m_itm_register_types);
@@ -0,0 +1,479 @@
+/*
+ * NXP S32K3 Periodic Interrupt Timer (PIT)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+/*
+ * This is a model of the PIT module documented in chapter "Periodic
+ * Interrupt Timer (PIT)" of the S32K3xx Reference Manual.
+ *
+ * Each module has four 32-bit down-counting channels. A channel reloads
+ * from LDVAL and sets TFLG.TIF every (LDVAL + 1) module clock ticks.
+ * Channels 1..3 can instead be chained (TCTRL.CHN), in which case they
+ * decrement once every time the previous channel expires; chaining
+ * channel 1 to channel 0 gives the 64-bit lifetime timer which is read
+ * through LTMR64H/LTMR64L.
+ *
+ * Rather than running one ptimer per channel, the counters are derived
+ * from the number of module clock ticks elapsed since the last sync
+ * point, and a single QEMUTimer is armed for the earliest expiry that
+ * can actually raise an interrupt. Channels that are not interrupting
+ * (e.g. the lifetime timer) therefore never wake the host up.
+ *
+ * The RTI channel (clocked from the RTC on PIT0) is not modelled, nor
+ * is the debug freeze behaviour of MCR.FRZ.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "qemu/host-utils.h"
+#include "qapi/error.h"
+#include "trace.h"
+#include "hw/sysbus.h"
+#include "hw/irq.h"
+#include "hw/registerfields.h"
+#include "hw/qdev-clock.h"
+#include "hw/timer/s32k3_pit.h"
+#include "migration/vmstate.h"
+
+REG32(MCR, 0x0)
+    FIELD(MCR, FRZ, 0, 1)
+    FIELD(MCR, MDIS, 1, 1)
+    FIELD(MCR, MDIS_RTI, 2, 1)
+REG32(LTMR64H, 0xe0)
+REG32(LTMR64L, 0xe4)
+REG32(RTI_LDVAL_STAT, 0xec)
+REG32(RTI_LDVAL, 0xf0)
+REG32(RTI_CVAL, 0xf4)
+REG32(RTI_TCTRL, 0xf8)
+REG32(RTI_TFLG, 0xfc)
+/* Channel 0 registers; channel n is at +n * PIT_CHANNEL_STRIDE */
+REG32(LDVAL, 0x100)
+REG32(CVAL, 0x104)
+REG32(TCTRL, 0x108)
+    FIELD(TCTRL, TEN, 0, 1)
+    FIELD(TCTRL, TIE, 1, 1)
+    FIELD(TCTRL, CHN, 2, 1)
+REG32(TFLG, 0x10c)
+    FIELD(TFLG, TIF, 0, 1)
+
+#define PIT_CHANNEL_STRIDE 0x10
+#define A_CHANNEL_END (A_LDVAL + S32K3_PIT_NUM_CHANNELS * PIT_CHANNEL_STRIDE)
+
+#define MCR_RESET (R_MCR_MDIS_MASK | R_MCR_MDIS_RTI_MASK)
+
+static bool s32k3_pit_running(S32K3PITState *s)
+{
+    return !(s->mcr & R_MCR_MDIS_MASK) && clock_is_enabled(s->clk);
+}
+
+static bool s32k3_pit_chained(S32K3PITState *s, int n)
+{
+    return n > 0 && (s->channel[n].tctrl & R_TCTRL_CHN_MASK);
+}
+
+static void s32k3_pit_update(S32K3PITState *s)
+{
+    bool level = false;
+    int i;
+
+    for (i = 0; i < S32K3_PIT_NUM_CHANNELS; i++) {
+        if ((s->channel[i].tflg & R_TFLG_TIF_MASK) &&
+            (s->channel[i].tctrl & R_TCTRL_TIE_MASK)) {
+            level = true;
+        }
+    }
+    qemu_set_irq(s->irq, level);
+}
+
+/*
+ * Decrement a running channel @events times, and return how many
+ * times it expired (reloaded from LDVAL) while doing so.
+ */
+static uint64_t s32k3_pit_advance(S32K3PITChannel *ch, uint64_t events)
+{
+    uint64_t period = (uint64_t)ch->ldval + 1;
+    uint64_t expired;
+
+    if (events <= ch->cval) {
+        ch->cval -= events;
+        return 0;
+    }
+    events -= (uint64_t)ch->cval + 1;
+    expired = 1 + events / period;
+    ch->cval = ch->ldval - events % period;
+    ch->tflg |= R_TFLG_TIF_MASK;
+    return expired;
+}
+
+/* Bring every channel's counter and TIF up to the current virtual time */
+static void s32k3_pit_sync(S32K3PITState *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    uint64_t ticks, events = 0;
+    int i;
+
+    if (!s32k3_pit_running(s)) {
+        return;
+    }
+
+    /* Nothing to do until a stall (see s32k3_pit_stall()) is over */
+    if (now <= s->epoch_ns) {
+        return;
+    }
+    ticks = clock_ns_to_ticks(s->clk, now - s->epoch_ns);
+    if (ticks <= s->ref_ticks) {
+        return;
+    }
+    ticks -= s->ref_ticks;
+    s->ref_ticks += ticks;
+
+    for (i = 0; i < S32K3_PIT_NUM_CHANNELS; i++) {
+        S32K3PITChannel *ch = &s->channel[i];
+
+        /* A chained channel counts the expiries of the previous one */
+        if (!s32k3_pit_chained(s, i)) {
+            events = ticks;
+        }
+        if (!(ch->tctrl & R_TCTRL_TEN_MASK)) {
+            events = 0;
+            continue;
+        }
+        events = s32k3_pit_advance(ch, events);
+    }
+}
+
+/* Restart counting module clock ticks from the current virtual time */
+static void s32k3_pit_restart(S32K3PITState *s)
+{
+    s->epoch_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    s->ref_ticks = 0;
+}
+
+/*
+ * Number of module clock ticks after ref_ticks at which channel @n
+ * expires for the @count'th time, saturated to UINT64_MAX.
+ */
+static uint64_t s32k3_pit_ticks_to_expiry(S32K3PITState *s, int n,
+                                          uint64_t count)
+{
+    S32K3PITChannel *ch = &s->channel[n];
+    uint64_t events;
+
+    if (!(ch->tctrl & R_TCTRL_TEN_MASK)) {
+        return UINT64_MAX;
+    }
+    if (umul64_overflow(count - 1, (uint64_t)ch->ldval + 1, &events) ||
+        uadd64_overflow(events, (uint64_t)ch->cval + 1, &events)) {
+        return UINT64_MAX;
+    }
+    if (s32k3_pit_chained(s, n)) {
+        return s32k3_pit_ticks_to_expiry(s, n - 1, events);
+    }
+    return events;
+}
+
+static void s32k3_pit_rearm(S32K3PITState *s)
+{
+    uint64_t next = UINT64_MAX;
+    uint64_t ticks, ns;
+    int i;
+
+    if (s32k3_pit_running(s)) {
+        for (i = 0; i < S32K3_PIT_NUM_CHANNELS; i++) {
+            S32K3PITChannel *ch = &s->channel[i];
+
+            /*
+             * Only an expiry that changes the interrupt line needs a
+             * callback; everything else is picked up by the next sync.
+             */
+            if ((ch->tctrl & R_TCTRL_TIE_MASK) &&
+                !(ch->tflg & R_TFLG_TIF_MASK)) {
+                next = MIN(next, s32k3_pit_ticks_to_expiry(s, i, 1));
+            }
+        }
+    }
+
+    if (next == UINT64_MAX || uadd64_overflow(s->ref_ticks, next, &ticks)) {
+        timer_del(s->timer);
+        return;
+    }
+
+    ns = clock_ticks_to_ns(s->clk, ticks);
+    /* Round up when the clock period is not a whole number of ns */
+    if (clock_ns_to_ticks(s->clk, ns) < ticks) {
+        ns++;
+    }
+    if (ns >= INT64_MAX - s->epoch_ns) {
+        timer_del(s->timer);
+        return;
+    }
+    timer_mod(s->timer, s->epoch_ns + ns);
+}
+
+void s32k3_pit_stall(S32K3PITState *s, int64_t ns)
+{
+    trace_s32k3_pit_stall(ns);
+    s32k3_pit_sync(s);
+    /* The module clock ticks counted from now on start @ns later */
+    s->epoch_ns += ns;
+    s32k3_pit_rearm(s);
+}
+
+static void s32k3_pit_tick(void *opaque)
+{
+    S32K3PITState *s = S32K3_PIT(opaque);
+
+    s32k3_pit_sync(s);
+    s32k3_pit_update(s);
+    s32k3_pit_rearm(s);
+}
+
+static uint64_t s32k3_pit_read(void *opaque, hwaddr offset, unsigned size)
+{
+    S32K3PITState *s = S32K3_PIT(opaque);
+    S32K3PITChannel *ch;
+    uint64_t r;
+
+    switch (offset) {
+    case A_MCR:
+        r = s->mcr;
+        break;
+    case A_LTMR64H:
+        /* Reading the upper half latches the lower half */
+        s32k3_pit_sync(s);
+        s->ltmr64l = s->channel[0].cval;
+        r = s->channel[1].cval;
+        break;
+    case A_LTMR64L:
+        r = s->ltmr64l;
+        break;
+    case A_RTI_LDVAL_STAT ... A_RTI_TFLG:
+        qemu_log_mask(LOG_UNIMP, "S32K3 PIT: RTI channel not implemented\n");
+        r = 0;
+        break;
+    case A_LDVAL ... A_CHANNEL_END - 1:
+        ch = &s->channel[(offset - A_LDVAL) / PIT_CHANNEL_STRIDE];
+        switch (A_LDVAL + (offset - A_LDVAL) % PIT_CHANNEL_STRIDE) {
+        case A_LDVAL:
+            r = ch->ldval;
+            break;
+        case A_CVAL:
+            s32k3_pit_sync(s);
+            r = ch->cval;
+            break;
+        case A_TCTRL:
+            r = ch->tctrl;
+            break;
+        case A_TFLG:
+            s32k3_pit_sync(s);
+            r = ch->tflg;
+            break;
+        default:
+            g_assert_not_reached();
+        }
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "S32K3 PIT read: bad offset 0x%x\n", (int)offset);
+        r = 0;
+        break;
+    }
+    trace_s32k3_pit_read(offset, r, size);
+    return r;
+}
+
+static void s32k3_pit_write(void *opaque, hwaddr offset, uint64_t value,
+                            unsigned size)
+{
+    S32K3PITState *s = S32K3_PIT(opaque);
+    S32K3PITChannel *ch;
+    bool was_disabled;
+    int n;
+
+    trace_s32k3_pit_write(offset, value, size);
+
+    switch (offset) {
+    case A_MCR:
+        s32k3_pit_sync(s);
+        was_disabled = s->mcr & R_MCR_MDIS_MASK;
+        s->mcr = value & (R_MCR_FRZ_MASK | R_MCR_MDIS_MASK |
+                          R_MCR_MDIS_RTI_MASK);
+        if (was_disabled && !(s->mcr & R_MCR_MDIS_MASK)) {
+            s32k3_pit_restart(s);
+        }
+        s32k3_pit_rearm(s);
+        break;
+    case A_LTMR64H:
+    case A_LTMR64L:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "S32K3 PIT write: write to RO offset 0x%x\n",
+                      (int)offset);
+        break;
+    case A_RTI_LDVAL_STAT ... A_RTI_TFLG:
+        qemu_log_mask(LOG_UNIMP, "S32K3 PIT: RTI channel not implemented\n");
+        break;
+    case A_LDVAL ... A_CHANNEL_END - 1:
+        n = (offset - A_LDVAL) / PIT_CHANNEL_STRIDE;
+        ch = &s->channel[n];
+        s32k3_pit_sync(s);
+        switch (A_LDVAL + (offset - A_LDVAL) % PIT_CHANNEL_STRIDE) {
+        case A_LDVAL:
+            /* The new value is used from the next reload onwards */
+            ch->ldval = value;
+            break;
+        case A_CVAL:
+            qemu_log_mask(LOG_GUEST_ERROR,
+                          "S32K3 PIT write: write to RO offset 0x%x\n",
+                          (int)offset);
+            break;
+        case A_TCTRL:
+            if (n == 0 && (value & R_TCTRL_CHN_MASK)) {
+                qemu_log_mask(LOG_GUEST_ERROR,
+                              "S32K3 PIT: channel 0 cannot be chained\n");
+                value &= ~R_TCTRL_CHN_MASK;
+            }
+            if (!(ch->tctrl & R_TCTRL_TEN_MASK) &&
+                (value & R_TCTRL_TEN_MASK)) {
+                ch->cval = ch->ldval;
+            }
+            ch->tctrl = value & (R_TCTRL_TEN_MASK | R_TCTRL_TIE_MASK |
+                                 R_TCTRL_CHN_MASK);
+            break;
+        case A_TFLG:
+            /* Just one bit, which is W1C. */
+            ch->tflg &= ~(value & R_TFLG_TIF_MASK);
+            break;
+        default:
+            g_assert_not_reached();
+        }
+        s32k3_pit_update(s);
+        s32k3_pit_rearm(s);
+        break;
+    default:
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "S32K3 PIT write: bad offset 0x%x\n", (int)offset);
+        break;
+    }
+}
+
+static const MemoryRegionOps s32k3_pit_ops = {
+    .read = s32k3_pit_read,
+    .write = s32k3_pit_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+static void s32k3_pit_reset(DeviceState *dev)
+{
+    S32K3PITState *s = S32K3_PIT(dev);
+
+    trace_s32k3_pit_reset();
+    timer_del(s->timer);
+    s->mcr = MCR_RESET;
+    s->ltmr64l = 0;
+    memset(s->channel, 0, sizeof(s->channel));
+    s32k3_pit_restart(s);
+}
+
+static void s32k3_pit_clk_update(void *opaque, ClockEvent event)
+{
+    S32K3PITState *s = S32K3_PIT(opaque);
+
+    switch (event) {
+    case ClockPreUpdate:
+        /* Account for the ticks elapsed at the old rate */
+        s32k3_pit_sync(s);
+        break;
+    case ClockUpdate:
+        s32k3_pit_restart(s);
+        s32k3_pit_rearm(s);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+static void s32k3_pit_init(Object *obj)
+{
+    SysBusDevice *sbd = SYS_BUS_DEVICE(obj);
+    S32K3PITState *s = S32K3_PIT(obj);
+
+    memory_region_init_io(&s->iomem, obj, &s32k3_pit_ops,
+                          s, "s32k3-pit", 0x1000);
+    sysbus_init_mmio(sbd, &s->iomem);
+    sysbus_init_irq(sbd, &s->irq);
+    s->clk = qdev_init_clock_in(DEVICE(s), "clk", s32k3_pit_clk_update, s,
+                                ClockPreUpdate | ClockUpdate);
+}
+
+static void s32k3_pit_realize(DeviceState *dev, Error **errp)
+{
+    S32K3PITState *s = S32K3_PIT(dev);
+
+    if (!clock_has_source(s->clk)) {
+        error_setg(errp, "S32K3 PIT: clk clock must be connected");
+        return;
+    }
+
+    s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, s32k3_pit_tick, s);
+}
+
+static const VMStateDescription s32k3_pit_channel_vmstate = {
+    .name = "s32k3-pit-channel",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (const VMStateField[]) {
+        VMSTATE_UINT32(ldval, S32K3PITChannel),
+        VMSTATE_UINT32(cval, S32K3PITChannel),
+        VMSTATE_UINT32(tctrl, S32K3PITChannel),
+        VMSTATE_UINT32(tflg, S32K3PITChannel),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription s32k3_pit_vmstate = {
+    .name = "s32k3-pit",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (const VMStateField[]) {
+        VMSTATE_TIMER_PTR(timer, S32K3PITState),
+        VMSTATE_CLOCK(clk, S32K3PITState),
+        VMSTATE_UINT32(mcr, S32K3PITState),
+        VMSTATE_UINT32(ltmr64l, S32K3PITState),
+        VMSTATE_INT64(epoch_ns, S32K3PITState),
+        VMSTATE_UINT64(ref_ticks, S32K3PITState),
+        VMSTATE_STRUCT_ARRAY(channel, S32K3PITState, S32K3_PIT_NUM_CHANNELS,
+                             1, s32k3_pit_channel_vmstate, S32K3PITChannel),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void s32k3_pit_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = s32k3_pit_realize;
+    dc->vmsd = &s32k3_pit_vmstate;
+    device_class_set_legacy_reset(dc, s32k3_pit_reset);
+}
+
+static const TypeInfo s32k3_pit_info = {
+    .name = TYPE_S32K3_PIT,
+    .parent = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(S32K3PITState),
+    .instance_init = s32k3_pit_init,
+    .class_init = s32k3_pit_class_init,
+};
+
+static void s32k3_pit_register_types(void)
+{
+    type_register_static(&s32k3_pit_info);
+}
+
+type_init(s32k3_pit_register_types);
@@ -12,6 +12,8 @@
 
 #include "hw/sysbus.h"
 #include "hw/intc/armv7m_nvic.h"
+#include "hw/misc/armv7m_dwt.h"
+#include "hw/misc/armv7m_itm.h"
 #include "hw/misc/armv7m_ras.h"
 #include "target/arm/idau.h"
 #include "qom/object.h"
@@ -53,6 +55,8 @@ OBJECT_DECLARE_SIMPLE_TYPE(ARMv7MState, ARMV7M)
  * + Property "vfp": enable VFP (forwarded to CPU object)
  * + Property "dsp": enable DSP (forwarded to CPU object)
  * + Property "enable-bitband": expose bitbanded IO
+ * + Property "enable-trace": expose the DWT profiling counters and the ITM
+ * + Property "itm-chardev": where the ITM trace goes (forwarded to the ITM)
  * + Property "mpu-ns-regions": number of Non-Secure MPU regions (forwarded
  *   to CPU object pmsav7-dregion property; default is whatever the default
  *   for the CPU is)
@@ -70,6 +74,8 @@ struct ARMv7MState {
     BitBandState bitband[ARMV7M_NUM_BITBANDS];
     ARMCPU *cpu;
     ARMv7MRAS ras;
+    ARMv7MDWT dwt;
+    ARMv7MITM itm;
     SysTickState systick[M_REG_NUM_BANKS];
 
     /* MemoryRegion we pass to the CPU, with our devices layered on
@@ -105,6 +111,7 @@ struct ARMv7MState {
     uint32_t mpu_ns_regions;
     uint32_t mpu_s_regions;
     bool enable_bitband;
+    bool enable_trace;
     bool start_powered_off;
     bool vfp;
     bool dsp;
@@ -0,0 +1,32 @@
+/*
+ * NXP S32K3X8EVB snapshot fuzzing harness
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+#ifndef S32K3X8EVB_FUZZ_H
+#define S32K3X8EVB_FUZZ_H
+
+#include "chardev/char.h"
+#include "hw/char/s32k3_lpuart.h"
+#include "hw/timer/s32k3_pit.h"
+
+/* Little-endian u32 sent to the driver once the snapshot is taken: "S32F" */
+#define S32K3X8_FUZZ_READY          0x46323353
+
+/* Bits of the status of an input */
+#define S32K3X8_FUZZ_STATUS_FAULT   (1u << 0)
+
+/*
+ * s32k3x8_fuzz_init: run the inputs received on @chr against the board.
+ * The machine runs until @snapshot_ns, where it is snapshotted and
+ * paused; every input then starts from the snapshot, feeds its bytes to
+ * @uart and its stalls to the @npits modules of @pits, and runs for
+ * @budget_ns of virtual time.
+ */
+void s32k3x8_fuzz_init(Chardev *chr, S32K3LPUARTState *uart, S32K3PITState **pits, int npits,
+                       int64_t snapshot_ns, int64_t budget_ns);
+
+#endif /* S32K3X8EVB_FUZZ_H */
@@ -0,0 +1,51 @@
+/*
+ * NXP S32K3X8EVB in-memory snapshot and fast rewind
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+#ifndef S32K3X8EVB_SNAPSHOT_H
+#define S32K3X8EVB_SNAPSHOT_H
+
+#include "exec/hwaddr.h"
+
+/*
+ * s32k3x8_snapshot_add_ram: make a RAM block of the board part of the
+ * snapshot. @addr is where @mr is mapped in the system address space,
+ * through which the dirty pages are written back.
+ */
+void s32k3x8_snapshot_add_ram(MemoryRegion *mr, hwaddr addr);
+
+/*
+ * s32k3x8_snapshot_add_device: tell the snapshot about a device the board
+ * realized while the machine runs. A snapshot taken before has no state
+ * for @dev, which every rewind to it puts back to its reset state.
+ */
+void s32k3x8_snapshot_add_device(DeviceState *dev);
+
+/*
+ * s32k3x8_snapshot_save: copy the RAM blocks and save the device state.
+ * The vCPUs must be paused and the virtual clock stopped (vm_stop()).
+ */
+bool s32k3x8_snapshot_save(Error **errp);
+
+/*
+ * s32k3x8_snapshot_restore: write back the RAM pages dirtied since the
+ * last save or restore, and reload the device state, under the same
+ * conditions as s32k3x8_snapshot_save(). @dirty_pages, if not NULL, is
+ * set to the number of pages written back.
+ */
+bool s32k3x8_snapshot_restore(uint64_t *dirty_pages, Error **errp);
+
+/* s32k3x8_snapshot_valid: true once a snapshot has been taken */
+bool s32k3x8_snapshot_valid(void);
+
+/*
+ * s32k3x8_snapshot_save_at: take a snapshot once the virtual clock
+ * reaches @ns, e.g. when the firmware has finished booting
+ */
+void s32k3x8_snapshot_save_at(int64_t ns);
+
+#endif /* S32K3X8EVB_SNAPSHOT_H */
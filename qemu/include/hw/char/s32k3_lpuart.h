@@ -0,0 +1,67 @@
+/*
+ * NXP S32K3 LPUART (Low Power Universal Asynchronous Receiver/Transmitter)
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_S32K3_LPUART_H
+#define HW_S32K3_LPUART_H
+
+#include "hw/sysbus.h"
+#include "chardev/char-fe.h"
+#include "qemu/fifo8.h"
+#include "qom/object.h"
+
+#define TYPE_S32K3_LPUART "s32k3-lpuart"
+OBJECT_DECLARE_SIMPLE_TYPE(S32K3LPUARTState, S32K3_LPUART)
+
+#define S32K3_LPUART_FIFO_SIZE 16
+
+/*
+ * QEMU interface:
+ *  + Clock input "clk": functional clock, used to derive the baud rate
+ *  + Property "chardev": the character backend
+ *  + sysbus MMIO region 0: the register bank
+ *  + sysbus IRQ 0: LPUART interrupt
+ *  + named GPIO outputs "dma-tx" and "dma-rx": transmit and receive DMA
+ *    requests, for a DMAMUX
+ */
+struct S32K3LPUARTState {
+    /*< private >*/
+    SysBusDevice parent_obj;
+
+    /*< public >*/
+    MemoryRegion mmio;
+
+    uint32_t global;
+    uint32_t pincfg;
+    uint32_t baud;
+    uint32_t stat;
+    uint32_t ctrl;
+    uint32_t match;
+    uint32_t modir;
+    uint32_t fifo;
+    uint32_t water;
+
+    Fifo8 tx_fifo;
+    Fifo8 rx_fifo;
+
+    Clock *clk;
+    CharBackend chr;
+    qemu_irq irq;
+    qemu_irq dma_tx;
+    qemu_irq dma_rx;
+    QEMUBH *tx_bh;
+    guint watch_tag;
+};
+
+/*
+ * s32k3_lpuart_inject_rx: receive @buf as if it came from the chardev,
+ * e.g. from a fuzzer. Bytes that do not fit in the RX FIFO, or that
+ * arrive while the receiver is disabled, are dropped without an overrun.
+ * Returns the number of bytes received.
+ */
+int s32k3_lpuart_inject_rx(S32K3LPUARTState *s, const uint8_t *buf, int size);
+
+#endif /* HW_S32K3_LPUART_H */
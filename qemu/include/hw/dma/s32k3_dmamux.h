@@ -0,0 +1,44 @@
+/*
+ * NXP S32K3 DMA channel multiplexer (DMAMUX)
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_S32K3_DMAMUX_H
+#define HW_S32K3_DMAMUX_H
+
+#include "hw/sysbus.h"
+#include "qom/object.h"
+
+#define TYPE_S32K3_DMAMUX "s32k3-dmamux"
+OBJECT_DECLARE_SIMPLE_TYPE(S32K3DMAMUXState, S32K3_DMAMUX)
+
+#define S32K3_DMAMUX_NUM_CHANNELS 16
+#define S32K3_DMAMUX_NUM_SOURCES 64
+/* Sources that request service whenever the channel is enabled */
+#define S32K3_DMAMUX_SRC_ALWAYS_ON0 62
+#define S32K3_DMAMUX_SRC_ALWAYS_ON1 63
+
+/*
+ * QEMU interface:
+ *  + sysbus MMIO region 0: the CHCFG registers
+ *  + named GPIO inputs "request" 0..63: peripheral DMA request sources;
+ *    source 0 is the "disabled" slot and is never routed
+ *  + unnamed GPIO outputs 0..15: hardware request for each eDMA channel
+ *    served by this multiplexer
+ */
+struct S32K3DMAMUXState {
+    /*< private >*/
+    SysBusDevice parent_obj;
+
+    /*< public >*/
+    MemoryRegion mmio;
+    qemu_irq out[S32K3_DMAMUX_NUM_CHANNELS];
+
+    uint8_t chcfg[S32K3_DMAMUX_NUM_CHANNELS];
+    /* Level of each request source */
+    uint64_t sources;
+};
+
+#endif /* HW_S32K3_DMAMUX_H */
@@ -0,0 +1,70 @@
+/*
+ * NXP S32K3 enhanced Direct Memory Access controller (eDMA)
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_S32K3_EDMA_H
+#define HW_S32K3_EDMA_H
+
+#include "hw/sysbus.h"
+#include "exec/memory.h"
+#include "qom/object.h"
+
+#define TYPE_S32K3_EDMA "s32k3-edma"
+OBJECT_DECLARE_SIMPLE_TYPE(S32K3EDMAState, S32K3_EDMA)
+
+#define S32K3_EDMA_NUM_CHANNELS 32
+/* Each channel has its own 16KiB page holding its control registers and TCD */
+#define S32K3_EDMA_CH_PAGE_SIZE 0x4000
+/* Size of a transfer control descriptor, in 32-bit words */
+#define S32K3_EDMA_TCD_WORDS 8
+
+typedef struct S32K3EDMAChannel {
+    /* Back pointer for the per-channel MMIO page */
+    S32K3EDMAState *edma;
+    uint8_t id;
+
+    uint32_t csr;
+    uint32_t es;
+    uint32_t intr;
+    uint32_t sbr;
+    uint32_t pri;
+    uint32_t tcd[S32K3_EDMA_TCD_WORDS];
+} S32K3EDMAChannel;
+
+/*
+ * QEMU interface:
+ *  + Property "memory": the address space the engine transfers data in
+ *  + sysbus MMIO region 0: the management page (CSR, ES, INT, HRS, GRPRI)
+ *  + sysbus MMIO regions 1..32: the page of channel 0..31
+ *  + sysbus IRQ 0..31: channel 0..31 major/half major loop interrupt
+ *  + sysbus IRQ 32: error interrupt, the OR of every channel's ERR & EEI
+ *  + unnamed GPIO inputs 0..31: hardware service request for each channel,
+ *    normally driven by a DMAMUX
+ */
+struct S32K3EDMAState {
+    /*< private >*/
+    SysBusDevice parent_obj;
+
+    /*< public >*/
+    MemoryRegion mmio;
+    MemoryRegion ch_mmio[S32K3_EDMA_NUM_CHANNELS];
+    MemoryRegion *downstream;
+    AddressSpace dma_as;
+    QEMUBH *bh;
+
+    qemu_irq irq[S32K3_EDMA_NUM_CHANNELS];
+    qemu_irq err_irq;
+
+    uint32_t csr;
+    /* Error status as of the last error, VLD is computed on read */
+    uint32_t es;
+    /* Level of each channel's hardware request input */
+    uint32_t hrs;
+    uint32_t grpri[S32K3_EDMA_NUM_CHANNELS];
+    S32K3EDMAChannel ch[S32K3_EDMA_NUM_CHANNELS];
+};
+
+#endif /* HW_S32K3_EDMA_H */
@@ -13,6 +13,8 @@
 #include "target/arm/cpu-qom.h"
 #include "hw/sysbus.h"
 #include "hw/timer/armv7m_systick.h"
+#include "qemu/bitmap.h"
+#include "qemu/notify.h"
 #include "qom/object.h"
 
 #define TYPE_NVIC "armv7m_nvic"
@@ -34,6 +36,9 @@ typedef struct VecInfo {
     uint8_t level; /* exceptions <=15 never set level */
 } VecInfo;
 
+/* Interrupt latency histograms of one exception */
+typedef struct NVICLatency NVICLatency;
+
 struct NVICState {
     /*< private >*/
     SysBusDevice parent_obj;
@@ -75,10 +80,22 @@ struct NVICState {
     bool vectpending_is_s_banked;
     int exception_prio; /* group prio of the highest prio active exception */
     int vectpending_prio; /* group prio of the exception in vectpending */
+    /*
+     * Exceptions which may be pending or active. This is a superset: a
+     * bit is set whenever its exception becomes pending or active, and is
+     * only cleared when a scan finds the exception to be neither. It lets
+     * the scans skip the idle external interrupts; the internal exceptions
+     * are always scanned.
+     */
+    DECLARE_BITMAP(busy_vectors, NVIC_MAX_VECTORS);
 
     MemoryRegion sysregmem;
 
     uint32_t num_irq;
+    /* Interrupt latency statistics, allocated on the first use of a vector */
+    bool latency_stats;
+    NVICLatency *latency[NVIC_MAX_VECTORS];
+    Notifier latency_report;
     qemu_irq excpout;
     qemu_irq sysresetreq;
 };
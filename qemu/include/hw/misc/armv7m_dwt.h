@@ -0,0 +1,52 @@
+/*
+ * Arm M-profile DWT (Data Watchpoint and Trace) unit
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * This is a model of the profiling counters of the DWT of an M-profile
+ * CPU (the registers starting at 0xE0001000 with DWT_CTRL).
+ *
+ * QEMU interface:
+ *  + sysbus MMIO region 0: the register bank
+ *  + Clock input "cpuclk": the CPU clock, which CYCCNT counts
+ *
+ * CYCCNT is derived from QEMU_CLOCK_VIRTUAL and the CPU clock period, so
+ * it follows the instruction count when -icount is in use. QEMU does not
+ * model pipeline stalls: CPICNT, EXCCNT, SLEEPCNT, LSUCNT and FOLDCNT never
+ * count. No comparators are implemented (DWT_CTRL.NUMCOMP is 0).
+ * DEMCR.TRCENA is not modelled: the counters work whether or not it is set.
+ */
+
+#ifndef HW_MISC_ARMV7M_DWT_H
+#define HW_MISC_ARMV7M_DWT_H
+
+#include "hw/sysbus.h"
+#include "hw/clock.h"
+
+#define TYPE_ARMV7M_DWT "armv7m-dwt"
+OBJECT_DECLARE_SIMPLE_TYPE(ARMv7MDWT, ARMV7M_DWT)
+
+struct ARMv7MDWT {
+    /*< private >*/
+    SysBusDevice parent_obj;
+
+    /*< public >*/
+    MemoryRegion iomem;
+    Clock *cpuclk;
+
+    uint32_t ctrl;
+    /* CYCCNT as of cyccnt_ns; it advances from there while CYCCNTENA is set */
+    uint32_t cyccnt;
+    int64_t cyccnt_ns;
+    /* The 8-bit profiling counters, which only change when written */
+    uint8_t cpicnt;
+    uint8_t exccnt;
+    uint8_t sleepcnt;
+    uint8_t lsucnt;
+    uint8_t foldcnt;
+};
+
+#endif
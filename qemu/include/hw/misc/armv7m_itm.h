@@ -0,0 +1,55 @@
+/*
+ * Arm M-profile ITM (Instrumentation Trace Macrocell)
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * This is a model of the ITM of an M-profile CPU (the registers starting
+ * at 0xE0000000 with the stimulus ports).
+ *
+ * QEMU interface:
+ *  + sysbus MMIO region 0: the register bank
+ *  + Property "chardev": where the trace stream goes
+ *
+ * Writes to an enabled stimulus port produce an instrumentation (SWIT)
+ * packet, in the format the ITM sends to the TPIU/SWO: a header byte
+ * with the port number and payload size, then the 1, 2 or 4 payload bytes.
+ * Packets are buffered and written to the chardev in batches. Local and
+ * global timestamps, synchronization packets and the DWT hardware source
+ * packets are not generated. As for the DWT, DEMCR.TRCENA is not modelled.
+ */
+
+#ifndef HW_MISC_ARMV7M_ITM_H
+#define HW_MISC_ARMV7M_ITM_H
+
+#include "hw/sysbus.h"
+#include "chardev/char-fe.h"
+
+#define TYPE_ARMV7M_ITM "armv7m-itm"
+OBJECT_DECLARE_SIMPLE_TYPE(ARMv7MITM, ARMV7M_ITM)
+
+#define ARMV7M_ITM_NUM_PORTS 32
+/* Size of the packet buffer drained to the chardev */
+#define ARMV7M_ITM_BUF_SIZE 512
+
+struct ARMv7MITM {
+    /*< private >*/
+    SysBusDevice parent_obj;
+
+    /*< public >*/
+    MemoryRegion iomem;
+    CharBackend chr;
+    QEMUBH *bh;
+
+    uint32_t ter;
+    uint32_t tpr;
+    uint32_t tcr;
+
+    /* Packets not yet written to the chardev */
+    uint8_t buf[ARMV7M_ITM_BUF_SIZE];
+    uint32_t buf_len;
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * NXP S32K3 Periodic Interrupt Timer (PIT)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 or
+ *  (at your option) any later version.
+ */
+
+#ifndef S32K3_PIT_H
+#define S32K3_PIT_H
+
+#include "hw/sysbus.h"
+#include "hw/clock.h"
+#include "qemu/timer.h"
+#include "qom/object.h"
+
+#define TYPE_S32K3_PIT "s32k3-pit"
+OBJECT_DECLARE_SIMPLE_TYPE(S32K3PITState, S32K3_PIT)
+
+#define S32K3_PIT_NUM_CHANNELS 4
+
+typedef struct S32K3PITChannel {
+    uint32_t ldval;
+    /* Counter value as of S32K3PITState::ref_ticks */
+    uint32_t cval;
+    uint32_t tctrl;
+    uint32_t tflg;
+} S32K3PITChannel;
+
+/*
+ * QEMU interface:
+ *  + Clock input "clk": module clock for the timer channels
+ *  + sysbus MMIO region 0: the register bank
+ *  + sysbus IRQ 0: module interrupt, the OR of every channel's TIF & TIE
+ *
+ * All channels share a single QEMUTimer which is armed for the earliest
+ * channel expiry that can raise an interrupt; counter values are
+ * computed lazily from the virtual clock when the guest reads them.
+ */
+struct S32K3PITState {
+    /*< private >*/
+    SysBusDevice parent_obj;
+
+    /*< public >*/
+    MemoryRegion iomem;
+    qemu_irq irq;
+    QEMUTimer *timer;
+    Clock *clk;
+
+    uint32_t mcr;
+    uint32_t ltmr64l;
+    /* Virtual time at which the module clock started counting */
+    int64_t epoch_ns;
+    /* Module clock ticks since epoch_ns that the channels reflect */
+    uint64_t ref_ticks;
+    S32K3PITChannel channel[S32K3_PIT_NUM_CHANNELS];
+};
+
+/*
+ * s32k3_pit_stall: hold the counters of every channel for @ns of virtual
+ * time, as if the module clock had been gated, e.g. to perturb the timing
+ * of the firmware from a fuzzer
+ */
+void s32k3_pit_stall(S32K3PITState *s, int64_t ns);
+
+#endif
@@ -96,6 +96,17 @@ int64_t cpu_get_clock(void);
 
 void qemu_timer_notify_cb(void *opaque, QEMUClockType type);
 
+/*
+ * Idle skipping: with icount disabled, QEMU_CLOCK_VIRTUAL normally follows
+ * the host clock, so a guest waiting for a timer waits in real time. When
+ * enabled, the main loop instead moves the clock straight to the next timer
+ * deadline as soon as every vCPU is idle.
+ */
+void cpu_timers_set_skip_idle(bool enable);
+bool cpu_timers_skip_idle_enabled(void);
+/* Caller must hold BQL */
+void cpu_timers_skip_idle(void);
+
 /* get/set VIRTUAL clock and VM elapsed ticks via the cpus accel interface */
 int64_t cpus_get_virtual_clock(void);
 void cpus_set_virtual_clock(int64_t new_time);
@@ -33,9 +33,11 @@
 #include "qemu/seqlock.h"
 #include "sysemu/replay.h"
 #include "sysemu/runstate.h"
+#include "sysemu/qtest.h"
 #include "hw/core/cpu.h"
 #include "sysemu/cpu-timers.h"
 #include "sysemu/cpu-timers-internal.h"
+#include "trace.h"
 
 /* clock and ticks */
 
@@ -134,6 +136,52 @@ void cpu_disable_ticks(void)
                          &timers_state.vm_clock_lock);
 }
 
+static bool skip_idle;
+
+void cpu_timers_set_skip_idle(bool enable)
+{
+    skip_idle = enable;
+}
+
+bool cpu_timers_skip_idle_enabled(void)
+{
+    return skip_idle;
+}
+
+/*
+ * If every vCPU is idle, nothing can happen before the next QEMU_CLOCK_VIRTUAL
+ * deadline: move the clock forward to it, as "-icount sleep=off" does, but
+ * without counting instructions. Timers with QEMU_TIMER_ATTR_EXTERNAL are
+ * driven by the outside world and do not stop the clock from moving.
+ */
+void cpu_timers_skip_idle(void)
+{
+    int64_t deadline;
+
+    if (!skip_idle || icount_enabled() || qtest_enabled()) {
+        return;
+    }
+    if (!runstate_is_running() || !all_cpu_threads_idle()) {
+        return;
+    }
+
+    deadline = qemu_clock_deadline_ns_all(QEMU_CLOCK_VIRTUAL,
+                                          ~QEMU_TIMER_ATTR_EXTERNAL);
+    if (deadline <= 0) {
+        return;
+    }
+
+    trace_cpu_timers_skip_idle(deadline);
+
+    seqlock_write_lock(&timers_state.vm_clock_seqlock,
+                       &timers_state.vm_clock_lock);
+    timers_state.cpu_clock_offset += deadline;
+    seqlock_write_unlock(&timers_state.vm_clock_seqlock,
+                         &timers_state.vm_clock_lock);
+
+    qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
+}
+
 static bool icount_state_needed(void *opaque)
 {
     return icount_enabled();
@@ -458,6 +458,10 @@ void qemu_wait_io_event(CPUState *cpu)
         if (!slept) {
             slept = true;
             qemu_plugin_vcpu_idle_cb(cpu);
+            if (cpu_timers_skip_idle_enabled()) {
+                /* This may be the last busy vCPU, let the main loop check */
+                qemu_notify_event();
+            }
         }
         qemu_cond_wait(cpu->halt_cond, &bql);
     }
@@ -52,6 +52,7 @@
 #include "qom/object.h"
 #include "qom/object_interfaces.h"
 #include "sysemu/cpus.h"
+#include "sysemu/cpu-timers.h"
 #include "sysemu/qtest.h"
 #include "sysemu/replay.h"
 #include "sysemu/reset.h"
@@ -832,6 +833,7 @@ int qemu_main_loop(void)
     int status = EXIT_SUCCESS;
 
     while (!main_loop_should_exit(&status)) {
+        cpu_timers_skip_idle();
         main_loop_wait(false);
     }
 
@@ -504,6 +504,7 @@ static void arm_cpu_reset_hold(Object *obj, ResetType type)
     arm_clear_exclusive(env);
 
     if (arm_feature(env, ARM_FEATURE_PMSA)) {
+        arm_mpu_cache_invalidate(cpu);
         if (cpu->pmsav7_dregion > 0) {
             if (arm_feature(env, ARM_FEATURE_V8)) {
                 memset(env->pmsav8.rbar[M_REG_NS], 0,
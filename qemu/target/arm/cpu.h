@@ -828,6 +828,35 @@ typedef struct {
     uint32_t map, init, supported;
 } ARMVQMap;
 
+/*
+ * M-profile MPU lookups whose result does not cover a whole TARGET_PAGE
+ * cannot be kept in the TLB, so every access to such an address goes back
+ * through the MPU region walk. ARMMPUCache remembers those results. MPU
+ * decisions are uniform over aligned 32-byte granules (the smallest region
+ * and subregion size), which is what the entries are tagged with.
+ */
+#define ARM_MPU_CACHE_ENTRIES 256
+#define ARM_MPU_CACHE_GRANULE_BITS 5
+
+typedef struct ARMMPUCacheEntry {
+    uint32_t gen;           /* ARMMPUCache::gen when the entry was filled */
+    uint32_t granule;       /* address >> ARM_MPU_CACHE_GRANULE_BITS */
+    uint8_t mmu_idx;
+    bool secure;
+    bool valid;
+    uint8_t lg_page_size;
+    uint8_t prot;
+    uint8_t fault_type;     /* ARMFaultType */
+    uint8_t fault_level;
+    int32_t mregion;        /* PMSAv8 matching region, or -1 */
+} ARMMPUCacheEntry;
+
+typedef struct ARMMPUCache {
+    /* Bumped to invalidate every entry, see arm_mpu_cache_invalidate() */
+    uint32_t gen;
+    ARMMPUCacheEntry entry[ARM_MPU_CACHE_ENTRIES];
+} ARMMPUCache;
+
 /**
  * ARMCPU:
  * @env: #CPUARMState
@@ -930,6 +959,8 @@ struct ArchCPU {
     uint32_t pmsav8r_hdregion;
     /* v8M SAU number of supported regions */
     uint32_t sau_sregion;
+    /* Sub-page M-profile MPU lookups, not migrated */
+    ARMMPUCache mpu_cache;
 
     /* PSCI conduit used to invoke PSCI methods
      * 0 - disabled, 1 - smc, 2 - hvc
@@ -1141,6 +1172,20 @@ void arm_gt_stimer_cb(void *opaque);
 void arm_gt_hvtimer_cb(void *opaque);
 
 unsigned int gt_cntfrq_period_ns(ARMCPU *cpu);
+
+/**
+ * arm_mpu_cache_invalidate: forget all the cached MPU lookups of @cpu
+ *
+ * Must be called whenever the MPU configuration of an M-profile CPU
+ * changes: region registers, MPU_CTRL, reset and migration.
+ */
+static inline void arm_mpu_cache_invalidate(ARMCPU *cpu)
+{
+    if (++cpu->mpu_cache.gen == 0) {
+        /* Wrapped around: entries from the previous generation 0 are stale */
+        memset(cpu->mpu_cache.entry, 0, sizeof(cpu->mpu_cache.entry));
+    }
+}
 void gt_rme_post_el_change(ARMCPU *cpu, void *opaque);
 
 void arm_cpu_post_init(Object *obj);
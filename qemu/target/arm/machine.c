@@ -1026,6 +1026,7 @@ static int cpu_post_load(void *opaque, int version_id)
 
     if (tcg_enabled()) {
         arm_rebuild_hflags(env);
+        arm_mpu_cache_invalidate(cpu);
     }
 
     return 0;
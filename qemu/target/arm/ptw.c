@@ -2379,12 +2379,79 @@ static bool pmsav7_use_background_region(ARMCPU *cpu, ARMMMUIdx mmu_idx,
     return regime_sctlr(env, mmu_idx) & SCTLR_BR;
 }
 
-static bool get_phys_addr_pmsav7(CPUARMState *env,
-                                 S1Translate *ptw,
-                                 uint32_t address,
-                                 MMUAccessType access_type,
-                                 GetPhysAddrResult *result,
-                                 ARMMMUFaultInfo *fi)
+/*
+ * Helpers for the M-profile MPU lookup cache (see ARMMPUCache). Only the
+ * results the TLB cannot hold, those with lg_page_size < TARGET_PAGE_BITS,
+ * are stored. Every fault leaves prot at 0, so the return value of a
+ * lookup can always be recomputed from prot and the access type.
+ */
+static ARMMPUCacheEntry *mpu_cache_entry(ARMCPU *cpu, uint32_t address,
+                                         ARMMMUIdx mmu_idx)
+{
+    uint32_t granule = address >> ARM_MPU_CACHE_GRANULE_BITS;
+
+    return &cpu->mpu_cache.entry[(granule ^ (mmu_idx << 5)) %
+                                 ARM_MPU_CACHE_ENTRIES];
+}
+
+static bool mpu_cache_hit(ARMCPU *cpu, ARMMPUCacheEntry *e,
+                          uint32_t address, ARMMMUIdx mmu_idx, bool secure)
+{
+    return e->valid && e->gen == cpu->mpu_cache.gen &&
+        e->granule == address >> ARM_MPU_CACHE_GRANULE_BITS &&
+        e->mmu_idx == mmu_idx && e->secure == secure;
+}
+
+static bool mpu_cache_replay(ARMMPUCacheEntry *e, uint32_t address,
+                             MMUAccessType access_type,
+                             GetPhysAddrResult *result,
+                             ARMMMUFaultInfo *fi, uint32_t *mregion)
+{
+    result->f.phys_addr = address;
+    result->f.lg_page_size = e->lg_page_size;
+    result->f.prot = e->prot;
+    fi->type = e->fault_type;
+    fi->level = e->fault_level;
+    if (mregion) {
+        *mregion = e->mregion;
+    }
+    return !(result->f.prot & (1 << access_type));
+}
+
+static void mpu_cache_fill(ARMCPU *cpu, ARMMPUCacheEntry *e,
+                           uint32_t address, ARMMMUIdx mmu_idx, bool secure,
+                           GetPhysAddrResult *result,
+                           ARMMMUFaultInfo *fi, uint32_t mregion)
+{
+    if (result->f.lg_page_size >= TARGET_PAGE_BITS) {
+        return;
+    }
+
+    *e = (ARMMPUCacheEntry) {
+        .gen = cpu->mpu_cache.gen,
+        .granule = address >> ARM_MPU_CACHE_GRANULE_BITS,
+        .mmu_idx = mmu_idx,
+        .secure = secure,
+        .valid = true,
+        .lg_page_size = result->f.lg_page_size,
+        .prot = result->f.prot,
+        .fault_type = fi->type,
+        .fault_level = fi->level,
+        .mregion = mregion,
+    };
+}
+
+/*
+ * Sets *cacheable to false if the result may not hold for the whole
+ * ARM_MPU_CACHE_GRANULE_BITS granule of @address.
+ */
+static bool get_phys_addr_pmsav7_uncached(CPUARMState *env,
+                                          S1Translate *ptw,
+                                          uint32_t address,
+                                          MMUAccessType access_type,
+                                          GetPhysAddrResult *result,
+                                          ARMMMUFaultInfo *fi,
+                                          bool *cacheable)
 {
     ARMCPU *cpu = env_archcpu(env);
     int n;
@@ -2427,6 +2494,11 @@ static bool get_phys_addr_pmsav7(CPUARMState *env,
             rsize++;
             rmask = (1ull << rsize) - 1;
 
+            if (rsize < ARM_MPU_CACHE_GRANULE_BITS) {
+                /* Smaller than any architecturally valid region size */
+                *cacheable = false;
+            }
+
             if (base & rmask) {
                 qemu_log_mask(LOG_GUEST_ERROR,
                               "DRBAR[%d]: 0x%" PRIx32 " misaligned "
@@ -2572,6 +2644,35 @@ static bool get_phys_addr_pmsav7(CPUARMState *env,
     return !(result->f.prot & (1 << access_type));
 }
 
+static bool get_phys_addr_pmsav7(CPUARMState *env,
+                                 S1Translate *ptw,
+                                 uint32_t address,
+                                 MMUAccessType access_type,
+                                 GetPhysAddrResult *result,
+                                 ARMMMUFaultInfo *fi)
+{
+    ARMCPU *cpu = env_archcpu(env);
+    ARMMMUIdx mmu_idx = ptw->in_mmu_idx;
+    bool secure = arm_space_is_secure(ptw->in_space);
+    bool cacheable = arm_feature(env, ARM_FEATURE_M);
+    ARMMPUCacheEntry *e = NULL;
+    bool ret;
+
+    if (cacheable) {
+        e = mpu_cache_entry(cpu, address, mmu_idx);
+        if (mpu_cache_hit(cpu, e, address, mmu_idx, secure)) {
+            return mpu_cache_replay(e, address, access_type, result, fi, NULL);
+        }
+    }
+
+    ret = get_phys_addr_pmsav7_uncached(env, ptw, address, access_type,
+                                        result, fi, &cacheable);
+    if (cacheable) {
+        mpu_cache_fill(cpu, e, address, mmu_idx, secure, result, fi, -1);
+    }
+    return ret;
+}
+
 static uint32_t *regime_rbar(CPUARMState *env, ARMMMUIdx mmu_idx,
                              uint32_t secure)
 {
@@ -2592,10 +2693,11 @@ static uint32_t *regime_rlar(CPUARMState *env, ARMMMUIdx mmu_idx,
     }
 }
 
-bool pmsav8_mpu_lookup(CPUARMState *env, uint32_t address,
-                       MMUAccessType access_type, ARMMMUIdx mmu_idx,
-                       bool secure, GetPhysAddrResult *result,
-                       ARMMMUFaultInfo *fi, uint32_t *mregion)
+static bool pmsav8_mpu_lookup_uncached(CPUARMState *env, uint32_t address,
+                                       MMUAccessType access_type,
+                                       ARMMMUIdx mmu_idx, bool secure,
+                                       GetPhysAddrResult *result,
+                                       ARMMMUFaultInfo *fi, uint32_t *mregion)
 {
     /*
      * Perform a PMSAv8 MPU lookup (without also doing the SAU check
@@ -2785,6 +2887,37 @@ bool pmsav8_mpu_lookup(CPUARMState *env, uint32_t address,
     return !(result->f.prot & (1 << access_type));
 }
 
+bool pmsav8_mpu_lookup(CPUARMState *env, uint32_t address,
+                       MMUAccessType access_type, ARMMMUIdx mmu_idx,
+                       bool secure, GetPhysAddrResult *result,
+                       ARMMMUFaultInfo *fi, uint32_t *mregion)
+{
+    ARMCPU *cpu = env_archcpu(env);
+    ARMMPUCacheEntry *e;
+    uint32_t matchregion;
+    bool ret;
+
+    /* M-profile regions are 32-byte granular: every result is cacheable */
+    if (!arm_feature(env, ARM_FEATURE_M)) {
+        return pmsav8_mpu_lookup_uncached(env, address, access_type, mmu_idx,
+                                          secure, result, fi, mregion);
+    }
+
+    e = mpu_cache_entry(cpu, address, mmu_idx);
+    if (mpu_cache_hit(cpu, e, address, mmu_idx, secure)) {
+        return mpu_cache_replay(e, address, access_type, result, fi, mregion);
+    }
+
+    /* Always ask for the region, a later lookup may want it */
+    ret = pmsav8_mpu_lookup_uncached(env, address, access_type, mmu_idx,
+                                     secure, result, fi, &matchregion);
+    mpu_cache_fill(cpu, e, address, mmu_idx, secure, result, fi, matchregion);
+    if (mregion) {
+        *mregion = matchregion;
+    }
+    return ret;
+}
+
 static bool v8m_is_sau_exempt(CPUARMState *env,
                               uint32_t address, MMUAccessType access_type)
 {
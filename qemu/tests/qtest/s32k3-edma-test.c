@@ -0,0 +1,288 @@
+/*
+ * QTest testcase for the NXP S32K3 eDMA and DMAMUX
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+#define EDMA_BASE 0x4020C000
+#define EDMA_CH(n) (0x40210000 + (n) * 0x4000)
+#define DMAMUX0_BASE 0x40280000
+#define EDMA_CH0_IRQ 32
+#define EDMA_ERR_IRQ 64
+
+/* Management page */
+#define ES 0x004
+#define INT 0x008
+
+/* Channel page */
+#define CH_CSR 0x00
+#define CH_ES 0x04
+#define CH_INT 0x08
+#define TCD_SADDR 0x20
+#define TCD_SOFF 0x24
+#define TCD_ATTR 0x26
+#define TCD_NBYTES 0x28
+#define TCD_SLAST_SDA 0x2C
+#define TCD_DADDR 0x30
+#define TCD_DOFF 0x34
+#define TCD_CITER 0x36
+#define TCD_DLAST_SGA 0x38
+#define TCD_CSR 0x3C
+#define TCD_BITER 0x3E
+
+#define CH_CSR_ERQ (1 << 0)
+#define CH_CSR_EEI (1 << 2)
+#define CH_CSR_DONE (1 << 30)
+#define CH_ES_DAE (1 << 5)
+#define CH_ES_ERR (1u << 31)
+#define TCD_CSR_START (1 << 0)
+#define TCD_CSR_INTMAJOR (1 << 1)
+#define TCD_CSR_DREQ (1 << 3)
+#define TCD_CSR_ESG (1 << 4)
+#define ATTR_SIZE(s, d) (((s) << 8) | (d))
+
+/* DMAMUX */
+#define CHCFG_ENBL 0x80
+#define DMAMUX_SRC_LPUART0_TX 3
+#define DMAMUX_SRC_ALWAYS_ON 62
+
+/* LPUART0 */
+#define LPUART_BASE 0x4006A000
+#define LPUART_BAUD 0x10
+#define LPUART_CTRL 0x18
+#define LPUART_DATA 0x1C
+#define LPUART_FIFO 0x28
+#define LPUART_WATER 0x2C
+#define BAUD_TDMAE (1 << 23)
+#define CTRL_TE (1 << 19)
+#define FIFO_TXFE (1 << 7)
+
+#define SRAM_BASE 0x20400000
+#define SRC_ADDR (SRAM_BASE + 0x1000)
+#define DST_ADDR (SRAM_BASE + 0x2000)
+#define SG_ADDR (SRAM_BASE + 0x3000)
+
+#define NVIC_ISPR(n) (0xE000E200 + ((n) / 32) * 4)
+
+static bool check_nvic_pending(QTestState *qts, unsigned int n)
+{
+    return qtest_readl(qts, NVIC_ISPR(n)) & (1 << (n % 32));
+}
+
+static void setup_tcd(QTestState *qts, unsigned int ch, uint32_t saddr,
+                      uint16_t soff, uint32_t daddr, uint16_t doff,
+                      uint16_t attr, uint32_t nbytes, uint16_t iter)
+{
+    qtest_writel(qts, EDMA_CH(ch) + TCD_SADDR, saddr);
+    qtest_writew(qts, EDMA_CH(ch) + TCD_SOFF, soff);
+    qtest_writew(qts, EDMA_CH(ch) + TCD_ATTR, attr);
+    qtest_writel(qts, EDMA_CH(ch) + TCD_NBYTES, nbytes);
+    qtest_writel(qts, EDMA_CH(ch) + TCD_SLAST_SDA, 0);
+    qtest_writel(qts, EDMA_CH(ch) + TCD_DADDR, daddr);
+    qtest_writew(qts, EDMA_CH(ch) + TCD_DOFF, doff);
+    qtest_writew(qts, EDMA_CH(ch) + TCD_CITER, iter);
+    qtest_writel(qts, EDMA_CH(ch) + TCD_DLAST_SGA, 0);
+    qtest_writew(qts, EDMA_CH(ch) + TCD_BITER, iter);
+}
+
+/* The engine runs from a bottom half: poll for the outcome */
+static void wait_for_done(QTestState *qts, unsigned int ch)
+{
+    while (!(qtest_readl(qts, EDMA_CH(ch) + CH_CSR) & CH_CSR_DONE)) {
+        g_usleep(1000);
+    }
+}
+
+static void test_mem_to_mem(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+    uint8_t src[64], dst[64];
+
+    for (int i = 0; i < sizeof(src); i++) {
+        src[i] = i * 3;
+    }
+    qtest_memwrite(qts, SRC_ADDR, src, sizeof(src));
+
+    /* A single 64-byte minor loop, 32-bit beats */
+    setup_tcd(qts, 1, SRC_ADDR, 4, DST_ADDR, 4, ATTR_SIZE(2, 2), 64, 1);
+    qtest_writew(qts, EDMA_CH(1) + TCD_CSR, TCD_CSR_INTMAJOR | TCD_CSR_START);
+    wait_for_done(qts, 1);
+
+    qtest_memread(qts, DST_ADDR, dst, sizeof(dst));
+    g_assert_cmpmem(src, sizeof(src), dst, sizeof(dst));
+
+    /* START self-clears, the major loop interrupt is raised */
+    g_assert_cmphex(qtest_readw(qts, EDMA_CH(1) + TCD_CSR) & TCD_CSR_START,
+                    ==, 0);
+    g_assert_cmphex(qtest_readl(qts, EDMA_BASE + INT), ==, 1 << 1);
+    g_assert_true(check_nvic_pending(qts, EDMA_CH0_IRQ + 1));
+
+    /* Addresses moved by NBYTES, CITER reloaded from BITER */
+    g_assert_cmphex(qtest_readl(qts, EDMA_CH(1) + TCD_SADDR), ==,
+                    SRC_ADDR + 64);
+    g_assert_cmphex(qtest_readl(qts, EDMA_CH(1) + TCD_DADDR), ==,
+                    DST_ADDR + 64);
+    g_assert_cmpuint(qtest_readw(qts, EDMA_CH(1) + TCD_CITER), ==, 1);
+
+    qtest_writel(qts, EDMA_CH(1) + CH_INT, 1);
+    g_assert_cmphex(qtest_readl(qts, EDMA_BASE + INT), ==, 0);
+
+    qtest_quit(qts);
+}
+
+static void test_minor_loops(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+    uint8_t src[16], dst[16];
+
+    for (int i = 0; i < sizeof(src); i++) {
+        src[i] = 0xa0 + i;
+    }
+    qtest_memwrite(qts, SRC_ADDR, src, sizeof(src));
+
+    /*
+     * Four 4-byte minor loops with byte beats, requested by an always-on
+     * DMAMUX source, with a backwards destination walk and SLAST rewinding
+     * the source at the end of the major loop.
+     */
+    setup_tcd(qts, 2, SRC_ADDR, 1, DST_ADDR + 15, -1, ATTR_SIZE(0, 0), 4, 4);
+    qtest_writel(qts, EDMA_CH(2) + TCD_SLAST_SDA, -16);
+    qtest_writew(qts, EDMA_CH(2) + TCD_CSR, TCD_CSR_DREQ);
+    qtest_writeb(qts, DMAMUX0_BASE + 1, CHCFG_ENBL | DMAMUX_SRC_ALWAYS_ON);
+    qtest_writel(qts, EDMA_CH(2) + CH_CSR, CH_CSR_ERQ);
+    wait_for_done(qts, 2);
+
+    qtest_memread(qts, DST_ADDR, dst, sizeof(dst));
+    for (int i = 0; i < sizeof(dst); i++) {
+        g_assert_cmphex(dst[15 - i], ==, src[i]);
+    }
+    g_assert_cmphex(qtest_readl(qts, EDMA_CH(2) + TCD_SADDR), ==, SRC_ADDR);
+
+    /* DREQ turned the request off at the end of the major loop */
+    g_assert_cmphex(qtest_readl(qts, EDMA_CH(2) + CH_CSR) & CH_CSR_ERQ, ==, 0);
+    g_assert_false(check_nvic_pending(qts, EDMA_CH0_IRQ + 2));
+
+    qtest_quit(qts);
+}
+
+static void test_scatter_gather(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+    uint32_t tcd[8];
+    uint32_t dst[2];
+
+    qtest_writel(qts, SRC_ADDR, 0x11111111);
+    qtest_writel(qts, SRC_ADDR + 4, 0x22222222);
+
+    /* Second TCD, in memory: copies the second word and interrupts */
+    tcd[0] = cpu_to_le32(SRC_ADDR + 4);
+    tcd[1] = cpu_to_le32((ATTR_SIZE(2, 2) << 16) | 4);
+    tcd[2] = cpu_to_le32(4);
+    tcd[3] = 0;
+    tcd[4] = cpu_to_le32(DST_ADDR + 4);
+    tcd[5] = cpu_to_le32((1 << 16) | 4);
+    tcd[6] = 0;
+    tcd[7] = cpu_to_le32((1 << 16) | TCD_CSR_INTMAJOR | TCD_CSR_START);
+    qtest_memwrite(qts, SG_ADDR, tcd, sizeof(tcd));
+
+    /* First TCD copies the first word and chains to the second */
+    setup_tcd(qts, 0, SRC_ADDR, 4, DST_ADDR, 4, ATTR_SIZE(2, 2), 4, 1);
+    qtest_writel(qts, EDMA_CH(0) + TCD_DLAST_SGA, SG_ADDR);
+    qtest_writew(qts, EDMA_CH(0) + TCD_CSR, TCD_CSR_ESG | TCD_CSR_START);
+
+    while (!check_nvic_pending(qts, EDMA_CH0_IRQ)) {
+        g_usleep(1000);
+    }
+    qtest_memread(qts, DST_ADDR, dst, sizeof(dst));
+    g_assert_cmphex(le32_to_cpu(dst[0]), ==, 0x11111111);
+    g_assert_cmphex(le32_to_cpu(dst[1]), ==, 0x22222222);
+
+    /* The channel now holds the loaded TCD, advanced past its transfer */
+    g_assert_cmphex(qtest_readl(qts, EDMA_CH(0) + TCD_DADDR), ==,
+                    DST_ADDR + 8);
+
+    qtest_quit(qts);
+}
+
+static void test_config_error(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    /* A misaligned 32-bit destination is a configuration error */
+    setup_tcd(qts, 3, SRC_ADDR, 4, DST_ADDR + 2, 4, ATTR_SIZE(2, 2), 4, 1);
+    qtest_writel(qts, EDMA_CH(3) + CH_CSR, CH_CSR_EEI);
+    qtest_writew(qts, EDMA_CH(3) + TCD_CSR, TCD_CSR_START);
+
+    while (!(qtest_readl(qts, EDMA_CH(3) + CH_ES) & CH_ES_ERR)) {
+        g_usleep(1000);
+    }
+    g_assert_cmphex(qtest_readl(qts, EDMA_CH(3) + CH_ES), ==,
+                    CH_ES_ERR | CH_ES_DAE);
+    g_assert_cmphex(qtest_readl(qts, EDMA_BASE + ES), ==,
+                    0x80000000 | (3 << 24) | CH_ES_DAE);
+    g_assert_true(check_nvic_pending(qts, EDMA_ERR_IRQ));
+
+    /* Writing ERR clears the channel errors */
+    qtest_writel(qts, EDMA_CH(3) + CH_ES, CH_ES_ERR);
+    g_assert_cmphex(qtest_readl(qts, EDMA_CH(3) + CH_ES), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, EDMA_BASE + ES) >> 31, ==, 0);
+
+    qtest_quit(qts);
+}
+
+static void test_lpuart_tx(void)
+{
+    int sock_fd;
+    const char *str = "transmitted by the eDMA through the LPUART FIFO\r\n";
+    size_t len = strlen(str);
+    size_t got = 0;
+    char buf[64];
+    QTestState *qts = qtest_init_with_serial("-M s32k3x8evb", &sock_fd);
+
+    qtest_memwrite(qts, SRC_ADDR, str, len);
+
+    /* LPUART0 with its TX FIFO, raising a DMA request while TDRE is set */
+    qtest_writel(qts, LPUART_BASE + LPUART_BAUD,
+                 (15 << 24) | 43 | BAUD_TDMAE);
+    qtest_writel(qts, LPUART_BASE + LPUART_FIFO, FIFO_TXFE);
+    qtest_writel(qts, LPUART_BASE + LPUART_WATER, 15);
+    qtest_writel(qts, LPUART_BASE + LPUART_CTRL, CTRL_TE);
+
+    /* One byte per request into the DATA register */
+    setup_tcd(qts, 0, SRC_ADDR, 1, LPUART_BASE + LPUART_DATA, 0,
+              ATTR_SIZE(0, 0), 1, len);
+    qtest_writew(qts, EDMA_CH(0) + TCD_CSR, TCD_CSR_DREQ | TCD_CSR_INTMAJOR);
+    qtest_writeb(qts, DMAMUX0_BASE + 3, CHCFG_ENBL | DMAMUX_SRC_LPUART0_TX);
+    qtest_writel(qts, EDMA_CH(0) + CH_CSR, CH_CSR_ERQ);
+
+    while (got < len) {
+        ssize_t ret = recv(sock_fd, buf + got, sizeof(buf) - got, 0);
+        g_assert_cmpint(ret, >, 0);
+        got += ret;
+    }
+    g_assert_cmpmem(buf, got, str, len);
+
+    wait_for_done(qts, 0);
+    g_assert_true(check_nvic_pending(qts, EDMA_CH0_IRQ));
+    g_assert_cmphex(qtest_readl(qts, EDMA_CH(0) + CH_CSR) & CH_CSR_ERQ, ==, 0);
+
+    close(sock_fd);
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("s32k3-edma/mem_to_mem", test_mem_to_mem);
+    qtest_add_func("s32k3-edma/minor_loops", test_minor_loops);
+    qtest_add_func("s32k3-edma/scatter_gather", test_scatter_gather);
+    qtest_add_func("s32k3-edma/config_error", test_config_error);
+    qtest_add_func("s32k3-edma/lpuart_tx", test_lpuart_tx);
+
+    return g_test_run();
+}
@@ -0,0 +1,65 @@
+/*
+ * QTest testcase for the shared flash image of the s32k3x8evb
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "libqtest.h"
+
+/* Program flash, blocks 0 to 3 */
+#define FLASH_BASE 0x00400000
+#define FLASH_SIZE 0x00800000
+#define BLOCK_SIZE 0x00200000
+
+static void put_word(int fd, off_t offset, uint32_t value)
+{
+    uint8_t buf[4];
+
+    stl_le_p(buf, value);
+    g_assert_cmpint(pwrite(fd, buf, sizeof(buf), offset), ==, sizeof(buf));
+}
+
+static void test_image(void)
+{
+    g_autofree char *path = NULL;
+    QTestState *qts;
+    uint8_t buf[4];
+    int fd;
+
+    fd = g_file_open_tmp("qtest-s32k3-flash-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    g_assert_cmpint(ftruncate(fd, FLASH_SIZE), ==, 0);
+    put_word(fd, 0, 0x11111111);
+    put_word(fd, BLOCK_SIZE, 0x22222222);
+    put_word(fd, FLASH_SIZE - 4, 0x44444444);
+
+    qts = qtest_initf("-M s32k3x8evb,flash-image=%s", path);
+
+    /* Every block maps its own part of the image */
+    g_assert_cmphex(qtest_readl(qts, FLASH_BASE), ==, 0x11111111);
+    g_assert_cmphex(qtest_readl(qts, FLASH_BASE + BLOCK_SIZE), ==, 0x22222222);
+    g_assert_cmphex(qtest_readl(qts, FLASH_BASE + 2 * BLOCK_SIZE), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, FLASH_BASE + FLASH_SIZE - 4), ==, 0x44444444);
+
+    /* The flash is ROM for the guest, and the image is never written */
+    qtest_writel(qts, FLASH_BASE, 0xdeadbeef);
+    g_assert_cmphex(qtest_readl(qts, FLASH_BASE), ==, 0x11111111);
+    g_assert_cmpint(pread(fd, buf, sizeof(buf), 0), ==, sizeof(buf));
+    g_assert_cmphex(ldl_le_p(buf), ==, 0x11111111);
+
+    qtest_quit(qts);
+    close(fd);
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("s32k3-flash/image", test_image);
+
+    return g_test_run();
+}
@@ -0,0 +1,111 @@
+/*
+ * QTest testcase for the fuzzing harness of the s32k3x8evb
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+
+/* LPUART0, which receives the bytes of the inputs */
+#define LPUART_BASE 0x4006A000
+#define STAT 0x14
+#define CTRL 0x18
+#define STAT_RDRF (1 << 21)
+#define CTRL_RE (1 << 18)
+
+#define SNAPSHOT_AT 1000000
+#define BUDGET 1000000
+
+/* From include/hw/arm/s32k3x8evb_fuzz.h */
+#define FUZZ_READY 0x46323353
+
+static void recv_all(int fd, uint8_t *buf, size_t len)
+{
+    size_t got = 0;
+    ssize_t ret;
+
+    while (got < len) {
+        ret = recv(fd, buf + got, len - got, 0);
+        g_assert_cmpint(ret, >, 0);
+        got += ret;
+    }
+}
+
+/* Run an input, from the snapshot, until the end of its budget */
+static uint32_t run_input(QTestState *qts, int fd, const uint8_t *input,
+                          uint32_t size)
+{
+    uint8_t header[4], reply[12];
+    QDict *resp, *ret;
+    bool running = false;
+
+    stl_le_p(header, size);
+    g_assert_cmpint(send(fd, header, sizeof(header), 0), ==, sizeof(header));
+    if (size) {
+        g_assert_cmpint(send(fd, input, size, 0), ==, size);
+    }
+
+    /* The budget only starts once the harness has rewound and resumed */
+    while (!running) {
+        resp = qtest_qmp(qts, "{ 'execute': 'query-status' }");
+        ret = qdict_get_qdict(resp, "return");
+        running = qdict_get_bool(ret, "running");
+        qobject_unref(resp);
+        if (!running) {
+            g_usleep(1000);
+        }
+    }
+    qtest_clock_step(qts, BUDGET);
+
+    recv_all(fd, reply, sizeof(reply));
+    return ldl_le_p(reply);
+}
+
+static void test_input(void)
+{
+    g_autofree char *path = g_strdup_printf("%s/qtest-s32k3-fuzz-%d.sock",
+                                            g_get_tmp_dir(), getpid());
+    /* 'A' on LPUART0 after 10 us */
+    static const uint8_t input[] = { 0, 'A', 10, 0 };
+    QTestState *qts;
+    uint8_t magic[4];
+    int server, fd;
+
+    server = qtest_socket_server(path);
+    qts = qtest_initf("-M s32k3x8evb,snapshot-at=%d,fuzz-budget=%d "
+                      "-chardev socket,id=fuzz,path=%s",
+                      SNAPSHOT_AT, BUDGET, path);
+    fd = accept(server, NULL, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(server);
+    unlink(path);
+
+    qtest_writel(qts, LPUART_BASE + CTRL, CTRL_RE);
+
+    qtest_clock_step(qts, SNAPSHOT_AT);
+    recv_all(fd, magic, sizeof(magic));
+    g_assert_cmphex(ldl_le_p(magic), ==, FUZZ_READY);
+
+    g_assert_cmpuint(run_input(qts, fd, input, sizeof(input)), ==, 0);
+    g_assert_true(qtest_readl(qts, LPUART_BASE + STAT) & STAT_RDRF);
+
+    /* The next input starts from the snapshot, where the FIFO was empty */
+    g_assert_cmpuint(run_input(qts, fd, NULL, 0), ==, 0);
+    g_assert_false(qtest_readl(qts, LPUART_BASE + STAT) & STAT_RDRF);
+
+    close(fd);
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("s32k3-fuzz/input", test_input);
+
+    return g_test_run();
+}
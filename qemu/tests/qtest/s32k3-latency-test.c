@@ -0,0 +1,123 @@
+/*
+ * QTest testcase for the interrupt latency statistics of the s32k3x8evb
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+/* The firmware runs from core 0's ITCM, with its stack in the DTCM */
+#define ITCM_BASE 0x00000000
+#define CODE_BASE 0x00000200
+#define STACK_TOP 0x20001000
+#define COUNTER 0x20000800
+
+#define IRQ 30
+#define PENDSV 14
+
+/*
+ * With interrupts masked, pend IRQ 30 (ISPR) and PendSV (ICSR), clear
+ * both (ICPR, ICSR), wait 100000 instructions, pend them again and take
+ * them. The handler counts the exceptions taken.
+ */
+static const uint8_t code[] = {
+    0x4e, 0xf2, 0x00, 0x10,     /* movw r0, #0xe100 */
+    0xce, 0xf2, 0x00, 0x00,     /* movt r0, #0xe000         @ NVIC_ISER0 */
+    0x4e, 0xf6, 0x04, 0x53,     /* movw r3, #0xed04 */
+    0xce, 0xf2, 0x00, 0x03,     /* movt r3, #0xe000         @ ICSR */
+    0x01, 0x24,                 /* movs r4, #1 */
+    0xa1, 0x07,                 /* lsls r1, r4, #30         @ IRQ 30 */
+    0x25, 0x07,                 /* lsls r5, r4, #28         @ PENDSVSET */
+    0xe6, 0x06,                 /* lsls r6, r4, #27         @ PENDSVCLR */
+    0x72, 0xb6,                 /* cpsid i */
+    0x01, 0x60,                 /* str r1, [r0]             @ enable */
+    0xc0, 0xf8, 0x00, 0x11,     /* str.w r1, [r0, #0x100]   @ pend */
+    0x1d, 0x60,                 /* str r5, [r3] */
+    0xc0, 0xf8, 0x80, 0x11,     /* str.w r1, [r0, #0x180]   @ clear */
+    0x1e, 0x60,                 /* str r6, [r3] */
+    0x4c, 0xf2, 0x50, 0x32,     /* movw r2, #50000 */
+    0x01, 0x3a,                 /* 1: subs r2, #1 */
+    0xfd, 0xd1,                 /* bne 1b */
+    0xc0, 0xf8, 0x00, 0x11,     /* str.w r1, [r0, #0x100]   @ pend */
+    0x1d, 0x60,                 /* str r5, [r3] */
+    0x62, 0xb6,                 /* cpsie i                  @ take */
+    0xfe, 0xe7,                 /* 2: b 2b */
+    /* handler, at CODE_BASE + 0x3a */
+    0x40, 0xf6, 0x00, 0x00,     /* movw r0, #0x0800 */
+    0xc2, 0xf2, 0x00, 0x00,     /* movt r0, #0x2000         @ COUNTER */
+    0x01, 0x68,                 /* ldr r1, [r0] */
+    0x01, 0x31,                 /* adds r1, #1 */
+    0x01, 0x60,                 /* str r1, [r0] */
+    0x70, 0x47,                 /* bx lr */
+};
+#define HANDLER (CODE_BASE + 0x3a)
+
+/* Maximum latency of an exception, from the report printed at exit */
+static uint64_t report_max_latency(const char *report, const char *name)
+{
+    g_autofree char *prefix = g_strdup_printf("\n%s, latency ns, ", name);
+    const char *line = strstr(report, prefix);
+    uint64_t count, min, avg, p99, max;
+
+    g_assert_nonnull(line);
+    g_assert_cmpint(sscanf(line + strlen(prefix),
+                           "%" SCNu64 ", %" SCNu64 ", %" SCNu64 ", %" SCNu64
+                           ", %" SCNu64, &count, &min, &avg, &p99, &max), ==, 5);
+    g_assert_cmpuint(count, ==, 1);
+    return max;
+}
+
+static void test_cleared_pend(void)
+{
+    g_autofree char *path = NULL;
+    g_autofree char *report = NULL;
+    QTestState *qts;
+    int fd;
+
+    if (!qtest_has_accel("tcg")) {
+        g_test_skip("TCG is needed to run the firmware");
+        return;
+    }
+
+    fd = g_file_open_tmp("qtest-s32k3-latency-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    /* The report goes to stdout when QEMU exits; with icount, 1 ns per instruction */
+    qts = qtest_initf("-M s32k3x8evb,irq-latency=on -accel tcg -icount shift=0 "
+                      "-S > %s", path);
+
+    qtest_writel(qts, ITCM_BASE, STACK_TOP);
+    qtest_writel(qts, ITCM_BASE + 4, CODE_BASE | 1);
+    qtest_writel(qts, ITCM_BASE + PENDSV * 4, HANDLER | 1);
+    qtest_writel(qts, ITCM_BASE + (16 + IRQ) * 4, HANDLER | 1);
+    qtest_memwrite(qts, CODE_BASE, code, sizeof(code));
+
+    /* The core reads its vector table again on reset */
+    qtest_qmp_assert_success(qts, "{ 'execute': 'system_reset' }");
+    qtest_qmp_eventwait(qts, "RESET");
+    qtest_qmp_assert_success(qts, "{ 'execute': 'cont' }");
+
+    while (qtest_readl(qts, COUNTER) < 2) {
+        g_usleep(1000);
+    }
+    qtest_quit(qts);
+
+    g_assert_true(g_file_get_contents(path, &report, NULL, NULL));
+    unlink(path);
+
+    /* Measured from the second pend, not from the one that was cleared */
+    g_assert_cmpuint(report_max_latency(report, "PendSV"), <, 1000);
+    g_assert_cmpuint(report_max_latency(report, "IRQ 30"), <, 1000);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("s32k3-latency/cleared-pend", test_cleared_pend);
+
+    return g_test_run();
+}
@@ -0,0 +1,224 @@
+/*
+ * QTest testcase for the NXP S32K3 LPUART
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+/* LPUART0 of the s32k3x8evb, connected to the first serial port */
+#define LPUART_BASE 0x4006A000
+#define LPUART_IRQ 0
+
+/* LPUART3, which has no serial port: realized on its first access */
+#define LPUART3_BASE (LPUART_BASE + 3 * 0x1000)
+#define LPUART3_IRQ 3
+
+#define GLOBAL 0x08
+#define BAUD 0x10
+#define STAT 0x14
+#define CTRL 0x18
+#define DATA 0x1C
+#define FIFO 0x28
+#define WATER 0x2C
+
+#define STAT_TDRE (1 << 23)
+#define STAT_TC (1 << 22)
+#define STAT_RDRF (1 << 21)
+#define CTRL_TIE (1 << 23)
+#define CTRL_RIE (1 << 21)
+#define CTRL_TE (1 << 19)
+#define CTRL_RE (1 << 18)
+#define DATA_RXEMPT (1 << 12)
+#define FIFO_RXFE (1 << 3)
+#define FIFO_TXFE (1 << 7)
+#define FIFO_RXEMPT (1 << 22)
+#define FIFO_TXEMPT (1 << 23)
+#define WATER_RXCOUNT(w) (((w) >> 24) & 0x1f)
+
+#define NVIC_ISPR0 0xE000E200
+#define NVIC_ICPR0 0xE000E280
+
+static bool check_nvic_pending(QTestState *qts, unsigned int n)
+{
+    return qtest_readl(qts, NVIC_ISPR0) & (1 << n);
+}
+
+/*
+ * Wait indefinitely for the flag to be updated.
+ * If this is run on a slow CI runner,
+ * the meson harness will timeout after 10 minutes for us.
+ */
+static void lpuart_wait_for_flag(QTestState *qts, uint32_t addr,
+                                 uint32_t flag)
+{
+    while (!(qtest_readl(qts, addr) & flag)) {
+        g_usleep(1000);
+    }
+}
+
+static void init_uart(QTestState *qts)
+{
+    /* 80 MHz / (16 * 43): about 115200 baud */
+    qtest_writel(qts, LPUART_BASE + BAUD, (15 << 24) | 43);
+    qtest_writel(qts, LPUART_BASE + FIFO, FIFO_TXFE | FIFO_RXFE);
+    qtest_writel(qts, LPUART_BASE + CTRL, CTRL_TE | CTRL_RE);
+}
+
+/* The FIFO may reach the backend in more than one write */
+static void recv_all(int sock_fd, char *buf, size_t len)
+{
+    size_t got = 0;
+    ssize_t ret;
+
+    while (got < len) {
+        ret = recv(sock_fd, buf + got, len - got, 0);
+        g_assert_cmpint(ret, >, 0);
+        got += ret;
+    }
+}
+
+static void test_reset(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    g_assert_cmphex(qtest_readl(qts, LPUART_BASE + BAUD), ==, 0x0F000004);
+    g_assert_cmphex(qtest_readl(qts, LPUART_BASE + STAT), ==,
+                    STAT_TDRE | STAT_TC);
+    g_assert_cmphex(qtest_readl(qts, LPUART_BASE + FIFO), ==,
+                    FIFO_TXEMPT | FIFO_RXEMPT | 0x33);
+    g_assert_cmphex(qtest_readl(qts, LPUART_BASE + DATA), ==, DATA_RXEMPT);
+
+    qtest_quit(qts);
+}
+
+static void test_send_str(void)
+{
+    int sock_fd;
+    char s[17];
+    QTestState *qts = qtest_init_with_serial("-M s32k3x8evb", &sock_fd);
+    const char *str = "hello, lpuart!\r\n";
+    int i;
+
+    init_uart(qts);
+
+    /* A whole FIFO worth of data fits without waiting on TDRE */
+    qtest_writel(qts, LPUART_BASE + WATER, 15);
+    for (i = 0; i < 16; i++) {
+        g_assert_true(qtest_readl(qts, LPUART_BASE + STAT) & STAT_TDRE);
+        qtest_writel(qts, LPUART_BASE + DATA, str[i]);
+    }
+    recv_all(sock_fd, s, 16);
+    s[16] = '\0';
+    g_assert_cmpstr(s, ==, str);
+
+    lpuart_wait_for_flag(qts, LPUART_BASE + STAT, STAT_TC);
+    g_assert_false(check_nvic_pending(qts, LPUART_IRQ));
+
+    close(sock_fd);
+    qtest_quit(qts);
+}
+
+static void test_receive_str(void)
+{
+    int sock_fd;
+    char s[6];
+    QTestState *qts = qtest_init_with_serial("-M s32k3x8evb", &sock_fd);
+    int i;
+
+    init_uart(qts);
+
+    /* With RXWATER at 0, RDRF and the interrupt follow the first byte */
+    qtest_writel(qts, LPUART_BASE + CTRL, CTRL_TE | CTRL_RE | CTRL_RIE);
+    g_assert_true(send(sock_fd, "world", 5, 0) == 5);
+    lpuart_wait_for_flag(qts, LPUART_BASE + STAT, STAT_RDRF);
+    g_assert_true(check_nvic_pending(qts, LPUART_IRQ));
+
+    /* The rest of the burst is queued in the RX FIFO */
+    while (WATER_RXCOUNT(qtest_readl(qts, LPUART_BASE + WATER)) < 5) {
+        g_usleep(1000);
+    }
+    for (i = 0; i < 5; i++) {
+        s[i] = qtest_readl(qts, LPUART_BASE + DATA);
+    }
+    s[5] = '\0';
+    g_assert_cmpstr(s, ==, "world");
+
+    g_assert_false(qtest_readl(qts, LPUART_BASE + STAT) & STAT_RDRF);
+    g_assert_cmphex(qtest_readl(qts, LPUART_BASE + DATA), ==, DATA_RXEMPT);
+    qtest_writel(qts, NVIC_ICPR0, 1 << LPUART_IRQ);
+    g_assert_false(check_nvic_pending(qts, LPUART_IRQ));
+
+    close(sock_fd);
+    qtest_quit(qts);
+}
+
+static void test_tx_interrupt(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    init_uart(qts);
+
+    /* TDRE is set with an empty FIFO, so TIE raises the line at once */
+    qtest_writel(qts, LPUART_BASE + CTRL, CTRL_TE | CTRL_RE | CTRL_TIE);
+    g_assert_true(check_nvic_pending(qts, LPUART_IRQ));
+
+    qtest_writel(qts, LPUART_BASE + CTRL, CTRL_TE | CTRL_RE);
+    qtest_writel(qts, NVIC_ICPR0, 1 << LPUART_IRQ);
+    g_assert_false(check_nvic_pending(qts, LPUART_IRQ));
+
+    qtest_quit(qts);
+}
+
+static void test_tx_disabled(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    init_uart(qts);
+
+    /* DATA writes are dropped while the transmitter is disabled */
+    qtest_writel(qts, LPUART_BASE + CTRL, CTRL_RE);
+    qtest_writel(qts, LPUART_BASE + DATA, 'x');
+    g_assert_true(qtest_readl(qts, LPUART_BASE + FIFO) & FIFO_TXEMPT);
+    g_assert_cmphex(qtest_readl(qts, LPUART_BASE + WATER) & 0x1f00, ==, 0);
+
+    /* The software reset returns every register to its reset value */
+    qtest_writel(qts, LPUART_BASE + GLOBAL, 2);
+    qtest_writel(qts, LPUART_BASE + GLOBAL, 0);
+    g_assert_cmphex(qtest_readl(qts, LPUART_BASE + BAUD), ==, 0x0F000004);
+    g_assert_cmphex(qtest_readl(qts, LPUART_BASE + CTRL), ==, 0);
+
+    qtest_quit(qts);
+}
+
+static void test_lazy(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    /* The access that realizes the device already sees its registers */
+    g_assert_cmphex(qtest_readl(qts, LPUART3_BASE + BAUD), ==, 0x0F000004);
+    g_assert_cmphex(qtest_readl(qts, LPUART3_BASE + CTRL), ==, 0);
+
+    /* Its interrupt line is connected */
+    qtest_writel(qts, LPUART3_BASE + CTRL, CTRL_TE | CTRL_TIE);
+    g_assert_true(check_nvic_pending(qts, LPUART3_IRQ));
+    g_assert_cmphex(qtest_readl(qts, LPUART3_BASE + CTRL), ==, CTRL_TE | CTRL_TIE);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("s32k3-lpuart/reset", test_reset);
+    qtest_add_func("s32k3-lpuart/send_str", test_send_str);
+    qtest_add_func("s32k3-lpuart/receive_str", test_receive_str);
+    qtest_add_func("s32k3-lpuart/tx_interrupt", test_tx_interrupt);
+    qtest_add_func("s32k3-lpuart/tx_disabled", test_tx_disabled);
+    qtest_add_func("s32k3-lpuart/lazy", test_lazy);
+
+    return g_test_run();
+}
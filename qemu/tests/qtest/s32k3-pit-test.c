@@ -0,0 +1,169 @@
+/*
+ * QTest testcase for the NXP S32K3 PIT
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+/* PIT0 of the s32k3x8evb; driven at 40MHz by AIPS_SLOW_CLK, 25ns per tick */
+#define PIT_BASE 0x40037000
+#define PIT_IRQ 8
+#define TICK_NS 25
+
+#define MCR 0x0
+#define LTMR64H 0xe0
+#define LTMR64L 0xe4
+#define LDVAL(n) (0x100 + (n) * 0x10)
+#define CVAL(n) (0x104 + (n) * 0x10)
+#define TCTRL(n) (0x108 + (n) * 0x10)
+#define TFLG(n) (0x10c + (n) * 0x10)
+
+#define TCTRL_TEN 1
+#define TCTRL_TIE 2
+#define TCTRL_CHN 4
+
+#define NVIC_ISPR0 0xE000E200
+#define NVIC_ICPR0 0xE000E280
+
+static bool check_nvic_pending(QTestState *qts, unsigned int n)
+{
+    return qtest_readl(qts, NVIC_ISPR0) & (1 << n);
+}
+
+static void test_reset(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    /* The module comes out of reset disabled */
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + MCR), ==, 0x6);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TCTRL(0)), ==, 0);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TFLG(0)), ==, 0);
+
+    /* Nothing counts while MCR.MDIS is set */
+    qtest_writel(qts, PIT_BASE + LDVAL(0), 1000);
+    qtest_writel(qts, PIT_BASE + TCTRL(0), TCTRL_TEN);
+    qtest_clock_step(qts, TICK_NS * 100);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + CVAL(0)), ==, 1000);
+
+    qtest_quit(qts);
+}
+
+static void test_periodic(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    qtest_writel(qts, PIT_BASE + MCR, 0);
+
+    /* Period is LDVAL + 1 ticks: fires after 25 * 1000 == 25000 ns */
+    qtest_writel(qts, PIT_BASE + LDVAL(0), 999);
+    qtest_writel(qts, PIT_BASE + TCTRL(0), TCTRL_TIE | TCTRL_TEN);
+
+    qtest_clock_step(qts, TICK_NS * 500);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + CVAL(0)), ==, 499);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TFLG(0)), ==, 0);
+    g_assert_false(check_nvic_pending(qts, PIT_IRQ));
+
+    qtest_clock_step(qts, TICK_NS * 500);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + CVAL(0)), ==, 999);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TFLG(0)), ==, 1);
+    g_assert_true(check_nvic_pending(qts, PIT_IRQ));
+
+    /* TIF is W1C; the line stays low until the next expiry */
+    qtest_writel(qts, PIT_BASE + TFLG(0), 1);
+    qtest_writel(qts, NVIC_ICPR0, 1 << PIT_IRQ);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TFLG(0)), ==, 0);
+    g_assert_false(check_nvic_pending(qts, PIT_IRQ));
+
+    qtest_clock_step(qts, TICK_NS * 999);
+    g_assert_false(check_nvic_pending(qts, PIT_IRQ));
+    qtest_clock_step(qts, TICK_NS);
+    g_assert_true(check_nvic_pending(qts, PIT_IRQ));
+
+    /* A new LDVAL only takes effect at the next reload */
+    qtest_writel(qts, PIT_BASE + TFLG(0), 1);
+    qtest_writel(qts, PIT_BASE + LDVAL(0), 99);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + CVAL(0)), ==, 999);
+    qtest_clock_step(qts, TICK_NS * 1000);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + CVAL(0)), ==, 99);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TFLG(0)), ==, 1);
+
+    qtest_quit(qts);
+}
+
+static void test_channels(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    qtest_writel(qts, PIT_BASE + MCR, 0);
+
+    /* Two independent channels on the same module */
+    qtest_writel(qts, PIT_BASE + LDVAL(2), 299);
+    qtest_writel(qts, PIT_BASE + LDVAL(3), 99);
+    qtest_writel(qts, PIT_BASE + TCTRL(2), TCTRL_TIE | TCTRL_TEN);
+    qtest_writel(qts, PIT_BASE + TCTRL(3), TCTRL_TEN);
+
+    /* Channel 3 has no TIE: its flag sets but the line stays low */
+    qtest_clock_step(qts, TICK_NS * 100);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TFLG(3)), ==, 1);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TFLG(2)), ==, 0);
+    g_assert_false(check_nvic_pending(qts, PIT_IRQ));
+
+    qtest_clock_step(qts, TICK_NS * 200);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TFLG(2)), ==, 1);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + CVAL(3)), ==, 99);
+    g_assert_true(check_nvic_pending(qts, PIT_IRQ));
+
+    qtest_quit(qts);
+}
+
+static void test_lifetime(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    qtest_writel(qts, PIT_BASE + MCR, 0);
+
+    /* Channel 1 chained to channel 0 forms the 64-bit lifetime timer */
+    qtest_writel(qts, PIT_BASE + LDVAL(1), 0xffffffff);
+    qtest_writel(qts, PIT_BASE + TCTRL(1), TCTRL_CHN | TCTRL_TEN);
+    qtest_writel(qts, PIT_BASE + LDVAL(0), 9);
+    qtest_writel(qts, PIT_BASE + TCTRL(0), TCTRL_TEN);
+
+    /* 25 ticks: channel 0 has wrapped twice and sits at 4 */
+    qtest_clock_step(qts, TICK_NS * 25);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + LTMR64H), ==, 0xfffffffd);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + LTMR64L), ==, 4);
+
+    /* LTMR64L holds the value latched by the last LTMR64H read */
+    qtest_clock_step(qts, TICK_NS * 3);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + LTMR64L), ==, 4);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + CVAL(0)), ==, 1);
+
+    /* A chained channel with TIE interrupts on its own expiry */
+    qtest_writel(qts, PIT_BASE + TCTRL(0), 0);
+    qtest_writel(qts, PIT_BASE + TCTRL(1), 0);
+    qtest_writel(qts, PIT_BASE + LDVAL(1), 2);
+    qtest_writel(qts, PIT_BASE + TCTRL(1), TCTRL_CHN | TCTRL_TIE | TCTRL_TEN);
+    qtest_writel(qts, PIT_BASE + TCTRL(0), TCTRL_TEN);
+    qtest_clock_step(qts, TICK_NS * 29);
+    g_assert_false(check_nvic_pending(qts, PIT_IRQ));
+    qtest_clock_step(qts, TICK_NS);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + TFLG(1)), ==, 1);
+    g_assert_true(check_nvic_pending(qts, PIT_IRQ));
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("s32k3-pit/reset", test_reset);
+    qtest_add_func("s32k3-pit/periodic", test_periodic);
+    qtest_add_func("s32k3-pit/channels", test_channels);
+    qtest_add_func("s32k3-pit/lifetime", test_lifetime);
+
+    return g_test_run();
+}
@@ -0,0 +1,131 @@
+/*
+ * QTest testcase for the in-memory snapshot of the s32k3x8evb
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+
+/* SRAM0 and the DTCM of core 0, through its backdoor */
+#define SRAM0_BASE 0x20410000
+#define DTCM0_BASE 0x21000000
+
+/* PIT0, whose channel registers are part of the device state */
+#define PIT_BASE 0x40037000
+#define LDVAL(n) (0x100 + (n) * 0x10)
+
+/* LPUART5, only realized by the first access of the guest */
+#define LPUART5_BASE (0x4006A000 + 5 * 0x1000)
+#define CTRL 0x18
+#define CTRL_RE (1 << 18)
+
+static QDict *snapshot_restore(QTestState *qts)
+{
+    return qtest_qmp_assert_success_ref(qts,
+        "{ 'execute': 'x-s32k3x8-snapshot-restore' }");
+}
+
+static void test_restore(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+    QDict *ret;
+
+    qtest_writel(qts, SRAM0_BASE, 0x11111111);
+    qtest_writel(qts, SRAM0_BASE + 0x8000, 0x22222222);
+    qtest_writel(qts, DTCM0_BASE + 0x100, 0x33333333);
+    qtest_writel(qts, PIT_BASE + LDVAL(0), 1000);
+
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-s32k3x8-snapshot-save' }");
+
+    /* Two pages of RAM and a register change after the snapshot */
+    qtest_writel(qts, SRAM0_BASE, 0xdeadbeef);
+    qtest_writel(qts, SRAM0_BASE + 4, 0xdeadbeef);
+    qtest_writel(qts, DTCM0_BASE + 0x100, 0xdeadbeef);
+    qtest_writel(qts, PIT_BASE + LDVAL(0), 2000);
+
+    ret = snapshot_restore(qts);
+    g_assert_cmpint(qdict_get_int(ret, "dirty-pages"), ==, 2);
+    g_assert_cmpint(qdict_get_int(ret, "device-bytes"), >, 0);
+    qobject_unref(ret);
+
+    g_assert_cmphex(qtest_readl(qts, SRAM0_BASE), ==, 0x11111111);
+    g_assert_cmphex(qtest_readl(qts, SRAM0_BASE + 4), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, SRAM0_BASE + 0x8000), ==, 0x22222222);
+    g_assert_cmphex(qtest_readl(qts, DTCM0_BASE + 0x100), ==, 0x33333333);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + LDVAL(0)), ==, 1000);
+
+    /* Nothing was written since the last rewind */
+    ret = snapshot_restore(qts);
+    g_assert_cmpint(qdict_get_int(ret, "dirty-pages"), ==, 0);
+    qobject_unref(ret);
+
+    qtest_quit(qts);
+}
+
+static void test_no_snapshot(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+    QDict *resp;
+
+    resp = qtest_qmp(qts, "{ 'execute': 'x-s32k3x8-snapshot-restore' }");
+    g_assert(qdict_haskey(resp, "error"));
+    qobject_unref(resp);
+
+    qtest_quit(qts);
+}
+
+static void test_rewind_on_reset(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb,rewind-on-reset=on");
+
+    qtest_writel(qts, SRAM0_BASE, 0x11111111);
+    qtest_writel(qts, PIT_BASE + LDVAL(1), 1000);
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-s32k3x8-snapshot-save' }");
+
+    qtest_writel(qts, SRAM0_BASE, 0xdeadbeef);
+    qtest_writel(qts, PIT_BASE + LDVAL(1), 2000);
+
+    qtest_qmp_assert_success(qts, "{ 'execute': 'system_reset' }");
+    qtest_qmp_eventwait(qts, "RESET");
+
+    g_assert_cmphex(qtest_readl(qts, SRAM0_BASE), ==, 0x11111111);
+    g_assert_cmpuint(qtest_readl(qts, PIT_BASE + LDVAL(1)), ==, 1000);
+
+    qtest_quit(qts);
+}
+
+static void test_lazy_device(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-s32k3x8-snapshot-save' }");
+
+    /* Realized after the snapshot, which has no state for it */
+    qtest_writel(qts, LPUART5_BASE + CTRL, CTRL_RE);
+    qobject_unref(snapshot_restore(qts));
+    g_assert_cmphex(qtest_readl(qts, LPUART5_BASE + CTRL), ==, 0);
+
+    /* Saved with the others by the next snapshot */
+    qtest_writel(qts, LPUART5_BASE + CTRL, CTRL_RE);
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-s32k3x8-snapshot-save' }");
+    qtest_writel(qts, LPUART5_BASE + CTRL, 0);
+    qobject_unref(snapshot_restore(qts));
+    g_assert_cmphex(qtest_readl(qts, LPUART5_BASE + CTRL), ==, CTRL_RE);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("s32k3-snapshot/restore", test_restore);
+    qtest_add_func("s32k3-snapshot/no-snapshot", test_no_snapshot);
+    qtest_add_func("s32k3-snapshot/rewind-on-reset", test_rewind_on_reset);
+    qtest_add_func("s32k3-snapshot/lazy-device", test_lazy_device);
+
+    return g_test_run();
+}
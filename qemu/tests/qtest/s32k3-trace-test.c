@@ -0,0 +1,100 @@
+/*
+ * QTest testcase for the DWT and ITM of the s32k3x8evb cores
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+/* DWT of core 0; CYCCNT counts CORE_CLK, 240MHz on the S32K358 */
+#define DWT_BASE 0xE0001000
+#define CYCLES_PER_US 240
+
+#define DWT_CTRL 0x0
+#define DWT_CYCCNT 0x4
+#define DWT_CTRL_CYCCNTENA 1
+
+/* ITM of core 0, whose trace goes to the chardev "itm0" */
+#define ITM_BASE 0xE0000000
+#define ITM_STIM(n) ((n) * 4)
+#define ITM_TER 0xE00
+#define ITM_TCR 0xE80
+#define ITM_TCR_ITMENA 1
+
+static void test_dwt_cyccnt(void)
+{
+    QTestState *qts = qtest_init("-M s32k3x8evb");
+
+    /* Out of reset the counter is stopped, and keeps its value */
+    g_assert_cmphex(qtest_readl(qts, DWT_BASE + DWT_CTRL), ==, 0);
+    qtest_writel(qts, DWT_BASE + DWT_CYCCNT, 1000);
+    qtest_clock_step(qts, 1000);
+    g_assert_cmpuint(qtest_readl(qts, DWT_BASE + DWT_CYCCNT), ==, 1000);
+
+    /* Enabled, it counts the core clock from the value written */
+    qtest_writel(qts, DWT_BASE + DWT_CTRL, DWT_CTRL_CYCCNTENA);
+    g_assert_cmphex(qtest_readl(qts, DWT_BASE + DWT_CTRL), ==, DWT_CTRL_CYCCNTENA);
+    qtest_clock_step(qts, 1000);
+    g_assert_cmpuint(qtest_readl(qts, DWT_BASE + DWT_CYCCNT), ==, 1000 + CYCLES_PER_US);
+
+    /* Disabled again, it stops where it was */
+    qtest_writel(qts, DWT_BASE + DWT_CTRL, 0);
+    qtest_clock_step(qts, 1000);
+    g_assert_cmpuint(qtest_readl(qts, DWT_BASE + DWT_CYCCNT), ==, 1000 + CYCLES_PER_US);
+
+    qtest_quit(qts);
+}
+
+static void test_itm_stimulus(void)
+{
+    /* Port 0 byte 'A', then port 5 word 0x12345678 */
+    static const uint8_t expected[] = {
+        0x01, 'A',
+        0x2b, 0x78, 0x56, 0x34, 0x12,
+    };
+    g_autofree char *path = NULL;
+    g_autofree char *trace = NULL;
+    QTestState *qts;
+    gsize len;
+    int fd;
+
+    fd = g_file_open_tmp("qtest-s32k3-itm-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    qts = qtest_initf("-M s32k3x8evb -chardev file,id=itm0,path=%s", path);
+
+    /* Disabled, the ports are not ready and the writes are dropped */
+    g_assert_cmphex(qtest_readl(qts, ITM_BASE + ITM_STIM(0)), ==, 0);
+    qtest_writeb(qts, ITM_BASE + ITM_STIM(0), 'X');
+
+    qtest_writel(qts, ITM_BASE + ITM_TER, (1 << 0) | (1 << 5));
+    g_assert_cmphex(qtest_readl(qts, ITM_BASE + ITM_TER), ==, (1 << 0) | (1 << 5));
+    qtest_writel(qts, ITM_BASE + ITM_TCR, ITM_TCR_ITMENA);
+    g_assert_cmphex(qtest_readl(qts, ITM_BASE + ITM_TCR), ==, ITM_TCR_ITMENA);
+    g_assert_cmphex(qtest_readl(qts, ITM_BASE + ITM_STIM(0)), ==, 1);
+
+    qtest_writeb(qts, ITM_BASE + ITM_STIM(0), 'A');
+    qtest_writel(qts, ITM_BASE + ITM_STIM(1), 0xdeadbeef);    /* Not enabled in TER */
+    qtest_writel(qts, ITM_BASE + ITM_STIM(5), 0x12345678);
+
+    /* Disabling the ITM sends the packets it holds */
+    qtest_writel(qts, ITM_BASE + ITM_TCR, 0);
+    g_assert_true(g_file_get_contents(path, &trace, &len, NULL));
+    g_assert_cmpmem(trace, len, expected, sizeof(expected));
+
+    qtest_quit(qts);
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("s32k3-trace/dwt-cyccnt", test_dwt_cyccnt);
+    qtest_add_func("s32k3-trace/itm-stimulus", test_itm_stimulus);
+
+    return g_test_run();
+}
@@ -0,0 +1,70 @@
+/*
+ * QTest testcase for the variants of the S32K3 family machines
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+/* Last SRAM block of the smaller parts, and the first one they lack */
+#define SRAM0_BASE 0x20410000
+#define SRAM1_BASE 0x20440000
+
+/* LPUART4, the first one the S32K311 lacks */
+#define LPUART4_BASE (0x4006A000 + 4 * 0x1000)
+#define CTRL 0x18
+#define CTRL_RE (1 << 18)
+
+/* PIT2, which the S32K311 lacks */
+#define PIT2_BASE 0x40039000
+#define LDVAL(n) (0x100 + (n) * 0x10)
+
+typedef struct VariantTest {
+    const char *machine;
+    bool has_sram1;
+    bool has_lpuart4;
+    bool has_pit2;
+} VariantTest;
+
+static const VariantTest variants[] = {
+    { "s32k311evb", false, false, false },
+    { "s32k344evb", true, true, true },
+    { "s32k3x8evb", true, true, true },
+    { "s32k358evb", true, true, true },
+    { "s32k388evb", true, true, true },
+};
+
+/* What is absent reads as 0, and ignores the writes */
+static void check_present(QTestState *qts, uint64_t addr, uint32_t value, bool present)
+{
+    qtest_writel(qts, addr, value);
+    g_assert_cmphex(qtest_readl(qts, addr), ==, present ? value : 0);
+}
+
+static void test_variant(const void *data)
+{
+    const VariantTest *t = data;
+    QTestState *qts = qtest_initf("-M %s", t->machine);
+
+    check_present(qts, SRAM0_BASE, 0x11111111, true);
+    check_present(qts, SRAM1_BASE, 0x22222222, t->has_sram1);
+    check_present(qts, LPUART4_BASE + CTRL, CTRL_RE, t->has_lpuart4);
+    check_present(qts, PIT2_BASE + LDVAL(0), 1000, t->has_pit2);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    for (int i = 0; i < ARRAY_SIZE(variants); i++) {
+        g_autofree char *path = g_strdup_printf("s32k3-variant/%s", variants[i].machine);
+
+        qtest_add_data_func(path, &variants[i], test_variant);
+    }
+
+    return g_test_run();
+}